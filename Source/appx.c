@@ -55,8 +55,22 @@
 #include <dos/dostags.h>
 #include <dos/rdargs.h>
 #include <string.h>
-#include <stdlib.h>
-#include <stdio.h>
+#ifdef APPX_PROFILE
+#include <devices/timer.h>
+#include <proto/timer.h>
+#endif
+
+#ifdef MEMTRACK
+/* Memory accounting build (smake memtrack) */
+#define MEMTRACK_FILE         "T:AppX.memory"
+#define MEMTRACK_PEAK_BUDGET  32768         /* Bytes, leaves room for the tool on 2 MB machines */
+#define MEMTRACK_STACK_BUDGET 3072          /* Bytes, of the 4096 asked for by $STACK */
+#include "memtrack.h"
+#else
+#define MEMTRACK_BEGIN()
+#define MEMTRACK_PHASE(name)
+#define MEMTRACK_DUMP()
+#endif
 
 /* Library base pointers */
 extern struct ExecBase *SysBase;
@@ -75,6 +89,61 @@ struct ClassLibrary *RequesterBase = NULL;
 /* Reaction class handles */
 Class *RequesterClass = NULL;
 
+/* Bulk toolbox conversion - BULK=<drawer> converts every program drawer below it */
+#define BULK_REPORT_FILE "T:AppX.report"
+#define BULK_MAX_DEPTH   3                  /* Drawer levels searched below the root */
+#define BULK_EXALL_SIZE  2048
+#define BULK_MAX_TOOLS   8                  /* Tool icons looked at per drawer */
+
+/* How a drawer's tool was picked */
+#define BULK_NONE      0                    /* No tool icon */
+#define BULK_SINGLE    1                    /* The only tool icon in the drawer */
+#define BULK_NAMED     2                    /* One of several, named like the drawer */
+#define BULK_AMBIGUOUS 3                    /* Several, none named like the drawer */
+
+/* One bulk run, allocated rather than on the 4 KB stack */
+struct BulkState {
+    BPTR bs_Report;
+    BOOL bs_DryRun;
+    BOOL bs_CopyImage;
+    ULONG bs_Drawers;                       /* Program drawer candidates examined */
+    ULONG bs_Converted;
+    ULONG bs_Failed;
+    ULONG bs_Skipped;
+    UBYTE bs_Path[512];                     /* Drawer being walked, grows and shrinks with the walk */
+    UBYTE bs_Header[64];                    /* Icon header, reused for every icon */
+    UBYTE bs_Tools[BULK_MAX_TOOLS][108];    /* Tool icons found in the current drawer */
+};
+
+/* Restore watcher - one process restores every drawer opened with Right Shift */
+#define RESTORE_PORT         "AppX.restore"
+#define RESTORE_TICKS        10             /* Watcher loop period, 100 ms */
+#define RESTORE_WAIT_CHECKS  50             /* Loops to wait for the icon to be released, 5 seconds */
+#define RESTORE_OPEN_TICKS   5              /* Loops between checks of an open drawer, 500 ms */
+#define RESTORE_OPEN_CHECKS  600            /* Checks before restoring a drawer left open */
+
+/* Restore states */
+#define RESTORE_WAITING 0                   /* Icon still in use by the spawning AppX */
+#define RESTORE_OPEN    1                   /* Opened as a drawer, waiting for it to close */
+#define RESTORE_DONE    2                   /* Restored or failed, to be freed */
+
+/* One drawer waiting for its project icon to be restored */
+struct RestoreDrawer {
+    struct MinNode rd_Node;
+    UBYTE rd_State;
+    LONG rd_Checks;
+    LONG rd_OriginalType;                   /* Icon type to put back */
+    UBYTE rd_Path[512];
+    UBYTE rd_IconPath[512];
+};
+
+/* Sent to the watcher by a later AppX DRAWER=, which waits for the reply */
+struct RestoreRequest {
+    struct Message rq_Message;
+    STRPTR rq_Path;
+    BOOL rq_Accepted;                       /* Set by the watcher before replying */
+};
+
 /* Forward declarations */
 BOOL InitializeLibraries(VOID);
 BOOL InitializeApplication(VOID);
@@ -82,11 +151,264 @@ VOID Cleanup(VOID);
 VOID ShowErrorDialog(STRPTR title, STRPTR message);
 BOOL ShowConfirmDialog(STRPTR fileName, STRPTR toolName);
 BOOL OpenToolboxDrawer(STRPTR fileName, BPTR fileLock);
-BOOL IsDirectory(STRPTR fileName, BPTR fileLock);
+STRPTR GetLockPath(BPTR lock);
 STRPTR GetToolTypeValue(struct DiskObject *icon, STRPTR toolTypeName);
 BOOL IsLeftAmigaHeld(VOID);
 BOOL HandleDrawerMode(STRPTR drawerPath);
+BOOL SendRestoreRequest(STRPTR drawerPath);
+struct RestoreDrawer *NewRestoreDrawer(STRPTR drawerPath);
+BOOL RunRestoreWatcher(struct RestoreDrawer *first);
+BOOL IsIconFree(struct RestoreDrawer *drawer);
+BOOL SetIconType(struct RestoreDrawer *drawer, LONG type);
+BOOL OpenRestoreDrawer(struct RestoreDrawer *drawer);
+BOOL IsDrawerOpen(struct RestoreDrawer *drawer);
 BOOL MakeToolboxDrawer(STRPTR drawerPath, STRPTR toolName, BOOL copyImage);
+STRPTR GetAppXPath(VOID);
+UBYTE ReadIconType(STRPTR path, UBYTE *header);
+LONG FindPrimaryTool(struct BulkState *state, STRPTR toolName, ULONG toolNameSize);
+BOOL BulkWalk(struct BulkState *state, LONG depth);
+BOOL BulkConvert(STRPTR rootPath, BOOL copyImage, BOOL dryRun, STRPTR reportPath);
+
+#ifdef APPX_PROFILE
+/* Profiling build (smake profile) */
+/* Every dos, icon and workbench call made by the toolbox code is counted */
+/* through the wrappers below, and each scenario appends one line of */
+/* key=value pairs to PROFILE_FILE (AppX has no console with cback.o) */
+
+#define PROFILE_FILE "T:AppX.profile"
+
+struct ProfileCounters {
+    ULONG pc_Locks;          /* Lock, ParentDir, DupLock */
+    ULONG pc_Opens;          /* Open of files */
+    ULONG pc_Examines;       /* Examine */
+    ULONG pc_NameLookups;    /* NameFromLock */
+    ULONG pc_IconReads;      /* GetDiskObject */
+    ULONG pc_IconWrites;     /* PutDiskObject, PutIconTagList */
+    ULONG pc_Deletes;        /* DeleteFile */
+    ULONG pc_WorkbenchCalls; /* OpenWorkbenchObjectA, WorkbenchControlA */
+    ULONG pc_Launches;       /* System, SystemTagList */
+    ULONG pc_Delays;         /* Delay polls */
+    ULONG pc_BytesWritten;   /* Size of icon files written */
+};
+
+static struct ProfileCounters profileCounters;
+static STRPTR profileScenario = "none";
+static struct timerequest *profileTimerIO = NULL;
+struct Device *TimerBase = NULL;
+static struct EClockVal profileStart;
+
+/* Size of the icon file just written, trying the name with and without .info */
+static ULONG ProfileIconSize(CONST_STRPTR name)
+{
+    UBYTE iconName[512];
+    struct FileInfoBlock *fib;
+    BPTR lock;
+    ULONG size = 0;
+    
+    SNPrintf(iconName, sizeof(iconName), "%s.info", name);
+    lock = Lock(iconName, SHARED_LOCK);
+    if (lock == NULL) {
+        lock = Lock(name, SHARED_LOCK);
+    }
+    if (lock != NULL) {
+        fib = (struct FileInfoBlock *)AllocDosObject(DOS_FIB, NULL);
+        if (fib != NULL) {
+            if (Examine(lock, fib) && fib->fib_DirEntryType < 0) {
+                size = fib->fib_Size;
+            }
+            FreeDosObject(DOS_FIB, fib);
+        }
+        UnLock(lock);
+    }
+    
+    return size;
+}
+
+static BPTR ProfLock(CONST_STRPTR name, LONG mode)
+{
+    profileCounters.pc_Locks++;
+    return Lock(name, mode);
+}
+
+static BPTR ProfParentDir(BPTR lock)
+{
+    profileCounters.pc_Locks++;
+    return ParentDir(lock);
+}
+
+static BPTR ProfDupLock(BPTR lock)
+{
+    profileCounters.pc_Locks++;
+    return DupLock(lock);
+}
+
+static BPTR ProfOpen(CONST_STRPTR name, LONG mode)
+{
+    profileCounters.pc_Opens++;
+    return Open(name, mode);
+}
+
+static LONG ProfExamine(BPTR lock, struct FileInfoBlock *fib)
+{
+    profileCounters.pc_Examines++;
+    return Examine(lock, fib);
+}
+
+static LONG ProfNameFromLock(BPTR lock, STRPTR buffer, LONG length)
+{
+    profileCounters.pc_NameLookups++;
+    return NameFromLock(lock, buffer, length);
+}
+
+static struct DiskObject *ProfGetDiskObject(CONST_STRPTR name)
+{
+    profileCounters.pc_IconReads++;
+    return GetDiskObject(name);
+}
+
+static BOOL ProfPutDiskObject(CONST_STRPTR name, struct DiskObject *icon)
+{
+    BOOL result;
+    
+    profileCounters.pc_IconWrites++;
+    result = PutDiskObject(name, icon);
+    if (result) {
+        profileCounters.pc_BytesWritten += ProfileIconSize(name);
+    }
+    return result;
+}
+
+static BOOL ProfPutIconTagList(CONST_STRPTR name, struct DiskObject *icon, struct TagItem *tags)
+{
+    BOOL result;
+    
+    profileCounters.pc_IconWrites++;
+    result = PutIconTagList(name, icon, tags);
+    if (result) {
+        profileCounters.pc_BytesWritten += ProfileIconSize(name);
+    }
+    return result;
+}
+
+static LONG ProfDeleteFile(CONST_STRPTR name)
+{
+    profileCounters.pc_Deletes++;
+    return DeleteFile(name);
+}
+
+static BOOL ProfOpenWorkbenchObjectA(CONST_STRPTR name, struct TagItem *tags)
+{
+    profileCounters.pc_WorkbenchCalls++;
+    return OpenWorkbenchObjectA(name, tags);
+}
+
+static BOOL ProfWorkbenchControlA(CONST_STRPTR name, struct TagItem *tags)
+{
+    profileCounters.pc_WorkbenchCalls++;
+    return WorkbenchControlA(name, tags);
+}
+
+static LONG ProfSystemTagList(CONST_STRPTR command, struct TagItem *tags)
+{
+    profileCounters.pc_Launches++;
+    return SystemTagList(command, tags);
+}
+
+static VOID ProfDelay(LONG ticks)
+{
+    profileCounters.pc_Delays++;
+    Delay(ticks);
+}
+
+/* Start measuring a scenario */
+static VOID ProfileBegin(VOID)
+{
+    memset(&profileCounters, 0, sizeof(profileCounters));
+    profileScenario = "none";
+    
+    if (profileTimerIO == NULL) {
+        profileTimerIO = (struct timerequest *)AllocVec(sizeof(struct timerequest), MEMF_PUBLIC | MEMF_CLEAR);
+        if (profileTimerIO != NULL) {
+            if (OpenDevice(TIMERNAME, UNIT_MICROHZ, (struct IORequest *)profileTimerIO, 0) == 0) {
+                TimerBase = profileTimerIO->tr_node.io_Device;
+            } else {
+                FreeVec(profileTimerIO);
+                profileTimerIO = NULL;
+            }
+        }
+    }
+    
+    if (TimerBase != NULL) {
+        ReadEClock(&profileStart);
+    }
+}
+
+/* Finish a scenario and append its line to the profile file */
+static VOID ProfileEnd(BOOL result)
+{
+    struct EClockVal profileEnd;
+    ULONG frequency;
+    ULONG ticks;
+    ULONG wallMicros = 0;
+    UBYTE line[512];
+    BPTR file;
+    
+    if (TimerBase != NULL) {
+        frequency = ReadEClock(&profileEnd);
+        ticks = profileEnd.ev_lo - profileStart.ev_lo;
+        wallMicros = (ticks / frequency) * 1000000 + ((ticks % frequency) * 1000) / (frequency / 1000);
+    }
+    
+    SNPrintf(line, sizeof(line),
+        "scenario=%s result=%ld wall_us=%lu locks=%lu opens=%lu examines=%lu "
+        "name_lookups=%lu icon_reads=%lu icon_writes=%lu deletes=%lu "
+        "wb_calls=%lu launches=%lu delays=%lu bytes_written=%lu\n",
+        profileScenario, (LONG)result, wallMicros,
+        profileCounters.pc_Locks, profileCounters.pc_Opens, profileCounters.pc_Examines,
+        profileCounters.pc_NameLookups, profileCounters.pc_IconReads, profileCounters.pc_IconWrites,
+        profileCounters.pc_Deletes, profileCounters.pc_WorkbenchCalls, profileCounters.pc_Launches,
+        profileCounters.pc_Delays, profileCounters.pc_BytesWritten);
+    
+    file = Open(PROFILE_FILE, MODE_READWRITE);
+    if (file != NULL) {
+        Seek(file, 0, OFFSET_END);
+        Write(file, line, strlen((char *)line));
+        Close(file);
+    }
+    
+    if (profileTimerIO != NULL) {
+        CloseDevice((struct IORequest *)profileTimerIO);
+        FreeVec(profileTimerIO);
+        profileTimerIO = NULL;
+        TimerBase = NULL;
+    }
+}
+
+/* Route the calls below this point through the counting wrappers */
+#define Lock(n, m)                  ProfLock(n, m)
+#define ParentDir(l)                ProfParentDir(l)
+#define DupLock(l)                  ProfDupLock(l)
+#define Open(n, m)                  ProfOpen(n, m)
+#define Examine(l, f)               ProfExamine(l, f)
+#define NameFromLock(l, b, n)       ProfNameFromLock(l, b, n)
+#define GetDiskObject(n)            ProfGetDiskObject(n)
+#define PutDiskObject(n, i)         ProfPutDiskObject(n, i)
+#define PutIconTagList(n, i, t)     ProfPutIconTagList(n, i, t)
+#define DeleteFile(n)               ProfDeleteFile(n)
+#define OpenWorkbenchObjectA(n, t)  ProfOpenWorkbenchObjectA(n, t)
+#define WorkbenchControlA(n, t)     ProfWorkbenchControlA(n, t)
+#define System(c, t)                ProfSystemTagList(c, t)
+#define SystemTagList(c, t)         ProfSystemTagList(c, t)
+#define Delay(t)                    ProfDelay(t)
+
+#define PROFILE_BEGIN()             ProfileBegin()
+#define PROFILE_SCENARIO(name)      (profileScenario = (name))
+#define PROFILE_END(result)         ProfileEnd(result)
+#else
+#define PROFILE_BEGIN()
+#define PROFILE_SCENARIO(name)
+#define PROFILE_END(result)
+#endif
 
 static const char *verstag = "$VER: AppX 47.1 (29.12.2025)\n";
 static const char *stack_cookie = "$STACK: 4096\n";
@@ -104,6 +426,8 @@ int main(int argc, char *argv[])
     BOOL success = TRUE;
     BOOL fromWorkbench = FALSE;
     
+    MEMTRACK_BEGIN();
+    
     /* Check if running from Workbench */
     fromWorkbench = (argc == 0);
     
@@ -113,9 +437,10 @@ int main(int argc, char *argv[])
         STRPTR drawerPath = NULL;
         STRPTR toolboxPath = NULL;
         STRPTR toolName = NULL;
+        STRPTR bulkPath = NULL;
         LONG copyImage = 0; /* COPYIMAGE/S - boolean switch */
-        LONG args[4] = {0, 0, 0, 0}; /* DRAWER/K, TOOLBOX/K, TOOL/K, COPYIMAGE/S */
-        CONST_STRPTR template = "DRAWER/K,TOOLBOX/K,TOOL/K,COPYIMAGE/S";
+        LONG args[7] = {0, 0, 0, 0, 0, 0, 0}; /* DRAWER/K, TOOLBOX/K, TOOL/K, COPYIMAGE/S, BULK/K, DRYRUN/S, REPORT/K */
+        CONST_STRPTR template = "DRAWER/K,TOOLBOX/K,TOOL/K,COPYIMAGE/S,BULK/K,DRYRUN/S,REPORT/K";
         LONG errorCode;
         
         /* Initialize libraries first (needed for ReadArgs and HandleDrawerMode/MakeToolboxDrawer) */
@@ -132,6 +457,38 @@ int main(int argc, char *argv[])
             toolboxPath = (STRPTR)args[1];
             toolName = (STRPTR)args[2];
             copyImage = args[3]; /* COPYIMAGE/S - 1 if set, 0 if not */
+            bulkPath = (STRPTR)args[4];
+            
+            /* BULK converts many drawers at once and excludes the single drawer modes */
+            if (bulkPath != NULL && *bulkPath != '\0') {
+                BOOL result;
+                
+                if ((drawerPath != NULL && *drawerPath != '\0') ||
+                    (toolboxPath != NULL && *toolboxPath != '\0') ||
+                    (toolName != NULL && *toolName != '\0')) {
+                    FreeArgs(rdargs);
+                    Cleanup();
+                    return RETURN_FAIL;
+                }
+                
+                PROFILE_BEGIN();
+                PROFILE_SCENARIO("convert-bulk");
+                MEMTRACK_PHASE("convert");
+                result = BulkConvert(bulkPath, copyImage != 0, args[5] != 0,
+                                     args[6] ? (STRPTR)args[6] : (STRPTR)BULK_REPORT_FILE);
+                PROFILE_END(result);
+                
+                FreeArgs(rdargs);
+                Cleanup();
+                return result ? RETURN_OK : RETURN_FAIL;
+            }
+            
+            /* DRYRUN and REPORT are only valid with BULK mode */
+            if (args[5] != 0 || args[6] != 0) {
+                FreeArgs(rdargs);
+                Cleanup();
+                return RETURN_FAIL;
+            }
             
             /* Check for mutual exclusivity: DRAWER and TOOLBOX cannot both be specified */
             if (drawerPath != NULL && *drawerPath != '\0' && toolboxPath != NULL && *toolboxPath != '\0') {
@@ -159,7 +516,15 @@ int main(int argc, char *argv[])
             
             if (drawerPath != NULL && *drawerPath != '\0') {
                 /* Handle drawer opening mode */
-                if (HandleDrawerMode(drawerPath)) {
+                BOOL result;
+                
+                PROFILE_BEGIN();
+                PROFILE_SCENARIO("drawer-restore");
+                MEMTRACK_PHASE("drawer-restore");
+                result = HandleDrawerMode(drawerPath);
+                PROFILE_END(result);
+                
+                if (result) {
                     FreeArgs(rdargs);
                     Cleanup();
                     return RETURN_OK;
@@ -170,7 +535,15 @@ int main(int argc, char *argv[])
                 }
             } else if (toolboxPath != NULL && *toolboxPath != '\0') {
                 /* Handle toolbox drawer creation mode (TOOL is guaranteed to be present here) */
-                if (MakeToolboxDrawer(toolboxPath, toolName, copyImage != 0)) {
+                BOOL result;
+                
+                PROFILE_BEGIN();
+                PROFILE_SCENARIO(copyImage != 0 ? "convert-copyimage" : "convert");
+                MEMTRACK_PHASE("convert");
+                result = MakeToolboxDrawer(toolboxPath, toolName, copyImage != 0);
+                PROFILE_END(result);
+                
+                if (result) {
                     FreeArgs(rdargs);
                     Cleanup();
                     return RETURN_OK;
@@ -227,8 +600,12 @@ int main(int argc, char *argv[])
             oldDir = CurrentDir(wbarg->wa_Lock);
             
             /* Open the toolbox drawer */
+            PROFILE_BEGIN();
             if (!OpenToolboxDrawer(wbarg->wa_Name, wbarg->wa_Lock)) {
                 success = FALSE;
+                PROFILE_END(FALSE);
+            } else {
+                PROFILE_END(TRUE);
             }
             
             /* Restore original directory */
@@ -369,47 +746,8 @@ VOID Cleanup(VOID)
         InputPort = NULL;
     }
     
-}
-
-/* Check if a file is a directory */
-/* fileLock is the lock to the parent directory, fileName is the file name */
-BOOL IsDirectory(STRPTR fileName, BPTR fileLock)
-{
-    struct FileInfoBlock *fib;
-    BPTR fileLock2 = NULL;
-    BOOL isDir = FALSE;
-    BPTR oldDir = NULL;
-    
-    if (fileLock == NULL || fileName == NULL) {
-        return FALSE;
-    }
-    
-    /* Change to the parent directory */
-    oldDir = CurrentDir(fileLock);
-    
-    /* Lock the file itself */
-    fileLock2 = Lock((UBYTE *)fileName, SHARED_LOCK);
-    
-    if (fileLock2 != NULL) {
-        fib = (struct FileInfoBlock *)AllocDosObject(DOS_FIB, NULL);
-        if (fib != NULL) {
-            if (Examine(fileLock2, fib)) {
-                /* fib_DirEntryType > 0 means it's a directory */
-                if (fib->fib_DirEntryType > 0) {
-                    isDir = TRUE;
-                }
-            }
-            FreeDosObject(DOS_FIB, fib);
-        }
-        UnLock(fileLock2);
-    }
-    
-    /* Restore original directory */
-    if (oldDir != NULL) {
-        CurrentDir(oldDir);
-    }
-    
-    return isDir;
+    /* Anything still allocated now is reported as leaked */
+    MEMTRACK_DUMP();
 }
 
 /* Get ToolType value from a DiskObject */
@@ -500,7 +838,7 @@ BOOL ShowConfirmDialog(STRPTR fileName, STRPTR toolName)
     Strncpy(title, "AppX", 255);
     title[255] = '\0';
     
-    sprintf(message,
+    SNPrintf(message, sizeof(message),
             "\n\n"
             "File: %s\n\n"
             "Tool: %s\n\n"
@@ -542,151 +880,168 @@ BOOL ShowConfirmDialog(STRPTR fileName, STRPTR toolName)
     return TRUE;
 }
 
+/* Get the full path of a lock, in a buffer grown until the path fits */
+/* Returns an AllocVec'd string, or NULL */
+STRPTR GetLockPath(BPTR lock)
+{
+    STRPTR path;
+    ULONG size;
+    
+    for (size = 256; size <= 65536; size *= 2) {
+        path = AllocVec(size, MEMF_CLEAR);
+        if (path == NULL) {
+            return NULL;
+        }
+        if (NameFromLock(lock, path, size)) {
+            return path;
+        }
+        FreeVec(path);
+        if (IoErr() != ERROR_LINE_TOO_LONG) {
+            break;
+        }
+    }
+    
+    return NULL;
+}
+
 /* Open toolbox drawer - handles directories with TOOLBOX tooltype */
+/* Works relative to locks: fileLock is the parent of the drawer, fileName the drawer's */
+/* name in it. Only the final launch needs the tool's full path as a string. */
 BOOL OpenToolboxDrawer(STRPTR fileName, BPTR fileLock)
 {
     BOOL success = FALSE;
-    BOOL confirmed = FALSE;
+    BOOL isDrawer = FALSE;
+    BOOL isScript = FALSE;
     struct TagItem tags[1];
-    UBYTE errorMsg[512];
+    UBYTE errorMsg[256];
+    UBYTE toolName[256];
     struct DiskObject *projectIcon = NULL;
+    struct FileInfoBlock *fib = NULL;
     STRPTR toolboxValue = NULL;
-    UBYTE fullToolPath[512];
+    STRPTR toolPath = NULL;
+    BPTR drawerLock = NULL;
+    BPTR toolLock = NULL;
+    BPTR oldDir;
     LONG errorCode;
     
+    if (fileLock == NULL || fileName == NULL) {
+        return FALSE;
+    }
+    
+    fib = (struct FileInfoBlock *)AllocDosObject(DOS_FIB, NULL);
+    if (fib == NULL) {
+        return FALSE;
+    }
+    
+    /* Everything below is relative to the drawer's parent */
+    oldDir = CurrentDir(fileLock);
+    
     /* Check if this is a directory (drawer) */
-    if (IsDirectory(fileName, fileLock)) {
-        UBYTE dirPath[512];
-        UBYTE fullDirPath[512];
-        UBYTE iconPath[512];
-        UBYTE toolboxValueCopy[256];
-        LONG errorCode;
-        LONG errorCode1;
-        LONG errorCode2;
-        UBYTE errorMsg[512];
-        UBYTE triedPath1[512];
-        UBYTE triedPath2[512];
-        
-        /* Get the full path to the directory from the lock */
-        NameFromLock(fileLock, dirPath, sizeof(dirPath));
-        
-        /* Construct the full path to the directory itself (parent + directory name) */
-        /* Use AddPart to properly handle volume roots (no extra /) */
-        Strncpy(fullDirPath, dirPath, sizeof(fullDirPath) - 1);
-        fullDirPath[sizeof(fullDirPath) - 1] = '\0';
-        if (!AddPart(fullDirPath, fileName, sizeof(fullDirPath))) {
-            ShowErrorDialog("AppX",
-                "\nPath too long.\n\n"
-                "The directory path is too long to process.\n");
-            return FALSE;
-        }
-        
-        /* Remove trailing slash if present */
-        {
-            LONG len;
-            len = strlen((char *)fullDirPath);
-            if (len > 0 && fullDirPath[len - 1] == '/') {
-                fullDirPath[len - 1] = '\0';
-            }
+    drawerLock = Lock((UBYTE *)fileName, SHARED_LOCK);
+    if (drawerLock != NULL && Examine(drawerLock, fib) && fib->fib_DirEntryType > 0) {
+        isDrawer = TRUE;
+    }
+    
+    if (!isDrawer) {
+        if (drawerLock != NULL) {
+            UnLock(drawerLock);
         }
+        CurrentDir(oldDir);
+        FreeDosObject(DOS_FIB, fib);
         
-        /* Construct full path to the icon file (with .info for PutDiskObject and file checks) */
-        /* For file extensions, append directly instead of using AddPart() */
-        {
-            LONG baseLen;
-            baseLen = strlen((char *)fullDirPath);
-            if (baseLen + 5 >= sizeof(iconPath)) { /* 5 = strlen(".info") + null terminator */
-                ShowErrorDialog("AppX",
-                    "\nPath too long.\n\n"
-                    "The icon file path is too long to process.\n");
-                return FALSE;
-            }
-            Strncpy(iconPath, fullDirPath, sizeof(iconPath) - 1);
-            iconPath[sizeof(iconPath) - 1] = '\0';
-            Strncpy(iconPath + baseLen, ".info", sizeof(iconPath) - baseLen);
-            iconPath[sizeof(iconPath) - 1] = '\0';
-        }
+        /* Not a directory - show error */
+        ShowErrorDialog("AppX",
+            "\nNot a directory.\n\n"
+            "AppX only works with toolbox drawer icons.\n"
+            "Please set AppX as the default tool on a drawer icon\n"
+            "with a TOOLBOX tooltype.\n");
+        return FALSE;
+    }
+    
+    /* GetDiskObject() appends .info to the drawer name itself */
+    SetIoErr(0);
+    projectIcon = GetDiskObject(fileName);
+    errorCode = IoErr();
+    
+    if (projectIcon == NULL) {
+        UnLock(drawerLock);
+        CurrentDir(oldDir);
+        FreeDosObject(DOS_FIB, fib);
         
-        /* Clear any previous error */
-        /* GetDiskObject() automatically appends .info, so use base path */
-        SetIoErr(0);
-        projectIcon = GetDiskObject(fullDirPath);
-        errorCode1 = IoErr();
+        SNPrintf(errorMsg, sizeof(errorMsg),
+            "Could not load project icon.\n\n"
+            "Drawer: %s\n"
+            "Error code: %ld\n\n"
+            "The icon file could not be found or read.\n"
+            "Please ensure the directory has a .info icon file.",
+            fileName, errorCode);
+        ShowErrorDialog("AppX", errorMsg);
+        return FALSE;
+    }
+    
+    /* Get the TOOLBOX tooltype value */
+    toolboxValue = GetToolTypeValue(projectIcon, "TOOLBOX");
+    
+    if (toolboxValue == NULL || *toolboxValue == '\0') {
+        FreeDiskObject(projectIcon);
+        UnLock(drawerLock);
+        CurrentDir(oldDir);
+        FreeDosObject(DOS_FIB, fib);
+        ShowErrorDialog("AppX",
+            "\nNo TOOLBOX tooltype found.\n\n"
+            "This directory icon must have a TOOLBOX tooltype\n"
+            "specifying the application to run.\n");
+        return FALSE;
+    }
+    
+    /* Copy the tool name (a name inside the drawer) before freeing the icon */
+    Strncpy(toolName, toolboxValue, sizeof(toolName));
+    
+    /* Free the icon before spawning or launching anything */
+    FreeDiskObject(projectIcon);
+    projectIcon = NULL;
+    
+    /* Check if Right Shift key is held - if so, spawn second process to open drawer */
+    if (IsLeftAmigaHeld()) {
+        /* Right Shift key held - spawn a second process to handle drawer opening */
+        /* This avoids the ERROR_OBJECT_IN_USE issue because the second process */
+        /* doesn't have the WBStartup lock */
+        STRPTR command = NULL;
+        STRPTR drawerPath;
+        STRPTR progPath = NULL;
+        struct TagItem sysTags[2];
+        BPTR progDirLock;
+        LONG sysResult = -1;
         
-            if (projectIcon == NULL) {
-                /* GetDiskObject failed - show detailed error */
-                /* GetDiskObject() automatically appends .info, so it tried fullDirPath + ".info" */
-                SNPrintf(triedPath1, sizeof(triedPath1), "%s.info", fullDirPath);
-                SNPrintf(triedPath2, sizeof(triedPath2), "%s", fullDirPath);
-                
-                SNPrintf(errorMsg, sizeof(errorMsg),
-                    "Could not load project icon.\n\n"
-                    "Directory: %s\n"
-                    "Directory name: %s\n\n"
-                    "Tried icon paths:\n"
-                    "1. %s (GetDiskObject base path + .info)\n"
-                    "   Error code: %ld\n\n"
-                    "The icon file could not be found or read.\n"
-                    "Please ensure the directory has a .info icon file.",
-                    dirPath, fileName, triedPath1, errorCode1);
-                ShowErrorDialog("AppX", errorMsg);
-                return FALSE;
-            }
+        PROFILE_SCENARIO("drawer-open");
+        MEMTRACK_PHASE("drawer-open");
         
-        /* Get the TOOLBOX tooltype value */
-        toolboxValue = GetToolTypeValue(projectIcon, "TOOLBOX");
+        /* The second process gets the drawer as a path, since it cannot share our locks */
+        drawerPath = GetLockPath(drawerLock);
         
-        if (toolboxValue == NULL || *toolboxValue == '\0') {
-            FreeDiskObject(projectIcon);
-            ShowErrorDialog("AppX",
-                "\nNo TOOLBOX tooltype found.\n\n"
-                "This directory icon must have a TOOLBOX tooltype\n"
-                "specifying the application to run.\n");
-            return FALSE;
+        /* A restore watcher is already running - it takes the drawer without a new process */
+        if (drawerPath != NULL && SendRestoreRequest(drawerPath)) {
+            sysResult = 0;
+        } else {
+            /* Build command: Use PROGDIR: to get full path to AppX */
+            progDirLock = Lock("PROGDIR:", ACCESS_READ);
+            if (progDirLock != NULL) {
+                progPath = GetLockPath(progDirLock);
+                UnLock(progDirLock);
+            }
         }
         
-        /* Copy the toolbox value before freeing the icon */
-        Strncpy(toolboxValueCopy, toolboxValue, sizeof(toolboxValueCopy) - 1);
-        toolboxValueCopy[sizeof(toolboxValueCopy) - 1] = '\0';
-        
-        /* Construct full path: full directory path + tool name */
-        /* Use AddPart to properly handle volume roots (no extra /) */
-        Strncpy(fullToolPath, fullDirPath, sizeof(fullToolPath) - 1);
-        fullToolPath[sizeof(fullToolPath) - 1] = '\0';
-        if (!AddPart(fullToolPath, toolboxValueCopy, sizeof(fullToolPath))) {
-            ShowErrorDialog("AppX",
-                "\nPath too long.\n\n"
-                "The tool path is too long to process.\n");
-            return FALSE;
+        if (sysResult == -1 && drawerPath != NULL) {
+            command = AllocVec(strlen((char *)drawerPath) +
+                               (progPath != NULL ? strlen((char *)progPath) : 0) + 32, MEMF_CLEAR);
         }
-        
-        /* Check if Right Shift key is held - if so, spawn second process to open drawer */
-        if (IsLeftAmigaHeld()) {
-            /* Right Shift key held - spawn a second process to handle drawer opening */
-            /* This avoids the ERROR_OBJECT_IN_USE issue because the second process */
-            /* doesn't have the WBStartup lock */
-            UBYTE command[512];
-            struct TagItem sysTags[2];
-            LONG sysResult;
-            
-            /* Free the icon before spawning the process */
-            FreeDiskObject(projectIcon);
-            projectIcon = NULL;
-            
-            /* Build command: Use PROGDIR: to get full path to AppX */
-            {
-                BPTR progDirLock;
-                UBYTE progPath[256];
-                
-                progDirLock = Lock("PROGDIR:", ACCESS_READ);
-                if (progDirLock != NULL) {
-                    NameFromLock(progDirLock, progPath, sizeof(progPath));
-                    UnLock(progDirLock);
-                    SNPrintf(command, sizeof(command), "%s/AppX DRAWER=%s", progPath, fullDirPath);
-                } else {
-                    /* Fallback: try without path (assumes AppX is in PATH) */
-                    SNPrintf(command, sizeof(command), "AppX DRAWER=%s", fullDirPath);
-                }
+        if (command != NULL) {
+            if (progPath != NULL) {
+                SNPrintf(command, strlen((char *)drawerPath) + strlen((char *)progPath) + 32,
+                         "\"%s/AppX\" DRAWER=\"%s\"", progPath, drawerPath);
+            } else {
+                /* Fallback: try without path (assumes AppX is in PATH) */
+                SNPrintf(command, strlen((char *)drawerPath) + 32, "AppX DRAWER=\"%s\"", drawerPath);
             }
             
             /* Spawn the second process asynchronously */
@@ -696,340 +1051,444 @@ BOOL OpenToolboxDrawer(STRPTR fileName, BPTR fileLock)
             
             SetIoErr(0);
             sysResult = System(command, sysTags);
-            
-            if (sysResult == -1) {
-                /* System() failed */
-                errorCode = IoErr();
-                SNPrintf(errorMsg, sizeof(errorMsg),
-                    "Failed to spawn drawer opening process.\n\n"
-                    "Path: %s\n\n"
-                    "Error code: %ld\n\n"
-                    "The drawer could not be opened.",
-                    fullDirPath, errorCode);
-                ShowErrorDialog("AppX", errorMsg);
-                return FALSE;
-            }
-            
-            /* Success - second process spawned, primary process exits immediately */
-            return TRUE;
+            FreeVec(command);
         }
+        errorCode = IoErr();
         
-        /* Free the icon BEFORE showing dialog */
-        FreeDiskObject(projectIcon);
-        projectIcon = NULL;
+        if (progPath != NULL) {
+            FreeVec(progPath);
+        }
+        if (drawerPath != NULL) {
+            FreeVec(drawerPath);
+        }
+        UnLock(drawerLock);
+        CurrentDir(oldDir);
+        FreeDosObject(DOS_FIB, fib);
         
-        /* Right Shift key not held - show confirmation dialog with the full directory path */
-        confirmed = ShowConfirmDialog(fullDirPath, toolboxValueCopy);
-        if (!confirmed) {
-            /* User clicked No - return FALSE but don't show error */
+        if (sysResult == -1) {
+            /* System() failed */
+            SNPrintf(errorMsg, sizeof(errorMsg),
+                "Failed to spawn drawer opening process.\n\n"
+                "Drawer: %s\n\n"
+                "Error code: %ld\n\n"
+                "The drawer could not be opened.",
+                fileName, errorCode);
+            ShowErrorDialog("AppX", errorMsg);
             return FALSE;
         }
         
-        /* User clicked Yes - launch the tool */
-        /* Check if the tool is a shell script (has FIBF_SCRIPT protection bit) */
-        {
-            BPTR toolCheckLock = NULL;
-            struct FileInfoBlock *fib = NULL;
-            BOOL isScript = FALSE;
-            
-            /* Lock the tool to examine it */
-            toolCheckLock = Lock((UBYTE *)fullToolPath, SHARED_LOCK);
-            if (toolCheckLock != NULL) {
-                fib = (struct FileInfoBlock *)AllocDosObject(DOS_FIB, NULL);
-                if (fib != NULL) {
-                    if (Examine(toolCheckLock, fib)) {
-                        /* Check if FIBF_SCRIPT bit is set */
-                        if (fib->fib_Protection & FIBF_SCRIPT) {
-                            isScript = TRUE;
-                        }
-                    }
-                    FreeDosObject(DOS_FIB, fib);
-                }
-                UnLock(toolCheckLock);
-            }
-            
-            if (isScript) {
-                /* Tool is a shell script - use SystemTagList() to execute it */
-                struct TagItem sysTags[2];
-                LONG sysResult;
-                
-                /* Build command: just the tool path (shell will handle script execution) */
-                sysTags[0].ti_Tag = SYS_Asynch;
-                sysTags[0].ti_Data = (ULONG)TRUE;
-                sysTags[1].ti_Tag = TAG_DONE;
-                
-                SetIoErr(0);
-                sysResult = SystemTagList(fullToolPath, sysTags);
-                errorCode = IoErr();
-                
-                if (sysResult == -1 || errorCode != 0) {
-                    /* SystemTagList failed - show error */
-                    SNPrintf(errorMsg, sizeof(errorMsg),
-                        "\nFailed to launch script %s\n\n"
-                        "Error code: %ld\n\n"
-                        "Please check that the script exists and is executable.\n",
-                        fullToolPath, errorCode);
-                    ShowErrorDialog("AppX", errorMsg);
-                    return FALSE;
-                }
-                
-                /* Success - script was launched */
-                return TRUE;
-            } else {
-                /* Tool is not a script - use OpenWorkbenchObjectA() */
-                tags[0].ti_Tag = TAG_DONE;
-                
-                /* Clear any previous error */
-                SetIoErr(0);
-                
-                success = OpenWorkbenchObjectA(fullToolPath, tags);
-                
-                /* Check IoErr() regardless of return value, as OpenWorkbenchObjectA may return TRUE even on failure */
-                errorCode = IoErr();
-                
-                if (!success || errorCode != 0) {
-                    /* OpenWorkbenchObjectA failed - show error code */
-                    SNPrintf(errorMsg, sizeof(errorMsg),
-                        "\nFailed to launch %s\n\n"
-                        "Error code: %ld\n\n"
-                        "Please check that the Tool exists.\n",
-                        fullToolPath, errorCode);
-                    ShowErrorDialog("AppX", errorMsg);
-                    return FALSE;
-                }
-                
-                /* Success - tool was launched */
-                return TRUE;
-            }
+        /* Success - second process spawned, primary process exits immediately */
+        return TRUE;
+    }
+    
+    /* Right Shift key not held - show confirmation dialog, naming the drawer as clicked */
+    if (!ShowConfirmDialog(fileName, toolName)) {
+        /* User clicked No - return FALSE but don't show error */
+        UnLock(drawerLock);
+        CurrentDir(oldDir);
+        FreeDosObject(DOS_FIB, fib);
+        return FALSE;
+    }
+    
+    /* User clicked Yes - lock the tool inside the drawer, reusing the FileInfoBlock */
+    /* to check if it is a shell script (has FIBF_SCRIPT protection bit) */
+    CurrentDir(drawerLock);
+    toolLock = Lock(toolName, SHARED_LOCK);
+    if (toolLock != NULL) {
+        if (Examine(toolLock, fib) && (fib->fib_Protection & FIBF_SCRIPT)) {
+            isScript = TRUE;
         }
+        toolPath = GetLockPath(toolLock);
+        UnLock(toolLock);
+    }
+    CurrentDir(oldDir);
+    UnLock(drawerLock);
+    FreeDosObject(DOS_FIB, fib);
+    
+    if (toolPath == NULL) {
+        SNPrintf(errorMsg, sizeof(errorMsg),
+            "\nFailed to launch %s\n\n"
+            "Error code: %ld\n\n"
+            "Please check that the Tool exists.\n",
+            toolName, IoErr());
+        ShowErrorDialog("AppX", errorMsg);
+        return FALSE;
     }
     
-    /* Not a directory - show error */
-    ShowErrorDialog("AppX",
-        "\nNot a directory.\n\n"
-        "AppX only works with toolbox drawer icons.\n"
-        "Please set AppX as the default tool on a drawer icon\n"
-        "with a TOOLBOX tooltype.\n");
-    return FALSE;
-}
-
+    if (isScript) {
+        /* Tool is a shell script - use SystemTagList() to execute it */
+        struct TagItem sysTags[2];
+        LONG sysResult;
+        
+        PROFILE_SCENARIO("script");
+        MEMTRACK_PHASE("script");
+        
+        /* Build command: just the tool path (shell will handle script execution) */
+        sysTags[0].ti_Tag = SYS_Asynch;
+        sysTags[0].ti_Data = (ULONG)TRUE;
+        sysTags[1].ti_Tag = TAG_DONE;
+        
+        SetIoErr(0);
+        sysResult = SystemTagList(toolPath, sysTags);
+        errorCode = IoErr();
+        success = (sysResult != -1 && errorCode == 0);
+        
+        if (!success) {
+            /* SystemTagList failed - show error */
+            SNPrintf(errorMsg, sizeof(errorMsg),
+                "\nFailed to launch script %s\n\n"
+                "Error code: %ld\n\n"
+                "Please check that the script exists and is executable.\n",
+                toolName, errorCode);
+            ShowErrorDialog("AppX", errorMsg);
+        }
+    } else {
+        /* Tool is not a script - use OpenWorkbenchObjectA() */
+        PROFILE_SCENARIO("launch");
+        MEMTRACK_PHASE("launch");
+        tags[0].ti_Tag = TAG_DONE;
+        
+        /* Clear any previous error */
+        SetIoErr(0);
+        
+        success = OpenWorkbenchObjectA(toolPath, tags);
+        
+        /* Check IoErr() regardless of return value, as OpenWorkbenchObjectA may return TRUE even on failure */
+        errorCode = IoErr();
+        
+        if (!success || errorCode != 0) {
+            /* OpenWorkbenchObjectA failed - show error code */
+            SNPrintf(errorMsg, sizeof(errorMsg),
+                "\nFailed to launch %s\n\n"
+                "Error code: %ld\n\n"
+                "Please check that the Tool exists.\n",
+                toolName, errorCode);
+            ShowErrorDialog("AppX", errorMsg);
+            success = FALSE;
+        }
+    }
+    
+    FreeVec(toolPath);
+    return success;
+}
+
 /* Handle drawer opening mode (CLI mode) */
 /* This function is called from a second process spawned by the main process */
-/* It waits for the icon file to be available, changes the type, opens the drawer, */
-/* waits a few seconds, then restores the icon type */
+/* The drawer is handed to the restore watcher if one is running; otherwise this */
+/* process becomes the watcher, and takes the drawers of later Right Shift opens too */
 BOOL HandleDrawerMode(STRPTR drawerPath)
 {
-    UBYTE iconPath[512];
-    UBYTE fullDirPath[512];
-    struct DiskObject *projectIcon = NULL;
-    LONG originalType;
-    struct TagItem tags[1];
-    BOOL putSuccess;
-    BPTR iconFile;
-    LONG waitCount;
-    BOOL success = FALSE;
-    LONG errorCode;
+    struct RestoreDrawer *drawer;
     
     if (drawerPath == NULL || *drawerPath == '\0') {
         return FALSE;
     }
     
-    /* Copy the drawer path */
-    Strncpy(fullDirPath, drawerPath, sizeof(fullDirPath) - 1);
-    fullDirPath[sizeof(fullDirPath) - 1] = '\0';
+    /* Libraries should already be initialized by main(), but check anyway */
+    if (IconBase == NULL || WorkbenchBase == NULL) {
+        if (!InitializeLibraries()) {
+            return FALSE;
+        }
+    }
+    
+    /* Started while a watcher is running - hand the drawer over and leave */
+    if (SendRestoreRequest(drawerPath)) {
+        return TRUE;
+    }
+    
+    /* No watcher, or it could not take the drawer - watch it ourselves */
+    drawer = NewRestoreDrawer(drawerPath);
+    if (drawer == NULL) {
+        return FALSE;
+    }
+    
+    return RunRestoreWatcher(drawer);
+}
+
+/* Pass a drawer to the running restore watcher */
+/* Returns TRUE once the watcher has taken it; FALSE if there is no watcher or it refused */
+BOOL SendRestoreRequest(STRPTR drawerPath)
+{
+    struct RestoreRequest request;
+    struct MsgPort *watcherPort;
+    struct MsgPort *replyPort;
+    
+    replyPort = CreateMsgPort();
+    if (replyPort == NULL) {
+        return FALSE;
+    }
+    
+    memset(&request, 0, sizeof(request));
+    request.rq_Message.mn_ReplyPort = replyPort;
+    request.rq_Message.mn_Length = sizeof(struct RestoreRequest);
+    request.rq_Path = drawerPath;
+    
+    /* The watcher removes its port under Forbid() too, so it cannot vanish in between */
+    Forbid();
+    watcherPort = FindPort(RESTORE_PORT);
+    if (watcherPort != NULL) {
+        PutMsg(watcherPort, (struct Message *)&request);
+    }
+    Permit();
+    
+    if (watcherPort != NULL) {
+        WaitPort(replyPort);
+        GetMsg(replyPort);
+    }
+    DeleteMsgPort(replyPort);
+    
+    return request.rq_Accepted;
+}
+
+/* Allocate a pending restore for a drawer path */
+struct RestoreDrawer *NewRestoreDrawer(STRPTR drawerPath)
+{
+    struct RestoreDrawer *drawer;
+    LONG len;
+    
+    len = strlen((char *)drawerPath);
+    if (len + 5 >= sizeof(drawer->rd_IconPath)) { /* 5 = strlen(".info") + null terminator */
+        return NULL;
+    }
+    
+    drawer = AllocVec(sizeof(struct RestoreDrawer), MEMF_CLEAR);
+    if (drawer == NULL) {
+        return NULL;
+    }
     
     /* Remove trailing slash if present */
-    {
-        LONG len;
-        len = strlen((char *)fullDirPath);
-        if (len > 0 && fullDirPath[len - 1] == '/') {
-            fullDirPath[len - 1] = '\0';
+    Strncpy(drawer->rd_Path, drawerPath, sizeof(drawer->rd_Path));
+    if (len > 0 && drawer->rd_Path[len - 1] == '/') {
+        drawer->rd_Path[--len] = '\0';
+    }
+    
+    /* Full path to the icon file (with .info for PutDiskObject and file checks) */
+    SNPrintf(drawer->rd_IconPath, sizeof(drawer->rd_IconPath), "%s.info", drawer->rd_Path);
+    drawer->rd_State = RESTORE_WAITING;
+    
+    return drawer;
+}
+
+/* Restore watcher - one loop for every drawer opened with Right Shift */
+/* Each drawer waits until the spawning AppX has let go of its icon, is switched to a */
+/* drawer icon and opened, and gets its project icon back once Workbench closes it. */
+/* Runs until no drawer is pending; later opens reach it through RESTORE_PORT */
+BOOL RunRestoreWatcher(struct RestoreDrawer *first)
+{
+    struct MinList pending;
+    struct RestoreDrawer *drawer;
+    struct RestoreDrawer *nextDrawer;
+    struct RestoreRequest *request;
+    struct MsgPort *port;
+    LONG tick = 0;
+    BOOL published = FALSE;
+    BOOL success = TRUE;
+    
+    NewList((struct List *)&pending);
+    AddTail((struct List *)&pending, (struct Node *)first);
+    
+    /* Publish the port, unless another watcher is already running - then this */
+    /* drawer is one it refused, and we watch just that one without a port */
+    port = CreateMsgPort();
+    if (port != NULL) {
+        port->mp_Node.ln_Name = RESTORE_PORT;
+        port->mp_Node.ln_Pri = 0;
+        Forbid();
+        if (FindPort(RESTORE_PORT) == NULL) {
+            AddPort(port);
+            published = TRUE;
+        }
+        Permit();
+        if (!published) {
+            DeleteMsgPort(port);
+            port = NULL;
         }
     }
     
-    /* Construct full path to the icon file (with .info for PutDiskObject and file checks) */
-    /* For file extensions, append directly instead of using AddPart() */
-    {
-        LONG baseLen;
-            baseLen = strlen((char *)fullDirPath);
-            if (baseLen + 5 >= sizeof(iconPath)) { /* 5 = strlen(".info") + null terminator */
-                return FALSE;
+    for (;;) {
+        /* Take new drawers from other AppX processes */
+        while (port != NULL && (request = (struct RestoreRequest *)GetMsg(port)) != NULL) {
+            drawer = NewRestoreDrawer(request->rq_Path);
+            if (drawer != NULL) {
+                AddTail((struct List *)&pending, (struct Node *)drawer);
             }
-            Strncpy(iconPath, fullDirPath, sizeof(iconPath) - 1);
-            iconPath[sizeof(iconPath) - 1] = '\0';
-            Strncpy(iconPath + baseLen, ".info", sizeof(iconPath) - baseLen);
-            iconPath[sizeof(iconPath) - 1] = '\0';
+            request->rq_Accepted = (drawer != NULL);
+            ReplyMsg((struct Message *)request);
         }
-    
-    /* Wait until we can get a lock on the icon file */
-    /* This ensures the parent process has released it */
-    waitCount = 0;
-    while (waitCount < 50) { /* Wait up to 5 seconds (50 * 100ms) */
-        SetIoErr(0);
-        iconFile = Open(iconPath, MODE_OLDFILE);
-        if (iconFile != NULL) {
-            Close(iconFile);
-            break;
+        
+        for (drawer = (struct RestoreDrawer *)pending.mlh_Head;
+             drawer->rd_Node.mln_Succ != NULL;
+             drawer = nextDrawer) {
+            nextDrawer = (struct RestoreDrawer *)drawer->rd_Node.mln_Succ;
+            
+            if (drawer->rd_State == RESTORE_WAITING) {
+                /* Every 100 ms for up to 5 seconds */
+                if (IsIconFree(drawer)) {
+                    if (!OpenRestoreDrawer(drawer)) {
+                        drawer->rd_State = RESTORE_DONE;
+                        success = FALSE;
+                    } else {
+                        drawer->rd_State = RESTORE_OPEN;
+                        drawer->rd_Checks = 0;
+                    }
+                } else if (++drawer->rd_Checks >= RESTORE_WAIT_CHECKS) {
+                    drawer->rd_State = RESTORE_DONE;
+                    success = FALSE;
+                }
+            } else if (drawer->rd_State == RESTORE_OPEN && (tick % RESTORE_OPEN_TICKS) == 0) {
+                /* Every 500 ms until the drawer is closed, or the time limit */
+                if (!IsDrawerOpen(drawer) || ++drawer->rd_Checks >= RESTORE_OPEN_CHECKS) {
+                    SetIconType(drawer, drawer->rd_OriginalType);
+                    drawer->rd_State = RESTORE_DONE;
+                }
+            }
+            
+            if (drawer->rd_State == RESTORE_DONE) {
+                Remove((struct Node *)drawer);
+                FreeVec(drawer);
+            }
         }
         
-        /* Try without .info extension */
-        SetIoErr(0);
-        iconFile = Open(fullDirPath, MODE_OLDFILE);
-        if (iconFile != NULL) {
-            Close(iconFile);
-            /* Use fullDirPath as iconPath */
-            Strncpy(iconPath, fullDirPath, sizeof(iconPath) - 1);
-            iconPath[sizeof(iconPath) - 1] = '\0';
-            break;
+        /* Nothing pending - stop, but not with a request already on its way */
+        if (pending.mlh_Head->mln_Succ == NULL) {
+            if (port == NULL) {
+                break;
+            }
+            Forbid();
+            if (port->mp_MsgList.lh_Head->ln_Succ == NULL) {
+                RemPort(port);
+                Permit();
+                DeleteMsgPort(port);
+                port = NULL;
+                break;
+            }
+            Permit();
+            continue;
         }
         
-        /* Wait 100ms before trying again */
-        Delay(10); /* 10 ticks = ~100ms */
-        waitCount++;
+        Delay(RESTORE_TICKS);
+        tick++;
     }
     
-    if (waitCount >= 50) {
-        return FALSE;
+    return success;
+}
+
+/* Check whether the spawning AppX has released the drawer's icon file */
+BOOL IsIconFree(struct RestoreDrawer *drawer)
+{
+    BPTR iconFile;
+    
+    SetIoErr(0);
+    iconFile = Open(drawer->rd_IconPath, MODE_OLDFILE);
+    if (iconFile != NULL) {
+        Close(iconFile);
+        return TRUE;
     }
     
-    /* Libraries should already be initialized by main(), but check anyway */
-    if (IconBase == NULL || WorkbenchBase == NULL) {
-        if (!InitializeLibraries()) {
-            return FALSE;
-        }
+    /* Try without .info extension */
+    SetIoErr(0);
+    iconFile = Open(drawer->rd_Path, MODE_OLDFILE);
+    if (iconFile != NULL) {
+        Close(iconFile);
+        /* Use the drawer path as the icon path */
+        Strncpy(drawer->rd_IconPath, drawer->rd_Path, sizeof(drawer->rd_IconPath));
+        return TRUE;
     }
     
-    /* Load the icon */
+    return FALSE;
+}
+
+/* Rewrite the drawer's icon with the given type */
+BOOL SetIconType(struct RestoreDrawer *drawer, LONG type)
+{
+    struct DiskObject *projectIcon;
+    BOOL putSuccess;
+    
     /* GetDiskObject() automatically appends .info, so use base path */
     SetIoErr(0);
-    projectIcon = GetDiskObject(fullDirPath);
-    
+    projectIcon = GetDiskObject(drawer->rd_Path);
     if (projectIcon == NULL) {
-        Cleanup();
         return FALSE;
     }
     
-    /* Save the original icon type */
-    originalType = projectIcon->do_Type;
-    
-    /* Change icon type to WBDRAWER */
-    projectIcon->do_Type = WBDRAWER;
+    projectIcon->do_Type = type;
     
-    /* Save the icon with the new type */
     /* PutDiskObject() may also append .info, so try base path first */
-    putSuccess = PutDiskObject(fullDirPath, projectIcon);
+    putSuccess = PutDiskObject(drawer->rd_Path, projectIcon);
     if (!putSuccess) {
         /* Try with .info extension explicitly */
-        putSuccess = PutDiskObject(iconPath, projectIcon);
+        SetIoErr(0);
+        putSuccess = PutDiskObject(drawer->rd_IconPath, projectIcon);
     }
     
-    if (!putSuccess) {
-        projectIcon->do_Type = originalType;
-        FreeDiskObject(projectIcon);
-        Cleanup();
+    FreeDiskObject(projectIcon);
+    return putSuccess;
+}
+
+/* Switch the drawer's icon to a drawer icon and open it on Workbench */
+/* On failure the project icon is put back at once */
+BOOL OpenRestoreDrawer(struct RestoreDrawer *drawer)
+{
+    struct DiskObject *projectIcon;
+    struct TagItem tags[1];
+    BPTR iconFile;
+    LONG errorCode;
+    BOOL success;
+    
+    /* Save the original icon type */
+    SetIoErr(0);
+    projectIcon = GetDiskObject(drawer->rd_Path);
+    if (projectIcon == NULL) {
         return FALSE;
     }
-    
-    /* Free the icon so Workbench will read it fresh from disk */
+    drawer->rd_OriginalType = projectIcon->do_Type;
     FreeDiskObject(projectIcon);
-    projectIcon = NULL;
+    
+    /* Change icon type to WBDRAWER, freeing the icon so Workbench will read it fresh from disk */
+    if (!SetIconType(drawer, WBDRAWER)) {
+        return FALSE;
+    }
     
     /* Ensure the icon file write is flushed to disk */
     SetIoErr(0);
-    iconFile = Open(iconPath, MODE_OLDFILE);
+    iconFile = Open(drawer->rd_IconPath, MODE_OLDFILE);
     if (iconFile != NULL) {
         Flush(iconFile);
         Close(iconFile);
-    } else {
-        /* Try without .info extension */
-        SetIoErr(0);
-        iconFile = Open(fullDirPath, MODE_OLDFILE);
-        if (iconFile != NULL) {
-            Flush(iconFile);
-            Close(iconFile);
-        }
     }
     
     /* Now open the drawer */
     tags[0].ti_Tag = TAG_DONE;
     SetIoErr(0);
-    success = OpenWorkbenchObjectA(fullDirPath, tags);
+    success = OpenWorkbenchObjectA(drawer->rd_Path, tags);
     errorCode = IoErr();
     
     if (!success || errorCode != 0) {
         /* Failed to open - restore icon type immediately */
-        /* Reload the icon to restore the type */
-        /* GetDiskObject() automatically appends .info, so use base path */
-        SetIoErr(0);
-        projectIcon = GetDiskObject(fullDirPath);
-        
-        if (projectIcon != NULL) {
-            /* Restore the original icon type */
-            projectIcon->do_Type = originalType;
-            
-            /* Save the icon with the original type restored */
-            /* PutDiskObject() may also append .info, so try base path first */
-            PutDiskObject(fullDirPath, projectIcon);
-            if (IoErr() != 0) {
-                SetIoErr(0);
-                PutDiskObject(iconPath, projectIcon);
-            }
-            
-            FreeDiskObject(projectIcon);
-        }
-    } else {
-        /* Drawer opened successfully - wait until it closes, then restore icon type */
-        /* Use WorkbenchControlA to check if drawer is still open */
-        {
-            LONG isOpen;
-            struct TagItem wbTags[2];
-            LONG checkCount;
-            
-            /* Check every 500ms (50 ticks) until drawer is closed */
-            checkCount = 0;
-            while (checkCount < 600) { /* Wait up to 30 seconds (600 * 50 ticks) */
-                wbTags[0].ti_Tag = WBCTRLA_IsOpen;
-                wbTags[0].ti_Data = (ULONG)&isOpen;
-                wbTags[1].ti_Tag = TAG_DONE;
-                
-                SetIoErr(0);
-                if (WorkbenchControlA(fullDirPath, wbTags)) {
-                    if (!isOpen) {
-                        /* Drawer is now closed */
-                        break;
-                    }
-                } else {
-                    /* WorkbenchControlA failed - assume drawer is closed */
-                    break;
-                }
-                
-                /* Wait 500ms before checking again */
-                Delay(50); /* 50 ticks = ~500ms */
-                checkCount++;
-            }
-        }
-        
-        /* Drawer is now closed - restore icon type */
-        SetIoErr(0);
-        projectIcon = GetDiskObject(fullDirPath);
-        
-        if (projectIcon != NULL) {
-            /* Restore the original icon type */
-            projectIcon->do_Type = originalType;
-            
-            /* Save the icon with the original type restored */
-            /* PutDiskObject() may also append .info, so try base path first */
-            PutDiskObject(fullDirPath, projectIcon);
-            if (IoErr() != 0) {
-                SetIoErr(0);
-                PutDiskObject(iconPath, projectIcon);
-            }
-            
-            FreeDiskObject(projectIcon);
-        }
+        SetIconType(drawer, drawer->rd_OriginalType);
+        return FALSE;
     }
-    Cleanup();
-    return success;
+    
+    return TRUE;
+}
+
+/* Check with Workbench whether the drawer is still open */
+BOOL IsDrawerOpen(struct RestoreDrawer *drawer)
+{
+    struct TagItem wbTags[2];
+    LONG isOpen = FALSE;
+    
+    wbTags[0].ti_Tag = WBCTRLA_IsOpen;
+    wbTags[0].ti_Data = (ULONG)&isOpen;
+    wbTags[1].ti_Tag = TAG_DONE;
+    
+    SetIoErr(0);
+    if (!WorkbenchControlA(drawer->rd_Path, wbTags)) {
+        /* WorkbenchControlA failed - assume drawer is closed */
+        return FALSE;
+    }
+    
+    return isOpen != 0;
 }
 
 /* Make a toolbox drawer: convert a drawer icon to a project-drawer with AppX as default tool */
@@ -1043,7 +1502,7 @@ BOOL MakeToolboxDrawer(STRPTR drawerPath, STRPTR toolName, BOOL copyImage)
     UBYTE fullToolPath[512];
     UBYTE fullDirPath[512];
     UBYTE iconPath[512];
-    UBYTE appXPath[256];
+    STRPTR appXPath;
     STRPTR *oldToolTypes = NULL;
     STRPTR *newToolTypes = NULL;
     LONG toolTypeCount = 0;
@@ -1052,7 +1511,6 @@ BOOL MakeToolboxDrawer(STRPTR drawerPath, STRPTR toolName, BOOL copyImage)
     BOOL success = FALSE;
     BPTR drawerLock = NULL;
     BPTR toolLock = NULL;
-    BPTR progDirLock = NULL;
     
     if (drawerPath == NULL || *drawerPath == '\0' || toolName == NULL || *toolName == '\0') {
         return FALSE;
@@ -1143,16 +1601,7 @@ BOOL MakeToolboxDrawer(STRPTR drawerPath, STRPTR toolName, BOOL copyImage)
     }
     
     /* Get AppX path using PROGDIR: */
-    progDirLock = Lock("PROGDIR:", ACCESS_READ);
-    if (progDirLock != NULL) {
-        NameFromLock(progDirLock, appXPath, sizeof(appXPath));
-        UnLock(progDirLock);
-        AddPart(appXPath, "AppX", sizeof(appXPath));
-    } else {
-        /* Fallback: just use "AppX" (assumes it's in PATH) */
-        Strncpy(appXPath, "AppX", sizeof(appXPath) - 1);
-        appXPath[sizeof(appXPath) - 1] = '\0';
-    }
+    appXPath = GetAppXPath();
     
     /* Count existing tooltypes and find TOOLBOX if it exists */
     if (drawerIcon->do_ToolTypes != NULL) {
@@ -1381,4 +1830,344 @@ BOOL MakeToolboxDrawer(STRPTR drawerPath, STRPTR toolName, BOOL copyImage)
     }
     
     return success;
-}
\ No newline at end of file
+}
+
+/* Full path of AppX for the default tool of toolbox icons, looked up once per run */
+STRPTR GetAppXPath(VOID)
+{
+    static UBYTE appXPath[256];
+    BPTR progDirLock;
+    
+    if (appXPath[0] != '\0') {
+        return appXPath;
+    }
+    
+    progDirLock = Lock("PROGDIR:", ACCESS_READ);
+    if (progDirLock != NULL) {
+        NameFromLock(progDirLock, appXPath, sizeof(appXPath));
+        UnLock(progDirLock);
+        AddPart(appXPath, "AppX", sizeof(appXPath));
+    } else {
+        /* Fallback: just use "AppX" (assumes it's in PATH) */
+        Strncpy(appXPath, "AppX", sizeof(appXPath) - 1);
+        appXPath[sizeof(appXPath) - 1] = '\0';
+    }
+    
+    return appXPath;
+}
+
+/* Read the type of an icon from the header of its .info file */
+/* Much cheaper than GetDiskObject(), which also loads the images */
+/* Returns WBTOOL, WBDRAWER and so on, or 0 if there is no valid icon */
+UBYTE ReadIconType(STRPTR path, UBYTE *header)
+{
+    UBYTE iconPath[520];
+    BPTR iconFile;
+    LONG length;
+    
+    SNPrintf(iconPath, sizeof(iconPath), "%s.info", path);
+    iconFile = Open(iconPath, MODE_OLDFILE);
+    if (iconFile == NULL) {
+        return 0;
+    }
+    
+    /* do_Magic and do_Version, the Gadget structure, then do_Type */
+    length = Read(iconFile, header, 49);
+    Close(iconFile);
+    if (length != 49 || header[0] != 0xE3 || header[1] != 0x10) {
+        return 0;
+    }
+    
+    return header[48];
+}
+
+/* Find the primary tool of the drawer in state->bs_Path */
+/* The only tool icon in the drawer is taken as is; among several, only one */
+/* named like the drawer (or a prefix of it, or the other way round) is taken */
+/* Returns one of the BULK_ values, with the tool's name for BULK_SINGLE and BULK_NAMED */
+LONG FindPrimaryTool(struct BulkState *state, STRPTR toolName, ULONG toolNameSize)
+{
+    struct ExAllControl *eac;
+    struct ExAllData *ead;
+    struct ExAllData *exAllBuffer;
+    STRPTR drawerName;
+    BPTR drawerLock;
+    UBYTE toolPath[520];
+    LONG toolCount = 0;
+    LONG named = -1;
+    LONG namedCount = 0;
+    LONG nameLength;
+    LONG drawerLength;
+    LONG shorter;
+    LONG i;
+    BOOL more;
+    
+    drawerLock = Lock(state->bs_Path, SHARED_LOCK);
+    if (drawerLock == NULL) {
+        return BULK_NONE;
+    }
+    exAllBuffer = AllocVec(BULK_EXALL_SIZE, MEMF_ANY);
+    eac = (struct ExAllControl *)AllocDosObject(DOS_EXALLCONTROL, NULL);
+    
+    if (exAllBuffer != NULL && eac != NULL) {
+        eac->eac_LastKey = 0;
+        do {
+            more = ExAll(drawerLock, exAllBuffer, BULK_EXALL_SIZE, ED_TYPE, eac);
+            if (!more && IoErr() != ERROR_NO_MORE_ENTRIES) {
+                break;
+            }
+            
+            for (ead = exAllBuffer; eac->eac_Entries > 0 && ead != NULL; ead = ead->ed_Next) {
+                /* Only the icons of files */
+                nameLength = strlen((char *)ead->ed_Name);
+                if (ead->ed_Type >= 0 || nameLength <= 5 || nameLength - 5 >= (LONG)sizeof(state->bs_Tools[0]) ||
+                    Stricmp(ead->ed_Name + nameLength - 5, ".info") != 0) {
+                    continue;
+                }
+                
+                Strncpy(toolPath, state->bs_Path, sizeof(toolPath));
+                AddPart(toolPath, ead->ed_Name, sizeof(toolPath));
+                toolPath[strlen((char *)toolPath) - 5] = '\0';
+                if (ReadIconType(toolPath, state->bs_Header) != WBTOOL) {
+                    continue;
+                }
+                
+                if (toolCount < BULK_MAX_TOOLS) {
+                    Strncpy(state->bs_Tools[toolCount], ead->ed_Name, nameLength - 4);
+                }
+                toolCount++;
+            }
+        } while (more);
+        
+        if (more) {
+            ExAllEnd(drawerLock, exAllBuffer, BULK_EXALL_SIZE, ED_TYPE, eac);
+        }
+    }
+    
+    if (eac != NULL) {
+        FreeDosObject(DOS_EXALLCONTROL, eac);
+    }
+    if (exAllBuffer != NULL) {
+        FreeVec(exAllBuffer);
+    }
+    UnLock(drawerLock);
+    
+    if (toolCount == 0) {
+        return BULK_NONE;
+    }
+    if (toolCount == 1) {
+        Strncpy(toolName, state->bs_Tools[0], toolNameSize);
+        return BULK_SINGLE;
+    }
+    
+    /* Several tools - look for the one named after the drawer */
+    drawerName = FilePart(state->bs_Path);
+    drawerLength = strlen((char *)drawerName);
+    for (i = 0; i < toolCount && i < BULK_MAX_TOOLS; i++) {
+        nameLength = strlen((char *)state->bs_Tools[i]);
+        shorter = (nameLength < drawerLength) ? nameLength : drawerLength;
+        if (shorter >= 3 && Strnicmp(state->bs_Tools[i], drawerName, shorter) == 0) {
+            if (nameLength == drawerLength) {
+                /* An exact match beats any prefix match */
+                named = i;
+                namedCount = 1;
+                break;
+            }
+            named = i;
+            namedCount++;
+        }
+    }
+    if (namedCount != 1) {
+        return BULK_AMBIGUOUS;
+    }
+    
+    Strncpy(toolName, state->bs_Tools[named], toolNameSize);
+    return BULK_NAMED;
+}
+
+/* Walk the drawers below state->bs_Path, converting program drawers */
+/* A drawer with a primary tool is converted and not searched further; */
+/* other drawers are searched down to BULK_MAX_DEPTH levels */
+BOOL BulkWalk(struct BulkState *state, LONG depth)
+{
+    struct ExAllControl *eac;
+    struct ExAllData *ead;
+    struct ExAllData *exAllBuffer;
+    BPTR drawerLock;
+    STRPTR names = NULL;
+    STRPTR name;
+    ULONG namesSize = 0;
+    ULONG namesUsed = 0;
+    UBYTE toolName[108];
+    LONG pathLength;
+    LONG nameLength;
+    LONG found;
+    BOOL result;
+    BOOL more;
+    BOOL success = TRUE;
+    
+    drawerLock = Lock(state->bs_Path, SHARED_LOCK);
+    if (drawerLock == NULL) {
+        return FALSE;
+    }
+    exAllBuffer = AllocVec(BULK_EXALL_SIZE, MEMF_ANY);
+    eac = (struct ExAllControl *)AllocDosObject(DOS_EXALLCONTROL, NULL);
+    if (exAllBuffer == NULL || eac == NULL) {
+        success = FALSE;
+    }
+    
+    /* Collect the drawer names first, as converting writes icons into this drawer */
+    if (success) {
+        eac->eac_LastKey = 0;
+        do {
+            more = ExAll(drawerLock, exAllBuffer, BULK_EXALL_SIZE, ED_TYPE, eac);
+            if (!more && IoErr() != ERROR_NO_MORE_ENTRIES) {
+                success = FALSE;
+                break;
+            }
+            
+            for (ead = exAllBuffer; eac->eac_Entries > 0 && ead != NULL; ead = ead->ed_Next) {
+                if (ead->ed_Type <= 0) {
+                    continue;
+                }
+                
+                nameLength = strlen((char *)ead->ed_Name) + 1;
+                if (namesUsed + nameLength + 1 > namesSize) {
+                    STRPTR newNames;
+                    
+                    namesSize = namesSize ? namesSize * 2 : 1024;
+                    newNames = AllocVec(namesSize, MEMF_ANY);
+                    if (newNames == NULL) {
+                        success = FALSE;
+                        break;
+                    }
+                    if (names != NULL) {
+                        CopyMem(names, newNames, namesUsed);
+                        FreeVec(names);
+                    }
+                    names = newNames;
+                }
+                CopyMem(ead->ed_Name, names + namesUsed, nameLength);
+                namesUsed += nameLength;
+            }
+        } while (more && success);
+        
+        if (more) {
+            ExAllEnd(drawerLock, exAllBuffer, BULK_EXALL_SIZE, ED_TYPE, eac);
+        }
+    }
+    
+    if (eac != NULL) {
+        FreeDosObject(DOS_EXALLCONTROL, eac);
+    }
+    if (exAllBuffer != NULL) {
+        FreeVec(exAllBuffer);
+    }
+    UnLock(drawerLock);
+    
+    /* Names are packed one after the other, each with its terminator */
+    pathLength = strlen((char *)state->bs_Path);
+    for (name = names; success && name != NULL && name < names + namesUsed; name += strlen((char *)name) + 1) {
+        if (!AddPart(state->bs_Path, name, sizeof(state->bs_Path))) {
+            continue;
+        }
+        
+        /* Only drawers with a drawer icon can become toolboxes; converted ones are projects */
+        if (ReadIconType(state->bs_Path, state->bs_Header) == WBDRAWER) {
+            found = FindPrimaryTool(state, toolName, sizeof(toolName));
+            if (found == BULK_SINGLE || found == BULK_NAMED) {
+                state->bs_Drawers++;
+                if (state->bs_DryRun) {
+                    result = TRUE;
+                } else {
+                    result = MakeToolboxDrawer(state->bs_Path, toolName, state->bs_CopyImage);
+                }
+                if (result) {
+                    state->bs_Converted++;
+                } else {
+                    state->bs_Failed++;
+                }
+                FPrintf(state->bs_Report, "convert drawer=\"%s\" tool=%s pick=%s result=%s\n",
+                        state->bs_Path, toolName, found == BULK_SINGLE ? "single" : "named",
+                        state->bs_DryRun ? "dryrun" : (result ? "ok" : "failed"));
+            } else if (found == BULK_AMBIGUOUS) {
+                state->bs_Drawers++;
+                state->bs_Skipped++;
+                FPrintf(state->bs_Report, "skip drawer=\"%s\" reason=ambiguous\n", state->bs_Path);
+            } else if (depth < BULK_MAX_DEPTH) {
+                /* No tool here - programs may be a level further down */
+                BulkWalk(state, depth + 1);
+            }
+        } else if (depth < BULK_MAX_DEPTH) {
+            BulkWalk(state, depth + 1);
+        }
+        
+        state->bs_Path[pathLength] = '\0';
+    }
+    
+    if (names != NULL) {
+        FreeVec(names);
+    }
+    
+    return success;
+}
+
+/* Convert every program drawer below rootPath into a toolbox drawer in one run */
+/* AppX has no console, so each drawer and a summary with the throughput in */
+/* drawers per second are written to the report file */
+BOOL BulkConvert(STRPTR rootPath, BOOL copyImage, BOOL dryRun, STRPTR reportPath)
+{
+    struct BulkState *state;
+    struct DateStamp start;
+    struct DateStamp end;
+    ULONG ticks;
+    ULONG rate;
+    BOOL success;
+    
+    if (rootPath == NULL || *rootPath == '\0') {
+        return FALSE;
+    }
+    
+    state = AllocVec(sizeof(struct BulkState), MEMF_CLEAR);
+    if (state == NULL) {
+        return FALSE;
+    }
+    
+    state->bs_Report = Open(reportPath, MODE_NEWFILE);
+    if (state->bs_Report == NULL) {
+        FreeVec(state);
+        return FALSE;
+    }
+    state->bs_DryRun = dryRun;
+    state->bs_CopyImage = copyImage;
+    Strncpy(state->bs_Path, rootPath, sizeof(state->bs_Path));
+    
+    /* Look AppX up once for the whole run */
+    GetAppXPath();
+    
+    DateStamp(&start);
+    success = BulkWalk(state, 1);
+    DateStamp(&end);
+    
+    ticks = (end.ds_Days - start.ds_Days) * 24 * 60 * 60 * TICKS_PER_SECOND +
+            (end.ds_Minute - start.ds_Minute) * 60 * TICKS_PER_SECOND +
+            (end.ds_Tick - start.ds_Tick);
+    if (ticks == 0) {
+        ticks = 1;
+    }
+    /* Tenths of a drawer per second */
+    rate = (state->bs_Drawers * TICKS_PER_SECOND * 10) / ticks;
+    
+    FPrintf(state->bs_Report,
+            "bulk root=\"%s\" dryrun=%s drawers=%lu converted=%lu failed=%lu skipped=%lu "
+            "ticks=%lu drawers_per_sec=%lu.%lu result=%s\n",
+            rootPath, dryRun ? "yes" : "no", state->bs_Drawers, state->bs_Converted,
+            state->bs_Failed, state->bs_Skipped, ticks, rate / 10, rate % 10,
+            (success && state->bs_Failed == 0) ? "ok" : "failed");
+    
+    Close(state->bs_Report);
+    success = (success && state->bs_Failed == 0);
+    FreeVec(state);
+    
+    return success;
+}
@@ -0,0 +1,177 @@
+/*
+ * bench_appx.c - AppX_Profile's toolbox scenarios timed against the host HAL
+ *
+ * Copyright (c) 2025 amigazen project
+ * Licensed under BSD 2-Clause License
+ *
+ * appx.c is built with APPX_PROFILE and run through each scenario its
+ * profile line reports: a normal launch and a script launch through
+ * OpenToolboxDrawer(), a Right Shift open with the restore that follows in
+ * HandleDrawerMode(), and MakeToolboxDrawer() with and without COPYIMAGE.
+ * Each is run on a hard disk and on a floppy, with icon decoding and
+ * Workbench drawer windows taking their modelled time. For every scenario
+ * the profile line is printed as AppX wrote it, followed by what the
+ * filesystem saw and the modelled time until everything had settled.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hal.h"
+
+int appx_main(int argc, char *argv[]);
+
+#define APPX    "SYS:Tools/AppX"
+#define PROFILE "T:AppX.profile"
+
+/* Long enough for a Right Shift drawer to be opened, closed and restored */
+#define SETTLE_MICROS (120 * 1000000UL)
+
+struct BenchVolume {
+    const char *bv_Name;
+    struct HalLatency bv_Latency;
+};
+
+static const struct BenchVolume volumes[] = {
+    { "Hard", { 400, 600, 250, 300, 1200, 1500 } },
+    { "Floppy", { 20000, 30000, 15000, 25000, 60000, 12 } },
+    { NULL, { 0, 0, 0, 0, 0, 0 } }
+};
+
+static UBYTE profile[65536];
+static LONG profileSeen = 0;
+static LONG failed = 0;
+
+static VOID MakeDrawer(const char *volume, const char *drawer, const char *tool, LONG protection)
+{
+    UBYTE path[256];
+
+    snprintf((char *)path, sizeof(path), "%s:Apps/%s/%s", volume, drawer, tool);
+    HalWriteFile(path, protection != 0 ? "echo Hello\n" : "tool", protection != 0 ? 11 : 4, protection);
+    HalWriteIcon(path, WBTOOL, NULL, NULL, 2048);
+    snprintf((char *)path, sizeof(path), "%s:Apps/%s", volume, drawer);
+    HalWriteIcon(path, WBDRAWER, NULL, NULL, 1024);
+}
+
+static VOID MakeWorld(VOID)
+{
+    LONG i;
+
+    HalInit();
+    HalAddProgram((CONST_STRPTR)APPX, appx_main);
+    HalSetSystemRuns(TRUE);
+    HalSetDrawerLife(5 * 1000000UL, 60000, 20000);
+
+    /* A 2 KB planar image takes a few milliseconds to decode on a 68020 */
+    HalIconLatency(4000, 0);
+
+    for (i = 0; volumes[i].bv_Name != NULL; i++) {
+        HalAddVolume((CONST_STRPTR)volumes[i].bv_Name, &volumes[i].bv_Latency);
+        MakeDrawer(volumes[i].bv_Name, "Paint", "Paint", 0);
+        MakeDrawer(volumes[i].bv_Name, "Draw", "Draw", 0);
+        MakeDrawer(volumes[i].bv_Name, "Scripts", "Run", FIBF_SCRIPT);
+    }
+}
+
+/* Print the profile lines written since the last call, with the filesystem's view */
+static VOID Report(const char *volume, ULONG start, LONG expected)
+{
+    LONG length = HalReadFile((CONST_STRPTR)PROFILE, profile, sizeof(profile) - 1);
+    char *line;
+    char *next;
+    LONG lines = 0;
+
+    if (length < 0) {
+        length = 0;
+    }
+    profile[length] = '\0';
+
+    for (line = (char *)profile + profileSeen; *line != '\0'; line = next) {
+        next = strchr(line, '\n');
+        if (next != NULL) {
+            *next++ = '\0';
+        } else {
+            next = line + strlen(line);
+        }
+        if (strstr(line, " result=1 ") == NULL) {
+            failed++;
+        }
+        printf("volume=%s %s\n", volume, line);
+        lines++;
+    }
+    printf("volume=%s settled_us=%lu fs_locks=%lu fs_opens=%lu fs_reads=%lu fs_writes=%lu "
+           "fs_examines=%lu fs_bytes_written=%lu icon_decodes=%lu launches=%ld\n\n",
+           volume, HalMicros() - start, halCounters.hc_Locks, halCounters.hc_Opens,
+           halCounters.hc_Reads, halCounters.hc_Writes, halCounters.hc_Examines,
+           halCounters.hc_BytesWritten, halCounters.hc_IconReads, HalLaunchCount(-1));
+
+    if (lines != expected) {
+        failed++;
+    }
+    profileSeen = length;
+}
+
+/* AppX from a shell, as the toolbox conversion is run */
+static VOID RunShell(const char *volume, const char *arguments)
+{
+    ULONG start;
+
+    HalResetCounters();
+    start = HalMicros();
+    if (HalRun((CONST_STRPTR)APPX, (CONST_STRPTR)arguments) != RETURN_OK) {
+        failed++;
+    }
+    HalSettle(SETTLE_MICROS);
+    HalReap();
+    Report(volume, start, 1);
+}
+
+/* AppX as the default tool of a toolbox drawer, double-clicked */
+static VOID RunWorkbench(const char *volume, const char *drawer, UWORD qualifier, LONG expected)
+{
+    UBYTE apps[64];
+    ULONG start;
+
+    snprintf((char *)apps, sizeof(apps), "%s:Apps", volume);
+    HalSetQualifier(qualifier);
+    HalResetCounters();
+    start = HalMicros();
+    HalRunWorkbench((CONST_STRPTR)APPX, apps, (CONST_STRPTR)drawer);
+    HalSetQualifier(0);
+    HalSettle(SETTLE_MICROS);
+    HalReap();
+    Report(volume, start, expected);
+}
+
+int main(void)
+{
+    UBYTE arguments[256];
+    LONG i;
+
+    MakeWorld();
+
+    for (i = 0; volumes[i].bv_Name != NULL; i++) {
+        const char *volume = volumes[i].bv_Name;
+
+        snprintf((char *)arguments, sizeof(arguments), "TOOLBOX=%s:Apps/Paint TOOL=Paint", volume);
+        RunShell(volume, (const char *)arguments);
+        snprintf((char *)arguments, sizeof(arguments), "TOOLBOX=%s:Apps/Draw TOOL=Draw COPYIMAGE", volume);
+        RunShell(volume, (const char *)arguments);
+        /* The script drawer is converted too, for the script launch below */
+        snprintf((char *)arguments, sizeof(arguments), "TOOLBOX=%s:Apps/Scripts TOOL=Run", volume);
+        RunShell(volume, (const char *)arguments);
+
+        RunWorkbench(volume, "Paint", 0, 1);
+        RunWorkbench(volume, "Scripts", 0, 1);
+
+        /* drawer-open, then drawer-restore from the process it started */
+        RunWorkbench(volume, "Paint", IEQUALIFIER_RSHIFT, 2);
+    }
+
+    if (failed > 0) {
+        printf("%ld scenarios failed\n", failed);
+        return 1;
+    }
+    return 0;
+}
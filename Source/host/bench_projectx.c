@@ -0,0 +1,141 @@
+/*
+ * bench_projectx.c - ProjectX opens timed against the host HAL
+ *
+ * Copyright (c) 2025 amigazen project
+ * Licensed under BSD 2-Clause License
+ *
+ * Resolves the tool for a mix of files on volumes of different speeds, and
+ * reports per open the modelled time, the dos.library calls made, and the
+ * host time the run took. Then runs ProjectX's own BENCH= mode over a
+ * generated corpus on the hard disk.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hal.h"
+
+int projectx_main(int argc, char *argv[]);
+
+#define PROJECTX "SYS:C/ProjectX"
+#define ROUNDS   20
+
+struct BenchVolume {
+    const char *bv_Name;
+    struct HalLatency bv_Latency;
+};
+
+static const struct BenchVolume volumes[] = {
+    { "Ram", { 0, 0, 0, 0, 0, 0 } },
+    { "Hard", { 400, 600, 250, 300, 1200, 1500 } },
+    { "CF", { 150, 200, 100, 150, 2500, 900 } },
+    { "Floppy", { 20000, 30000, 15000, 25000, 60000, 12 } },
+    { NULL, { 0, 0, 0, 0, 0, 0 } }
+};
+
+static const char *files[] = {
+    "ReadMe.txt", "Picture", "Notes", "Archive.lha", "Page.html", NULL
+};
+
+static double HostMillis(VOID)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+}
+
+static VOID MakeWorld(VOID)
+{
+    static const UBYTE ilbm[] = "FORM\0\0\0\x40ILBMBMHD\0\0\0\x14";
+    UBYTE path[256];
+    LONG i;
+
+    HalInit();
+    HalAddProgram((CONST_STRPTR)PROJECTX, projectx_main);
+    HalWriteFile((CONST_STRPTR)"SYS:Utilities/MultiView", "tool", 4, 0);
+    HalWriteFile((CONST_STRPTR)"SYS:Tools/Ed", "tool", 4, 0);
+    HalWriteIcon((CONST_STRPTR)"ENV:Sys/def_ascii", WBPROJECT, (CONST_STRPTR)"SYS:Tools/Ed", NULL, 256);
+    HalWriteIcon((CONST_STRPTR)"ENV:Sys/def_ilbm", WBPROJECT, (CONST_STRPTR)"SYS:Utilities/MultiView", NULL, 512);
+    HalWriteIcon((CONST_STRPTR)"ENV:Sys/def_lha", WBPROJECT, (CONST_STRPTR)"SYS:Utilities/MultiView", NULL, 512);
+    HalWriteIcon((CONST_STRPTR)"ENV:Sys/def_html", WBPROJECT, (CONST_STRPTR)"SYS:Utilities/MultiView", NULL, 512);
+    HalDefIconsRule((CONST_STRPTR)"#?.txt", NULL, (CONST_STRPTR)"ascii");
+    HalDefIconsRule((CONST_STRPTR)"#?.(lha|lzh)", NULL, (CONST_STRPTR)"lha");
+    HalDefIconsRule((CONST_STRPTR)"#?.htm#?", NULL, (CONST_STRPTR)"html");
+    HalDefIconsRule(NULL, (CONST_STRPTR)"FORM", (CONST_STRPTR)"ilbm");
+    HalDefIconsStart();
+
+    for (i = 0; volumes[i].bv_Name != NULL; i++) {
+        if (i > 0) {
+            HalAddVolume((CONST_STRPTR)volumes[i].bv_Name, &volumes[i].bv_Latency);
+        }
+        snprintf((char *)path, sizeof(path), "%s:ReadMe.txt", i == 0 ? "RAM" : volumes[i].bv_Name);
+        HalWriteFile(path, "Hello\n", 6, 0);
+        snprintf((char *)path, sizeof(path), "%s:Picture", i == 0 ? "RAM" : volumes[i].bv_Name);
+        HalWriteFile(path, ilbm, sizeof(ilbm) - 1, 0);
+        snprintf((char *)path, sizeof(path), "%s:Notes", i == 0 ? "RAM" : volumes[i].bv_Name);
+        HalWriteFile(path, "No suffix, still text\n", 22, 0);
+        snprintf((char *)path, sizeof(path), "%s:Archive.lha", i == 0 ? "RAM" : volumes[i].bv_Name);
+        HalWriteFile(path, "\x00\x00-lh5-", 7, 0);
+        snprintf((char *)path, sizeof(path), "%s:Page.html", i == 0 ? "RAM" : volumes[i].bv_Name);
+        HalWriteFile(path, "<html></html>\n", 14, 0);
+    }
+}
+
+int main(void)
+{
+    UBYTE arguments[256];
+    double hostStart;
+    double hostMillis;
+    ULONG start;
+    ULONG opens;
+    LONG failed = 0;
+    LONG round;
+    LONG i;
+    LONG f;
+
+    MakeWorld();
+
+    printf("%-8s %10s %8s %8s %8s %8s %8s %10s\n",
+           "volume", "ms/open", "locks", "opens", "reads", "exams", "icons", "host us");
+    for (i = 0; volumes[i].bv_Name != NULL; i++) {
+        HalResetCounters();
+        start = HalMicros();
+        hostStart = HostMillis();
+        opens = 0;
+        for (round = 0; round < ROUNDS; round++) {
+            for (f = 0; files[f] != NULL; f++) {
+                snprintf((char *)arguments, sizeof(arguments), "\"%s:%s\"",
+                         i == 0 ? "RAM" : volumes[i].bv_Name, files[f]);
+                if (HalRun((CONST_STRPTR)PROJECTX, arguments) != RETURN_OK) {
+                    failed++;
+                }
+                opens++;
+            }
+        }
+        hostMillis = HostMillis() - hostStart;
+        printf("%-8s %10.2f %8.1f %8.1f %8.1f %8.1f %8.1f %10.1f\n", volumes[i].bv_Name,
+               (HalMicros() - start) / 1000.0 / opens,
+               (double)halCounters.hc_Locks / opens, (double)halCounters.hc_Opens / opens,
+               (double)halCounters.hc_Reads / opens, (double)halCounters.hc_Examines / opens,
+               (double)halCounters.hc_IconReads / opens, hostMillis * 1000.0 / opens);
+    }
+
+    /* ProjectX's own benchmark, over a corpus it generates */
+    HalClearOutput();
+    HalMakeDir((CONST_STRPTR)"Hard:Bench");
+    start = HalMicros();
+    if (HalRun((CONST_STRPTR)PROJECTX, (CONST_STRPTR)"BENCH=Hard:Bench GENERATE=200") != RETURN_OK) {
+        failed++;
+    }
+    printf("\nProjectX BENCH=Hard:Bench GENERATE=200 (%.1f ms modelled)\n%s",
+           (HalMicros() - start) / 1000.0, HalOutput());
+
+    if (failed > 0) {
+        printf("%ld runs failed\n", failed);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,161 @@
+/*
+ * hal.h - host stand-ins for the AmigaOS libraries, and the harness API
+ *
+ * Copyright (c) 2025 amigazen project
+ * Licensed under BSD 2-Clause License
+ *
+ * The hal_*.c files implement the exec, dos, icon, workbench, intuition,
+ * utility and rexxsyslib calls ProjectX and AppX make, on top of:
+ *
+ *   - cooperative tasks, one host thread each, of which only one runs at a
+ *     time; a task gives up the CPU only in Wait() or while an operation's
+ *     latency passes, so Forbid() and Permit() have nothing to do
+ *   - a virtual clock in microseconds, advanced by the modelled latencies
+ *     and by Delay() and timer.device, never by host time
+ *   - an in-memory filesystem of volumes, each with its own latencies, and
+ *     the usual assigns (ENV:, ENVARC:, T:, C:, PROGDIR:)
+ *   - a fake icon store - .info files in a small text format, with an image
+ *     blob so icon writes have a realistic size - and a scripted DefIcons
+ *   - a recording launcher in place of Workbench, System() and requesters
+ *
+ * Programs are host functions registered under a path. LoadSeg() of that
+ * path yields a seglist that runs them, so CreateNewProc(), the shell and
+ * Workbench-style startup all work as they do on the machine.
+ */
+
+#ifndef HOST_HAL_H
+#define HOST_HAL_H
+
+#include <exec/types.h>
+#include <ndk.h>
+
+/* Latencies of one volume, in microseconds */
+struct HalLatency {
+    ULONG hl_Lock;                          /* Lock(), and each name looked up */
+    ULONG hl_Open;                          /* Open() */
+    ULONG hl_Examine;                       /* Examine(), ExNext(), each ExAll() entry */
+    ULONG hl_Read;                          /* Per Read() call */
+    ULONG hl_Write;                         /* Per Write() call, and per directory change */
+    ULONG hl_BytesPerMilli;                 /* Transfer rate, 0 for no transfer time */
+};
+
+/* Operation counts since HalInit() or HalResetCounters() */
+struct HalCounters {
+    ULONG hc_Locks;
+    ULONG hc_Opens;
+    ULONG hc_Reads;
+    ULONG hc_Writes;
+    ULONG hc_Examines;
+    ULONG hc_Deletes;
+    ULONG hc_IconReads;                     /* GetDiskObject(), GetIconTagList() */
+    ULONG hc_IconWrites;                    /* PutDiskObject(), PutIconTagList() */
+    ULONG hc_Identifies;                    /* DefIcons identifications */
+    ULONG hc_WorkbenchCalls;                /* OpenWorkbenchObjectA(), WorkbenchControlA() */
+    ULONG hc_Delays;
+    ULONG hc_LoadSegs;
+    ULONG hc_UnLoadSegs;
+    ULONG hc_Processes;                     /* CreateNewProc() */
+    ULONG hc_BytesRead;
+    ULONG hc_BytesWritten;
+};
+
+/* What the recording launcher saw - Workbench opens, System() commands, */
+/* and programs started with a WBStartup or from a shell */
+#define HAL_LAUNCH_WORKBENCH 0              /* OpenWorkbenchObjectA() */
+#define HAL_LAUNCH_SYSTEM    1              /* System(), SystemTagList() */
+#define HAL_LAUNCH_STARTUP   2              /* A registered program read its WBStartup */
+#define HAL_LAUNCH_SHELL     3              /* A registered program run from a shell */
+
+struct HalLaunch {
+    struct HalLaunch *hl_Next;
+    LONG hl_Kind;
+    UBYTE hl_Tool[256];                     /* Object, command or program path */
+    UBYTE hl_Args[512];                     /* Project names, or the command arguments */
+    LONG hl_NumArgs;
+    ULONG hl_Micros;                        /* Virtual time of the launch */
+};
+
+/* A requester shown through requester.class */
+struct HalDialog {
+    struct HalDialog *hd_Next;
+    UBYTE hd_Title[64];
+    UBYTE hd_Body[512];
+    UBYTE hd_Gadgets[128];
+};
+
+/* A registered program - main() as the C startup code would call it */
+typedef int (*HalMain)(int argc, char *argv[]);
+
+extern struct HalCounters halCounters;
+extern struct HalLaunch *halLaunches;
+extern struct HalDialog *halDialogs;
+
+/* World */
+VOID HalInit(VOID);
+VOID HalResetCounters(VOID);
+ULONG HalMicros(VOID);
+VOID HalSettle(ULONG maxMicros);
+ULONG HalMemoryUsed(VOID);
+
+/* Filesystem */
+BOOL HalAddVolume(CONST_STRPTR name, const struct HalLatency *latency);
+BOOL HalAssign(CONST_STRPTR name, CONST_STRPTR target);
+BOOL HalMakeDir(CONST_STRPTR path);
+BOOL HalWriteFile(CONST_STRPTR path, CONST_APTR data, LONG length, LONG protection);
+LONG HalReadFile(CONST_STRPTR path, STRPTR buffer, LONG size);
+BOOL HalExists(CONST_STRPTR path);
+LONG HalOpenLocks(VOID);
+
+/* Icons and DefIcons */
+BOOL HalWriteIcon(CONST_STRPTR path, UBYTE type, CONST_STRPTR defaultTool,
+                  CONST_STRPTR *toolTypes, LONG imageBytes);
+/* identifyMicros is DefIcons' fixed cost; each rule tried, and reading a file no rule fits, add to it */
+VOID HalIconLatency(ULONG decodeMicros, ULONG identifyMicros);
+VOID HalDefIconsRule(CONST_STRPTR pattern, CONST_STRPTR magic, CONST_STRPTR type);
+VOID HalDefIconsStart(VOID);
+
+/* Programs */
+BOOL HalAddProgram(CONST_STRPTR path, HalMain entry);
+LONG HalRun(CONST_STRPTR path, CONST_STRPTR arguments);
+LONG HalRunWorkbench(CONST_STRPTR path, CONST_STRPTR drawer, CONST_STRPTR project); /* Projects one to a line */
+CONST_STRPTR HalOutput(VOID);
+LONG HalLiveProcesses(VOID);
+
+/* Launcher, Workbench and input scripting */
+VOID HalSetQualifier(UWORD qualifier);
+VOID HalSetRequesterResult(LONG result);
+VOID HalSetWorkbenchRunning(BOOL running);
+VOID HalSetSystemRuns(BOOL runs);
+VOID HalSetDrawerLife(ULONG micros, ULONG openMicros, ULONG closeMicros);
+BOOL HalDrawerOpen(CONST_STRPTR path);
+LONG HalLaunchCount(LONG kind);
+struct HalLaunch *HalLastLaunch(LONG kind);
+
+/* Shared between the hal_*.c files */
+struct HalNode;
+
+VOID HalSpend(ULONG micros);
+VOID HalSleepUntil(ULONG micros);
+VOID HalAddEvent(ULONG micros, VOID (*fire)(APTR data), APTR data);
+BOOL HalCancelEvent(APTR data);
+LONG HalTagInt(ULONG data);
+VOID HalVarTags(struct TagItem *tags, LONG max, va_list args);
+VOID HalRecordLaunch(LONG kind, CONST_STRPTR tool, CONST_STRPTR args, LONG numArgs);
+BPTR HalNewSeg(HalMain entry);
+HalMain HalFindProgram(BPTR seglist);
+struct Process *HalStartCommand(BPTR seglist, CONST_STRPTR name, CONST_STRPTR arguments,
+                                BPTR output, struct Task *notify, ULONG signal);
+LONG HalWaitCommand(struct Process *process, ULONG signal);
+LONG HalCommandResult(struct Process *process);
+VOID HalReap(VOID);
+BOOL HalProgramPath(CONST_STRPTR path, STRPTR resolved, LONG size);
+struct HalNode *HalLockNode(BPTR lock);
+VOID HalAbort(CONST_STRPTR format, ...);
+VOID HalClearOutput(VOID);
+
+VOID HalInitExec(VOID);
+VOID HalInitDos(VOID);
+VOID HalInitIcon(VOID);
+VOID HalInitWorkbench(VOID);
+
+#endif /* HOST_HAL_H */
@@ -0,0 +1,2415 @@
+/*
+ * hal_dos.c - dos.library over an in-memory filesystem
+ *
+ * Copyright (c) 2025 amigazen project
+ * Licensed under BSD 2-Clause License
+ *
+ * Volumes are trees of HalNodes. A FileLock's fl_Key is its node and its
+ * fl_Volume the volume's DosList, as a filesystem would set them. Every
+ * call the programs make pays the latency of the volume it touches and is
+ * counted in halCounters; the Hal*() calls the harness uses to build the
+ * world do neither.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+
+#include "hal.h"
+
+#define HAL_FILE_MAGIC   0x48414C46UL
+#define HAL_EPOCH_DAYS   17000              /* 2024-07-18, as a DateStamp */
+#define HAL_BLOCK_SIZE   4096               /* Buffered reads pay latency once per block */
+#define HAL_SEG_PREFIX   "HALSEG:"
+
+#define FILE_NODE    0
+#define FILE_NIL     1
+#define FILE_CONSOLE 2
+
+struct HalVolume;
+
+struct HalNode {
+    struct HalNode *hn_Parent;
+    struct HalNode *hn_Child;
+    struct HalNode *hn_Next;
+    struct HalVolume *hn_Volume;
+    UBYTE hn_Name[108];
+    LONG hn_Type;
+    UBYTE *hn_Data;
+    LONG hn_Size;
+    LONG hn_Capacity;
+    LONG hn_Protection;
+    UBYTE hn_Comment[80];
+    struct DateStamp hn_Date;
+    LONG hn_Key;
+    LONG hn_Shared;                         /* Shared locks and handles */
+    BOOL hn_Exclusive;
+};
+
+struct HalVolume {
+    struct DosList hv_DosList;
+    struct HalVolume *hv_Next;
+    struct MsgPort hv_Port;                 /* Stands in for the handler, for fl_Task */
+    UBYTE hv_BName[32];
+    struct HalNode hv_Root;
+    struct HalLatency hv_Latency;
+};
+
+struct HalAssign {
+    struct HalAssign *ha_Next;
+    UBYTE ha_Name[32];
+    UBYTE ha_Target[256];
+};
+
+struct HalFile {
+    ULONG hf_Magic;
+    LONG hf_Kind;
+    struct HalNode *hf_Node;
+    LONG hf_Position;
+    LONG hf_Block;                          /* Last block a buffered read paid for */
+    BOOL hf_Exclusive;
+};
+
+struct HalProgram {
+    struct HalProgram *hp_Next;
+    UBYTE hp_Path[256];
+    HalMain hp_Main;
+};
+
+static struct HalVolume *halVolumes = NULL;
+static struct HalAssign *halAssigns = NULL;
+static struct HalProgram *halPrograms = NULL;
+static struct HalFile halConsole = { HAL_FILE_MAGIC, FILE_CONSOLE, NULL, 0, -1, FALSE };
+static UBYTE *consoleText = NULL;
+static LONG consoleLength = 0;
+static LONG consoleCapacity = 0;
+static LONG halLocks = 0;
+static LONG nextKey = 1;
+
+/* Errors and time */
+
+static struct Process *Me(VOID)
+{
+    return (struct Process *)FindTask(NULL);
+}
+
+LONG IoErr(VOID)
+{
+    return Me()->pr_Result2;
+}
+
+LONG SetIoErr(LONG code)
+{
+    struct Process *me = Me();
+    LONG old = me->pr_Result2;
+
+    me->pr_Result2 = code;
+    return old;
+}
+
+static const struct {
+    LONG code;
+    const char *text;
+} faults[] = {
+    { ERROR_NO_FREE_STORE, "not enough memory available" },
+    { ERROR_BAD_TEMPLATE, "bad template" },
+    { ERROR_BAD_NUMBER, "bad number" },
+    { ERROR_REQUIRED_ARG_MISSING, "required argument missing" },
+    { ERROR_KEY_NEEDS_ARG, "value after keyword missing" },
+    { ERROR_TOO_MANY_ARGS, "wrong number of arguments" },
+    { ERROR_LINE_TOO_LONG, "argument line invalid or too long" },
+    { ERROR_FILE_NOT_OBJECT, "file is not executable" },
+    { ERROR_OBJECT_IN_USE, "object is in use" },
+    { ERROR_OBJECT_EXISTS, "object already exists" },
+    { ERROR_DIR_NOT_FOUND, "directory not found" },
+    { ERROR_OBJECT_NOT_FOUND, "object not found" },
+    { ERROR_OBJECT_WRONG_TYPE, "object is not of required type" },
+    { ERROR_DIRECTORY_NOT_EMPTY, "directory not empty" },
+    { ERROR_DEVICE_NOT_MOUNTED, "device (or volume) is not mounted" },
+    { ERROR_SEEK_ERROR, "seek failure" },
+    { ERROR_DELETE_PROTECTED, "file is protected from deletion" },
+    { ERROR_RENAME_ACROSS_DEVICES, "rename across devices attempted" },
+    { ERROR_NO_MORE_ENTRIES, "no more entries in directory" },
+    { ERROR_BUFFER_OVERFLOW, "buffer overflow" },
+    { ERROR_BREAK, "***Break" },
+    { 0, NULL }
+};
+
+LONG Fault(LONG code, CONST_STRPTR header, STRPTR buffer, LONG length)
+{
+    const char *text = NULL;
+    LONG i;
+
+    for (i = 0; faults[i].text != NULL; i++) {
+        if (faults[i].code == code) {
+            text = faults[i].text;
+        }
+    }
+    if (text == NULL) {
+        return snprintf((char *)buffer, length, "%s%serror %ld", header ? (const char *)header : "",
+                        header ? ": " : "", code);
+    }
+    return snprintf((char *)buffer, length, "%s%s%s", header ? (const char *)header : "",
+                    header ? ": " : "", text);
+}
+
+LONG PrintFault(LONG code, CONST_STRPTR header)
+{
+    UBYTE text[128];
+
+    Fault(code, header, text, sizeof(text));
+    PutStr(text);
+    PutStr((CONST_STRPTR)"\n");
+    return code != 0;
+}
+
+struct DateStamp *DateStamp(struct DateStamp *date)
+{
+    ULONG seconds = HalMicros() / 1000000UL;
+    ULONG ticks = (HalMicros() % 1000000UL) / 20000UL;
+
+    date->ds_Days = HAL_EPOCH_DAYS + seconds / 86400UL;
+    date->ds_Minute = (seconds % 86400UL) / 60;
+    date->ds_Tick = (seconds % 60) * TICKS_PER_SECOND + ticks;
+    return date;
+}
+
+/* Below zero when a is the later date */
+LONG CompareDates(const struct DateStamp *a, const struct DateStamp *b)
+{
+    if (a->ds_Days != b->ds_Days) {
+        return b->ds_Days - a->ds_Days;
+    }
+    if (a->ds_Minute != b->ds_Minute) {
+        return b->ds_Minute - a->ds_Minute;
+    }
+    return b->ds_Tick - a->ds_Tick;
+}
+
+VOID Delay(LONG ticks)
+{
+    halCounters.hc_Delays++;
+    if (ticks > 0) {
+        HalSpend((ULONG)ticks * 20000UL);
+    }
+}
+
+LONG CheckSignal(LONG mask)
+{
+    return (LONG)(SetSignal(0, (ULONG)mask) & (ULONG)mask);
+}
+
+/* Nodes */
+
+static struct HalNode *NewNode(struct HalNode *parent, CONST_STRPTR name, LONG type)
+{
+    struct HalNode *node = calloc(1, sizeof(struct HalNode));
+    struct HalNode **link;
+
+    if (node == NULL) {
+        HalAbort("out of host memory");
+    }
+    strncpy((char *)node->hn_Name, (const char *)name, sizeof(node->hn_Name) - 1);
+    node->hn_Type = type;
+    node->hn_Parent = parent;
+    node->hn_Volume = parent->hn_Volume;
+    node->hn_Key = nextKey++;
+    DateStamp(&node->hn_Date);
+    /* Entries stay in creation order, as ExNext() reports them */
+    for (link = &parent->hn_Child; *link != NULL; link = &(*link)->hn_Next) {
+    }
+    *link = node;
+    DateStamp(&parent->hn_Date);
+    return node;
+}
+
+static VOID FreeNode(struct HalNode *node)
+{
+    struct HalNode **link;
+
+    for (link = &node->hn_Parent->hn_Child; *link != NULL; link = &(*link)->hn_Next) {
+        if (*link == node) {
+            *link = node->hn_Next;
+            break;
+        }
+    }
+    free(node->hn_Data);
+    free(node);
+}
+
+static struct HalNode *FindChild(struct HalNode *dir, CONST_STRPTR name, LONG length)
+{
+    struct HalNode *child;
+
+    for (child = dir->hn_Child; child != NULL; child = child->hn_Next) {
+        if ((LONG)strlen((char *)child->hn_Name) == length &&
+            Strnicmp(child->hn_Name, name, length) == 0) {
+            return child;
+        }
+    }
+    return NULL;
+}
+
+static struct HalVolume *FindVolumeNamed(CONST_STRPTR name, LONG length)
+{
+    struct HalVolume *volume;
+
+    for (volume = halVolumes; volume != NULL; volume = volume->hv_Next) {
+        if (volume->hv_BName[0] == length && Strnicmp(volume->hv_BName + 1, name, length) == 0) {
+            return volume;
+        }
+    }
+    return NULL;
+}
+
+static struct HalAssign *FindAssign(CONST_STRPTR name, LONG length)
+{
+    struct HalAssign *assign;
+
+    for (assign = halAssigns; assign != NULL; assign = assign->ha_Next) {
+        if ((LONG)strlen((char *)assign->ha_Name) == length &&
+            Strnicmp(assign->ha_Name, name, length) == 0) {
+            return assign;
+        }
+    }
+    return NULL;
+}
+
+struct HalNode *HalLockNode(BPTR lock)
+{
+    struct FileLock *fileLock = BADDR(lock);
+
+    return fileLock != NULL ? (struct HalNode *)fileLock->fl_Key : NULL;
+}
+
+static struct HalNode *BootRoot(VOID)
+{
+    struct HalVolume *volume = FindVolumeNamed((CONST_STRPTR)"System", 6);
+
+    return volume != NULL ? &volume->hv_Root : &halVolumes->hv_Root;
+}
+
+static struct HalNode *CurrentNode(VOID)
+{
+    struct HalNode *node = HalLockNode(Me()->pr_CurrentDir);
+
+    return node != NULL ? node : BootRoot();
+}
+
+static VOID Charge(struct HalNode *node, ULONG micros)
+{
+    (void)node;
+    HalSpend(micros);
+}
+
+/* Walk a path. Returns the node, or NULL with IoErr() set; when only the last */
+/* component is missing, *parent and *leaf say where it would be created */
+static struct HalNode *Resolve(CONST_STRPTR path, BOOL charge, struct HalNode **parent, CONST_STRPTR *leaf)
+{
+    struct HalNode *node;
+    struct HalVolume *volume;
+    struct HalAssign *assign;
+    CONST_STRPTR colon = (CONST_STRPTR)strchr((const char *)path, ':');
+    CONST_STRPTR part;
+    CONST_STRPTR end;
+    UBYTE expanded[512];
+    LONG length;
+
+    if (parent != NULL) {
+        *parent = NULL;
+    }
+
+    if (colon != NULL) {
+        length = colon - path;
+        if (length == 0) {
+            node = CurrentNode();
+            node = &node->hn_Volume->hv_Root;
+        } else if ((volume = FindVolumeNamed(path, length)) != NULL) {
+            node = &volume->hv_Root;
+        } else if (length == 7 && Strnicmp(path, (CONST_STRPTR)"PROGDIR", 7) == 0 &&
+                   HalLockNode(Me()->pr_HomeDir) != NULL) {
+            node = HalLockNode(Me()->pr_HomeDir);
+        } else if ((assign = FindAssign(path, length)) != NULL) {
+            Strncpy(expanded, assign->ha_Target, sizeof(expanded));
+            if (colon[1] != '\0' && !AddPart(expanded, colon + 1, sizeof(expanded))) {
+                SetIoErr(ERROR_LINE_TOO_LONG);
+                return NULL;
+            }
+            return Resolve(expanded, charge, parent, leaf);
+        } else {
+            SetIoErr(ERROR_DEVICE_NOT_MOUNTED);
+            return NULL;
+        }
+        part = colon + 1;
+    } else {
+        node = CurrentNode();
+        part = path;
+    }
+
+    if (charge) {
+        Charge(node, node->hn_Volume->hv_Latency.hl_Lock);
+    }
+
+    while (*part != '\0') {
+        end = part;
+        while (*end != '\0' && *end != '/') {
+            end++;
+        }
+        if (end == part) {
+            /* An empty component is the parent */
+            if (node->hn_Parent == NULL) {
+                SetIoErr(ERROR_OBJECT_NOT_FOUND);
+                return NULL;
+            }
+            node = node->hn_Parent;
+            part = end + 1;
+            continue;
+        }
+        if (node->hn_Type == ST_FILE) {
+            SetIoErr(ERROR_DIR_NOT_FOUND);
+            return NULL;
+        }
+        {
+            struct HalNode *child = FindChild(node, part, end - part);
+
+            if (charge && end != part && part != path + (colon ? colon - path + 1 : 0)) {
+                Charge(node, node->hn_Volume->hv_Latency.hl_Lock);
+            }
+            if (child == NULL) {
+                if (*end == '\0' || (end[0] == '/' && end[1] == '\0')) {
+                    if (parent != NULL) {
+                        *parent = node;
+                    }
+                    if (leaf != NULL) {
+                        *leaf = part;
+                    }
+                    SetIoErr(ERROR_OBJECT_NOT_FOUND);
+                } else {
+                    SetIoErr(ERROR_DIR_NOT_FOUND);
+                }
+                return NULL;
+            }
+            node = child;
+        }
+        part = *end == '/' ? end + 1 : end;
+    }
+    return node;
+}
+
+/* Copy of the last component, without a trailing slash */
+static VOID LeafName(CONST_STRPTR leaf, STRPTR name, LONG size)
+{
+    LONG i;
+
+    for (i = 0; i < size - 1 && leaf[i] != '\0' && leaf[i] != '/'; i++) {
+        name[i] = leaf[i];
+    }
+    name[i] = '\0';
+}
+
+/* Locks */
+
+static BPTR MakeLock(struct HalNode *node, LONG mode)
+{
+    struct FileLock *lock;
+
+    if (node->hn_Exclusive || (mode == EXCLUSIVE_LOCK && node->hn_Shared > 0)) {
+        SetIoErr(ERROR_OBJECT_IN_USE);
+        return NULL;
+    }
+    lock = AllocMem(sizeof(struct FileLock), MEMF_CLEAR | MEMF_PUBLIC);
+    if (lock == NULL) {
+        SetIoErr(ERROR_NO_FREE_STORE);
+        return NULL;
+    }
+    lock->fl_Key = (LONG)node;
+    lock->fl_Access = mode;
+    lock->fl_Task = &node->hn_Volume->hv_Port;
+    lock->fl_Volume = MKBADDR(&node->hn_Volume->hv_DosList);
+    if (mode == EXCLUSIVE_LOCK) {
+        node->hn_Exclusive = TRUE;
+    } else {
+        node->hn_Shared++;
+    }
+    halLocks++;
+    return MKBADDR(lock);
+}
+
+LONG HalOpenLocks(VOID)
+{
+    return halLocks;
+}
+
+BPTR Lock(CONST_STRPTR name, LONG mode)
+{
+    struct HalNode *node;
+
+    halCounters.hc_Locks++;
+    node = Resolve(name, TRUE, NULL, NULL);
+    if (node == NULL) {
+        return NULL;
+    }
+    return MakeLock(node, mode);
+}
+
+VOID UnLock(BPTR lock)
+{
+    struct FileLock *fileLock = BADDR(lock);
+    struct HalNode *node;
+
+    if (fileLock == NULL) {
+        return;
+    }
+    node = (struct HalNode *)fileLock->fl_Key;
+    if (fileLock->fl_Access == EXCLUSIVE_LOCK) {
+        node->hn_Exclusive = FALSE;
+    } else if (--node->hn_Shared < 0) {
+        HalAbort("UnLock() of %s, which is not locked", node->hn_Name);
+    }
+    halLocks--;
+    fileLock->fl_Key = 0;
+    FreeMem(fileLock, sizeof(struct FileLock));
+}
+
+BPTR DupLock(BPTR lock)
+{
+    struct HalNode *node = HalLockNode(lock);
+
+    if (node == NULL) {
+        return NULL;
+    }
+    return MakeLock(node, SHARED_LOCK);
+}
+
+BPTR ParentDir(BPTR lock)
+{
+    struct HalNode *node = HalLockNode(lock);
+
+    halCounters.hc_Locks++;
+    if (node == NULL) {
+        node = BootRoot();
+    }
+    Charge(node, node->hn_Volume->hv_Latency.hl_Lock);
+    if (node->hn_Parent == NULL) {
+        SetIoErr(0);
+        return NULL;
+    }
+    return MakeLock(node->hn_Parent, SHARED_LOCK);
+}
+
+BPTR CurrentDir(BPTR lock)
+{
+    struct Process *me = Me();
+    BPTR old = me->pr_CurrentDir;
+
+    me->pr_CurrentDir = lock;
+    return old;
+}
+
+LONG SameLock(BPTR a, BPTR b)
+{
+    struct HalNode *nodeA = HalLockNode(a);
+    struct HalNode *nodeB = HalLockNode(b);
+
+    if (nodeA == nodeB) {
+        return LOCK_SAME;
+    }
+    if (nodeA != NULL && nodeB != NULL && nodeA->hn_Volume == nodeB->hn_Volume) {
+        return LOCK_SAME_VOLUME;
+    }
+    return LOCK_DIFFERENT;
+}
+
+BPTR CreateDir(CONST_STRPTR name)
+{
+    struct HalNode *parent;
+    struct HalNode *node;
+    CONST_STRPTR leaf;
+    UBYTE leafName[108];
+
+    halCounters.hc_Writes++;
+    node = Resolve(name, TRUE, &parent, &leaf);
+    if (node != NULL) {
+        SetIoErr(ERROR_OBJECT_EXISTS);
+        return NULL;
+    }
+    if (parent == NULL) {
+        return NULL;
+    }
+    Charge(parent, parent->hn_Volume->hv_Latency.hl_Write);
+    LeafName(leaf, leafName, sizeof(leafName));
+    node = NewNode(parent, leafName, ST_USERDIR);
+    return MakeLock(node, EXCLUSIVE_LOCK);
+}
+
+/* Examining */
+
+static VOID FillInfo(struct HalNode *node, struct FileInfoBlock *fib)
+{
+    fib->fib_DirEntryType = node->hn_Type;
+    fib->fib_EntryType = node->hn_Type;
+    if (node->hn_Parent == NULL) {
+        memcpy(fib->fib_FileName, node->hn_Volume->hv_BName + 1, node->hn_Volume->hv_BName[0]);
+        fib->fib_FileName[node->hn_Volume->hv_BName[0]] = '\0';
+    } else {
+        strcpy(fib->fib_FileName, (char *)node->hn_Name);
+    }
+    fib->fib_Protection = node->hn_Protection;
+    fib->fib_Size = node->hn_Type == ST_FILE ? node->hn_Size : 0;
+    fib->fib_NumBlocks = (fib->fib_Size + 511) / 512;
+    fib->fib_Date = node->hn_Date;
+    strcpy(fib->fib_Comment, (char *)node->hn_Comment);
+}
+
+LONG Examine(BPTR lock, struct FileInfoBlock *fib)
+{
+    struct HalNode *node = HalLockNode(lock);
+
+    halCounters.hc_Examines++;
+    if (node == NULL) {
+        node = BootRoot();
+    }
+    Charge(node, node->hn_Volume->hv_Latency.hl_Examine);
+    FillInfo(node, fib);
+    fib->fib_DiskKey = 0;
+    return DOSTRUE;
+}
+
+LONG ExNext(BPTR lock, struct FileInfoBlock *fib)
+{
+    struct HalNode *node = HalLockNode(lock);
+    struct HalNode *child;
+    LONG index;
+
+    halCounters.hc_Examines++;
+    if (node == NULL) {
+        node = BootRoot();
+    }
+    if (node->hn_Type == ST_FILE) {
+        SetIoErr(ERROR_OBJECT_WRONG_TYPE);
+        return DOSFALSE;
+    }
+    Charge(node, node->hn_Volume->hv_Latency.hl_Examine);
+    for (child = node->hn_Child, index = 0; child != NULL && index < fib->fib_DiskKey; index++) {
+        child = child->hn_Next;
+    }
+    if (child == NULL) {
+        SetIoErr(ERROR_NO_MORE_ENTRIES);
+        return DOSFALSE;
+    }
+    FillInfo(child, fib);
+    fib->fib_DiskKey = index + 1;
+    return DOSTRUE;
+}
+
+static struct HalFile *FileOf(BPTR file)
+{
+    struct HalFile *handle = BADDR(file);
+
+    if (handle == NULL || handle->hf_Magic != HAL_FILE_MAGIC) {
+        HalAbort("not a file handle");
+    }
+    return handle;
+}
+
+LONG ExamineFH(BPTR file, struct FileInfoBlock *fib)
+{
+    struct HalFile *handle = FileOf(file);
+
+    halCounters.hc_Examines++;
+    if (handle->hf_Node == NULL) {
+        SetIoErr(ERROR_ACTION_NOT_KNOWN);
+        return DOSFALSE;
+    }
+    Charge(handle->hf_Node, handle->hf_Node->hn_Volume->hv_Latency.hl_Examine);
+    FillInfo(handle->hf_Node, fib);
+    return DOSTRUE;
+}
+
+LONG ExAll(BPTR lock, struct ExAllData *buffer, LONG size, LONG type, struct ExAllControl *control)
+{
+    static const LONG entrySizes[] = {
+        0,
+        offsetof(struct ExAllData, ed_Type),
+        offsetof(struct ExAllData, ed_Size),
+        offsetof(struct ExAllData, ed_Prot),
+        offsetof(struct ExAllData, ed_Days),
+        offsetof(struct ExAllData, ed_Comment),
+        offsetof(struct ExAllData, ed_OwnerUID),
+        sizeof(struct ExAllData)
+    };
+    struct HalNode *dir = HalLockNode(lock);
+    struct HalNode *child;
+    struct ExAllData *entry;
+    struct ExAllData *last = NULL;
+    UBYTE *free = (UBYTE *)buffer;
+    UBYTE *end = (UBYTE *)buffer + size;
+    LONG index;
+    LONG need;
+
+    if (type < ED_NAME || type > ED_OWNER) {
+        SetIoErr(ERROR_BAD_NUMBER);
+        return DOSFALSE;
+    }
+    if (dir == NULL) {
+        dir = BootRoot();
+    }
+    control->eac_Entries = 0;
+    for (child = dir->hn_Child, index = 0; child != NULL && index < (LONG)control->eac_LastKey; index++) {
+        child = child->hn_Next;
+    }
+
+    for (; child != NULL; child = child->hn_Next, index++) {
+        halCounters.hc_Examines++;
+        Charge(dir, dir->hn_Volume->hv_Latency.hl_Examine);
+        if (control->eac_MatchString != NULL &&
+            !MatchPatternNoCase(control->eac_MatchString, child->hn_Name)) {
+            continue;
+        }
+        need = entrySizes[type] + strlen((char *)child->hn_Name) + 1;
+        if (type >= ED_COMMENT) {
+            need += strlen((char *)child->hn_Comment) + 1;
+        }
+        need = (need + 7) & ~7;
+        if (free + need > end) {
+            if (control->eac_Entries == 0) {
+                SetIoErr(ERROR_BUFFER_OVERFLOW);
+                return DOSFALSE;
+            }
+            control->eac_LastKey = index;
+            return DOSTRUE;
+        }
+        entry = (struct ExAllData *)free;
+        memset(entry, 0, entrySizes[type]);
+        entry->ed_Name = free + entrySizes[type];
+        strcpy((char *)entry->ed_Name, (char *)child->hn_Name);
+        if (type >= ED_TYPE) {
+            entry->ed_Type = child->hn_Type;
+        }
+        if (type >= ED_SIZE) {
+            entry->ed_Size = child->hn_Type == ST_FILE ? child->hn_Size : 0;
+        }
+        if (type >= ED_PROTECTION) {
+            entry->ed_Prot = child->hn_Protection;
+        }
+        if (type >= ED_DATE) {
+            entry->ed_Days = child->hn_Date.ds_Days;
+            entry->ed_Mins = child->hn_Date.ds_Minute;
+            entry->ed_Ticks = child->hn_Date.ds_Tick;
+        }
+        if (type >= ED_COMMENT) {
+            entry->ed_Comment = entry->ed_Name + strlen((char *)child->hn_Name) + 1;
+            strcpy((char *)entry->ed_Comment, (char *)child->hn_Comment);
+        }
+        if (last != NULL) {
+            last->ed_Next = entry;
+        }
+        last = entry;
+        control->eac_Entries++;
+        free += need;
+    }
+
+    control->eac_LastKey = index;
+    SetIoErr(ERROR_NO_MORE_ENTRIES);
+    return DOSFALSE;
+}
+
+VOID ExAllEnd(BPTR lock, struct ExAllData *buffer, LONG size, LONG type, struct ExAllControl *control)
+{
+    (void)lock;
+    (void)buffer;
+    (void)size;
+    (void)type;
+    control->eac_LastKey = 0;
+}
+
+LONG Info(BPTR lock, struct InfoData *info)
+{
+    struct HalNode *node = HalLockNode(lock);
+
+    if (node == NULL) {
+        node = BootRoot();
+    }
+    memset(info, 0, sizeof(struct InfoData));
+    info->id_DiskState = 82;                /* ID_VALIDATED */
+    info->id_NumBlocks = 4096;
+    info->id_BytesPerBlock = 512;
+    info->id_DiskType = 0x444F5301;         /* ID_FFS_DISK */
+    info->id_VolumeNode = MKBADDR(&node->hn_Volume->hv_DosList);
+    return DOSTRUE;
+}
+
+static BOOL BuildName(struct HalNode *node, STRPTR buffer, LONG size)
+{
+    UBYTE path[1024];
+    UBYTE part[1024];
+    struct HalVolume *volume = node->hn_Volume;
+    LONG length;
+
+    path[0] = '\0';
+    for (; node->hn_Parent != NULL; node = node->hn_Parent) {
+        if (path[0] != '\0') {
+            snprintf((char *)part, sizeof(part), "%s/%s", node->hn_Name, path);
+        } else {
+            snprintf((char *)part, sizeof(part), "%s", node->hn_Name);
+        }
+        strcpy((char *)path, (char *)part);
+    }
+    length = snprintf((char *)part, sizeof(part), "%.*s:%s",
+                      volume->hv_BName[0], volume->hv_BName + 1, path);
+    if (length >= size) {
+        SetIoErr(ERROR_LINE_TOO_LONG);
+        return FALSE;
+    }
+    strcpy((char *)buffer, (char *)part);
+    return TRUE;
+}
+
+LONG NameFromLock(BPTR lock, STRPTR buffer, LONG size)
+{
+    struct HalNode *node = HalLockNode(lock);
+
+    return BuildName(node != NULL ? node : BootRoot(), buffer, size) ? DOSTRUE : DOSFALSE;
+}
+
+LONG NameFromFH(BPTR file, STRPTR buffer, LONG size)
+{
+    struct HalFile *handle = FileOf(file);
+
+    if (handle->hf_Node == NULL) {
+        SetIoErr(ERROR_OBJECT_WRONG_TYPE);
+        return DOSFALSE;
+    }
+    return BuildName(handle->hf_Node, buffer, size) ? DOSTRUE : DOSFALSE;
+}
+
+/* Files */
+
+static BPTR NewHandle(LONG kind, struct HalNode *node, BOOL exclusive)
+{
+    struct HalFile *handle = AllocMem(sizeof(struct HalFile), MEMF_CLEAR | MEMF_PUBLIC);
+
+    if (handle == NULL) {
+        SetIoErr(ERROR_NO_FREE_STORE);
+        return NULL;
+    }
+    handle->hf_Magic = HAL_FILE_MAGIC;
+    handle->hf_Kind = kind;
+    handle->hf_Node = node;
+    handle->hf_Block = -1;
+    handle->hf_Exclusive = exclusive;
+    if (node != NULL) {
+        if (exclusive) {
+            node->hn_Exclusive = TRUE;
+        } else {
+            node->hn_Shared++;
+        }
+    }
+    return MKBADDR(handle);
+}
+
+static BPTR OpenNode(struct HalNode *node, LONG mode)
+{
+    BOOL exclusive = (mode == MODE_NEWFILE);
+
+    if (node->hn_Type != ST_FILE) {
+        SetIoErr(ERROR_OBJECT_WRONG_TYPE);
+        return NULL;
+    }
+    if (node->hn_Exclusive || (exclusive && node->hn_Shared > 0)) {
+        SetIoErr(ERROR_OBJECT_IN_USE);
+        return NULL;
+    }
+    if (mode == MODE_NEWFILE) {
+        node->hn_Size = 0;
+        DateStamp(&node->hn_Date);
+        /* Replacing a file writes it a new header, which dates its drawer too */
+        DateStamp(&node->hn_Parent->hn_Date);
+    }
+    return NewHandle(FILE_NODE, node, exclusive);
+}
+
+BPTR Open(CONST_STRPTR name, LONG mode)
+{
+    struct HalNode *node;
+    struct HalNode *parent;
+    CONST_STRPTR leaf;
+    UBYTE leafName[108];
+
+    if (Stricmp(name, (CONST_STRPTR)"NIL:") == 0) {
+        return NewHandle(FILE_NIL, NULL, FALSE);
+    }
+    if (Stricmp(name, (CONST_STRPTR)"*") == 0 || Stricmp(name, (CONST_STRPTR)"CONSOLE:") == 0) {
+        return MKBADDR(&halConsole);
+    }
+
+    halCounters.hc_Opens++;
+    node = Resolve(name, TRUE, &parent, &leaf);
+    if (node == NULL && parent != NULL && mode != MODE_OLDFILE) {
+        LeafName(leaf, leafName, sizeof(leafName));
+        Charge(parent, parent->hn_Volume->hv_Latency.hl_Write);
+        node = NewNode(parent, leafName, ST_FILE);
+    }
+    if (node == NULL) {
+        return NULL;
+    }
+    Charge(node, node->hn_Volume->hv_Latency.hl_Open);
+    return OpenNode(node, mode);
+}
+
+BPTR OpenFromLock(BPTR lock)
+{
+    struct FileLock *fileLock = BADDR(lock);
+    struct HalNode *node = HalLockNode(lock);
+    BPTR file;
+
+    halCounters.hc_Opens++;
+    if (node == NULL || node->hn_Type != ST_FILE) {
+        SetIoErr(ERROR_OBJECT_WRONG_TYPE);
+        return NULL;
+    }
+    Charge(node, node->hn_Volume->hv_Latency.hl_Open);
+    /* The lock becomes the handle's */
+    if (fileLock->fl_Access == EXCLUSIVE_LOCK) {
+        node->hn_Exclusive = FALSE;
+    } else {
+        node->hn_Shared--;
+    }
+    file = OpenNode(node, MODE_OLDFILE);
+    if (file == NULL) {
+        if (fileLock->fl_Access == EXCLUSIVE_LOCK) {
+            node->hn_Exclusive = TRUE;
+        } else {
+            node->hn_Shared++;
+        }
+        return NULL;
+    }
+    halLocks--;
+    FreeMem(fileLock, sizeof(struct FileLock));
+    return file;
+}
+
+LONG Close(BPTR file)
+{
+    struct HalFile *handle;
+
+    if (file == NULL) {
+        return DOSTRUE;
+    }
+    handle = FileOf(file);
+    if (handle == &halConsole) {
+        return DOSTRUE;
+    }
+    if (handle->hf_Node != NULL) {
+        if (handle->hf_Exclusive) {
+            handle->hf_Node->hn_Exclusive = FALSE;
+        } else {
+            handle->hf_Node->hn_Shared--;
+        }
+    }
+    handle->hf_Magic = 0;
+    FreeMem(handle, sizeof(struct HalFile));
+    return DOSTRUE;
+}
+
+static VOID ChargeTransfer(struct HalNode *node, ULONG perCall, LONG bytes)
+{
+    const struct HalLatency *latency = &node->hn_Volume->hv_Latency;
+    ULONG micros = perCall;
+
+    if (latency->hl_BytesPerMilli != 0 && bytes > 0) {
+        micros += (ULONG)bytes * 1000UL / latency->hl_BytesPerMilli;
+    }
+    Charge(node, micros);
+}
+
+/* Copy out of a file, paying for the blocks touched when buffered */
+static LONG ReadNode(struct HalFile *handle, UBYTE *buffer, LONG length, BOOL buffered)
+{
+    struct HalNode *node = handle->hf_Node;
+    LONG available = node->hn_Size - handle->hf_Position;
+    LONG block;
+
+    if (length > available) {
+        length = available > 0 ? available : 0;
+    }
+    if (buffered) {
+        block = handle->hf_Position / HAL_BLOCK_SIZE;
+        if (block != handle->hf_Block) {
+            handle->hf_Block = block;
+            halCounters.hc_Reads++;
+            halCounters.hc_BytesRead += HAL_BLOCK_SIZE < available ? HAL_BLOCK_SIZE : (available > 0 ? available : 0);
+            ChargeTransfer(node, node->hn_Volume->hv_Latency.hl_Read, HAL_BLOCK_SIZE < available ? HAL_BLOCK_SIZE : available);
+        }
+    } else {
+        halCounters.hc_Reads++;
+        halCounters.hc_BytesRead += length;
+        ChargeTransfer(node, node->hn_Volume->hv_Latency.hl_Read, length);
+    }
+    memcpy(buffer, node->hn_Data + handle->hf_Position, length);
+    handle->hf_Position += length;
+    return length;
+}
+
+LONG Read(BPTR file, APTR buffer, LONG length)
+{
+    struct HalFile *handle = FileOf(file);
+
+    if (handle->hf_Kind != FILE_NODE || length <= 0) {
+        return 0;
+    }
+    handle->hf_Block = -1;
+    return ReadNode(handle, buffer, length, FALSE);
+}
+
+static VOID ConsoleWrite(CONST_APTR buffer, LONG length)
+{
+    if (consoleLength + length + 1 > consoleCapacity) {
+        consoleCapacity = (consoleLength + length + 1) * 2;
+        consoleText = realloc(consoleText, consoleCapacity);
+        if (consoleText == NULL) {
+            HalAbort("out of host memory");
+        }
+    }
+    memcpy(consoleText + consoleLength, buffer, length);
+    consoleLength += length;
+    consoleText[consoleLength] = '\0';
+    if (getenv("HAL_ECHO") != NULL) {
+        fwrite(buffer, 1, length, stdout);
+    }
+}
+
+CONST_STRPTR HalOutput(VOID)
+{
+    return consoleText != NULL ? consoleText : (UBYTE *)"";
+}
+
+VOID HalClearOutput(VOID)
+{
+    consoleLength = 0;
+    if (consoleText != NULL) {
+        consoleText[0] = '\0';
+    }
+}
+
+static VOID WriteNode(struct HalNode *node, LONG position, CONST_APTR buffer, LONG length)
+{
+    if (position + length > node->hn_Capacity) {
+        node->hn_Capacity = (position + length) * 2 + 64;
+        node->hn_Data = realloc(node->hn_Data, node->hn_Capacity);
+        if (node->hn_Data == NULL) {
+            HalAbort("out of host memory");
+        }
+    }
+    if (position > node->hn_Size) {
+        memset(node->hn_Data + node->hn_Size, 0, position - node->hn_Size);
+    }
+    memcpy(node->hn_Data + position, buffer, length);
+    if (position + length > node->hn_Size) {
+        node->hn_Size = position + length;
+    }
+    DateStamp(&node->hn_Date);
+}
+
+LONG Write(BPTR file, CONST_APTR buffer, LONG length)
+{
+    struct HalFile *handle = FileOf(file);
+
+    if (length <= 0) {
+        return 0;
+    }
+    if (handle->hf_Kind == FILE_NIL) {
+        return length;
+    }
+    if (handle->hf_Kind == FILE_CONSOLE) {
+        ConsoleWrite(buffer, length);
+        return length;
+    }
+    halCounters.hc_Writes++;
+    halCounters.hc_BytesWritten += length;
+    ChargeTransfer(handle->hf_Node, handle->hf_Node->hn_Volume->hv_Latency.hl_Write, length);
+    WriteNode(handle->hf_Node, handle->hf_Position, buffer, length);
+    handle->hf_Position += length;
+    return length;
+}
+
+LONG Seek(BPTR file, LONG position, LONG mode)
+{
+    struct HalFile *handle = FileOf(file);
+    LONG old = handle->hf_Position;
+    LONG base;
+
+    if (handle->hf_Kind != FILE_NODE) {
+        return old;
+    }
+    base = mode == OFFSET_BEGINNING ? 0 : mode == OFFSET_END ? handle->hf_Node->hn_Size : old;
+    if (base + position < 0 || base + position > handle->hf_Node->hn_Size) {
+        SetIoErr(ERROR_SEEK_ERROR);
+        return -1;
+    }
+    handle->hf_Position = base + position;
+    return old;
+}
+
+LONG Flush(BPTR file)
+{
+    (void)file;
+    return DOSTRUE;
+}
+
+LONG FGetC(BPTR file)
+{
+    struct HalFile *handle = FileOf(file);
+    UBYTE c;
+
+    if (handle->hf_Kind != FILE_NODE || ReadNode(handle, &c, 1, TRUE) != 1) {
+        return -1;
+    }
+    return c;
+}
+
+STRPTR FGets(BPTR file, STRPTR buffer, ULONG size)
+{
+    struct HalFile *handle = FileOf(file);
+    ULONG length = 0;
+    UBYTE c;
+
+    if (handle->hf_Kind != FILE_NODE || size == 0) {
+        return NULL;
+    }
+    while (length + 1 < size && ReadNode(handle, &c, 1, TRUE) == 1) {
+        buffer[length++] = c;
+        if (c == '\n') {
+            break;
+        }
+    }
+    buffer[length] = '\0';
+    return length > 0 ? buffer : NULL;
+}
+
+LONG FPutC(BPTR file, LONG c)
+{
+    UBYTE byte = (UBYTE)c;
+
+    return Write(file, &byte, 1) == 1 ? c : -1;
+}
+
+LONG FPuts(BPTR file, CONST_STRPTR string)
+{
+    LONG length = strlen((const char *)string);
+
+    return Write(file, string, length) == length ? 0 : -1;
+}
+
+BPTR Input(VOID)
+{
+    return Me()->pr_CIS;
+}
+
+BPTR Output(VOID)
+{
+    return Me()->pr_COS;
+}
+
+BPTR SelectOutput(BPTR file)
+{
+    struct Process *me = Me();
+    BPTR old = me->pr_COS;
+
+    me->pr_COS = file;
+    return old;
+}
+
+LONG PutStr(CONST_STRPTR string)
+{
+    BPTR output = Output();
+
+    return output != NULL ? FPuts(output, string) : -1;
+}
+
+LONG WriteChars(CONST_STRPTR buffer, ULONG length)
+{
+    BPTR output = Output();
+
+    return output != NULL ? Write(output, buffer, length) : -1;
+}
+
+static LONG FormatTo(BPTR file, CONST_STRPTR format, va_list args)
+{
+    char text[2048];
+    LONG length = vsnprintf(text, sizeof(text), (const char *)format, args);
+
+    if (length >= (LONG)sizeof(text)) {
+        length = sizeof(text) - 1;
+    }
+    if (file == NULL) {
+        return -1;
+    }
+    return Write(file, text, length);
+}
+
+LONG FPrintf(BPTR file, CONST_STRPTR format, ...)
+{
+    va_list args;
+    LONG length;
+
+    va_start(args, format);
+    length = FormatTo(file, format, args);
+    va_end(args);
+    return length;
+}
+
+LONG Printf(CONST_STRPTR format, ...)
+{
+    va_list args;
+    LONG length;
+
+    va_start(args, format);
+    length = FormatTo(Output(), format, args);
+    va_end(args);
+    return length;
+}
+
+LONG VPrintf(CONST_STRPTR format, CONST_APTR args)
+{
+    (void)format;
+    (void)args;
+    HalAbort("VPrintf() with a RawDoFmt() argument array is not modelled");
+    return -1;
+}
+
+LONG VFPrintf(BPTR file, CONST_STRPTR format, CONST_APTR args)
+{
+    (void)file;
+    (void)format;
+    (void)args;
+    HalAbort("VFPrintf() with a RawDoFmt() argument array is not modelled");
+    return -1;
+}
+
+/* Changing the tree */
+
+LONG DeleteFile(CONST_STRPTR name)
+{
+    struct HalNode *node;
+
+    halCounters.hc_Deletes++;
+    node = Resolve(name, TRUE, NULL, NULL);
+    if (node == NULL) {
+        return DOSFALSE;
+    }
+    if (node->hn_Parent == NULL || node->hn_Shared > 0 || node->hn_Exclusive) {
+        SetIoErr(ERROR_OBJECT_IN_USE);
+        return DOSFALSE;
+    }
+    if (node->hn_Child != NULL) {
+        SetIoErr(ERROR_DIRECTORY_NOT_EMPTY);
+        return DOSFALSE;
+    }
+    if (node->hn_Protection & FIBF_DELETE) {
+        SetIoErr(ERROR_DELETE_PROTECTED);
+        return DOSFALSE;
+    }
+    Charge(node, node->hn_Volume->hv_Latency.hl_Write);
+    DateStamp(&node->hn_Parent->hn_Date);
+    FreeNode(node);
+    return DOSTRUE;
+}
+
+LONG Rename(CONST_STRPTR oldName, CONST_STRPTR newName)
+{
+    struct HalNode *node;
+    struct HalNode *parent;
+    struct HalNode **link;
+    CONST_STRPTR leaf;
+
+    halCounters.hc_Writes++;
+    node = Resolve(oldName, TRUE, NULL, NULL);
+    if (node == NULL) {
+        return DOSFALSE;
+    }
+    if (Resolve(newName, TRUE, &parent, &leaf) != NULL) {
+        SetIoErr(ERROR_OBJECT_EXISTS);
+        return DOSFALSE;
+    }
+    if (parent == NULL) {
+        return DOSFALSE;
+    }
+    if (parent->hn_Volume != node->hn_Volume) {
+        SetIoErr(ERROR_RENAME_ACROSS_DEVICES);
+        return DOSFALSE;
+    }
+    Charge(node, node->hn_Volume->hv_Latency.hl_Write);
+    for (link = &node->hn_Parent->hn_Child; *link != NULL; link = &(*link)->hn_Next) {
+        if (*link == node) {
+            *link = node->hn_Next;
+            break;
+        }
+    }
+    node->hn_Next = NULL;
+    node->hn_Parent = parent;
+    for (link = &parent->hn_Child; *link != NULL; link = &(*link)->hn_Next) {
+    }
+    *link = node;
+    LeafName(leaf, node->hn_Name, sizeof(node->hn_Name));
+    return DOSTRUE;
+}
+
+LONG SetProtection(CONST_STRPTR name, LONG protection)
+{
+    struct HalNode *node;
+
+    halCounters.hc_Writes++;
+    node = Resolve(name, TRUE, NULL, NULL);
+    if (node == NULL) {
+        return DOSFALSE;
+    }
+    Charge(node, node->hn_Volume->hv_Latency.hl_Write);
+    node->hn_Protection = protection;
+    return DOSTRUE;
+}
+
+LONG SetComment(CONST_STRPTR name, CONST_STRPTR comment)
+{
+    struct HalNode *node;
+
+    halCounters.hc_Writes++;
+    node = Resolve(name, TRUE, NULL, NULL);
+    if (node == NULL) {
+        return DOSFALSE;
+    }
+    Charge(node, node->hn_Volume->hv_Latency.hl_Write);
+    Strncpy(node->hn_Comment, comment, sizeof(node->hn_Comment));
+    return DOSTRUE;
+}
+
+LONG SetFileDate(CONST_STRPTR name, const struct DateStamp *date)
+{
+    struct HalNode *node;
+
+    halCounters.hc_Writes++;
+    node = Resolve(name, TRUE, NULL, NULL);
+    if (node == NULL) {
+        return DOSFALSE;
+    }
+    Charge(node, node->hn_Volume->hv_Latency.hl_Write);
+    node->hn_Date = *date;
+    return DOSTRUE;
+}
+
+/* DOS objects */
+
+APTR AllocDosObject(ULONG type, struct TagItem *tags)
+{
+    (void)tags;
+    switch (type) {
+    case DOS_FIB:
+        return AllocMem(sizeof(struct FileInfoBlock), MEMF_CLEAR | MEMF_PUBLIC);
+    case DOS_EXALLCONTROL:
+        return AllocMem(sizeof(struct ExAllControl), MEMF_CLEAR | MEMF_PUBLIC);
+    case DOS_RDARGS:
+        return AllocMem(sizeof(struct RDArgs), MEMF_CLEAR | MEMF_PUBLIC);
+    default:
+        SetIoErr(ERROR_BAD_NUMBER);
+        return NULL;
+    }
+}
+
+VOID FreeDosObject(ULONG type, APTR object)
+{
+    if (object == NULL) {
+        return;
+    }
+    switch (type) {
+    case DOS_FIB:
+        FreeMem(object, sizeof(struct FileInfoBlock));
+        break;
+    case DOS_EXALLCONTROL:
+        FreeMem(object, sizeof(struct ExAllControl));
+        break;
+    case DOS_RDARGS:
+        FreeMem(object, sizeof(struct RDArgs));
+        break;
+    default:
+        break;
+    }
+}
+
+/* Path strings */
+
+STRPTR FilePart(CONST_STRPTR path)
+{
+    CONST_STRPTR part = path;
+
+    for (; *path != '\0'; path++) {
+        if (*path == '/' || *path == ':') {
+            part = path + 1;
+        }
+    }
+    return (STRPTR)part;
+}
+
+STRPTR PathPart(CONST_STRPTR path)
+{
+    CONST_STRPTR file = FilePart(path);
+
+    if (file > path && file[-1] == '/') {
+        file--;
+    }
+    return (STRPTR)file;
+}
+
+BOOL AddPart(STRPTR dirname, CONST_STRPTR filename, ULONG size)
+{
+    ULONG length;
+
+    if (strchr((const char *)filename, ':') != NULL) {
+        if (strlen((const char *)filename) + 1 > size) {
+            SetIoErr(ERROR_LINE_TOO_LONG);
+            return FALSE;
+        }
+        strcpy((char *)dirname, (const char *)filename);
+        return TRUE;
+    }
+    length = strlen((char *)dirname);
+    if (length > 0 && dirname[length - 1] != ':' && dirname[length - 1] != '/' && *filename != '\0') {
+        if (length + 2 > size) {
+            SetIoErr(ERROR_LINE_TOO_LONG);
+            return FALSE;
+        }
+        dirname[length++] = '/';
+        dirname[length] = '\0';
+    }
+    if (length + strlen((const char *)filename) + 1 > size) {
+        SetIoErr(ERROR_LINE_TOO_LONG);
+        return FALSE;
+    }
+    strcpy((char *)dirname + length, (const char *)filename);
+    return TRUE;
+}
+
+LONG StrToLong(CONST_STRPTR string, LONG *value)
+{
+    CONST_STRPTR start = string;
+    LONG result = 0;
+    BOOL negative = FALSE;
+    BOOL digits = FALSE;
+
+    while (*string == ' ' || *string == '\t') {
+        string++;
+    }
+    if (*string == '-' || *string == '+') {
+        negative = (*string == '-');
+        string++;
+    }
+    while (*string >= '0' && *string <= '9') {
+        result = result * 10 + (*string - '0');
+        string++;
+        digits = TRUE;
+    }
+    if (!digits) {
+        return -1;
+    }
+    *value = negative ? -result : result;
+    return string - start;
+}
+
+/* Argument parsing */
+
+/* One item of a command line - quotes removed, *" *N and ** decoded */
+/* Copy a quoted string after its opening quote, with the * escapes, and step past its end */
+static CONST_STRPTR QuotedItem(CONST_STRPTR in, STRPTR item, LONG *length, LONG size)
+{
+    while (*in != '\0' && *in != '"' && *in != '\n') {
+        UBYTE c = *in++;
+
+        if (c == '*' && *in != '\0') {
+            c = *in++;
+            if (c == 'N' || c == 'n') {
+                c = '\n';
+            } else if (c == 'E' || c == 'e') {
+                c = 0x1B;
+            }
+        }
+        if (*length < size - 1) {
+            item[(*length)++] = c;
+        }
+    }
+    if (*in == '"') {
+        in++;
+    }
+    return in;
+}
+
+static LONG NextItem(CONST_STRPTR *line, STRPTR item, LONG size, BOOL *quoted)
+{
+    CONST_STRPTR in = *line;
+    LONG length = 0;
+
+    while (*in == ' ' || *in == '\t') {
+        in++;
+    }
+    *quoted = FALSE;
+    if (*in == '\0' || *in == '\n' || *in == ';') {
+        *line = in;
+        return ITEM_NOTHING;
+    }
+    if (*in == '"') {
+        *quoted = TRUE;
+        in = QuotedItem(in + 1, item, &length, size);
+    } else {
+        while (*in != '\0' && *in != ' ' && *in != '\t' && *in != '\n') {
+            /* KEY="value" - the quotes are not part of the value */
+            if (*in == '"' && length > 0 && item[length - 1] == '=') {
+                in = QuotedItem(in + 1, item, &length, size);
+                continue;
+            }
+            if (length < size - 1) {
+                item[length++] = *in;
+            }
+            in++;
+        }
+    }
+    item[length] = '\0';
+    *line = in;
+    return *quoted ? ITEM_QUOTED : ITEM_UNQUOTED;
+}
+
+LONG ReadItem(STRPTR name, LONG maxchars, struct CSource *source)
+{
+    CONST_STRPTR line;
+    CONST_STRPTR start;
+    BOOL quoted;
+    LONG result;
+    LONG length;
+
+    if (source == NULL) {
+        return ITEM_NOTHING;
+    }
+    start = line = source->CS_Buffer + source->CS_CurChr;
+    while (*line == ' ' || *line == '\t') {
+        line++;
+    }
+    if (*line == '=') {
+        source->CS_CurChr = line + 1 - source->CS_Buffer;
+        return ITEM_EQUAL;
+    }
+    result = NextItem(&line, name, maxchars, &quoted);
+    if (result == ITEM_UNQUOTED) {
+        /* An unquoted item ends at '=' */
+        for (length = 0; name[length] != '\0' && name[length] != '='; length++) {
+        }
+        if (name[length] == '=') {
+            name[length] = '\0';
+            line = start;
+            while (*line == ' ' || *line == '\t') {
+                line++;
+            }
+            line += length;
+        }
+    }
+    source->CS_CurChr = line - source->CS_Buffer;
+    return result;
+}
+
+/* Memory handed out by ReadArgs(), chained from RDA_DAList */
+static APTR ArgsAlloc(struct RDArgs *rdargs, ULONG size)
+{
+    APTR *block = AllocVec(sizeof(APTR) + size, MEMF_CLEAR);
+
+    if (block == NULL) {
+        return NULL;
+    }
+    block[0] = (APTR)rdargs->RDA_DAList;
+    rdargs->RDA_DAList = (LONG)block;
+    return block + 1;
+}
+
+struct TemplateItem {
+    UBYTE ti_Names[64];                     /* Names and aliases, '=' separated */
+    BOOL ti_Always;                         /* /A */
+    BOOL ti_Keyword;                        /* /K */
+    BOOL ti_Switch;                         /* /S or /T */
+    BOOL ti_Number;                         /* /N */
+    BOOL ti_Multiple;                       /* /M */
+    BOOL ti_Rest;                           /* /F */
+    BOOL ti_Filled;
+    LONG ti_Count;                          /* /M values so far */
+};
+
+static LONG ParseTemplate(CONST_STRPTR template, struct TemplateItem *items, LONG max)
+{
+    LONG count = 0;
+    LONG length;
+    CONST_STRPTR end;
+    CONST_STRPTR slash;
+
+    while (*template != '\0' && count < max) {
+        struct TemplateItem *item = &items[count++];
+
+        memset(item, 0, sizeof(struct TemplateItem));
+        end = (CONST_STRPTR)strchr((const char *)template, ',');
+        if (end == NULL) {
+            end = template + strlen((const char *)template);
+        }
+        slash = (CONST_STRPTR)memchr(template, '/', end - template);
+        length = (slash != NULL ? slash : end) - template;
+        if (length >= (LONG)sizeof(item->ti_Names)) {
+            return -1;
+        }
+        memcpy(item->ti_Names, template, length);
+        for (; slash != NULL && slash < end; slash++) {
+            switch (ToUpper(slash[1])) {
+            case 'A': item->ti_Always = TRUE; break;
+            case 'K': item->ti_Keyword = TRUE; break;
+            case 'S': case 'T': item->ti_Switch = TRUE; break;
+            case 'N': item->ti_Number = TRUE; break;
+            case 'M': item->ti_Multiple = TRUE; break;
+            case 'F': item->ti_Rest = TRUE; break;
+            default: break;
+            }
+            slash = (CONST_STRPTR)memchr(slash + 1, '/', end - slash - 1);
+            if (slash == NULL) {
+                break;
+            }
+            slash--;
+        }
+        template = *end == ',' ? end + 1 : end;
+    }
+    return count;
+}
+
+static LONG FindKeyword(struct TemplateItem *items, LONG count, CONST_STRPTR word, LONG length)
+{
+    CONST_STRPTR name;
+    CONST_STRPTR end;
+    LONG i;
+
+    for (i = 0; i < count; i++) {
+        for (name = items[i].ti_Names; *name != '\0'; name = *end ? end + 1 : end) {
+            end = (CONST_STRPTR)strchr((const char *)name, '=');
+            if (end == NULL) {
+                end = name + strlen((const char *)name);
+            }
+            if (end - name == length && Strnicmp(name, word, length) == 0) {
+                return i;
+            }
+        }
+    }
+    return -1;
+}
+
+static BOOL StoreValue(struct RDArgs *rdargs, struct TemplateItem *item, LONG *slot, CONST_STRPTR value)
+{
+    STRPTR copy;
+    STRPTR *list;
+    STRPTR *old;
+    LONG *number;
+    LONG i;
+
+    copy = ArgsAlloc(rdargs, strlen((const char *)value) + 1);
+    if (copy == NULL) {
+        SetIoErr(ERROR_NO_FREE_STORE);
+        return FALSE;
+    }
+    strcpy((char *)copy, (const char *)value);
+
+    if (item->ti_Multiple) {
+        list = ArgsAlloc(rdargs, sizeof(STRPTR) * (item->ti_Count + 2));
+        if (list == NULL) {
+            SetIoErr(ERROR_NO_FREE_STORE);
+            return FALSE;
+        }
+        old = (STRPTR *)*slot;
+        for (i = 0; i < item->ti_Count; i++) {
+            list[i] = old[i];
+        }
+        list[item->ti_Count++] = copy;
+        *slot = (LONG)list;
+    } else if (item->ti_Number) {
+        number = ArgsAlloc(rdargs, sizeof(LONG));
+        if (number == NULL || StrToLong(copy, number) < 0) {
+            SetIoErr(ERROR_BAD_NUMBER);
+            return FALSE;
+        }
+        *slot = (LONG)number;
+    } else {
+        *slot = (LONG)copy;
+    }
+    item->ti_Filled = TRUE;
+    return TRUE;
+}
+
+struct RDArgs *ReadArgs(CONST_STRPTR arg_template, LONG *array, struct RDArgs *args)
+{
+    struct TemplateItem items[32];
+    struct RDArgs *rdargs = args;
+    CONST_STRPTR line;
+    CONST_STRPTR before;
+    UBYTE word[512];
+    BOOL quoted;
+    LONG count;
+    LONG index;
+    LONG i;
+
+    count = ParseTemplate(arg_template, items, 32);
+    if (count < 0) {
+        SetIoErr(ERROR_BAD_TEMPLATE);
+        return NULL;
+    }
+    if (rdargs == NULL) {
+        rdargs = AllocDosObject(DOS_RDARGS, NULL);
+        if (rdargs == NULL) {
+            SetIoErr(ERROR_NO_FREE_STORE);
+            return NULL;
+        }
+        rdargs->RDA_Flags = 0x80000000L;    /* Ours to free */
+    }
+    rdargs->RDA_DAList = 0;
+    line = rdargs->RDA_Source.CS_Buffer != NULL ? rdargs->RDA_Source.CS_Buffer : GetArgStr();
+    if (line == NULL) {
+        line = (CONST_STRPTR)"";
+    }
+
+    for (;;) {
+        before = line;
+        if (NextItem(&line, word, sizeof(word), &quoted) == ITEM_NOTHING) {
+            break;
+        }
+        index = -1;
+        if (!quoted) {
+            UBYTE *equals = (UBYTE *)strchr((char *)word, '=');
+            LONG length = equals != NULL ? equals - word : (LONG)strlen((char *)word);
+
+            index = FindKeyword(items, count, word, length);
+            if (index >= 0) {
+                if (items[index].ti_Switch) {
+                    array[index] = DOSTRUE;
+                    items[index].ti_Filled = TRUE;
+                    continue;
+                }
+                if (items[index].ti_Rest) {
+                    while (*line == ' ' || *line == '\t') {
+                        line++;
+                    }
+                    strncpy((char *)word, (const char *)line, sizeof(word) - 1);
+                    word[strcspn((char *)word, "\n")] = '\0';
+                    line += strlen((const char *)line);
+                } else if (equals != NULL) {
+                    memmove(word, equals + 1, strlen((char *)equals + 1) + 1);
+                } else if (NextItem(&line, word, sizeof(word), &quoted) == ITEM_NOTHING) {
+                    SetIoErr(ERROR_KEY_NEEDS_ARG);
+                    goto fail;
+                }
+                if (!StoreValue(rdargs, &items[index], &array[index], word)) {
+                    goto fail;
+                }
+                continue;
+            }
+        }
+        /* Positional - the first item still open that takes one */
+        for (i = 0; i < count; i++) {
+            if (!items[i].ti_Keyword && !items[i].ti_Switch &&
+                (!items[i].ti_Filled || items[i].ti_Multiple)) {
+                break;
+            }
+        }
+        if (i == count) {
+            SetIoErr(ERROR_TOO_MANY_ARGS);
+            goto fail;
+        }
+        if (items[i].ti_Rest) {
+            while (*before == ' ' || *before == '\t') {
+                before++;
+            }
+            strncpy((char *)word, (const char *)before, sizeof(word) - 1);
+            word[strcspn((char *)word, "\n")] = '\0';
+            line = before + strlen((const char *)before);
+        }
+        if (!StoreValue(rdargs, &items[i], &array[i], word)) {
+            goto fail;
+        }
+    }
+
+    for (i = 0; i < count; i++) {
+        if (items[i].ti_Always && !items[i].ti_Filled) {
+            SetIoErr(ERROR_REQUIRED_ARG_MISSING);
+            goto fail;
+        }
+    }
+    SetIoErr(0);
+    return rdargs;
+
+fail:
+    {
+        LONG code = IoErr();
+
+        FreeArgs(rdargs);
+        SetIoErr(code);
+    }
+    return NULL;
+}
+
+VOID FreeArgs(struct RDArgs *args)
+{
+    APTR *block;
+    APTR *next;
+
+    if (args == NULL) {
+        return;
+    }
+    for (block = (APTR *)args->RDA_DAList; block != NULL; block = next) {
+        next = block[0];
+        FreeVec(block);
+    }
+    args->RDA_DAList = 0;
+    if (args->RDA_Flags == (LONG)0x80000000L) {
+        FreeDosObject(DOS_RDARGS, args);
+    }
+}
+
+/* Variables */
+
+LONG GetVar(CONST_STRPTR name, STRPTR buffer, LONG size, ULONG flags)
+{
+    UBYTE path[256];
+    BPTR file;
+    LONG length;
+    LONG i;
+
+    if (flags & GVF_LOCAL_ONLY) {
+        SetIoErr(ERROR_OBJECT_NOT_FOUND);
+        return -1;
+    }
+    snprintf((char *)path, sizeof(path), "ENV:%s", name);
+    file = Open(path, MODE_OLDFILE);
+    if (file == NULL) {
+        SetIoErr(ERROR_OBJECT_NOT_FOUND);
+        return -1;
+    }
+    length = Read(file, buffer, size > 0 ? size - 1 : 0);
+    Close(file);
+    if (length < 0) {
+        return -1;
+    }
+    if (!(flags & GVF_BINARY_VAR)) {
+        for (i = 0; i < length; i++) {
+            if (buffer[i] == '\n') {
+                length = i;
+                break;
+            }
+        }
+    }
+    if (!(flags & GVF_DONT_NULL_TERM) && size > 0) {
+        buffer[length] = '\0';
+    }
+    return length;
+}
+
+/* The directories a variable's path names are created as needed */
+static BOOL WriteVar(CONST_STRPTR root, CONST_STRPTR name, CONST_STRPTR buffer, LONG size)
+{
+    UBYTE path[256];
+    UBYTE *slash;
+    BPTR file;
+    BPTR lock;
+
+    snprintf((char *)path, sizeof(path), "%s%s", root, name);
+    for (slash = (UBYTE *)strchr((char *)path, ':') + 1; (slash = (UBYTE *)strchr((char *)slash, '/')) != NULL; slash++) {
+        *slash = '\0';
+        lock = Lock(path, SHARED_LOCK);
+        if (lock == NULL) {
+            lock = CreateDir(path);
+        }
+        UnLock(lock);
+        *slash = '/';
+    }
+    file = Open(path, MODE_NEWFILE);
+    if (file == NULL) {
+        return FALSE;
+    }
+    Write(file, buffer, size);
+    Close(file);
+    return TRUE;
+}
+
+LONG SetVar(CONST_STRPTR name, CONST_STRPTR buffer, LONG size, ULONG flags)
+{
+    if (size < 0) {
+        size = strlen((const char *)buffer);
+    }
+    if (flags & GVF_LOCAL_ONLY) {
+        SetIoErr(ERROR_NOT_IMPLEMENTED);
+        return DOSFALSE;
+    }
+    if (!WriteVar((CONST_STRPTR)"ENV:", name, buffer, size)) {
+        return DOSFALSE;
+    }
+    if ((flags & GVF_SAVE_VAR) && !WriteVar((CONST_STRPTR)"ENVARC:", name, buffer, size)) {
+        return DOSFALSE;
+    }
+    return DOSTRUE;
+}
+
+LONG DeleteVar(CONST_STRPTR name, ULONG flags)
+{
+    UBYTE path[256];
+
+    (void)flags;
+    snprintf((char *)path, sizeof(path), "ENV:%s", name);
+    return DeleteFile(path);
+}
+
+/* Patterns - the parsed form is the source with a marker in front, matched directly */
+
+struct Continuation {
+    CONST_STRPTR co_Pattern;
+    CONST_STRPTR co_End;
+    struct Continuation *co_Next;
+    CONST_STRPTR co_MustPass;               /* A # repeat must have consumed something */
+};
+
+static CONST_STRPTR ElementEnd(CONST_STRPTR p, CONST_STRPTR end)
+{
+    LONG depth;
+
+    if (p >= end) {
+        return end;
+    }
+    switch (*p) {
+    case '\'':
+        return p + 2 <= end ? p + 2 : end;
+    case '#':
+    case '~':
+        return ElementEnd(p + 1, end);
+    case '[':
+        for (p++; p < end && *p != ']'; p++) {
+        }
+        return p < end ? p + 1 : end;
+    case '(':
+        for (depth = 0; p < end; p++) {
+            if (*p == '\'') {
+                p++;
+            } else if (*p == '(') {
+                depth++;
+            } else if (*p == ')' && --depth == 0) {
+                return p + 1;
+            }
+        }
+        return end;
+    default:
+        return p + 1;
+    }
+}
+
+static BOOL Same(UBYTE a, UBYTE b, BOOL noCase)
+{
+    return noCase ? ToUpper(a) == ToUpper(b) : a == b;
+}
+
+static BOOL ClassMatch(CONST_STRPTR p, CONST_STRPTR end, UBYTE c, BOOL noCase)
+{
+    BOOL negate = FALSE;
+    BOOL found = FALSE;
+
+    p++;
+    end--;
+    if (p < end && *p == '~') {
+        negate = TRUE;
+        p++;
+    }
+    while (p < end) {
+        if (p + 2 < end && p[1] == '-') {
+            UBYTE low = noCase ? ToUpper(p[0]) : p[0];
+            UBYTE high = noCase ? ToUpper(p[2]) : p[2];
+            UBYTE test = noCase ? ToUpper(c) : c;
+
+            if (test >= low && test <= high) {
+                found = TRUE;
+            }
+            p += 3;
+        } else {
+            if (Same(*p, c, noCase)) {
+                found = TRUE;
+            }
+            p++;
+        }
+    }
+    return found != negate;
+}
+
+static BOOL MatchFrom(CONST_STRPTR p, CONST_STRPTR end, CONST_STRPTR s, CONST_STRPTR send,
+                      struct Continuation *next, BOOL noCase);
+
+static BOOL MatchWhole(CONST_STRPTR p, CONST_STRPTR end, CONST_STRPTR s, CONST_STRPTR send, BOOL noCase)
+{
+    return MatchFrom(p, end, s, send, NULL, noCase);
+}
+
+static BOOL MatchFrom(CONST_STRPTR p, CONST_STRPTR end, CONST_STRPTR s, CONST_STRPTR send,
+                      struct Continuation *next, BOOL noCase)
+{
+    CONST_STRPTR elementEnd;
+    CONST_STRPTR alternative;
+    CONST_STRPTR t;
+    struct Continuation continuation;
+    LONG depth;
+
+    if (p >= end) {
+        if (next == NULL) {
+            return s == send;
+        }
+        if (next->co_MustPass != NULL && s == next->co_MustPass) {
+            return FALSE;
+        }
+        return MatchFrom(next->co_Pattern, next->co_End, s, send, next->co_Next, noCase);
+    }
+
+    elementEnd = ElementEnd(p, end);
+    switch (*p) {
+    case '?':
+        return s < send && MatchFrom(p + 1, end, s + 1, send, next, noCase);
+    case '%':
+        return MatchFrom(p + 1, end, s, send, next, noCase);
+    case '\'':
+        return s < send && p + 1 < end && Same(p[1], *s, noCase) &&
+               MatchFrom(elementEnd, end, s + 1, send, next, noCase);
+    case '[':
+        return s < send && ClassMatch(p, elementEnd, *s, noCase) &&
+               MatchFrom(elementEnd, end, s + 1, send, next, noCase);
+    case '#':
+        /* Zero more of the element, or one more and the # again */
+        if (MatchFrom(elementEnd, end, s, send, next, noCase)) {
+            return TRUE;
+        }
+        continuation.co_Pattern = p;
+        continuation.co_End = end;
+        continuation.co_Next = next;
+        continuation.co_MustPass = s;
+        return MatchFrom(p + 1, elementEnd, s, send, &continuation, noCase);
+    case '~':
+        for (t = s; t <= send; t++) {
+            if (!MatchWhole(p + 1, elementEnd, s, t, noCase) &&
+                MatchFrom(elementEnd, end, t, send, next, noCase)) {
+                return TRUE;
+            }
+        }
+        return FALSE;
+    case '(':
+        continuation.co_Pattern = elementEnd;
+        continuation.co_End = end;
+        continuation.co_Next = next;
+        continuation.co_MustPass = NULL;
+        alternative = p + 1;
+        for (t = p + 1, depth = 0; t < elementEnd - 1; t++) {
+            if (*t == '\'') {
+                t++;
+            } else if (*t == '(') {
+                depth++;
+            } else if (*t == ')') {
+                depth--;
+            } else if (*t == '|' && depth == 0) {
+                if (MatchFrom(alternative, t, s, send, &continuation, noCase)) {
+                    return TRUE;
+                }
+                alternative = t + 1;
+            }
+        }
+        return MatchFrom(alternative, elementEnd - 1, s, send, &continuation, noCase);
+    default:
+        return s < send && Same(*p, *s, noCase) && MatchFrom(p + 1, end, s + 1, send, next, noCase);
+    }
+}
+
+static LONG Parse(CONST_STRPTR source, STRPTR dest, LONG length)
+{
+    LONG size = strlen((const char *)source);
+    CONST_STRPTR p;
+    BOOL wild = FALSE;
+
+    if (size + 2 > length) {
+        return -1;
+    }
+    for (p = source; *p != '\0'; p++) {
+        if (strchr("#?()|~[]%", *p) != NULL) {
+            wild = TRUE;
+        } else if (*p == '\'' && p[1] != '\0') {
+            p++;
+        }
+    }
+    dest[0] = 0x80;
+    strcpy((char *)dest + 1, (const char *)source);
+    return wild ? 1 : 0;
+}
+
+LONG ParsePattern(CONST_STRPTR source, STRPTR dest, LONG length)
+{
+    return Parse(source, dest, length);
+}
+
+LONG ParsePatternNoCase(CONST_STRPTR source, STRPTR dest, LONG length)
+{
+    return Parse(source, dest, length);
+}
+
+static BOOL Match(CONST_STRPTR pattern, CONST_STRPTR string, BOOL noCase)
+{
+    if (pattern[0] == 0x80) {
+        pattern++;
+    }
+    return MatchWhole(pattern, pattern + strlen((const char *)pattern),
+                      string, string + strlen((const char *)string), noCase);
+}
+
+BOOL MatchPattern(CONST_STRPTR pattern, CONST_STRPTR string)
+{
+    return Match(pattern, string, FALSE);
+}
+
+BOOL MatchPatternNoCase(CONST_STRPTR pattern, CONST_STRPTR string)
+{
+    return Match(pattern, string, TRUE);
+}
+
+/* Programs and seglists */
+
+BOOL HalAddProgram(CONST_STRPTR path, HalMain entry)
+{
+    struct HalProgram *program = calloc(1, sizeof(struct HalProgram));
+    UBYTE text[300];
+
+    if (program == NULL) {
+        return FALSE;
+    }
+    Strncpy(program->hp_Path, path, sizeof(program->hp_Path));
+    program->hp_Main = entry;
+    program->hp_Next = halPrograms;
+    halPrograms = program;
+    snprintf((char *)text, sizeof(text), HAL_SEG_PREFIX "%s\n", path);
+    return HalWriteFile(path, text, strlen((char *)text), 0);
+}
+
+/* The program a file stands for, NULL for an ordinary file */
+static HalMain ProgramOf(struct HalNode *node)
+{
+    struct HalProgram *program;
+    LONG length = strlen(HAL_SEG_PREFIX);
+    UBYTE path[256];
+    LONG i;
+
+    if (node->hn_Size <= length || memcmp(node->hn_Data, HAL_SEG_PREFIX, length) != 0) {
+        return NULL;
+    }
+    for (i = 0; i < (LONG)sizeof(path) - 1 && length + i < node->hn_Size &&
+                node->hn_Data[length + i] != '\n'; i++) {
+        path[i] = node->hn_Data[length + i];
+    }
+    path[i] = '\0';
+    for (program = halPrograms; program != NULL; program = program->hp_Next) {
+        if (Stricmp(program->hp_Path, path) == 0) {
+            return program->hp_Main;
+        }
+    }
+    return NULL;
+}
+
+BPTR LoadSeg(CONST_STRPTR name)
+{
+    struct HalNode *node;
+    HalMain entry;
+    BPTR file;
+    BPTR seglist;
+
+    halCounters.hc_LoadSegs++;
+    file = Open(name, MODE_OLDFILE);
+    if (file == NULL) {
+        return NULL;
+    }
+    node = ((struct HalFile *)BADDR(file))->hf_Node;
+    /* The whole file is read, as the loader would */
+    ReadNode((struct HalFile *)BADDR(file), (UBYTE[1]){ 0 }, 0, FALSE);
+    ChargeTransfer(node, 0, node->hn_Size);
+    halCounters.hc_BytesRead += node->hn_Size;
+    entry = ProgramOf(node);
+    Close(file);
+    if (entry == NULL) {
+        SetIoErr(ERROR_FILE_NOT_OBJECT);
+        return NULL;
+    }
+    seglist = HalNewSeg(entry);
+    if (seglist == NULL) {
+        SetIoErr(ERROR_NO_FREE_STORE);
+    }
+    return seglist;
+}
+
+BOOL HalProgramPath(CONST_STRPTR path, STRPTR resolved, LONG size)
+{
+    struct HalNode *node = Resolve(path, FALSE, NULL, NULL);
+
+    if (node == NULL || ProgramOf(node) == NULL) {
+        return FALSE;
+    }
+    return BuildName(node, resolved, size);
+}
+
+/* No resident list on the host */
+struct Segment *FindSegment(CONST_STRPTR name, const struct Segment *start, LONG system)
+{
+    (void)name;
+    (void)start;
+    (void)system;
+    return NULL;
+}
+
+struct CommandLineInterface *Cli(VOID)
+{
+    return (struct CommandLineInterface *)BADDR(Me()->pr_CLI);
+}
+
+BOOL GetProgramName(STRPTR buffer, LONG length)
+{
+    struct CommandLineInterface *cli = Cli();
+    UBYTE *name;
+
+    if (cli == NULL || cli->cli_CommandName == NULL) {
+        if (length > 0) {
+            buffer[0] = '\0';
+        }
+        SetIoErr(ERROR_OBJECT_WRONG_TYPE);
+        return FALSE;
+    }
+    name = BADDR(cli->cli_CommandName);
+    if (name[0] + 1 > length) {
+        SetIoErr(ERROR_LINE_TOO_LONG);
+        return FALSE;
+    }
+    memcpy(buffer, name + 1, name[0]);
+    buffer[name[0]] = '\0';
+    return TRUE;
+}
+
+BPTR GetProgramDir(VOID)
+{
+    return Me()->pr_HomeDir;
+}
+
+STRPTR GetArgStr(VOID)
+{
+    return Me()->pr_Arguments;
+}
+
+/* Dos list - the volumes */
+
+static struct DosList dosListHead;
+
+struct DosList *LockDosList(ULONG flags)
+{
+    (void)flags;
+    return &dosListHead;
+}
+
+VOID UnLockDosList(ULONG flags)
+{
+    (void)flags;
+}
+
+struct DosList *NextDosEntry(struct DosList *list, ULONG flags)
+{
+    struct HalVolume *volume;
+
+    if (!(flags & LDF_VOLUMES)) {
+        return NULL;
+    }
+    if (list == &dosListHead) {
+        return halVolumes != NULL ? &halVolumes->hv_DosList : NULL;
+    }
+    volume = (struct HalVolume *)list;
+    return volume->hv_Next != NULL ? &volume->hv_Next->hv_DosList : NULL;
+}
+
+struct DosList *FindDosEntry(struct DosList *list, CONST_STRPTR name, ULONG flags)
+{
+    LONG length = strlen((const char *)name);
+
+    if (length > 0 && name[length - 1] == ':') {
+        length--;
+    }
+    while ((list = NextDosEntry(list, flags)) != NULL) {
+        UBYTE *bname = BADDR(list->dol_Name);
+
+        if (bname[0] == length && Strnicmp(bname + 1, name, length) == 0) {
+            return list;
+        }
+    }
+    return NULL;
+}
+
+/* Harness side - building the world */
+
+BOOL HalAddVolume(CONST_STRPTR name, const struct HalLatency *latency)
+{
+    struct HalVolume *volume = calloc(1, sizeof(struct HalVolume));
+    struct HalVolume **link;
+    LONG length = strlen((const char *)name);
+
+    if (volume == NULL || length > 30) {
+        free(volume);
+        return FALSE;
+    }
+    volume->hv_BName[0] = (UBYTE)length;
+    memcpy(volume->hv_BName + 1, name, length);
+    volume->hv_DosList.dol_Type = DLT_VOLUME;
+    volume->hv_DosList.dol_Name = (BSTR)volume->hv_BName;
+    volume->hv_DosList.dol_Task = &volume->hv_Port;
+    volume->hv_DosList.dol_DiskType = 0x444F5301;
+    volume->hv_Port.mp_Node.ln_Type = NT_MSGPORT;
+    volume->hv_Port.mp_Node.ln_Name = (char *)volume->hv_BName + 1;
+    volume->hv_Root.hn_Type = ST_ROOT;
+    volume->hv_Root.hn_Volume = volume;
+    volume->hv_Root.hn_Key = nextKey++;
+    if (latency != NULL) {
+        volume->hv_Latency = *latency;
+    }
+    for (link = &halVolumes; *link != NULL; link = &(*link)->hv_Next) {
+    }
+    *link = volume;
+    return TRUE;
+}
+
+BOOL HalAssign(CONST_STRPTR name, CONST_STRPTR target)
+{
+    struct HalAssign *assign = calloc(1, sizeof(struct HalAssign));
+
+    if (assign == NULL) {
+        return FALSE;
+    }
+    Strncpy(assign->ha_Name, name, sizeof(assign->ha_Name));
+    if (assign->ha_Name[0] != '\0' && assign->ha_Name[strlen((char *)assign->ha_Name) - 1] == ':') {
+        assign->ha_Name[strlen((char *)assign->ha_Name) - 1] = '\0';
+    }
+    Strncpy(assign->ha_Target, target, sizeof(assign->ha_Target));
+    assign->ha_Next = halAssigns;
+    halAssigns = assign;
+    return TRUE;
+}
+
+BOOL HalMakeDir(CONST_STRPTR path)
+{
+    struct HalNode *parent;
+    struct HalNode *node;
+    CONST_STRPTR leaf;
+    UBYTE partial[512];
+    UBYTE leafName[108];
+    LONG i;
+
+    Strncpy(partial, path, sizeof(partial));
+    for (i = 0; partial[i] != '\0'; i++) {
+        if (partial[i] == '/' || partial[i + 1] == '\0') {
+            UBYTE saved = partial[i + 1];
+
+            if (partial[i] == '/') {
+                partial[i] = '\0';
+            } else {
+                partial[i + 1] = '\0';
+            }
+            node = Resolve(partial, FALSE, &parent, &leaf);
+            if (node == NULL) {
+                if (parent == NULL) {
+                    return FALSE;
+                }
+                LeafName(leaf, leafName, sizeof(leafName));
+                NewNode(parent, leafName, ST_USERDIR);
+            }
+            if (saved != '\0' || partial[i] == '\0') {
+                partial[i] = (partial[i] == '\0' && saved != '\0') ? '/' : partial[i];
+            }
+            partial[i + 1] = saved;
+            if (path[i] == '/') {
+                partial[i] = '/';
+            }
+        }
+    }
+    return Resolve(path, FALSE, NULL, NULL) != NULL;
+}
+
+BOOL HalWriteFile(CONST_STRPTR path, CONST_APTR data, LONG length, LONG protection)
+{
+    struct HalNode *parent;
+    struct HalNode *node;
+    CONST_STRPTR leaf;
+    UBYTE dir[512];
+    UBYTE leafName[108];
+
+    node = Resolve(path, FALSE, &parent, &leaf);
+    if (node == NULL && parent == NULL) {
+        Strncpy(dir, path, sizeof(dir));
+        *PathPart(dir) = '\0';
+        if (!HalMakeDir(dir)) {
+            return FALSE;
+        }
+        node = Resolve(path, FALSE, &parent, &leaf);
+    }
+    if (node == NULL) {
+        if (parent == NULL) {
+            return FALSE;
+        }
+        LeafName(leaf, leafName, sizeof(leafName));
+        node = NewNode(parent, leafName, ST_FILE);
+    }
+    if (node->hn_Type != ST_FILE) {
+        return FALSE;
+    }
+    node->hn_Size = 0;
+    WriteNode(node, 0, data, length);
+    node->hn_Protection = protection;
+    DateStamp(&node->hn_Parent->hn_Date);
+    return TRUE;
+}
+
+LONG HalReadFile(CONST_STRPTR path, STRPTR buffer, LONG size)
+{
+    struct HalNode *node = Resolve(path, FALSE, NULL, NULL);
+    LONG length;
+
+    if (node == NULL || node->hn_Type != ST_FILE) {
+        return -1;
+    }
+    length = node->hn_Size < size - 1 ? node->hn_Size : size - 1;
+    memcpy(buffer, node->hn_Data, length);
+    buffer[length] = '\0';
+    return node->hn_Size;
+}
+
+BOOL HalExists(CONST_STRPTR path)
+{
+    return Resolve(path, FALSE, NULL, NULL) != NULL;
+}
+
+VOID HalInitDos(VOID)
+{
+    static const struct HalLatency hardDisk = { 400, 600, 250, 300, 1200, 1500 };
+    struct Process *me = Me();
+
+    HalAddVolume((CONST_STRPTR)"System", &hardDisk);
+    HalAddVolume((CONST_STRPTR)"Ram Disk", NULL);
+    HalAssign((CONST_STRPTR)"SYS", (CONST_STRPTR)"System:");
+    HalAssign((CONST_STRPTR)"RAM", (CONST_STRPTR)"Ram Disk:");
+    HalAssign((CONST_STRPTR)"ENV", (CONST_STRPTR)"Ram Disk:Env");
+    HalAssign((CONST_STRPTR)"T", (CONST_STRPTR)"Ram Disk:T");
+    HalAssign((CONST_STRPTR)"ENVARC", (CONST_STRPTR)"System:Prefs/Env-Archive");
+    HalAssign((CONST_STRPTR)"C", (CONST_STRPTR)"System:C");
+    HalAssign((CONST_STRPTR)"S", (CONST_STRPTR)"System:S");
+    HalMakeDir((CONST_STRPTR)"Ram Disk:Env/Sys");
+    HalMakeDir((CONST_STRPTR)"Ram Disk:T");
+    HalMakeDir((CONST_STRPTR)"System:Prefs/Env-Archive/Sys");
+    HalMakeDir((CONST_STRPTR)"System:C");
+    HalMakeDir((CONST_STRPTR)"System:S");
+
+    me->pr_CurrentDir = MakeLock(BootRoot(), SHARED_LOCK);
+    me->pr_HomeDir = MakeLock(BootRoot(), SHARED_LOCK);
+    me->pr_CIS = MKBADDR(&halConsole);
+    me->pr_COS = MKBADDR(&halConsole);
+}
@@ -0,0 +1,1422 @@
+/*
+ * hal_exec.c - exec.library, timer.device and input.device on the host
+ *
+ * Copyright (c) 2025 amigazen project
+ * Licensed under BSD 2-Clause License
+ *
+ * Every task is a host thread with a stack of its own, so tc_SPLower and
+ * tc_SPUpper describe the stack the task really runs on. One lock is held
+ * by whichever task is running; the others sleep on their condition until
+ * the dispatcher makes them current. Tasks are dispatched in FIFO order,
+ * and when none is ready the clock jumps to the earliest pending event.
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include "hal.h"
+
+#define HAL_STACK_SIZE  (1024 * 1024)       /* Host frames are larger than the 68000's */
+#define HAL_MEMORY_SIZE (2 * 1024 * 1024)   /* What AvailMem() reports with nothing allocated */
+#define HAL_SLEEPING    100                 /* tc_State while waiting for the clock */
+#define HAL_MEMORY_MAGIC 0x48414C4DUL
+#define HAL_SEG_MAGIC    0x48414C53UL
+#define ECLOCK_HZ       709379UL
+
+/* A task, with the Process it presents first */
+struct HalTask {
+    struct Process ht_Process;
+    struct HalTask *ht_Next;                /* All tasks, including dead ones not yet reaped */
+    struct HalTask *ht_ReadyNext;
+    pthread_t ht_Thread;
+    pthread_cond_t ht_Cond;
+    BOOL ht_Host;                           /* The harness, on the host's main thread */
+    UBYTE *ht_Stack;
+    VOID (*ht_Entry)(VOID);
+    BPTR ht_Seglist;
+    BOOL ht_FreeSeglist;
+    BOOL ht_Shell;                          /* Run like a shell command - unload cli_Module after */
+    BOOL ht_CloseInput;
+    BOOL ht_CloseOutput;
+    struct Task *ht_Notify;                 /* Signalled with ht_NotifySignal on exit */
+    ULONG ht_NotifySignal;
+    LONG ht_Result;
+    struct CommandLineInterface ht_Cli;
+    UBYTE ht_Name[64];
+    UBYTE ht_CommandName[256];              /* BSTR for cli_CommandName */
+    UBYTE *ht_Arguments;
+};
+
+/* Something that happens at a given virtual time */
+struct HalEvent {
+    struct HalEvent *he_Next;
+    ULONG he_Micros;
+    VOID (*he_Fire)(APTR data);
+    APTR he_Data;
+};
+
+/* Header in front of every allocation, so FreeMem() sizes can be checked */
+struct HalMemory {
+    ULONG hm_Magic;
+    ULONG hm_Size;
+};
+
+/* A loaded registered program */
+struct HalSeg {
+    ULONG hs_Magic;
+    HalMain hs_Main;
+};
+
+struct ExecBase *SysBase = NULL;
+struct DosLibrary *DOSBase = NULL;
+struct IntuitionBase *IntuitionBase = NULL;
+struct Library *IconBase = NULL;
+struct Library *WorkbenchBase = NULL;
+struct Library *UtilityBase = NULL;
+
+struct HalCounters halCounters;
+
+static struct ExecBase execBase;
+static struct DosLibrary dosLibrary;
+static struct IntuitionBase intuitionLibrary;
+static struct Library iconLibrary;
+static struct Library workbenchLibrary;
+static struct Library utilityLibrary;
+static struct RxsLib rexxLibrary;
+static struct IClass requesterClass;
+static struct ClassLibrary requesterLibrary;
+static struct Device timerDevice;
+static struct Device inputDevice;
+
+static pthread_mutex_t halLock = PTHREAD_MUTEX_INITIALIZER;
+static struct HalTask *halCurrent = NULL;
+static struct HalTask *halTasks = NULL;
+static struct HalTask *readyHead = NULL;
+static struct HalTask *readyTail = NULL;
+static struct HalEvent *halEvents = NULL;
+static ULONG halClock = 0;
+static ULONG halMemoryUsed = 0;
+static UWORD halQualifier = 0;
+static BOOL halReady = FALSE;
+
+extern VOID HalStartTask(struct HalTask *task);
+
+VOID HalAbort(CONST_STRPTR format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    fprintf(stderr, "hal: ");
+    vfprintf(stderr, (const char *)format, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    fflush(stdout);
+    abort();
+}
+
+/* Allocation */
+
+APTR AllocMem(ULONG size, ULONG flags)
+{
+    struct HalMemory *memory;
+
+    (void)flags;
+    if (size == 0) {
+        return NULL;
+    }
+    memory = calloc(1, sizeof(struct HalMemory) + size);
+    if (memory == NULL) {
+        return NULL;
+    }
+    memory->hm_Magic = HAL_MEMORY_MAGIC;
+    memory->hm_Size = size;
+    halMemoryUsed += size;
+    return memory + 1;
+}
+
+VOID FreeMem(APTR address, ULONG size)
+{
+    struct HalMemory *memory;
+
+    if (address == NULL) {
+        return;
+    }
+    memory = (struct HalMemory *)address - 1;
+    if (memory->hm_Magic != HAL_MEMORY_MAGIC) {
+        HalAbort("FreeMem() of memory AllocMem() did not return");
+    }
+    if (memory->hm_Size != size) {
+        HalAbort("FreeMem() of %lu bytes, allocated %lu", size, memory->hm_Size);
+    }
+    memory->hm_Magic = 0;
+    halMemoryUsed -= size;
+    free(memory);
+}
+
+/* The size, including itself, goes in the longword before the memory as on the machine */
+APTR AllocVec(ULONG size, ULONG flags)
+{
+    ULONG *memory = AllocMem(size + 2 * sizeof(ULONG), flags);
+
+    if (memory == NULL) {
+        return NULL;
+    }
+    memory[1] = size + sizeof(ULONG);
+    return memory + 2;
+}
+
+VOID FreeVec(APTR address)
+{
+    ULONG *memory = address;
+
+    if (memory != NULL) {
+        FreeMem(memory - 2, memory[-1] + sizeof(ULONG));
+    }
+}
+
+ULONG AvailMem(ULONG flags)
+{
+    if (flags & MEMF_TOTAL) {
+        return HAL_MEMORY_SIZE;
+    }
+    return halMemoryUsed < HAL_MEMORY_SIZE ? HAL_MEMORY_SIZE - halMemoryUsed : 0;
+}
+
+ULONG HalMemoryUsed(VOID)
+{
+    return halMemoryUsed;
+}
+
+VOID CopyMem(CONST_APTR source, APTR dest, ULONG size)
+{
+    memmove(dest, source, size);
+}
+
+VOID CopyMemQuick(CONST_APTR source, APTR dest, ULONG size)
+{
+    memmove(dest, source, size);
+}
+
+APTR CreatePool(ULONG flags, ULONG puddle, ULONG threshold)
+{
+    (void)puddle;
+    (void)threshold;
+    return AllocMem(sizeof(ULONG), flags);
+}
+
+VOID DeletePool(APTR pool)
+{
+    FreeMem(pool, sizeof(ULONG));
+}
+
+APTR AllocPooled(APTR pool, ULONG size)
+{
+    (void)pool;
+    return AllocMem(size, MEMF_CLEAR);
+}
+
+VOID FreePooled(APTR pool, APTR memory, ULONG size)
+{
+    (void)pool;
+    FreeMem(memory, size);
+}
+
+/* Lists */
+
+VOID NewList(struct List *list)
+{
+    list->lh_Head = (struct Node *)&list->lh_Tail;
+    list->lh_Tail = NULL;
+    list->lh_TailPred = (struct Node *)&list->lh_Head;
+}
+
+VOID AddHead(struct List *list, struct Node *node)
+{
+    node->ln_Succ = list->lh_Head;
+    node->ln_Pred = (struct Node *)&list->lh_Head;
+    list->lh_Head->ln_Pred = node;
+    list->lh_Head = node;
+}
+
+VOID AddTail(struct List *list, struct Node *node)
+{
+    node->ln_Succ = (struct Node *)&list->lh_Tail;
+    node->ln_Pred = list->lh_TailPred;
+    list->lh_TailPred->ln_Succ = node;
+    list->lh_TailPred = node;
+}
+
+VOID Insert(struct List *list, struct Node *node, struct Node *pred)
+{
+    if (pred == NULL) {
+        AddHead(list, node);
+        return;
+    }
+    node->ln_Succ = pred->ln_Succ;
+    node->ln_Pred = pred;
+    pred->ln_Succ->ln_Pred = node;
+    pred->ln_Succ = node;
+}
+
+VOID Enqueue(struct List *list, struct Node *node)
+{
+    struct Node *next;
+
+    for (next = list->lh_Head; next->ln_Succ != NULL; next = next->ln_Succ) {
+        if (next->ln_Pri < node->ln_Pri) {
+            break;
+        }
+    }
+    Insert(list, node, next->ln_Pred);
+}
+
+VOID Remove(struct Node *node)
+{
+    node->ln_Pred->ln_Succ = node->ln_Succ;
+    node->ln_Succ->ln_Pred = node->ln_Pred;
+}
+
+struct Node *RemHead(struct List *list)
+{
+    struct Node *node = list->lh_Head;
+
+    if (node->ln_Succ == NULL) {
+        return NULL;
+    }
+    Remove(node);
+    return node;
+}
+
+struct Node *RemTail(struct List *list)
+{
+    struct Node *node = list->lh_TailPred;
+
+    if (node->ln_Pred == NULL) {
+        return NULL;
+    }
+    Remove(node);
+    return node;
+}
+
+struct Node *FindName(struct List *list, CONST_STRPTR name)
+{
+    struct Node *node;
+
+    for (node = list->lh_Head; node->ln_Succ != NULL; node = node->ln_Succ) {
+        if (node->ln_Name != NULL && strcmp(node->ln_Name, (const char *)name) == 0) {
+            return node;
+        }
+    }
+    return NULL;
+}
+
+/* Dispatching */
+
+static VOID MakeReady(struct HalTask *task)
+{
+    task->ht_Process.pr_Task.tc_State = TS_READY;
+    task->ht_ReadyNext = NULL;
+    if (readyTail != NULL) {
+        readyTail->ht_ReadyNext = task;
+    } else {
+        readyHead = task;
+    }
+    readyTail = task;
+}
+
+static VOID WakeTask(APTR data)
+{
+    MakeReady((struct HalTask *)data);
+}
+
+VOID HalAddEvent(ULONG micros, VOID (*fire)(APTR data), APTR data)
+{
+    struct HalEvent *event = calloc(1, sizeof(struct HalEvent));
+    struct HalEvent **link;
+
+    if (event == NULL) {
+        HalAbort("out of host memory");
+    }
+    event->he_Micros = micros;
+    event->he_Fire = fire;
+    event->he_Data = data;
+    for (link = &halEvents; *link != NULL && (*link)->he_Micros <= micros; link = &(*link)->he_Next) {
+    }
+    event->he_Next = *link;
+    *link = event;
+}
+
+BOOL HalCancelEvent(APTR data)
+{
+    struct HalEvent **link;
+    struct HalEvent *event;
+
+    for (link = &halEvents; *link != NULL; link = &(*link)->he_Next) {
+        if ((*link)->he_Data == data) {
+            event = *link;
+            *link = event->he_Next;
+            free(event);
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static VOID ListTasks(VOID)
+{
+    struct HalTask *task;
+
+    for (task = halTasks; task != NULL; task = task->ht_Next) {
+        fprintf(stderr, "hal:   %s state=%d wait=%08lx received=%08lx\n",
+                task->ht_Name, task->ht_Process.pr_Task.tc_State,
+                task->ht_Process.pr_Task.tc_SigWait, task->ht_Process.pr_Task.tc_SigRecvd);
+    }
+}
+
+/* Make the next ready task current, running events until one is */
+static VOID Dispatch(VOID)
+{
+    struct HalTask *next;
+    struct HalEvent *event;
+
+    while (readyHead == NULL) {
+        event = halEvents;
+        if (event == NULL) {
+            ListTasks();
+            HalAbort("deadlock - every task is waiting and nothing is pending");
+        }
+        halEvents = event->he_Next;
+        if (event->he_Micros > halClock) {
+            halClock = event->he_Micros;
+        }
+        event->he_Fire(event->he_Data);
+        free(event);
+    }
+
+    next = readyHead;
+    readyHead = next->ht_ReadyNext;
+    if (readyHead == NULL) {
+        readyTail = NULL;
+    }
+    next->ht_Process.pr_Task.tc_State = TS_RUN;
+    halCurrent = next;
+    execBase.ThisTask = &next->ht_Process.pr_Task;
+    pthread_cond_signal(&next->ht_Cond);
+}
+
+/* Give up the CPU until this task is made current again */
+static VOID Block(struct HalTask *me)
+{
+    Dispatch();
+    while (halCurrent != me) {
+        pthread_cond_wait(&me->ht_Cond, &halLock);
+    }
+}
+
+VOID HalSleepUntil(ULONG micros)
+{
+    struct HalTask *me = halCurrent;
+
+    if (micros <= halClock) {
+        return;
+    }
+    me->ht_Process.pr_Task.tc_State = HAL_SLEEPING;
+    HalAddEvent(micros, WakeTask, me);
+    Block(me);
+}
+
+VOID HalSpend(ULONG micros)
+{
+    if (micros != 0) {
+        HalSleepUntil(halClock + micros);
+    }
+}
+
+ULONG HalMicros(VOID)
+{
+    return halClock;
+}
+
+/* Let the other tasks run until they are all waiting, or for maxMicros */
+VOID HalSettle(ULONG maxMicros)
+{
+    struct HalTask *me = halCurrent;
+    ULONG deadline = halClock + maxMicros;
+
+    for (;;) {
+        if (readyHead != NULL) {
+            MakeReady(me);
+            Block(me);
+        } else if (halEvents != NULL && halEvents->he_Micros <= deadline) {
+            HalSleepUntil(halEvents->he_Micros);
+        } else {
+            return;
+        }
+    }
+}
+
+/* Tasks */
+
+VOID Forbid(VOID)
+{
+}
+
+VOID Permit(VOID)
+{
+}
+
+struct Task *FindTask(CONST_STRPTR name)
+{
+    struct HalTask *task;
+
+    if (name == NULL) {
+        return &halCurrent->ht_Process.pr_Task;
+    }
+    for (task = halTasks; task != NULL; task = task->ht_Next) {
+        if (task->ht_Process.pr_Task.tc_State != TS_REMOVED &&
+            strcmp((char *)task->ht_Name, (const char *)name) == 0) {
+            return &task->ht_Process.pr_Task;
+        }
+    }
+    return NULL;
+}
+
+BYTE SetTaskPri(struct Task *task, LONG priority)
+{
+    BYTE old = task->tc_Node.ln_Pri;
+
+    task->tc_Node.ln_Pri = (BYTE)priority;
+    return old;
+}
+
+BYTE AllocSignal(LONG signal)
+{
+    struct Task *me = &halCurrent->ht_Process.pr_Task;
+
+    if (signal < 0) {
+        for (signal = 31; signal >= 16; signal--) {
+            if (!(me->tc_SigAlloc & (1UL << signal))) {
+                break;
+            }
+        }
+        if (signal < 16) {
+            return -1;
+        }
+    } else if (me->tc_SigAlloc & (1UL << signal)) {
+        return -1;
+    }
+    me->tc_SigAlloc |= 1UL << signal;
+    me->tc_SigRecvd &= ~(1UL << signal);
+    return (BYTE)signal;
+}
+
+VOID FreeSignal(LONG signal)
+{
+    if (signal >= 0) {
+        halCurrent->ht_Process.pr_Task.tc_SigAlloc &= ~(1UL << signal);
+    }
+}
+
+ULONG SetSignal(ULONG newSignals, ULONG mask)
+{
+    struct Task *me = &halCurrent->ht_Process.pr_Task;
+    ULONG old = me->tc_SigRecvd;
+
+    me->tc_SigRecvd = (old & ~mask) | (newSignals & mask);
+    return old;
+}
+
+VOID Signal(struct Task *task, ULONG signals)
+{
+    task->tc_SigRecvd |= signals;
+    if (task->tc_State == TS_WAIT && (task->tc_SigRecvd & task->tc_SigWait) != 0) {
+        MakeReady((struct HalTask *)task);
+    }
+}
+
+ULONG Wait(ULONG signals)
+{
+    struct HalTask *me = halCurrent;
+    struct Task *task = &me->ht_Process.pr_Task;
+    ULONG received;
+
+    task->tc_SigWait = signals;
+    while ((task->tc_SigRecvd & signals) == 0) {
+        task->tc_State = TS_WAIT;
+        Block(me);
+    }
+    received = task->tc_SigRecvd & signals;
+    task->tc_SigRecvd &= ~received;
+    task->tc_SigWait = 0;
+    return received;
+}
+
+/* Ports and messages */
+
+static VOID InitPort(struct MsgPort *port, struct Task *task, UBYTE sigBit)
+{
+    port->mp_Node.ln_Type = NT_MSGPORT;
+    port->mp_Flags = PA_SIGNAL;
+    port->mp_SigBit = sigBit;
+    port->mp_SigTask = task;
+    NewList(&port->mp_MsgList);
+}
+
+struct MsgPort *CreateMsgPort(VOID)
+{
+    struct MsgPort *port;
+    BYTE signal = AllocSignal(-1);
+
+    if (signal < 0) {
+        return NULL;
+    }
+    port = AllocMem(sizeof(struct MsgPort), MEMF_CLEAR | MEMF_PUBLIC);
+    if (port == NULL) {
+        FreeSignal(signal);
+        return NULL;
+    }
+    InitPort(port, FindTask(NULL), (UBYTE)signal);
+    return port;
+}
+
+VOID DeleteMsgPort(struct MsgPort *port)
+{
+    if (port != NULL) {
+        FreeSignal(port->mp_SigBit);
+        FreeMem(port, sizeof(struct MsgPort));
+    }
+}
+
+VOID AddPort(struct MsgPort *port)
+{
+    port->mp_Node.ln_Type = NT_MSGPORT;
+    NewList(&port->mp_MsgList);
+    Enqueue(&execBase.PortList, &port->mp_Node);
+}
+
+VOID RemPort(struct MsgPort *port)
+{
+    Remove(&port->mp_Node);
+}
+
+struct MsgPort *FindPort(CONST_STRPTR name)
+{
+    return (struct MsgPort *)FindName(&execBase.PortList, name);
+}
+
+static VOID QueueMessage(struct MsgPort *port, struct Message *message)
+{
+    AddTail(&port->mp_MsgList, &message->mn_Node);
+    if ((port->mp_Flags & PF_ACTION) == PA_SIGNAL && port->mp_SigTask != NULL) {
+        Signal((struct Task *)port->mp_SigTask, 1UL << port->mp_SigBit);
+    }
+}
+
+VOID PutMsg(struct MsgPort *port, struct Message *message)
+{
+    message->mn_Node.ln_Type = NT_MESSAGE;
+    QueueMessage(port, message);
+}
+
+struct Message *GetMsg(struct MsgPort *port)
+{
+    return (struct Message *)RemHead(&port->mp_MsgList);
+}
+
+VOID ReplyMsg(struct Message *message)
+{
+    if (message->mn_ReplyPort == NULL) {
+        message->mn_Node.ln_Type = NT_FREEMSG;
+        return;
+    }
+    message->mn_Node.ln_Type = NT_REPLYMSG;
+    QueueMessage(message->mn_ReplyPort, message);
+}
+
+struct Message *WaitPort(struct MsgPort *port)
+{
+    while (IsListEmpty(&port->mp_MsgList)) {
+        Wait(1UL << port->mp_SigBit);
+    }
+    return (struct Message *)port->mp_MsgList.lh_Head;
+}
+
+/* Semaphores - ss_Owner is NULL while held shared, ss_NestCount counts holds */
+
+VOID InitSemaphore(struct SignalSemaphore *semaphore)
+{
+    semaphore->ss_Link.ln_Type = NT_SIGNALSEM;
+    NewList((struct List *)&semaphore->ss_WaitQueue);
+    semaphore->ss_NestCount = 0;
+    semaphore->ss_Owner = NULL;
+    semaphore->ss_QueueCount = -1;
+}
+
+static BOOL TakeSemaphore(struct SignalSemaphore *semaphore, BOOL shared)
+{
+    struct Task *me = FindTask(NULL);
+
+    if (semaphore->ss_NestCount == 0) {
+        semaphore->ss_Owner = shared ? NULL : me;
+    } else if (semaphore->ss_Owner != me && (!shared || semaphore->ss_Owner != NULL)) {
+        return FALSE;
+    }
+    semaphore->ss_NestCount++;
+    return TRUE;
+}
+
+static VOID ObtainMode(struct SignalSemaphore *semaphore, BOOL shared)
+{
+    struct SemaphoreRequest request;
+    struct MinList *queue = &semaphore->ss_WaitQueue;
+
+    while (!TakeSemaphore(semaphore, shared)) {
+        request.sr_Waiter = FindTask(NULL);
+        /* By hand: a MinNode is too small to pass to AddTail() as a Node */
+        request.sr_Link.mln_Succ = (struct MinNode *)&queue->mlh_Tail;
+        request.sr_Link.mln_Pred = queue->mlh_TailPred;
+        queue->mlh_TailPred->mln_Succ = &request.sr_Link;
+        queue->mlh_TailPred = &request.sr_Link;
+        semaphore->ss_QueueCount++;
+        SetSignal(0, SIGF_SINGLE);
+        Wait(SIGF_SINGLE);
+    }
+}
+
+VOID ObtainSemaphore(struct SignalSemaphore *semaphore)
+{
+    ObtainMode(semaphore, FALSE);
+}
+
+VOID ObtainSemaphoreShared(struct SignalSemaphore *semaphore)
+{
+    ObtainMode(semaphore, TRUE);
+}
+
+ULONG AttemptSemaphore(struct SignalSemaphore *semaphore)
+{
+    return TakeSemaphore(semaphore, FALSE);
+}
+
+VOID ReleaseSemaphore(struct SignalSemaphore *semaphore)
+{
+    struct SemaphoreRequest *request;
+
+    if (semaphore->ss_NestCount <= 0) {
+        HalAbort("ReleaseSemaphore() of a semaphore nobody holds");
+    }
+    if (--semaphore->ss_NestCount > 0) {
+        return;
+    }
+    semaphore->ss_Owner = NULL;
+    while ((request = (struct SemaphoreRequest *)RemHead((struct List *)&semaphore->ss_WaitQueue)) != NULL) {
+        semaphore->ss_QueueCount--;
+        Signal(request->sr_Waiter, SIGF_SINGLE);
+    }
+}
+
+VOID AddSemaphore(struct SignalSemaphore *semaphore)
+{
+    InitSemaphore(semaphore);
+    Enqueue(&execBase.SemaphoreList, &semaphore->ss_Link);
+}
+
+VOID RemSemaphore(struct SignalSemaphore *semaphore)
+{
+    Remove(&semaphore->ss_Link);
+}
+
+struct SignalSemaphore *FindSemaphore(CONST_STRPTR name)
+{
+    return (struct SignalSemaphore *)FindName(&execBase.SemaphoreList, name);
+}
+
+/* Libraries and devices */
+
+struct Library *OpenLibrary(CONST_STRPTR name, ULONG version)
+{
+    static const struct {
+        const char *name;
+        struct Library *library;
+    } libraries[] = {
+        { "exec.library", &execBase.LibNode },
+        { "dos.library", &dosLibrary.dl_lib },
+        { "intuition.library", &intuitionLibrary.LibNode },
+        { "icon.library", &iconLibrary },
+        { "workbench.library", &workbenchLibrary },
+        { "utility.library", &utilityLibrary },
+        { "rexxsyslib.library", &rexxLibrary.rl_Node },
+        { "requester.class", &requesterLibrary.cl_Lib },
+        { NULL, NULL }
+    };
+    LONG i;
+
+    for (i = 0; libraries[i].name != NULL; i++) {
+        if (strcmp(libraries[i].name, (const char *)name) == 0) {
+            if (version > libraries[i].library->lib_Version) {
+                return NULL;
+            }
+            libraries[i].library->lib_OpenCnt++;
+            return libraries[i].library;
+        }
+    }
+    return NULL;
+}
+
+VOID CloseLibrary(APTR library)
+{
+    if (library != NULL) {
+        ((struct Library *)library)->lib_OpenCnt--;
+    }
+}
+
+Class *REQUESTER_GetClass(VOID)
+{
+    return &requesterClass;
+}
+
+APTR CreateIORequest(struct MsgPort *port, ULONG size)
+{
+    struct IORequest *request;
+
+    if (port == NULL) {
+        return NULL;
+    }
+    request = AllocMem(size, MEMF_CLEAR | MEMF_PUBLIC);
+    if (request != NULL) {
+        request->io_Message.mn_Node.ln_Type = NT_REPLYMSG;
+        request->io_Message.mn_ReplyPort = port;
+        request->io_Message.mn_Length = (UWORD)size;
+    }
+    return request;
+}
+
+VOID DeleteIORequest(APTR request)
+{
+    if (request != NULL) {
+        FreeMem(request, ((struct IORequest *)request)->io_Message.mn_Length);
+    }
+}
+
+BYTE OpenDevice(CONST_STRPTR name, ULONG unit, struct IORequest *request, ULONG flags)
+{
+    (void)flags;
+    if (strcmp((const char *)name, TIMERNAME) == 0) {
+        request->io_Device = &timerDevice;
+    } else if (strcmp((const char *)name, "input.device") == 0) {
+        request->io_Device = &inputDevice;
+    } else {
+        request->io_Device = NULL;
+        request->io_Error = IOERR_OPENFAIL;
+        return IOERR_OPENFAIL;
+    }
+    request->io_Unit = (struct Unit *)unit;
+    request->io_Error = 0;
+    return 0;
+}
+
+VOID CloseDevice(struct IORequest *request)
+{
+    request->io_Device = NULL;
+}
+
+static VOID TimerDone(APTR data)
+{
+    struct IORequest *request = data;
+
+    request->io_Error = 0;
+    ReplyMsg(&request->io_Message);
+}
+
+VOID SendIO(struct IORequest *request)
+{
+    struct timerequest *timer = (struct timerequest *)request;
+
+    request->io_Flags &= ~IOF_QUICK;
+    request->io_Message.mn_Node.ln_Type = NT_MESSAGE;
+    if (request->io_Device == &timerDevice && request->io_Command == TR_ADDREQUEST) {
+        HalAddEvent(halClock + timer->tr_time.tv_secs * 1000000UL + timer->tr_time.tv_micro,
+                    TimerDone, request);
+        return;
+    }
+    if (request->io_Device == &timerDevice && request->io_Command == TR_GETSYSTIME) {
+        GetSysTime(&timer->tr_time);
+    }
+    request->io_Error = 0;
+    ReplyMsg(&request->io_Message);
+}
+
+struct IORequest *CheckIO(struct IORequest *request)
+{
+    return request->io_Message.mn_Node.ln_Type == NT_REPLYMSG ? request : NULL;
+}
+
+BYTE WaitIO(struct IORequest *request)
+{
+    struct MsgPort *port = request->io_Message.mn_ReplyPort;
+
+    while (request->io_Message.mn_Node.ln_Type != NT_REPLYMSG) {
+        Wait(1UL << port->mp_SigBit);
+    }
+    Remove(&request->io_Message.mn_Node);
+    return request->io_Error;
+}
+
+BYTE DoIO(struct IORequest *request)
+{
+    SendIO(request);
+    return WaitIO(request);
+}
+
+VOID AbortIO(struct IORequest *request)
+{
+    if (HalCancelEvent(request)) {
+        request->io_Error = IOERR_ABORTED;
+        ReplyMsg(&request->io_Message);
+    }
+}
+
+ULONG ReadEClock(struct EClockVal *eclock)
+{
+    unsigned long long ticks = (unsigned long long)halClock * ECLOCK_HZ / 1000000ULL;
+
+    eclock->ev_hi = (ULONG)(ticks >> 32);
+    eclock->ev_lo = (ULONG)(ticks & 0xFFFFFFFFULL);
+    return ECLOCK_HZ;
+}
+
+VOID GetSysTime(struct TimeVal *time)
+{
+    time->tv_secs = halClock / 1000000UL;
+    time->tv_micro = halClock % 1000000UL;
+}
+
+VOID AddTime(struct TimeVal *dest, const struct TimeVal *source)
+{
+    dest->tv_micro += source->tv_micro;
+    dest->tv_secs += source->tv_secs + dest->tv_micro / 1000000UL;
+    dest->tv_micro %= 1000000UL;
+}
+
+VOID SubTime(struct TimeVal *dest, const struct TimeVal *source)
+{
+    if (dest->tv_micro < source->tv_micro) {
+        dest->tv_micro += 1000000UL;
+        dest->tv_secs--;
+    }
+    dest->tv_micro -= source->tv_micro;
+    dest->tv_secs -= source->tv_secs;
+}
+
+LONG CmpTime(const struct TimeVal *a, const struct TimeVal *b)
+{
+    if (a->tv_secs != b->tv_secs) {
+        return a->tv_secs < b->tv_secs ? 1 : -1;
+    }
+    if (a->tv_micro != b->tv_micro) {
+        return a->tv_micro < b->tv_micro ? 1 : -1;
+    }
+    return 0;
+}
+
+UWORD PeekQualifier(VOID)
+{
+    return halQualifier;
+}
+
+VOID HalSetQualifier(UWORD qualifier)
+{
+    halQualifier = qualifier;
+}
+
+/* Processes */
+
+static VOID RunTask(struct HalTask *task);
+
+static VOID *TaskThread(VOID *data)
+{
+    struct HalTask *task = data;
+
+    pthread_mutex_lock(&halLock);
+    while (halCurrent != task) {
+        pthread_cond_wait(&task->ht_Cond, &halLock);
+    }
+    RunTask(task);
+    /* RunTask() ends by dispatching another task; this one never runs again */
+    pthread_mutex_unlock(&halLock);
+    return NULL;
+}
+
+/* Join and free the tasks that have finished */
+static VOID ReapTasks(VOID)
+{
+    struct HalTask **link = &halTasks;
+    struct HalTask *task;
+
+    while ((task = *link) != NULL) {
+        if (task->ht_Process.pr_Task.tc_State == TS_REMOVED && task != halCurrent) {
+            *link = task->ht_Next;
+            pthread_join(task->ht_Thread, NULL);
+            pthread_cond_destroy(&task->ht_Cond);
+            free(task->ht_Stack);
+            free(task->ht_Arguments);
+            free(task);
+        } else {
+            link = &task->ht_Next;
+        }
+    }
+}
+
+LONG HalLiveProcesses(VOID)
+{
+    struct HalTask *task;
+    LONG count = 0;
+
+    for (task = halTasks; task != NULL; task = task->ht_Next) {
+        if (task->ht_Process.pr_Task.tc_State != TS_REMOVED && !task->ht_Host) {
+            count++;
+        }
+    }
+    return count;
+}
+
+static struct HalTask *NewTask(CONST_STRPTR name)
+{
+    struct HalTask *task = calloc(1, sizeof(struct HalTask));
+    struct Process *process;
+
+    if (task == NULL) {
+        return NULL;
+    }
+    process = &task->ht_Process;
+    strncpy((char *)task->ht_Name, name != NULL ? (const char *)name : "New Process",
+            sizeof(task->ht_Name) - 1);
+    process->pr_Task.tc_Node.ln_Type = NT_PROCESS;
+    process->pr_Task.tc_Node.ln_Name = (char *)task->ht_Name;
+    process->pr_Task.tc_SigAlloc = 0x0000FFFFUL;
+    NewList(&process->pr_Task.tc_MemEntry);
+    InitPort(&process->pr_MsgPort, &process->pr_Task, SIGB_DOS);
+    pthread_cond_init(&task->ht_Cond, NULL);
+    task->ht_Next = halTasks;
+    halTasks = task;
+    return task;
+}
+
+/* The harness becomes a process on the host's own thread */
+static VOID InitHarness(VOID)
+{
+    struct HalTask *task = NewTask((CONST_STRPTR)"Harness");
+    pthread_attr_t attr;
+    APTR stack;
+    size_t size;
+
+    if (task == NULL) {
+        HalAbort("out of host memory");
+    }
+    task->ht_Host = TRUE;
+    task->ht_Thread = pthread_self();
+    if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+        pthread_attr_getstack(&attr, &stack, &size);
+        task->ht_Process.pr_Task.tc_SPLower = stack;
+        task->ht_Process.pr_Task.tc_SPUpper = (UBYTE *)stack + size;
+        pthread_attr_destroy(&attr);
+    }
+    pthread_mutex_lock(&halLock);
+    task->ht_Process.pr_Task.tc_State = TS_RUN;
+    halCurrent = task;
+    execBase.ThisTask = &task->ht_Process.pr_Task;
+}
+
+static VOID InitLibrary(struct Library *library, CONST_STRPTR name, UWORD version)
+{
+    library->lib_Node.ln_Type = NT_LIBRARY;
+    library->lib_Node.ln_Name = (char *)name;
+    library->lib_Version = version;
+}
+
+VOID HalInitExec(VOID)
+{
+    if (halReady) {
+        HalAbort("HalInit() called twice - fork() for a fresh world");
+    }
+    halReady = TRUE;
+
+    InitLibrary(&execBase.LibNode, (CONST_STRPTR)"exec.library", 47);
+    NewList(&execBase.PortList);
+    NewList(&execBase.SemaphoreList);
+    NewList(&execBase.TaskReady);
+    NewList(&execBase.TaskWait);
+    InitLibrary(&dosLibrary.dl_lib, (CONST_STRPTR)"dos.library", 47);
+    InitLibrary(&intuitionLibrary.LibNode, (CONST_STRPTR)"intuition.library", 47);
+    InitLibrary(&iconLibrary, (CONST_STRPTR)"icon.library", 47);
+    InitLibrary(&workbenchLibrary, (CONST_STRPTR)"workbench.library", 47);
+    InitLibrary(&utilityLibrary, (CONST_STRPTR)"utility.library", 47);
+    InitLibrary(&rexxLibrary.rl_Node, (CONST_STRPTR)"rexxsyslib.library", 45);
+    InitLibrary(&requesterLibrary.cl_Lib, (CONST_STRPTR)"requester.class", 47);
+    requesterLibrary.cl_Class = &requesterClass;
+    InitLibrary(&timerDevice.dd_Library, (CONST_STRPTR)TIMERNAME, 47);
+    InitLibrary(&inputDevice.dd_Library, (CONST_STRPTR)"input.device", 47);
+
+    SysBase = &execBase;
+    DOSBase = &dosLibrary;
+    IntuitionBase = &intuitionLibrary;
+    IconBase = &iconLibrary;
+    WorkbenchBase = &workbenchLibrary;
+    UtilityBase = &utilityLibrary;
+
+    InitHarness();
+}
+
+VOID HalResetCounters(VOID)
+{
+    memset(&halCounters, 0, sizeof(halCounters));
+}
+
+/* Seglists of registered programs */
+
+BPTR HalNewSeg(HalMain entry)
+{
+    struct HalSeg *seg = AllocMem(sizeof(struct HalSeg), MEMF_CLEAR);
+
+    if (seg == NULL) {
+        return NULL;
+    }
+    seg->hs_Magic = HAL_SEG_MAGIC;
+    seg->hs_Main = entry;
+    return (BPTR)seg;
+}
+
+HalMain HalFindProgram(BPTR seglist)
+{
+    struct HalSeg *seg = BADDR(seglist);
+
+    if (seg == NULL || seg->hs_Magic != HAL_SEG_MAGIC) {
+        return NULL;
+    }
+    return seg->hs_Main;
+}
+
+VOID UnLoadSeg(BPTR seglist)
+{
+    struct HalSeg *seg = BADDR(seglist);
+
+    if (seg == NULL) {
+        return;
+    }
+    if (seg->hs_Magic != HAL_SEG_MAGIC) {
+        HalAbort("UnLoadSeg() of something LoadSeg() did not return");
+    }
+    seg->hs_Magic = 0;
+    halCounters.hc_UnLoadSegs++;
+    FreeMem(seg, sizeof(struct HalSeg));
+}
+
+/* Words of the argument line for argv, quotes removed */
+static LONG SplitArguments(STRPTR line, STRPTR *argv, LONG max)
+{
+    LONG argc = 0;
+    UBYTE *in = line;
+    UBYTE *out;
+
+    while (*in != '\0' && argc < max) {
+        while (*in == ' ' || *in == '\t' || *in == '\n') {
+            in++;
+        }
+        if (*in == '\0') {
+            break;
+        }
+        argv[argc++] = out = in;
+        if (*in == '"') {
+            in++;
+            while (*in != '\0' && *in != '"') {
+                *out++ = *in++;
+            }
+            if (*in == '"') {
+                in++;
+            }
+        } else {
+            while (*in != '\0' && *in != ' ' && *in != '\t' && *in != '\n') {
+                *out++ = *in++;
+            }
+        }
+        if (*in != '\0') {
+            in++;
+        }
+        *out = '\0';
+    }
+    return argc;
+}
+
+/* What the C startup code does - a shell's argv, or the WBStartup message */
+static VOID RunProgram(struct HalTask *task, HalMain entry)
+{
+    struct Process *me = &task->ht_Process;
+    struct WBStartup *startup;
+    STRPTR argv[32];
+    UBYTE *line;
+    LONG argc;
+
+    if (me->pr_CLI != NULL) {
+        HalRecordLaunch(HAL_LAUNCH_SHELL, task->ht_CommandName + 1, me->pr_Arguments, 0);
+        line = (UBYTE *)strdup(me->pr_Arguments != NULL ? (const char *)me->pr_Arguments : "");
+        argv[0] = task->ht_CommandName + 1;
+        argc = 1 + SplitArguments(line, argv + 1, 30);
+        argv[argc] = NULL;
+        task->ht_Result = entry(argc, (char **)argv);
+        free(line);
+        return;
+    }
+
+    WaitPort(&me->pr_MsgPort);
+    startup = (struct WBStartup *)GetMsg(&me->pr_MsgPort);
+    HalRecordLaunch(HAL_LAUNCH_STARTUP, task->ht_Name,
+                    startup->sm_NumArgs > 1 ? (STRPTR)startup->sm_ArgList[1].wa_Name : (STRPTR)"",
+                    startup->sm_NumArgs);
+    task->ht_Result = entry(0, (char **)startup);
+    Forbid();
+    ReplyMsg(&startup->sm_Message);
+}
+
+static VOID RunTask(struct HalTask *task)
+{
+    struct Process *me = &task->ht_Process;
+    HalMain entry;
+
+    if (task->ht_Entry != NULL) {
+        task->ht_Entry();
+    } else if ((entry = HalFindProgram(task->ht_Seglist)) != NULL) {
+        RunProgram(task, entry);
+    }
+
+    if (task->ht_Shell && task->ht_Cli.cli_Module != NULL) {
+        UnLoadSeg(task->ht_Cli.cli_Module);
+    }
+    if (task->ht_FreeSeglist && task->ht_Seglist != NULL) {
+        UnLoadSeg(task->ht_Seglist);
+    }
+    UnLock(me->pr_CurrentDir);
+    UnLock(me->pr_HomeDir);
+    me->pr_CurrentDir = NULL;
+    me->pr_HomeDir = NULL;
+    if (task->ht_CloseInput) {
+        Close(me->pr_CIS);
+    }
+    if (task->ht_CloseOutput) {
+        Close(me->pr_COS);
+    }
+    if (task->ht_Notify != NULL) {
+        Signal(task->ht_Notify, task->ht_NotifySignal);
+    }
+
+    me->pr_Task.tc_State = TS_REMOVED;
+    Dispatch();
+}
+
+struct Process *CreateNewProc(struct TagItem *tags)
+{
+    struct Process *parent = (struct Process *)FindTask(NULL);
+    struct TagItem *state = tags;
+    struct TagItem *tag;
+    struct HalTask *task;
+    struct Process *process;
+    pthread_attr_t attr;
+    CONST_STRPTR name = (CONST_STRPTR)"New Process";
+    CONST_STRPTR commandName = NULL;
+    CONST_STRPTR arguments = NULL;
+    BPTR currentDir = (BPTR)-1;
+    BPTR homeDir = (BPTR)-1;
+    BPTR input = (BPTR)-1;
+    BPTR output = (BPTR)-1;
+    BOOL cli = FALSE;
+    LONG stackSize = 4000;
+    LONG length;
+
+    ReapTasks();
+
+    for (tag = tags; tag != NULL && tag->ti_Tag != TAG_DONE; tag++) {
+        if (tag->ti_Tag == NP_Name) {
+            name = (CONST_STRPTR)tag->ti_Data;
+        }
+    }
+    task = NewTask(name);
+    if (task == NULL) {
+        SetIoErr(ERROR_NO_FREE_STORE);
+        return NULL;
+    }
+    process = &task->ht_Process;
+    task->ht_FreeSeglist = TRUE;
+    task->ht_CloseInput = TRUE;
+    task->ht_CloseOutput = TRUE;
+
+    while ((tag = NextTagItem(&state)) != NULL) {
+        switch (tag->ti_Tag) {
+        case NP_Seglist:
+            task->ht_Seglist = (BPTR)tag->ti_Data;
+            break;
+        case NP_FreeSeglist:
+            task->ht_FreeSeglist = (BOOL)HalTagInt(tag->ti_Data);
+            break;
+        case NP_Entry:
+            task->ht_Entry = (VOID (*)(VOID))tag->ti_Data;
+            break;
+        case NP_Input:
+            input = (BPTR)tag->ti_Data;
+            break;
+        case NP_Output:
+            output = (BPTR)tag->ti_Data;
+            break;
+        case NP_CloseInput:
+            task->ht_CloseInput = (BOOL)HalTagInt(tag->ti_Data);
+            break;
+        case NP_CloseOutput:
+            task->ht_CloseOutput = (BOOL)HalTagInt(tag->ti_Data);
+            break;
+        case NP_CurrentDir:
+            currentDir = (BPTR)tag->ti_Data;
+            break;
+        case NP_HomeDir:
+            homeDir = (BPTR)tag->ti_Data;
+            break;
+        case NP_StackSize:
+            stackSize = HalTagInt(tag->ti_Data);
+            break;
+        case NP_Priority:
+            process->pr_Task.tc_Node.ln_Pri = (BYTE)HalTagInt(tag->ti_Data);
+            break;
+        case NP_Cli:
+            cli = (BOOL)HalTagInt(tag->ti_Data);
+            break;
+        case NP_CommandName:
+            commandName = (CONST_STRPTR)tag->ti_Data;
+            break;
+        case NP_Arguments:
+            arguments = (CONST_STRPTR)tag->ti_Data;
+            break;
+        default:
+            break;
+        }
+    }
+
+    process->pr_StackSize = stackSize;
+    process->pr_CurrentDir = currentDir != (BPTR)-1 ? currentDir : DupLock(parent->pr_CurrentDir);
+    process->pr_HomeDir = homeDir != (BPTR)-1 ? homeDir : DupLock(parent->pr_HomeDir);
+    process->pr_CIS = input != (BPTR)-1 ? input : Open((CONST_STRPTR)"NIL:", MODE_OLDFILE);
+    process->pr_COS = output != (BPTR)-1 ? output : Open((CONST_STRPTR)"NIL:", MODE_NEWFILE);
+    process->pr_CES = process->pr_COS;
+    if (input != (BPTR)-1 && input == NULL) {
+        task->ht_CloseInput = FALSE;
+    }
+    if (output != (BPTR)-1 && output == NULL) {
+        task->ht_CloseOutput = FALSE;
+    }
+    if (arguments != NULL) {
+        task->ht_Arguments = (UBYTE *)strdup((const char *)arguments);
+        process->pr_Arguments = task->ht_Arguments;
+    }
+    if (commandName == NULL) {
+        commandName = name;
+    }
+    length = strlen((const char *)commandName);
+    if (length > 254) {
+        length = 254;
+    }
+    task->ht_CommandName[0] = (UBYTE)length;
+    memcpy(task->ht_CommandName + 1, commandName, length);
+    task->ht_CommandName[length + 1] = '\0';
+    if (cli) {
+        task->ht_Cli.cli_DefaultStack = stackSize / 4;
+        task->ht_Cli.cli_CommandName = (BSTR)task->ht_CommandName;
+        task->ht_Cli.cli_StandardInput = process->pr_CIS;
+        task->ht_Cli.cli_CurrentInput = process->pr_CIS;
+        task->ht_Cli.cli_StandardOutput = process->pr_COS;
+        task->ht_Cli.cli_CurrentOutput = process->pr_COS;
+        task->ht_Cli.cli_Background = DOSTRUE;
+        process->pr_CLI = (BPTR)&task->ht_Cli;
+    }
+
+    task->ht_Stack = malloc(HAL_STACK_SIZE);
+    if (task->ht_Stack == NULL) {
+        HalAbort("out of host memory");
+    }
+    process->pr_Task.tc_SPLower = task->ht_Stack;
+    process->pr_Task.tc_SPUpper = task->ht_Stack + HAL_STACK_SIZE;
+    halCounters.hc_Processes++;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setstack(&attr, task->ht_Stack, HAL_STACK_SIZE);
+    if (pthread_create(&task->ht_Thread, &attr, TaskThread, task) != 0) {
+        HalAbort("could not start a host thread");
+    }
+    pthread_attr_destroy(&attr);
+    MakeReady(task);
+    return process;
+}
+
+struct Process *CreateNewProcTags(ULONG tag, ...)
+{
+    struct TagItem tags[32];
+    va_list args;
+
+    tags[0].ti_Tag = tag & 0xFFFFFFFFUL;
+    tags[0].ti_Data = 0;
+    if (tags[0].ti_Tag != TAG_DONE) {
+        va_start(args, tag);
+        tags[0].ti_Data = va_arg(args, ULONG);
+        HalVarTags(tags + 1, 31, args);
+        va_end(args);
+    }
+    return CreateNewProc(tags);
+}
+
+/* Shell-like run of a seglist with a CLI, signalling the caller when it ends */
+struct Process *HalStartCommand(BPTR seglist, CONST_STRPTR name, CONST_STRPTR arguments,
+                                BPTR output, struct Task *notify, ULONG signal)
+{
+    struct Process *process;
+    struct HalTask *task;
+
+    process = CreateNewProcTags(NP_Seglist, seglist,
+                                NP_FreeSeglist, FALSE,
+                                NP_Cli, TRUE,
+                                NP_Name, name,
+                                NP_CommandName, name,
+                                NP_Arguments, arguments,
+                                NP_Output, output,
+                                NP_CloseOutput, FALSE,
+                                NP_StackSize, 4096,
+                                TAG_DONE);
+    if (process == NULL) {
+        return NULL;
+    }
+    task = (struct HalTask *)process;
+    task->ht_Shell = TRUE;
+    task->ht_Cli.cli_Module = seglist;
+    task->ht_Notify = notify;
+    task->ht_NotifySignal = signal;
+    return process;
+}
+
+LONG HalCommandResult(struct Process *process)
+{
+    return ((struct HalTask *)process)->ht_Result;
+}
+
+/* Wait for the process started with HalStartCommand() to end */
+LONG HalWaitCommand(struct Process *process, ULONG signal)
+{
+    struct HalTask *task = (struct HalTask *)process;
+
+    while (task->ht_Process.pr_Task.tc_State != TS_REMOVED) {
+        Wait(signal);
+    }
+    return task->ht_Result;
+}
+
+VOID HalReap(VOID)
+{
+    ReapTasks();
+}
@@ -0,0 +1,621 @@
+/*
+ * hal_icon.c - icon.library over the in-memory filesystem, and DefIcons
+ *
+ * Copyright (c) 2025 amigazen project
+ * Licensed under BSD 2-Clause License
+ *
+ * A .info file here is text - "HALICON", then type=, tool=, stack=, x=, y=
+ * and tt= lines - followed by image=<bytes> and that many bytes of image
+ * data, so writing an icon with or without its image costs what it would.
+ * Icons are read and written through dos.library, so they pay the latency
+ * of their volume, and decoding one pays the icon latency on top.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hal.h"
+
+#define ICON_MAGIC       "HALICON\n"
+#define ICON_ROW_BYTES   64                 /* Image rows, Width 512 at Depth 1 */
+#define MAX_TOOLTYPES    32
+
+/* One allocation per icon - what FreeDiskObject() frees */
+struct HalIcon {
+    struct DiskObject hi_Object;
+    struct Image hi_Image;
+    STRPTR hi_ToolTypes[MAX_TOOLTYPES + 1];
+    UBYTE hi_Tool[256];
+    UBYTE hi_Strings[1024];                 /* Tooltype text */
+    LONG hi_ImageBytes;
+    UWORD hi_ImageData[1];                  /* hi_ImageBytes of image */
+};
+
+struct DefIconsRule {
+    struct DefIconsRule *dr_Next;
+    UBYTE dr_Pattern[128];                  /* Name pattern, empty for any */
+    UBYTE dr_Magic[32];                     /* Leading bytes, empty for any */
+    LONG dr_MagicLength;
+    UBYTE dr_Type[32];
+};
+
+/* What DefIcons spends on top of the fixed identify time, so files do not all cost the same */
+#define DEFICONS_RULE_MICROS 60             /* Matching one rule's pattern against the name */
+#define DEFICONS_SCAN_BYTES  1024           /* Read to tell text from binary when no rule fits */
+#define DEFICONS_BYTE_MICROS 2              /* Scanning one of those bytes */
+
+static struct DefIconsRule *rules = NULL;
+static struct MsgPort *defIconsPort = NULL;
+static struct SignalSemaphore defIconsServer;
+static ULONG decodeMicros = 0;
+static ULONG identifyMicros = 0;
+
+static LONG ImageBytes(const struct DiskObject *icon)
+{
+    const struct Image *image = icon->do_Gadget.GadgetRender;
+
+    if (image == NULL || image->ImageData == NULL) {
+        return 0;
+    }
+    return ((image->Width + 15) / 16) * 2 * image->Height * image->Depth;
+}
+
+static struct HalIcon *NewIcon(LONG imageBytes)
+{
+    struct HalIcon *icon;
+
+    imageBytes = (imageBytes + ICON_ROW_BYTES - 1) / ICON_ROW_BYTES * ICON_ROW_BYTES;
+    icon = AllocVec(sizeof(struct HalIcon) + imageBytes, MEMF_CLEAR | MEMF_PUBLIC);
+    if (icon == NULL) {
+        return NULL;
+    }
+    icon->hi_Object.do_Magic = WB_DISKMAGIC;
+    icon->hi_Object.do_Version = WB_DISKVERSION;
+    icon->hi_Object.do_CurrentX = (LONG)NO_ICON_POSITION;
+    icon->hi_Object.do_CurrentY = (LONG)NO_ICON_POSITION;
+    icon->hi_Object.do_StackSize = 4096;
+    icon->hi_ImageBytes = imageBytes;
+    if (imageBytes > 0) {
+        icon->hi_Image.Width = ICON_ROW_BYTES * 8;
+        icon->hi_Image.Height = imageBytes / ICON_ROW_BYTES;
+        icon->hi_Image.Depth = 1;
+        icon->hi_Image.ImageData = icon->hi_ImageData;
+        icon->hi_Object.do_Gadget.GadgetRender = &icon->hi_Image;
+        icon->hi_Object.do_Gadget.Width = ICON_ROW_BYTES * 8;
+        icon->hi_Object.do_Gadget.Height = icon->hi_Image.Height;
+    }
+    return icon;
+}
+
+/* Tooltypes are copied into the icon's own string space */
+static VOID SetToolTypes(struct HalIcon *icon, STRPTR *toolTypes)
+{
+    UBYTE *free = icon->hi_Strings;
+    UBYTE *end = icon->hi_Strings + sizeof(icon->hi_Strings);
+    LONG count = 0;
+    LONG length;
+
+    for (; toolTypes != NULL && toolTypes[count] != NULL && count < MAX_TOOLTYPES; count++) {
+        length = strlen((char *)toolTypes[count]) + 1;
+        if (free + length > end) {
+            break;
+        }
+        memcpy(free, toolTypes[count], length);
+        icon->hi_ToolTypes[count] = free;
+        free += length;
+    }
+    icon->hi_ToolTypes[count] = NULL;
+    icon->hi_Object.do_ToolTypes = icon->hi_ToolTypes;
+}
+
+static VOID SetTool(struct HalIcon *icon, CONST_STRPTR tool)
+{
+    if (tool != NULL) {
+        Strncpy(icon->hi_Tool, tool, sizeof(icon->hi_Tool));
+        icon->hi_Object.do_DefaultTool = icon->hi_Tool;
+    } else {
+        icon->hi_Object.do_DefaultTool = NULL;
+    }
+}
+
+/* The text form of an icon, in host memory */
+static UBYTE *Serialize(const struct DiskObject *icon, LONG *length)
+{
+    const struct Image *image = icon->do_Gadget.GadgetRender;
+    LONG imageBytes = ImageBytes(icon);
+    LONG size = 512 + imageBytes;
+    UBYTE *text;
+    LONG used;
+    LONG i;
+
+    for (i = 0; icon->do_ToolTypes != NULL && icon->do_ToolTypes[i] != NULL; i++) {
+        size += strlen((char *)icon->do_ToolTypes[i]) + 4;
+    }
+    if (icon->do_DefaultTool != NULL) {
+        size += strlen((char *)icon->do_DefaultTool);
+    }
+    text = malloc(size);
+    if (text == NULL) {
+        HalAbort("out of host memory");
+    }
+    used = snprintf((char *)text, size, ICON_MAGIC "type=%d\ntool=%s\nstack=%ld\nx=%ld\ny=%ld\n",
+                    icon->do_Type, icon->do_DefaultTool != NULL ? (char *)icon->do_DefaultTool : "",
+                    icon->do_StackSize, icon->do_CurrentX, icon->do_CurrentY);
+    for (i = 0; icon->do_ToolTypes != NULL && icon->do_ToolTypes[i] != NULL; i++) {
+        used += snprintf((char *)text + used, size - used, "tt=%s\n", icon->do_ToolTypes[i]);
+    }
+    used += snprintf((char *)text + used, size - used, "image=%ld\n", imageBytes);
+    if (imageBytes > 0) {
+        memcpy(text + used, image->ImageData, imageBytes);
+        used += imageBytes;
+    }
+    *length = used;
+    return text;
+}
+
+static struct HalIcon *Deserialize(const UBYTE *text, LONG length)
+{
+    struct HalIcon *icon;
+    STRPTR toolTypes[MAX_TOOLTYPES + 1];
+    UBYTE strings[1024];
+    UBYTE tool[256];
+    const UBYTE *line = text + strlen(ICON_MAGIC);
+    const UBYTE *end = text + length;
+    const UBYTE *next;
+    UBYTE *free = strings;
+    LONG count = 0;
+    LONG type = WBPROJECT;
+    LONG stack = 4096;
+    LONG x = (LONG)NO_ICON_POSITION;
+    LONG y = (LONG)NO_ICON_POSITION;
+    LONG imageBytes = 0;
+    LONG size;
+
+    if (length < (LONG)strlen(ICON_MAGIC) || memcmp(text, ICON_MAGIC, strlen(ICON_MAGIC)) != 0) {
+        return NULL;
+    }
+    tool[0] = '\0';
+    while (line < end) {
+        next = memchr(line, '\n', end - line);
+        if (next == NULL) {
+            return NULL;
+        }
+        size = next - line;
+        if (size > 3 && strncmp((const char *)line, "tt=", 3) == 0) {
+            if (count < MAX_TOOLTYPES && free + size - 2 <= strings + sizeof(strings)) {
+                memcpy(free, line + 3, size - 3);
+                free[size - 3] = '\0';
+                toolTypes[count++] = free;
+                free += size - 2;
+            }
+        } else if (strncmp((const char *)line, "tool=", 5) == 0 && size - 5 < (LONG)sizeof(tool)) {
+            memcpy(tool, line + 5, size - 5);
+            tool[size - 5] = '\0';
+        } else if (strncmp((const char *)line, "type=", 5) == 0) {
+            type = atol((const char *)line + 5);
+        } else if (strncmp((const char *)line, "stack=", 6) == 0) {
+            stack = atol((const char *)line + 6);
+        } else if (strncmp((const char *)line, "x=", 2) == 0) {
+            x = atol((const char *)line + 2);
+        } else if (strncmp((const char *)line, "y=", 2) == 0) {
+            y = atol((const char *)line + 2);
+        } else if (strncmp((const char *)line, "image=", 6) == 0) {
+            imageBytes = atol((const char *)line + 6);
+            line = next + 1;
+            break;
+        }
+        line = next + 1;
+    }
+    if (line + imageBytes > end) {
+        return NULL;
+    }
+    toolTypes[count] = NULL;
+
+    icon = NewIcon(imageBytes);
+    if (icon == NULL) {
+        return NULL;
+    }
+    icon->hi_Object.do_Type = (UBYTE)type;
+    icon->hi_Object.do_StackSize = stack;
+    icon->hi_Object.do_CurrentX = x;
+    icon->hi_Object.do_CurrentY = y;
+    SetTool(icon, tool[0] != '\0' ? tool : NULL);
+    SetToolTypes(icon, count > 0 ? toolTypes : NULL);
+    memcpy(icon->hi_ImageData, line, imageBytes);
+    return icon;
+}
+
+static VOID SetError(const struct TagItem *tags, LONG code)
+{
+    struct TagItem *tag = FindTagItem(ICONA_ErrorCode, tags);
+
+    if (tag != NULL && tag->ti_Data != 0) {
+        *(LONG *)tag->ti_Data = code;
+    }
+    SetIoErr(code);
+}
+
+static struct HalIcon *ReadIcon(CONST_STRPTR name)
+{
+    struct HalIcon *icon;
+    struct FileInfoBlock *fib;
+    UBYTE path[512];
+    UBYTE *text;
+    BPTR file;
+    LONG length;
+
+    snprintf((char *)path, sizeof(path), "%s.info", name);
+    file = Open(path, MODE_OLDFILE);
+    if (file == NULL) {
+        return NULL;
+    }
+    fib = AllocDosObject(DOS_FIB, NULL);
+    if (fib == NULL || !ExamineFH(file, fib)) {
+        FreeDosObject(DOS_FIB, fib);
+        Close(file);
+        return NULL;
+    }
+    length = fib->fib_Size;
+    FreeDosObject(DOS_FIB, fib);
+    text = malloc(length > 0 ? length : 1);
+    if (text == NULL) {
+        HalAbort("out of host memory");
+    }
+    length = Read(file, text, length);
+    Close(file);
+    halCounters.hc_IconReads++;
+    HalSpend(decodeMicros);
+    icon = Deserialize(text, length);
+    free(text);
+    if (icon == NULL) {
+        SetIoErr(ERROR_OBJECT_WRONG_TYPE);
+    }
+    return icon;
+}
+
+struct DiskObject *GetDiskObject(CONST_STRPTR name)
+{
+    struct HalIcon *icon = ReadIcon(name);
+
+    return icon != NULL ? &icon->hi_Object : NULL;
+}
+
+VOID FreeDiskObject(struct DiskObject *icon)
+{
+    if (icon != NULL) {
+        FreeVec(icon);
+    }
+}
+
+struct DiskObject *GetDefDiskObject(LONG type)
+{
+    struct HalIcon *icon = NewIcon(ICON_ROW_BYTES * 8);
+
+    if (icon == NULL) {
+        SetIoErr(ERROR_NO_FREE_STORE);
+        return NULL;
+    }
+    icon->hi_Object.do_Type = (UBYTE)type;
+    return &icon->hi_Object;
+}
+
+/* DefIcons - the first rule whose pattern and magic both fit names the type */
+static BOOL IdentifyRules(CONST_STRPTR name, STRPTR type, LONG size)
+{
+    struct DefIconsRule *rule;
+    UBYTE header[32];
+    UBYTE scan[DEFICONS_SCAN_BYTES];
+    LONG headerLength = -1;
+    LONG scanLength = 0;
+    BPTR file;
+    BPTR lock;
+    LONG isDir = FALSE;
+
+    halCounters.hc_Identifies++;
+    HalSpend(identifyMicros);
+
+    lock = Lock(name, SHARED_LOCK);
+    if (lock == NULL) {
+        return FALSE;
+    }
+    {
+        struct FileInfoBlock *fib = AllocDosObject(DOS_FIB, NULL);
+
+        if (fib != NULL && Examine(lock, fib)) {
+            isDir = fib->fib_DirEntryType > 0;
+        }
+        FreeDosObject(DOS_FIB, fib);
+    }
+    UnLock(lock);
+    if (isDir) {
+        Strncpy(type, (CONST_STRPTR)"drawer", size);
+        return TRUE;
+    }
+
+    for (rule = rules; rule != NULL; rule = rule->dr_Next) {
+        HalSpend(DEFICONS_RULE_MICROS);
+        if (rule->dr_Pattern[0] != '\0' && !MatchPatternNoCase(rule->dr_Pattern, FilePart(name))) {
+            continue;
+        }
+        if (rule->dr_MagicLength > 0) {
+            if (headerLength < 0) {
+                headerLength = 0;
+                file = Open(name, MODE_OLDFILE);
+                if (file != NULL) {
+                    headerLength = Read(file, header, sizeof(header));
+                    Close(file);
+                }
+            }
+            if (headerLength < rule->dr_MagicLength ||
+                memcmp(header, rule->dr_Magic, rule->dr_MagicLength) != 0) {
+                continue;
+            }
+        }
+        Strncpy(type, rule->dr_Type, size);
+        return TRUE;
+    }
+
+    /* No rule fits - DefIcons reads further to see whether it is text, and finds nothing here */
+    file = Open(name, MODE_OLDFILE);
+    if (file != NULL) {
+        scanLength = Read(file, scan, sizeof(scan));
+        Close(file);
+    }
+    if (scanLength > 0) {
+        HalSpend(scanLength * DEFICONS_BYTE_MICROS);
+    }
+    return FALSE;
+}
+
+/* DefIcons has one port and answers one request at a time, whoever sends them */
+static BOOL Identify(CONST_STRPTR name, STRPTR type, LONG size)
+{
+    BOOL found;
+
+    type[0] = '\0';
+    if (FindPort((CONST_STRPTR)"DEFICONS") == NULL) {
+        return FALSE;
+    }
+    ObtainSemaphore(&defIconsServer);
+    found = IdentifyRules(name, type, size);
+    ReleaseSemaphore(&defIconsServer);
+    return found;
+}
+
+struct DiskObject *GetIconTagList(CONST_STRPTR name, const struct TagItem *tags)
+{
+    struct HalIcon *icon;
+    STRPTR buffer;
+    UBYTE type[32];
+
+    if (GetTagData(ICONGETA_IdentifyOnly, FALSE, tags)) {
+        buffer = (STRPTR)GetTagData(ICONGETA_IdentifyBuffer, 0, tags);
+        if (Identify(name, type, sizeof(type))) {
+            if (buffer != NULL) {
+                Strncpy(buffer, type, 32);
+            }
+            SetError(tags, 0);
+        } else {
+            if (buffer != NULL) {
+                buffer[0] = '\0';
+            }
+            SetError(tags, ERROR_OBJECT_NOT_FOUND);
+        }
+        return NULL;
+    }
+
+    icon = ReadIcon(name);
+    if (icon != NULL) {
+        SetError(tags, 0);
+        return &icon->hi_Object;
+    }
+    if (!HalTagInt(GetTagData(ICONGETA_FailIfUnavailable, TRUE, tags))) {
+        SetError(tags, 0);
+        return GetDefDiskObject(WBPROJECT);
+    }
+    SetError(tags, IoErr() != 0 ? IoErr() : ERROR_OBJECT_NOT_FOUND);
+    return NULL;
+}
+
+struct DiskObject *GetIconTags(CONST_STRPTR name, ...)
+{
+    struct TagItem tags[16];
+    va_list args;
+
+    va_start(args, name);
+    HalVarTags(tags, 16, args);
+    va_end(args);
+    return GetIconTagList(name, tags);
+}
+
+struct DiskObject *GetDiskObjectNew(CONST_STRPTR name)
+{
+    struct HalIcon *icon = ReadIcon(name);
+
+    return icon != NULL ? &icon->hi_Object : GetDefDiskObject(WBPROJECT);
+}
+
+BOOL PutIconTagList(CONST_STRPTR name, struct DiskObject *icon, const struct TagItem *tags)
+{
+    UBYTE path[512];
+    UBYTE *text;
+    LONG length;
+    BPTR file;
+    BOOL success;
+
+    snprintf((char *)path, sizeof(path), "%s.info", name);
+    file = Open(path, MODE_NEWFILE);
+    if (file == NULL) {
+        SetError(tags, IoErr());
+        return FALSE;
+    }
+    text = Serialize(icon, &length);
+    success = (Write(file, text, length) == length);
+    free(text);
+    Close(file);
+    halCounters.hc_IconWrites++;
+    SetError(tags, success ? 0 : IoErr());
+    return success;
+}
+
+BOOL PutIconTags(CONST_STRPTR name, struct DiskObject *icon, ...)
+{
+    struct TagItem tags[16];
+    va_list args;
+
+    va_start(args, icon);
+    HalVarTags(tags, 16, args);
+    va_end(args);
+    return PutIconTagList(name, icon, tags);
+}
+
+BOOL PutDiskObject(CONST_STRPTR name, struct DiskObject *icon)
+{
+    return PutIconTagList(name, icon, NULL);
+}
+
+BOOL DeleteDiskObject(CONST_STRPTR name)
+{
+    UBYTE path[512];
+
+    snprintf((char *)path, sizeof(path), "%s.info", name);
+    return DeleteFile(path) ? TRUE : FALSE;
+}
+
+struct DiskObject *DupDiskObjectA(struct DiskObject *source, const struct TagItem *tags)
+{
+    LONG imageBytes = HalTagInt(GetTagData(ICONDUPA_DuplicateImages, TRUE, tags)) ? ImageBytes(source) : 0;
+    struct HalIcon *icon = NewIcon(imageBytes);
+
+    if (icon == NULL) {
+        SetIoErr(ERROR_NO_FREE_STORE);
+        return NULL;
+    }
+    icon->hi_Object.do_Type = source->do_Type;
+    icon->hi_Object.do_StackSize = source->do_StackSize;
+    icon->hi_Object.do_CurrentX = source->do_CurrentX;
+    icon->hi_Object.do_CurrentY = source->do_CurrentY;
+    SetTool(icon, source->do_DefaultTool);
+    if (HalTagInt(GetTagData(ICONDUPA_DuplicateToolTypes, TRUE, tags))) {
+        SetToolTypes(icon, source->do_ToolTypes);
+    }
+    if (imageBytes > 0) {
+        memcpy(icon->hi_ImageData, ((struct Image *)source->do_Gadget.GadgetRender)->ImageData, imageBytes);
+    }
+    return &icon->hi_Object;
+}
+
+UBYTE *FindToolType(STRPTR *toolTypes, CONST_STRPTR name)
+{
+    LONG length = strlen((const char *)name);
+    LONG i;
+
+    for (i = 0; toolTypes != NULL && toolTypes[i] != NULL; i++) {
+        if (Strnicmp(toolTypes[i], name, length) == 0) {
+            if (toolTypes[i][length] == '=') {
+                return toolTypes[i] + length + 1;
+            }
+            if (toolTypes[i][length] == '\0') {
+                return toolTypes[i] + length;
+            }
+        }
+    }
+    return NULL;
+}
+
+BOOL MatchToolValue(CONST_STRPTR value, CONST_STRPTR substring)
+{
+    LONG length = strlen((const char *)substring);
+    CONST_STRPTR end;
+
+    for (;;) {
+        end = (CONST_STRPTR)strchr((const char *)value, '|');
+        if (end == NULL) {
+            end = value + strlen((const char *)value);
+        }
+        if (end - value == length && Strnicmp(value, substring, length) == 0) {
+            return TRUE;
+        }
+        if (*end == '\0') {
+            return FALSE;
+        }
+        value = end + 1;
+    }
+}
+
+/* Harness side */
+
+BOOL HalWriteIcon(CONST_STRPTR path, UBYTE type, CONST_STRPTR defaultTool,
+                  CONST_STRPTR *toolTypes, LONG imageBytes)
+{
+    struct HalIcon *icon = NewIcon(imageBytes);
+    UBYTE infoPath[512];
+    UBYTE *text;
+    LONG length;
+    LONG i;
+    BOOL success;
+
+    if (icon == NULL) {
+        return FALSE;
+    }
+    icon->hi_Object.do_Type = type;
+    SetTool(icon, defaultTool);
+    SetToolTypes(icon, (STRPTR *)toolTypes);
+    for (i = 0; i < icon->hi_ImageBytes; i++) {
+        ((UBYTE *)icon->hi_ImageData)[i] = (UBYTE)(i * 7);
+    }
+    text = Serialize(&icon->hi_Object, &length);
+    FreeVec(icon);
+    snprintf((char *)infoPath, sizeof(infoPath), "%s.info", path);
+    success = HalWriteFile(infoPath, text, length, 0);
+    free(text);
+    return success;
+}
+
+VOID HalIconLatency(ULONG decode, ULONG identify)
+{
+    decodeMicros = decode;
+    identifyMicros = identify;
+}
+
+VOID HalDefIconsRule(CONST_STRPTR pattern, CONST_STRPTR magic, CONST_STRPTR type)
+{
+    struct DefIconsRule *rule = calloc(1, sizeof(struct DefIconsRule));
+    struct DefIconsRule **link;
+
+    if (rule == NULL) {
+        HalAbort("out of host memory");
+    }
+    if (pattern != NULL) {
+        Strncpy(rule->dr_Pattern, pattern, sizeof(rule->dr_Pattern));
+    }
+    if (magic != NULL) {
+        Strncpy(rule->dr_Magic, magic, sizeof(rule->dr_Magic));
+        rule->dr_MagicLength = strlen((char *)rule->dr_Magic);
+    }
+    Strncpy(rule->dr_Type, type, sizeof(rule->dr_Type));
+    for (link = &rules; *link != NULL; link = &(*link)->dr_Next) {
+    }
+    *link = rule;
+}
+
+VOID HalDefIconsStart(VOID)
+{
+    if (defIconsPort != NULL) {
+        return;
+    }
+    defIconsPort = CreateMsgPort();
+    if (defIconsPort == NULL) {
+        HalAbort("no port for DefIcons");
+    }
+    defIconsPort->mp_Node.ln_Name = "DEFICONS";
+    AddPort(defIconsPort);
+    InitSemaphore(&defIconsServer);
+}
+
+VOID HalInitIcon(VOID)
+{
+    /* An OS 3.2 icon from a hard disk, and one DefIcons pass, on a 68000 */
+    HalIconLatency(3000, 2000);
+}
@@ -0,0 +1,186 @@
+/*
+ * hal_util.c - utility.library on the host, and tag list helpers
+ *
+ * Copyright (c) 2025 amigazen project
+ * Licensed under BSD 2-Clause License
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include "hal.h"
+
+/* Integer data in a tag list built from varargs was passed as an int, */
+/* so only its low 32 bits are meaningful on an LP64 host */
+LONG HalTagInt(ULONG data)
+{
+    return (LONG)(int)(data & 0xFFFFFFFFUL);
+}
+
+/* Copy a varargs tag list, ending in TAG_DONE, into an array */
+VOID HalVarTags(struct TagItem *tags, LONG max, va_list args)
+{
+    LONG i;
+
+    for (i = 0; i < max - 1; i++) {
+        tags[i].ti_Tag = va_arg(args, ULONG) & 0xFFFFFFFFUL;
+        if (tags[i].ti_Tag == TAG_DONE) {
+            return;
+        }
+        tags[i].ti_Data = va_arg(args, ULONG);
+    }
+    tags[i].ti_Tag = TAG_DONE;
+    tags[i].ti_Data = 0;
+}
+
+struct TagItem *NextTagItem(struct TagItem **tags)
+{
+    struct TagItem *tag;
+
+    for (;;) {
+        tag = *tags;
+        if (tag == NULL) {
+            return NULL;
+        }
+        switch (tag->ti_Tag) {
+        case TAG_DONE:
+            *tags = NULL;
+            return NULL;
+        case TAG_IGNORE:
+            *tags = tag + 1;
+            break;
+        case TAG_MORE:
+            *tags = (struct TagItem *)tag->ti_Data;
+            break;
+        case TAG_SKIP:
+            *tags = tag + 1 + HalTagInt(tag->ti_Data);
+            break;
+        default:
+            *tags = tag + 1;
+            return tag;
+        }
+    }
+}
+
+struct TagItem *FindTagItem(Tag tagValue, const struct TagItem *tags)
+{
+    struct TagItem *state = (struct TagItem *)tags;
+    struct TagItem *tag;
+
+    while ((tag = NextTagItem(&state)) != NULL) {
+        if (tag->ti_Tag == tagValue) {
+            return tag;
+        }
+    }
+    return NULL;
+}
+
+ULONG GetTagData(Tag tagValue, ULONG defaultData, const struct TagItem *tags)
+{
+    struct TagItem *tag = FindTagItem(tagValue, tags);
+
+    return tag != NULL ? tag->ti_Data : defaultData;
+}
+
+UBYTE ToUpper(ULONG c)
+{
+    c &= 0xFF;
+    if ((c >= 'a' && c <= 'z') || (c >= 0xE0 && c <= 0xFE && c != 0xF7)) {
+        return (UBYTE)(c - 0x20);
+    }
+    return (UBYTE)c;
+}
+
+UBYTE ToLower(ULONG c)
+{
+    c &= 0xFF;
+    if ((c >= 'A' && c <= 'Z') || (c >= 0xC0 && c <= 0xDE && c != 0xD7)) {
+        return (UBYTE)(c + 0x20);
+    }
+    return (UBYTE)c;
+}
+
+LONG Strnicmp(CONST_STRPTR a, CONST_STRPTR b, LONG length)
+{
+    LONG difference;
+
+    while (length-- > 0) {
+        difference = (LONG)ToUpper(*a) - (LONG)ToUpper(*b);
+        if (difference != 0 || *a == '\0') {
+            return difference;
+        }
+        a++;
+        b++;
+    }
+    return 0;
+}
+
+LONG Stricmp(CONST_STRPTR a, CONST_STRPTR b)
+{
+    return Strnicmp(a, b, 0x7FFFFFFFL);
+}
+
+/* Copy with truncation, always terminated - the length copied */
+LONG Strncpy(STRPTR dest, CONST_STRPTR source, LONG size)
+{
+    LONG length = 0;
+
+    if (size <= 0) {
+        return 0;
+    }
+    while (length < size - 1 && source[length] != '\0') {
+        dest[length] = source[length];
+        length++;
+    }
+    dest[length] = '\0';
+    return length;
+}
+
+LONG Strncat(STRPTR dest, CONST_STRPTR source, LONG size)
+{
+    LONG length = strlen((char *)dest);
+
+    if (length >= size) {
+        return length;
+    }
+    return length + Strncpy(dest + length, source, size - length);
+}
+
+LONG VSNPrintf(STRPTR buffer, LONG size, CONST_STRPTR format, va_list args)
+{
+    return vsnprintf((char *)buffer, size, (const char *)format, args);
+}
+
+LONG SNPrintf(STRPTR buffer, LONG size, CONST_STRPTR format, ...)
+{
+    va_list args;
+    LONG length;
+
+    va_start(args, format);
+    length = VSNPrintf(buffer, size, format, args);
+    va_end(args);
+    return length;
+}
+
+ULONG UDivMod32(ULONG dividend, ULONG divisor)
+{
+    return dividend / divisor;
+}
+
+ULONG UMult32(ULONG a, ULONG b)
+{
+    return a * b;
+}
+
+LONG SMult32(LONG a, LONG b)
+{
+    return a * b;
+}
+
+ULONG GetUniqueID(VOID)
+{
+    static ULONG next = 0;
+
+    return ++next;
+}
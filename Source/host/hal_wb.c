@@ -0,0 +1,702 @@
+/*
+ * hal_wb.c - Workbench, System(), requesters and ARexx messages on the host
+ *
+ * Copyright (c) 2025 amigazen project
+ * Licensed under BSD 2-Clause License
+ *
+ * Every launch is recorded in halLaunches, and every requester shown in
+ * halDialogs. Launches only run something when the harness asked for it
+ * with HalSetSystemRuns() and the command or tool is a registered program.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+
+#include "hal.h"
+
+/* A requester.class object */
+struct HalRequester {
+    ULONG hr_Magic;
+    UBYTE hr_Title[64];
+    UBYTE hr_Body[512];
+    UBYTE hr_Gadgets[128];
+};
+
+#define HAL_REQUESTER_MAGIC 0x48414C52UL
+#define HAL_WB_ARGS         8               /* Projects in one HalRunWorkbench() */
+
+/* A drawer Workbench has open */
+struct HalDrawer {
+    struct HalDrawer *hd_Next;
+    UBYTE hd_Path[256];
+};
+
+struct HalLaunch *halLaunches = NULL;
+struct HalDialog *halDialogs = NULL;
+
+static struct HalLaunch **lastLaunch = &halLaunches;
+static struct HalDialog **lastDialog = &halDialogs;
+static struct HalDrawer *drawers = NULL;
+static LONG requesterResult = 1;
+static BOOL workbenchRunning = TRUE;
+static BOOL systemRuns = FALSE;
+static ULONG drawerLife = 0;
+static ULONG drawerOpenMicros = 0;
+static ULONG drawerCloseMicros = 0;
+
+/* Launch records */
+
+VOID HalRecordLaunch(LONG kind, CONST_STRPTR tool, CONST_STRPTR args, LONG numArgs)
+{
+    struct HalLaunch *launch = calloc(1, sizeof(struct HalLaunch));
+
+    if (launch == NULL) {
+        HalAbort("out of host memory");
+    }
+    launch->hl_Kind = kind;
+    Strncpy(launch->hl_Tool, tool != NULL ? tool : (CONST_STRPTR)"", sizeof(launch->hl_Tool));
+    Strncpy(launch->hl_Args, args != NULL ? args : (CONST_STRPTR)"", sizeof(launch->hl_Args));
+    launch->hl_NumArgs = numArgs;
+    launch->hl_Micros = HalMicros();
+    *lastLaunch = launch;
+    lastLaunch = &launch->hl_Next;
+}
+
+LONG HalLaunchCount(LONG kind)
+{
+    struct HalLaunch *launch;
+    LONG count = 0;
+
+    for (launch = halLaunches; launch != NULL; launch = launch->hl_Next) {
+        if (kind < 0 || launch->hl_Kind == kind) {
+            count++;
+        }
+    }
+    return count;
+}
+
+struct HalLaunch *HalLastLaunch(LONG kind)
+{
+    struct HalLaunch *launch;
+    struct HalLaunch *found = NULL;
+
+    for (launch = halLaunches; launch != NULL; launch = launch->hl_Next) {
+        if (kind < 0 || launch->hl_Kind == kind) {
+            found = launch;
+        }
+    }
+    return found;
+}
+
+VOID HalSetRequesterResult(LONG result)
+{
+    requesterResult = result;
+}
+
+VOID HalSetWorkbenchRunning(BOOL running)
+{
+    workbenchRunning = running;
+}
+
+VOID HalSetSystemRuns(BOOL runs)
+{
+    systemRuns = runs;
+}
+
+VOID HalSetDrawerLife(ULONG micros, ULONG openMicros, ULONG closeMicros)
+{
+    drawerLife = micros;
+    drawerOpenMicros = openMicros;
+    drawerCloseMicros = closeMicros;
+}
+
+/* Drawers */
+
+static struct HalDrawer *FindDrawer(CONST_STRPTR path)
+{
+    struct HalDrawer *drawer;
+
+    for (drawer = drawers; drawer != NULL; drawer = drawer->hd_Next) {
+        if (Stricmp(drawer->hd_Path, path) == 0) {
+            return drawer;
+        }
+    }
+    return NULL;
+}
+
+static VOID CloseDrawer(struct HalDrawer *drawer)
+{
+    struct HalDrawer **link;
+
+    for (link = &drawers; *link != NULL; link = &(*link)->hd_Next) {
+        if (*link == drawer) {
+            *link = drawer->hd_Next;
+            break;
+        }
+    }
+    HalCancelEvent(drawer);
+    free(drawer);
+}
+
+/* The user closed the window */
+static VOID DrawerClosed(APTR data)
+{
+    CloseDrawer(data);
+}
+
+/* Canonical name of an object, for matching drawers however they were named */
+static BOOL Canonical(CONST_STRPTR name, STRPTR path, LONG size, BOOL *isDrawer)
+{
+    struct FileInfoBlock *fib;
+    BPTR lock = Lock(name, SHARED_LOCK);
+    BOOL success;
+
+    if (lock == NULL) {
+        return FALSE;
+    }
+    success = NameFromLock(lock, path, size) != DOSFALSE;
+    fib = AllocDosObject(DOS_FIB, NULL);
+    *isDrawer = FALSE;
+    if (fib != NULL && Examine(lock, fib)) {
+        *isDrawer = fib->fib_DirEntryType > 0;
+    }
+    FreeDosObject(DOS_FIB, fib);
+    UnLock(lock);
+    return success;
+}
+
+BOOL HalDrawerOpen(CONST_STRPTR path)
+{
+    UBYTE canonical[256];
+    BOOL isDrawer;
+
+    if (!Canonical(path, canonical, sizeof(canonical), &isDrawer)) {
+        return FALSE;
+    }
+    return FindDrawer(canonical) != NULL;
+}
+
+/* Workbench */
+
+BOOL OpenWorkbenchObjectA(CONST_STRPTR name, const struct TagItem *tags)
+{
+    struct TagItem *state = (struct TagItem *)tags;
+    struct TagItem *tag;
+    struct HalDrawer *drawer;
+    UBYTE canonical[256];
+    UBYTE args[512];
+    LONG numArgs = 0;
+    BOOL isDrawer;
+
+    halCounters.hc_WorkbenchCalls++;
+    if (!workbenchRunning) {
+        SetIoErr(ERROR_OBJECT_NOT_FOUND);
+        return FALSE;
+    }
+
+    args[0] = '\0';
+    while ((tag = NextTagItem(&state)) != NULL) {
+        if (tag->ti_Tag == WBOPENA_ArgName && tag->ti_Data != 0) {
+            if (numArgs > 0) {
+                Strncat(args, (CONST_STRPTR)"\n", sizeof(args));
+            }
+            Strncat(args, (CONST_STRPTR)tag->ti_Data, sizeof(args));
+            numArgs++;
+        }
+    }
+
+    if (!Canonical(name, canonical, sizeof(canonical), &isDrawer)) {
+        SetIoErr(ERROR_OBJECT_NOT_FOUND);
+        return FALSE;
+    }
+    HalRecordLaunch(HAL_LAUNCH_WORKBENCH, name, args, numArgs);
+
+    if (isDrawer) {
+        HalSpend(drawerOpenMicros);
+        drawer = FindDrawer(canonical);
+        if (drawer == NULL) {
+            drawer = calloc(1, sizeof(struct HalDrawer));
+            if (drawer == NULL) {
+                HalAbort("out of host memory");
+            }
+            Strncpy(drawer->hd_Path, canonical, sizeof(drawer->hd_Path));
+            drawer->hd_Next = drawers;
+            drawers = drawer;
+        }
+        HalCancelEvent(drawer);
+        if (drawerLife > 0) {
+            HalAddEvent(HalMicros() + drawerLife + drawerCloseMicros, DrawerClosed, drawer);
+        }
+    } else if (systemRuns && HalProgramPath(canonical, canonical, sizeof(canonical))) {
+        HalRunWorkbench(canonical, NULL, numArgs > 0 ? args : NULL);
+    }
+    SetIoErr(0);
+    return TRUE;
+}
+
+BOOL OpenWorkbenchObject(CONST_STRPTR name, ...)
+{
+    struct TagItem tags[16];
+    va_list args;
+
+    va_start(args, name);
+    HalVarTags(tags, 16, args);
+    va_end(args);
+    return OpenWorkbenchObjectA(name, tags);
+}
+
+BOOL CloseWorkbenchObjectA(CONST_STRPTR name, const struct TagItem *tags)
+{
+    struct HalDrawer *drawer;
+    UBYTE canonical[256];
+    BOOL isDrawer;
+
+    (void)tags;
+    halCounters.hc_WorkbenchCalls++;
+    if (!Canonical(name, canonical, sizeof(canonical), &isDrawer) ||
+        (drawer = FindDrawer(canonical)) == NULL) {
+        SetIoErr(ERROR_OBJECT_NOT_FOUND);
+        return FALSE;
+    }
+    HalSpend(drawerCloseMicros);
+    CloseDrawer(drawer);
+    SetIoErr(0);
+    return TRUE;
+}
+
+BOOL WorkbenchControlA(CONST_STRPTR name, const struct TagItem *tags)
+{
+    struct TagItem *state = (struct TagItem *)tags;
+    struct TagItem *tag;
+    UBYTE canonical[256];
+    BOOL isDrawer = FALSE;
+    BOOL known;
+
+    halCounters.hc_WorkbenchCalls++;
+    if (!workbenchRunning) {
+        SetIoErr(ERROR_OBJECT_NOT_FOUND);
+        return FALSE;
+    }
+    known = name != NULL && Canonical(name, canonical, sizeof(canonical), &isDrawer);
+    while ((tag = NextTagItem(&state)) != NULL) {
+        if (tag->ti_Tag == WBCTRLA_IsOpen) {
+            if (!known) {
+                SetIoErr(ERROR_OBJECT_NOT_FOUND);
+                return FALSE;
+            }
+            *(LONG *)tag->ti_Data = FindDrawer(canonical) != NULL;
+        }
+    }
+    SetIoErr(0);
+    return TRUE;
+}
+
+BOOL WorkbenchControl(CONST_STRPTR name, ...)
+{
+    struct TagItem tags[16];
+    va_list args;
+
+    va_start(args, name);
+    HalVarTags(tags, 16, args);
+    va_end(args);
+    return WorkbenchControlA(name, tags);
+}
+
+/* Programs started the way Workbench starts them */
+LONG HalRunWorkbench(CONST_STRPTR path, CONST_STRPTR drawer, CONST_STRPTR project)
+{
+    struct WBStartup *startup;
+    struct MsgPort *replyPort;
+    struct Process *process;
+    BPTR seglist;
+    BPTR toolDir;
+    UBYTE toolPath[256];
+    UBYTE names[512];
+    STRPTR name;
+    STRPTR next;
+    LONG result;
+    LONG i;
+
+    seglist = LoadSeg(path);
+    if (seglist == NULL) {
+        return -1;
+    }
+    replyPort = CreateMsgPort();
+    startup = AllocMem(sizeof(struct WBStartup) + (HAL_WB_ARGS + 1) * sizeof(struct WBArg), MEMF_CLEAR | MEMF_PUBLIC);
+    if (replyPort == NULL || startup == NULL) {
+        HalAbort("no memory for a WBStartup");
+    }
+    Strncpy(toolPath, path, sizeof(toolPath));
+    *PathPart(toolPath) = '\0';
+    toolDir = Lock(toolPath, SHARED_LOCK);
+
+    startup->sm_ArgList = (struct WBArg *)(startup + 1);
+    startup->sm_ArgList[0].wa_Lock = toolDir;
+    startup->sm_ArgList[0].wa_Name = (BYTE *)FilePart(path);
+    startup->sm_NumArgs = 1;
+
+    /* Several projects selected together come one to a line */
+    if (project != NULL) {
+        Strncpy(names, project, sizeof(names));
+        for (name = names; name != NULL && startup->sm_NumArgs <= HAL_WB_ARGS; name = next) {
+            next = (STRPTR)strchr((char *)name, '\n');
+            if (next != NULL) {
+                *next++ = '\0';
+            }
+            startup->sm_ArgList[startup->sm_NumArgs].wa_Lock = drawer != NULL ? Lock(drawer, SHARED_LOCK) : NULL;
+            startup->sm_ArgList[startup->sm_NumArgs].wa_Name = (BYTE *)name;
+            startup->sm_NumArgs++;
+        }
+    }
+    startup->sm_Segment = seglist;
+    startup->sm_Message.mn_ReplyPort = replyPort;
+    startup->sm_Message.mn_Length = sizeof(struct WBStartup);
+    startup->sm_Message.mn_Node.ln_Type = NT_MESSAGE;
+
+    process = CreateNewProcTags(NP_Seglist, seglist,
+                                NP_FreeSeglist, FALSE,
+                                NP_Name, FilePart(path),
+                                NP_CurrentDir, toolDir != NULL ? DupLock(toolDir) : NULL,
+                                NP_HomeDir, toolDir != NULL ? DupLock(toolDir) : NULL,
+                                NP_StackSize, 4096,
+                                TAG_DONE);
+    if (process == NULL) {
+        HalAbort("could not start %s", path);
+    }
+    startup->sm_Process = &process->pr_MsgPort;
+    PutMsg(&process->pr_MsgPort, &startup->sm_Message);
+
+    WaitPort(replyPort);
+    GetMsg(replyPort);
+    result = HalCommandResult(process);
+
+    UnLoadSeg(seglist);
+    for (i = 0; i < startup->sm_NumArgs; i++) {
+        UnLock(startup->sm_ArgList[i].wa_Lock);
+    }
+    FreeMem(startup, sizeof(struct WBStartup) + (HAL_WB_ARGS + 1) * sizeof(struct WBArg));
+    DeleteMsgPort(replyPort);
+    HalSettle(0);
+    HalReap();
+    return result;
+}
+
+/* Programs started from a shell */
+LONG HalRun(CONST_STRPTR path, CONST_STRPTR arguments)
+{
+    struct Process *process;
+    UBYTE line[512];
+    BPTR seglist;
+    LONG signal;
+    LONG result;
+
+    seglist = LoadSeg(path);
+    if (seglist == NULL) {
+        return -1;
+    }
+    signal = AllocSignal(-1);
+    if (signal < 0) {
+        HalAbort("no signal for a command");
+    }
+    /* The shell hands the arguments over with a newline at the end */
+    snprintf((char *)line, sizeof(line), "%s\n", arguments != NULL ? (const char *)arguments : "");
+    process = HalStartCommand(seglist, path, line, Output(), FindTask(NULL), 1UL << signal);
+    if (process == NULL) {
+        HalAbort("could not start %s", path);
+    }
+    result = HalWaitCommand(process, 1UL << signal);
+    SetSignal(0, 1UL << signal);
+    FreeSignal(signal);
+    HalReap();
+    return result;
+}
+
+/* System() - recorded, and run when it names a registered program */
+LONG SystemTagList(CONST_STRPTR command, struct TagItem *tags)
+{
+    struct Process *process;
+    UBYTE tool[256];
+    UBYTE resolved[256];
+    CONST_STRPTR rest = command;
+    UBYTE line[512];
+    BPTR seglist;
+    BPTR output;
+    LONG signal;
+    LONG result;
+    LONG length = 0;
+
+    while (*rest == ' ') {
+        rest++;
+    }
+    if (*rest == '"') {
+        for (rest++; *rest != '\0' && *rest != '"' && length < (LONG)sizeof(tool) - 1; rest++) {
+            tool[length++] = *rest;
+        }
+        if (*rest == '"') {
+            rest++;
+        }
+    } else {
+        for (; *rest != '\0' && *rest != ' ' && length < (LONG)sizeof(tool) - 1; rest++) {
+            tool[length++] = *rest;
+        }
+    }
+    tool[length] = '\0';
+    while (*rest == ' ') {
+        rest++;
+    }
+    HalRecordLaunch(HAL_LAUNCH_SYSTEM, tool, rest, 0);
+    SetIoErr(0);
+
+    if (!systemRuns || !HalProgramPath(tool, resolved, sizeof(resolved))) {
+        return RETURN_OK;
+    }
+    seglist = LoadSeg(resolved);
+    if (seglist == NULL) {
+        return -1;
+    }
+    output = (BPTR)GetTagData(SYS_Output, 0, tags);
+    snprintf((char *)line, sizeof(line), "%s\n", rest);
+    if (HalTagInt(GetTagData(SYS_Asynch, FALSE, tags))) {
+        process = HalStartCommand(seglist, tool, line, output, NULL, 0);
+        SetIoErr(0);
+        return process != NULL ? RETURN_OK : -1;
+    }
+    signal = AllocSignal(-1);
+    process = HalStartCommand(seglist, tool, line, output != NULL ? output : Output(),
+                              FindTask(NULL), 1UL << signal);
+    if (process == NULL) {
+        FreeSignal(signal);
+        return -1;
+    }
+    result = HalWaitCommand(process, 1UL << signal);
+    SetSignal(0, 1UL << signal);
+    FreeSignal(signal);
+    SetIoErr(0);
+    return result;
+}
+
+LONG System(CONST_STRPTR command, struct TagItem *tags)
+{
+    return SystemTagList(command, tags);
+}
+
+LONG SystemTags(CONST_STRPTR command, ...)
+{
+    struct TagItem tags[16];
+    va_list args;
+
+    va_start(args, command);
+    HalVarTags(tags, 16, args);
+    va_end(args);
+    return SystemTagList(command, tags);
+}
+
+/* requester.class */
+
+Object *NewObjectA(Class *classPtr, CONST_STRPTR classID, const struct TagItem *tags)
+{
+    struct HalRequester *requester;
+    struct TagItem *state = (struct TagItem *)tags;
+    struct TagItem *tag;
+
+    (void)classPtr;
+    (void)classID;
+    requester = AllocVec(sizeof(struct HalRequester), MEMF_CLEAR | MEMF_PUBLIC);
+    if (requester == NULL) {
+        return NULL;
+    }
+    requester->hr_Magic = HAL_REQUESTER_MAGIC;
+    while ((tag = NextTagItem(&state)) != NULL) {
+        switch (tag->ti_Tag) {
+        case REQ_TitleText:
+            Strncpy(requester->hr_Title, (CONST_STRPTR)tag->ti_Data, sizeof(requester->hr_Title));
+            break;
+        case REQ_BodyText:
+            Strncpy(requester->hr_Body, (CONST_STRPTR)tag->ti_Data, sizeof(requester->hr_Body));
+            break;
+        case REQ_GadgetText:
+            Strncpy(requester->hr_Gadgets, (CONST_STRPTR)tag->ti_Data, sizeof(requester->hr_Gadgets));
+            break;
+        default:
+            break;
+        }
+    }
+    return (Object *)requester;
+}
+
+Object *NewObject(Class *classPtr, CONST_STRPTR classID, ...)
+{
+    struct TagItem tags[16];
+    va_list args;
+
+    va_start(args, classID);
+    HalVarTags(tags, 16, args);
+    va_end(args);
+    return NewObjectA(classPtr, classID, tags);
+}
+
+VOID DisposeObject(Object *object)
+{
+    struct HalRequester *requester = (struct HalRequester *)object;
+
+    if (requester == NULL) {
+        return;
+    }
+    if (requester->hr_Magic != HAL_REQUESTER_MAGIC) {
+        HalAbort("DisposeObject() of something that is not a requester");
+    }
+    requester->hr_Magic = 0;
+    FreeVec(requester);
+}
+
+static ULONG OpenRequester(struct HalRequester *requester)
+{
+    struct HalDialog *dialog = calloc(1, sizeof(struct HalDialog));
+
+    if (dialog == NULL) {
+        HalAbort("out of host memory");
+    }
+    memcpy(dialog->hd_Title, requester->hr_Title, sizeof(dialog->hd_Title));
+    memcpy(dialog->hd_Body, requester->hr_Body, sizeof(dialog->hd_Body));
+    memcpy(dialog->hd_Gadgets, requester->hr_Gadgets, sizeof(dialog->hd_Gadgets));
+    *lastDialog = dialog;
+    lastDialog = &dialog->hd_Next;
+    return (ULONG)requesterResult;
+}
+
+ULONG DoMethodA(Object *object, APTR message)
+{
+    struct HalRequester *requester = (struct HalRequester *)object;
+
+    if (requester == NULL || requester->hr_Magic != HAL_REQUESTER_MAGIC) {
+        HalAbort("DoMethod() on something that is not a requester");
+    }
+    if ((*(ULONG *)message & 0xFFFFFFFFUL) == RM_OPENREQ) {
+        return OpenRequester(requester);
+    }
+    return 0;
+}
+
+ULONG DoMethod(Object *object, ULONG methodID, ...)
+{
+    ULONG message = methodID & 0xFFFFFFFFUL;
+
+    return DoMethodA(object, &message);
+}
+
+/* rexxsyslib.library */
+
+struct RexxMsg *CreateRexxMsg(const struct MsgPort *port, CONST_STRPTR extension, CONST_STRPTR host)
+{
+    struct RexxMsg *message = AllocMem(sizeof(struct RexxMsg), MEMF_CLEAR | MEMF_PUBLIC);
+
+    if (message == NULL) {
+        return NULL;
+    }
+    message->rm_Node.mn_Node.ln_Type = NT_MESSAGE;
+    message->rm_Node.mn_Node.ln_Name = "REXX";
+    message->rm_Node.mn_ReplyPort = (struct MsgPort *)port;
+    message->rm_Node.mn_Length = sizeof(struct RexxMsg);
+    message->rm_FileExt = (STRPTR)extension;
+    message->rm_CommAddr = (STRPTR)host;
+    return message;
+}
+
+VOID DeleteRexxMsg(struct RexxMsg *message)
+{
+    if (message != NULL) {
+        FreeMem(message, sizeof(struct RexxMsg));
+    }
+}
+
+BOOL IsRexxMsg(const struct RexxMsg *message)
+{
+    return message->rm_Node.mn_Node.ln_Name != NULL &&
+           strcmp(message->rm_Node.mn_Node.ln_Name, "REXX") == 0;
+}
+
+STRPTR CreateArgstring(CONST_STRPTR string, ULONG length)
+{
+    ULONG size = offsetof(struct RexxArg, ra_Buff) + length + 1;
+    struct RexxArg *arg = AllocMem(size, MEMF_CLEAR | MEMF_PUBLIC);
+
+    if (arg == NULL) {
+        return NULL;
+    }
+    arg->ra_Size = size;
+    arg->ra_Length = (UWORD)length;
+    memcpy(arg->ra_Buff, string, length);
+    arg->ra_Buff[length] = '\0';
+    return (STRPTR)arg->ra_Buff;
+}
+
+static struct RexxArg *ArgOf(CONST_STRPTR argstring)
+{
+    return (struct RexxArg *)(argstring - offsetof(struct RexxArg, ra_Buff));
+}
+
+VOID DeleteArgstring(STRPTR argstring)
+{
+    struct RexxArg *arg;
+
+    if (argstring == NULL) {
+        return;
+    }
+    arg = ArgOf(argstring);
+    FreeMem(arg, arg->ra_Size);
+}
+
+ULONG LengthArgstring(CONST_STRPTR argstring)
+{
+    return ArgOf(argstring)->ra_Length;
+}
+
+VOID ClearRexxMsg(struct RexxMsg *message, ULONG count)
+{
+    ULONG i;
+
+    for (i = 0; i < count && i < 16; i++) {
+        DeleteArgstring(message->rm_Args[i]);
+        message->rm_Args[i] = NULL;
+    }
+}
+
+BOOL FillRexxMsg(struct RexxMsg *message, ULONG count, ULONG mask)
+{
+    UBYTE number[16];
+    ULONG i;
+
+    for (i = 0; i < count && i < 16; i++) {
+        if (mask & (1UL << i)) {
+            snprintf((char *)number, sizeof(number), "%ld", (LONG)message->rm_Args[i]);
+            message->rm_Args[i] = CreateArgstring(number, strlen((char *)number));
+        } else if (message->rm_Args[i] != NULL) {
+            message->rm_Args[i] = CreateArgstring(message->rm_Args[i], strlen((char *)message->rm_Args[i]));
+        }
+        if (message->rm_Args[i] == NULL) {
+            ClearRexxMsg(message, i);
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/* The world */
+
+VOID HalInitWorkbench(VOID)
+{
+    /* Opening a drawer window of a few icons, and closing it, on a 68000 */
+    HalSetDrawerLife(0, 60000, 20000);
+}
+
+VOID HalInit(VOID)
+{
+    HalInitExec();
+    HalInitDos();
+    HalInitIcon();
+    HalInitWorkbench();
+    HalResetCounters();
+}
@@ -0,0 +1,2 @@
+/* classes/requester.h - see ndk.h */
+#include <ndk.h>
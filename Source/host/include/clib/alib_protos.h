@@ -0,0 +1,2 @@
+/* clib/alib_protos.h - see ndk.h */
+#include <ndk.h>
@@ -0,0 +1,2 @@
+/* devices/input.h - see ndk.h */
+#include <ndk.h>
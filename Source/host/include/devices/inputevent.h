@@ -0,0 +1,2 @@
+/* devices/inputevent.h - see ndk.h */
+#include <ndk.h>
@@ -0,0 +1,2 @@
+/* devices/timer.h - see ndk.h */
+#include <ndk.h>
@@ -0,0 +1,2 @@
+/* dos/datetime.h - see ndk.h */
+#include <ndk.h>
@@ -0,0 +1,2 @@
+/* dos/dos.h - see ndk.h */
+#include <ndk.h>
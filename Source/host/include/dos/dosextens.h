@@ -0,0 +1,2 @@
+/* dos/dosextens.h - see ndk.h */
+#include <ndk.h>
@@ -0,0 +1,2 @@
+/* dos/dostags.h - see ndk.h */
+#include <ndk.h>
@@ -0,0 +1,2 @@
+/* dos/exall.h - see ndk.h */
+#include <ndk.h>
@@ -0,0 +1,2 @@
+/* dos/rdargs.h - see ndk.h */
+#include <ndk.h>
@@ -0,0 +1,2 @@
+/* dos/var.h - see ndk.h */
+#include <ndk.h>
@@ -0,0 +1,2 @@
+/* exec/execbase.h - see ndk.h */
+#include <ndk.h>
@@ -0,0 +1,2 @@
+/* exec/io.h - see ndk.h */
+#include <ndk.h>
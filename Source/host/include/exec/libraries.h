@@ -0,0 +1,2 @@
+/* exec/libraries.h - see ndk.h */
+#include <ndk.h>
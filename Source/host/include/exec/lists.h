@@ -0,0 +1,2 @@
+/* exec/lists.h - see ndk.h */
+#include <ndk.h>
@@ -0,0 +1,2 @@
+/* exec/memory.h - see ndk.h */
+#include <ndk.h>
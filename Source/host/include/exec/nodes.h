@@ -0,0 +1,2 @@
+/* exec/nodes.h - see ndk.h */
+#include <ndk.h>
@@ -0,0 +1,2 @@
+/* exec/ports.h - see ndk.h */
+#include <ndk.h>
@@ -0,0 +1,2 @@
+/* exec/semaphores.h - see ndk.h */
+#include <ndk.h>
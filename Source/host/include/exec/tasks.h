@@ -0,0 +1,2 @@
+/* exec/tasks.h - see ndk.h */
+#include <ndk.h>
@@ -0,0 +1,70 @@
+/*
+ * exec/types.h - host stand-in for the NDK header
+ *
+ * Copyright (c) 2025 amigazen project
+ * Licensed under BSD 2-Clause License
+ *
+ * The same definitions as the NDK: LONG and ULONG are long, so on an LP64
+ * host they are 64 bits wide and every pointer cast in the sources stays
+ * lossless. Code that needs exactly 32 bits says so itself (see pxcore.h).
+ */
+
+#ifndef EXEC_TYPES_H
+#define EXEC_TYPES_H
+
+#define GLOBAL  extern
+#define IMPORT  extern
+#define STATIC  static
+#define REGISTER register
+
+#define CONST   const
+
+typedef void           *APTR;
+typedef const void     *CONST_APTR;
+typedef long            LONG;
+typedef unsigned long   ULONG;
+typedef unsigned long   LONGBITS;
+typedef short           WORD;
+typedef unsigned short  UWORD;
+typedef unsigned short  WORDBITS;
+typedef signed char     BYTE;
+typedef unsigned char   UBYTE;
+typedef unsigned char   BYTEBITS;
+typedef unsigned short  RPTR;
+typedef unsigned char  *STRPTR;
+typedef const unsigned char *CONST_STRPTR;
+typedef short           SHORT;
+typedef unsigned short  USHORT;
+typedef short           COUNT;
+typedef unsigned short  UCOUNT;
+typedef ULONG           CPTR;
+typedef float           FLOAT;
+typedef double          DOUBLE;
+typedef short           BOOL;
+typedef unsigned char   TEXT;
+typedef ULONG           IPTR;
+
+#define VOID    void
+
+#define TRUE    1
+#define FALSE   0
+
+/* BPTR x = NULL is common in the sources, so NULL has to be an integer */
+#ifdef NULL
+#undef NULL
+#endif
+#define NULL    0L
+
+#define BYTEMASK 0xFF
+
+/* SAS/C keywords */
+#define __saveds
+#define __asm
+#define __stdargs
+#define __regargs
+#define __far
+#define __near
+#define __chip
+#define __aligned
+
+#endif /* EXEC_TYPES_H */
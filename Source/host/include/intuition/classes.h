@@ -0,0 +1,2 @@
+/* intuition/classes.h - see ndk.h */
+#include <ndk.h>
@@ -0,0 +1,2 @@
+/* intuition/classusr.h - see ndk.h */
+#include <ndk.h>
@@ -0,0 +1,2 @@
+/* intuition/intuition.h - see ndk.h */
+#include <ndk.h>
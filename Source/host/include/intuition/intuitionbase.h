@@ -0,0 +1,2 @@
+/* intuition/intuitionbase.h - see ndk.h */
+#include <ndk.h>
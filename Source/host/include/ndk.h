@@ -0,0 +1,1083 @@
+/*
+ * ndk.h - the part of the NDK the host build needs, in one header
+ *
+ * Copyright (c) 2025 amigazen project
+ * Licensed under BSD 2-Clause License
+ *
+ * Every NDK header the sources include (exec/execbase.h, dos/dos.h,
+ * proto/icon.h and so on) is a one-line stand-in that includes this file.
+ * Structures keep their NDK field names and order, with the fields nothing
+ * here uses left out. Library functions are plain prototypes, implemented
+ * by the hal_*.c files. BCPL pointers are ordinary pointers on the host,
+ * so BADDR() and MKBADDR() do nothing.
+ */
+
+#ifndef HOST_NDK_H
+#define HOST_NDK_H
+
+#include <stdarg.h>
+
+#include <exec/types.h>
+
+#define BADDR(x)        ((APTR)(x))
+#define MKBADDR(x)      ((BPTR)(x))
+
+typedef long            BPTR;
+typedef long            BSTR;
+
+/* exec/nodes.h */
+struct Node {
+    struct Node *ln_Succ;
+    struct Node *ln_Pred;
+    UBYTE ln_Type;
+    BYTE ln_Pri;
+    char *ln_Name;
+};
+
+struct MinNode {
+    struct MinNode *mln_Succ;
+    struct MinNode *mln_Pred;
+};
+
+#define NT_UNKNOWN      0
+#define NT_TASK         1
+#define NT_INTERRUPT    2
+#define NT_DEVICE       3
+#define NT_MSGPORT      4
+#define NT_MESSAGE      5
+#define NT_FREEMSG      6
+#define NT_REPLYMSG     7
+#define NT_RESOURCE     8
+#define NT_LIBRARY      9
+#define NT_PROCESS      13
+#define NT_SEMAPHORE    15
+#define NT_SIGNALSEM    15
+#define NT_USER         254
+
+/* exec/lists.h */
+struct List {
+    struct Node *lh_Head;
+    struct Node *lh_Tail;
+    struct Node *lh_TailPred;
+    UBYTE lh_Type;
+    UBYTE l_pad;
+};
+
+struct MinList {
+    struct MinNode *mlh_Head;
+    struct MinNode *mlh_Tail;
+    struct MinNode *mlh_TailPred;
+};
+
+#define IsListEmpty(x)  (((x)->lh_TailPred) == (struct Node *)(x))
+
+/* exec/libraries.h */
+struct Library {
+    struct Node lib_Node;
+    UBYTE lib_Flags;
+    UBYTE lib_pad;
+    UWORD lib_NegSize;
+    UWORD lib_PosSize;
+    UWORD lib_Version;
+    UWORD lib_Revision;
+    APTR lib_IdString;
+    ULONG lib_Sum;
+    UWORD lib_OpenCnt;
+};
+
+/* exec/tasks.h */
+struct Task {
+    struct Node tc_Node;
+    UBYTE tc_Flags;
+    UBYTE tc_State;
+    BYTE tc_IDNestCnt;
+    BYTE tc_TDNestCnt;
+    ULONG tc_SigAlloc;
+    ULONG tc_SigWait;
+    ULONG tc_SigRecvd;
+    ULONG tc_SigExcept;
+    APTR tc_SPReg;
+    APTR tc_SPLower;
+    APTR tc_SPUpper;
+    struct List tc_MemEntry;
+    APTR tc_UserData;
+};
+
+#define TS_RUN          2
+#define TS_READY        3
+#define TS_WAIT         4
+#define TS_REMOVED      6
+
+#define SIGB_ABORT      0
+#define SIGB_CHILD      1
+#define SIGB_SINGLE     4
+#define SIGB_DOS        8
+
+#define SIGF_ABORT      (1L<<0)
+#define SIGF_CHILD      (1L<<1)
+#define SIGF_SINGLE     (1L<<4)
+#define SIGF_DOS        (1L<<8)
+
+/* exec/ports.h */
+struct MsgPort {
+    struct Node mp_Node;
+    UBYTE mp_Flags;
+    UBYTE mp_SigBit;
+    APTR mp_SigTask;
+    struct List mp_MsgList;
+};
+
+#define PF_ACTION       3
+#define PA_SIGNAL       0
+#define PA_SOFTINT      1
+#define PA_IGNORE       2
+
+struct Message {
+    struct Node mn_Node;
+    struct MsgPort *mn_ReplyPort;
+    UWORD mn_Length;
+};
+
+/* exec/semaphores.h */
+struct SemaphoreRequest {
+    struct MinNode sr_Link;
+    struct Task *sr_Waiter;
+};
+
+struct SignalSemaphore {
+    struct Node ss_Link;
+    WORD ss_NestCount;
+    struct MinList ss_WaitQueue;
+    struct SemaphoreRequest ss_MultipleLink;
+    struct Task *ss_Owner;
+    WORD ss_QueueCount;
+};
+
+/* exec/memory.h */
+#define MEMF_ANY        0L
+#define MEMF_PUBLIC     (1L<<0)
+#define MEMF_CHIP       (1L<<1)
+#define MEMF_FAST       (1L<<2)
+#define MEMF_CLEAR      (1L<<16)
+#define MEMF_LARGEST    (1L<<17)
+#define MEMF_TOTAL      (1L<<19)
+
+/* exec/execbase.h */
+struct ExecBase {
+    struct Library LibNode;
+    struct Task *ThisTask;
+    struct List MemList;
+    struct List ResourceList;
+    struct List DeviceList;
+    struct List IntrList;
+    struct List LibList;
+    struct List PortList;
+    struct List TaskReady;
+    struct List TaskWait;
+    struct List SemaphoreList;
+};
+
+/* exec/io.h, exec/devices.h, exec/errors.h */
+struct Device {
+    struct Library dd_Library;
+};
+
+struct Unit {
+    struct MsgPort unit_MsgPort;
+    UBYTE unit_flags;
+    UBYTE unit_pad;
+    UWORD unit_OpenCnt;
+};
+
+struct IORequest {
+    struct Message io_Message;
+    struct Device *io_Device;
+    struct Unit *io_Unit;
+    UWORD io_Command;
+    UBYTE io_Flags;
+    BYTE io_Error;
+};
+
+struct IOStdReq {
+    struct Message io_Message;
+    struct Device *io_Device;
+    struct Unit *io_Unit;
+    UWORD io_Command;
+    UBYTE io_Flags;
+    BYTE io_Error;
+    ULONG io_Actual;
+    ULONG io_Length;
+    APTR io_Data;
+    ULONG io_Offset;
+};
+
+#define IOF_QUICK       (1<<0)
+#define CMD_INVALID     0
+#define CMD_RESET       1
+#define CMD_READ        2
+#define CMD_WRITE       3
+#define CMD_NONSTD      9
+
+#define IOERR_OPENFAIL  (-1)
+#define IOERR_ABORTED   (-2)
+#define IOERR_NOCMD     (-3)
+
+/* exec/resident.h, dos/dosextens.h */
+struct Segment {
+    BPTR seg_Next;
+    LONG seg_UC;
+    BPTR seg_Seg;
+    UBYTE seg_Name[4];
+};
+
+#define CMD_SYSTEM      -1
+#define CMD_INTERNAL    -2
+#define CMD_DISABLED    -999
+
+/* utility/tagitem.h */
+typedef ULONG Tag;
+
+struct TagItem {
+    Tag ti_Tag;
+    ULONG ti_Data;
+};
+
+#define TAG_DONE        0UL
+#define TAG_END         0UL
+#define TAG_IGNORE      1UL
+#define TAG_MORE        2UL
+#define TAG_SKIP        3UL
+#define TAG_USER        0x80000000UL
+
+/* devices/timer.h - struct timeval is renamed so it cannot meet the C library's */
+#define timeval TimeVal
+
+struct TimeVal {
+    ULONG tv_secs;
+    ULONG tv_micro;
+};
+
+struct EClockVal {
+    ULONG ev_hi;
+    ULONG ev_lo;
+};
+
+struct timerequest {
+    struct IORequest tr_node;
+    struct TimeVal tr_time;
+};
+
+#define UNIT_MICROHZ    0
+#define UNIT_VBLANK     1
+#define UNIT_ECLOCK     2
+#define UNIT_WAITUNTIL  3
+#define UNIT_WAITECLOCK 4
+
+#define TR_ADDREQUEST   (CMD_NONSTD)
+#define TR_GETSYSTIME   (CMD_NONSTD+1)
+#define TR_SETSYSTIME   (CMD_NONSTD+2)
+
+#define TIMERNAME       "timer.device"
+
+/* devices/input.h, devices/inputevent.h */
+#define IND_ADDHANDLER  (CMD_NONSTD+0)
+#define IND_REMHANDLER  (CMD_NONSTD+1)
+
+#define IEQUALIFIER_LSHIFT      0x0001
+#define IEQUALIFIER_RSHIFT      0x0002
+#define IEQUALIFIER_CAPSLOCK    0x0004
+#define IEQUALIFIER_CONTROL     0x0008
+#define IEQUALIFIER_LALT        0x0010
+#define IEQUALIFIER_RALT        0x0020
+#define IEQUALIFIER_LCOMMAND    0x0040
+#define IEQUALIFIER_RCOMMAND    0x0080
+
+/* dos/dos.h */
+#define DOSNAME         "dos.library"
+
+#define MODE_OLDFILE    1005
+#define MODE_NEWFILE    1006
+#define MODE_READWRITE  1004
+
+#define OFFSET_BEGINNING -1
+#define OFFSET_CURRENT   0
+#define OFFSET_END       1
+
+#define SHARED_LOCK     -2
+#define ACCESS_READ     -2
+#define EXCLUSIVE_LOCK  -1
+#define ACCESS_WRITE    -1
+
+#define LOCK_SAME        0
+#define LOCK_SAME_VOLUME 1
+#define LOCK_DIFFERENT  -1
+
+struct DateStamp {
+    LONG ds_Days;
+    LONG ds_Minute;
+    LONG ds_Tick;
+};
+
+#define TICKS_PER_SECOND 50
+
+struct FileInfoBlock {
+    LONG fib_DiskKey;
+    LONG fib_DirEntryType;
+    char fib_FileName[108];
+    LONG fib_Protection;
+    LONG fib_EntryType;
+    LONG fib_Size;
+    LONG fib_NumBlocks;
+    struct DateStamp fib_Date;
+    char fib_Comment[80];
+    UWORD fib_OwnerUID;
+    UWORD fib_OwnerGID;
+    char fib_Reserved[32];
+};
+
+#define FIBB_OTR_READ    15
+#define FIBB_SCRIPT      6
+#define FIBB_PURE        5
+#define FIBB_ARCHIVE     4
+#define FIBB_READ        3
+#define FIBB_WRITE       2
+#define FIBB_EXECUTE     1
+#define FIBB_DELETE      0
+
+#define FIBF_SCRIPT      (1<<FIBB_SCRIPT)
+#define FIBF_PURE        (1<<FIBB_PURE)
+#define FIBF_ARCHIVE     (1<<FIBB_ARCHIVE)
+#define FIBF_READ        (1<<FIBB_READ)
+#define FIBF_WRITE       (1<<FIBB_WRITE)
+#define FIBF_EXECUTE     (1<<FIBB_EXECUTE)
+#define FIBF_DELETE      (1<<FIBB_DELETE)
+
+struct InfoData {
+    LONG id_NumSoftErrors;
+    LONG id_UnitNumber;
+    LONG id_DiskState;
+    LONG id_NumBlocks;
+    LONG id_NumBlocksUsed;
+    LONG id_BytesPerBlock;
+    LONG id_DiskType;
+    BPTR id_VolumeNode;
+    LONG id_InUse;
+};
+
+#define DOSTRUE          (-1L)
+#define DOSFALSE         (0L)
+
+#define RETURN_OK        0
+#define RETURN_WARN      5
+#define RETURN_ERROR     10
+#define RETURN_FAIL      20
+
+#define SIGBREAKB_CTRL_C 12
+#define SIGBREAKB_CTRL_D 13
+#define SIGBREAKB_CTRL_E 14
+#define SIGBREAKB_CTRL_F 15
+#define SIGBREAKF_CTRL_C (1L<<SIGBREAKB_CTRL_C)
+#define SIGBREAKF_CTRL_D (1L<<SIGBREAKB_CTRL_D)
+#define SIGBREAKF_CTRL_E (1L<<SIGBREAKB_CTRL_E)
+#define SIGBREAKF_CTRL_F (1L<<SIGBREAKB_CTRL_F)
+
+#define ERROR_NO_FREE_STORE         103
+#define ERROR_TASK_TABLE_FULL       105
+#define ERROR_BAD_TEMPLATE          114
+#define ERROR_BAD_NUMBER            115
+#define ERROR_REQUIRED_ARG_MISSING  116
+#define ERROR_KEY_NEEDS_ARG         117
+#define ERROR_TOO_MANY_ARGS         118
+#define ERROR_UNMATCHED_QUOTES      119
+#define ERROR_LINE_TOO_LONG         120
+#define ERROR_FILE_NOT_OBJECT       121
+#define ERROR_OBJECT_IN_USE         202
+#define ERROR_OBJECT_EXISTS         203
+#define ERROR_DIR_NOT_FOUND         204
+#define ERROR_OBJECT_NOT_FOUND      205
+#define ERROR_BAD_STREAM_NAME       206
+#define ERROR_OBJECT_TOO_LARGE      207
+#define ERROR_ACTION_NOT_KNOWN      209
+#define ERROR_INVALID_COMPONENT_NAME 210
+#define ERROR_INVALID_LOCK          211
+#define ERROR_OBJECT_WRONG_TYPE     212
+#define ERROR_DISK_NOT_VALIDATED    213
+#define ERROR_DISK_WRITE_PROTECTED  214
+#define ERROR_WRITE_PROTECTED       214
+#define ERROR_RENAME_ACROSS_DEVICES 215
+#define ERROR_DIRECTORY_NOT_EMPTY   216
+#define ERROR_DEVICE_NOT_MOUNTED    218
+#define ERROR_SEEK_ERROR            219
+#define ERROR_DISK_FULL             221
+#define ERROR_DELETE_PROTECTED      222
+#define ERROR_READ_PROTECTED        224
+#define ERROR_NOT_A_DOS_DISK        225
+#define ERROR_NO_DISK               226
+#define ERROR_NO_MORE_ENTRIES       232
+#define ERROR_IS_SOFT_LINK          233
+#define ERROR_NOT_IMPLEMENTED       236
+#define ERROR_BUFFER_OVERFLOW       303
+#define ERROR_BREAK                 304
+
+#define DOS_FILEHANDLE      0
+#define DOS_EXALLCONTROL    1
+#define DOS_FIB             2
+#define DOS_STDPKT          3
+#define DOS_CLI             4
+#define DOS_RDARGS          5
+
+/* dos/dosextens.h */
+struct Process {
+    struct Task pr_Task;
+    struct MsgPort pr_MsgPort;
+    WORD pr_Pad;
+    BPTR pr_SegList;
+    LONG pr_StackSize;
+    APTR pr_GlobVec;
+    LONG pr_TaskNum;
+    BPTR pr_StackBase;
+    LONG pr_Result2;
+    BPTR pr_CurrentDir;
+    BPTR pr_CIS;
+    BPTR pr_COS;
+    APTR pr_ConsoleTask;
+    APTR pr_FileSystemTask;
+    BPTR pr_CLI;
+    APTR pr_ReturnAddr;
+    APTR pr_PktWait;
+    APTR pr_WindowPtr;
+    BPTR pr_HomeDir;
+    LONG pr_Flags;
+    VOID (*pr_ExitCode)(VOID);
+    LONG pr_ExitData;
+    UBYTE *pr_Arguments;
+    struct MinList pr_LocalVars;
+    ULONG pr_ShellPrivate;
+    BPTR pr_CES;
+};
+
+struct CommandLineInterface {
+    LONG cli_Result2;
+    BSTR cli_SetName;
+    BPTR cli_CommandDir;
+    LONG cli_ReturnCode;
+    BSTR cli_CommandName;
+    LONG cli_FailLevel;
+    BSTR cli_Prompt;
+    BPTR cli_StandardInput;
+    BPTR cli_CurrentInput;
+    BSTR cli_CommandFile;
+    LONG cli_Interactive;
+    LONG cli_Background;
+    BPTR cli_CurrentOutput;
+    LONG cli_DefaultStack;
+    BPTR cli_StandardOutput;
+    BPTR cli_Module;
+};
+
+struct FileLock {
+    BPTR fl_Link;
+    LONG fl_Key;
+    LONG fl_Access;
+    struct MsgPort *fl_Task;
+    BPTR fl_Volume;
+};
+
+struct DosList {
+    BPTR dol_Next;
+    LONG dol_Type;
+    struct MsgPort *dol_Task;
+    BPTR dol_Lock;
+    struct DateStamp dol_VolumeDate;
+    BPTR dol_LockList;
+    LONG dol_DiskType;
+    LONG dol_unused;
+    BSTR dol_Name;
+};
+
+#define DLT_DEVICE      0
+#define DLT_DIRECTORY   1
+#define DLT_VOLUME      2
+#define DLT_LATE        3
+#define DLT_NONBINDING  4
+
+#define LDF_DEVICES     (1L<<2)
+#define LDF_VOLUMES     (1L<<3)
+#define LDF_ASSIGNS     (1L<<4)
+#define LDF_READ        (1L<<0)
+#define LDF_WRITE       (1L<<1)
+
+struct DosLibrary {
+    struct Library dl_lib;
+};
+
+#define ST_ROOT         1
+#define ST_USERDIR      2
+#define ST_SOFTLINK     3
+#define ST_LINKDIR      4
+#define ST_FILE         -3
+#define ST_LINKFILE     -4
+
+/* dos/exall.h */
+#define ED_NAME         1
+#define ED_TYPE         2
+#define ED_SIZE         3
+#define ED_PROTECTION   4
+#define ED_DATE         5
+#define ED_COMMENT      6
+#define ED_OWNER        7
+
+struct ExAllData {
+    struct ExAllData *ed_Next;
+    UBYTE *ed_Name;
+    LONG ed_Type;
+    ULONG ed_Size;
+    ULONG ed_Prot;
+    ULONG ed_Days;
+    ULONG ed_Mins;
+    ULONG ed_Ticks;
+    UBYTE *ed_Comment;
+    UWORD ed_OwnerUID;
+    UWORD ed_OwnerGID;
+};
+
+struct ExAllControl {
+    ULONG eac_Entries;
+    ULONG eac_LastKey;
+    UBYTE *eac_MatchString;
+    APTR eac_MatchFunc;
+};
+
+/* dos/rdargs.h */
+struct CSource {
+    UBYTE *CS_Buffer;
+    LONG CS_Length;
+    LONG CS_CurChr;
+};
+
+struct RDArgs {
+    struct CSource RDA_Source;
+    LONG RDA_DAList;
+    UBYTE *RDA_Buffer;
+    LONG RDA_BufSiz;
+    UBYTE *RDA_ExtHelp;
+    LONG RDA_Flags;
+};
+
+#define ITEM_EQUAL      -2
+#define ITEM_ERROR      -1
+#define ITEM_NOTHING    0
+#define ITEM_UNQUOTED   1
+#define ITEM_QUOTED     2
+
+/* dos/var.h */
+#define LV_VAR              0
+#define LV_ALIAS            1
+#define GVF_GLOBAL_ONLY     (1L<<8)
+#define GVF_LOCAL_ONLY      (1L<<9)
+#define GVF_BINARY_VAR      (1L<<10)
+#define GVF_DONT_NULL_TERM  (1L<<11)
+#define GVF_SAVE_VAR        (1L<<12)
+
+/* dos/dostags.h */
+#define SYS_Dummy       (TAG_USER + 32)
+#define SYS_Input       (SYS_Dummy + 1)
+#define SYS_Output      (SYS_Dummy + 2)
+#define SYS_Asynch      (SYS_Dummy + 3)
+#define SYS_UserShell   (SYS_Dummy + 4)
+#define SYS_CustomShell (SYS_Dummy + 5)
+
+#define NP_Dummy        (TAG_USER + 1000)
+#define NP_Seglist      (NP_Dummy + 1)
+#define NP_FreeSeglist  (NP_Dummy + 2)
+#define NP_Entry        (NP_Dummy + 3)
+#define NP_Input        (NP_Dummy + 4)
+#define NP_Output       (NP_Dummy + 5)
+#define NP_CloseInput   (NP_Dummy + 6)
+#define NP_CloseOutput  (NP_Dummy + 7)
+#define NP_Error        (NP_Dummy + 8)
+#define NP_CloseError   (NP_Dummy + 9)
+#define NP_CurrentDir   (NP_Dummy + 10)
+#define NP_StackSize    (NP_Dummy + 11)
+#define NP_Name         (NP_Dummy + 12)
+#define NP_Priority     (NP_Dummy + 13)
+#define NP_ConsoleTask  (NP_Dummy + 14)
+#define NP_WindowPtr    (NP_Dummy + 15)
+#define NP_HomeDir      (NP_Dummy + 16)
+#define NP_CopyVars     (NP_Dummy + 17)
+#define NP_Cli          (NP_Dummy + 18)
+#define NP_Path         (NP_Dummy + 19)
+#define NP_CommandName  (NP_Dummy + 20)
+#define NP_Arguments    (NP_Dummy + 21)
+
+/* intuition */
+struct Image {
+    WORD LeftEdge;
+    WORD TopEdge;
+    WORD Width;
+    WORD Height;
+    WORD Depth;
+    UWORD *ImageData;
+    UBYTE PlanePick;
+    UBYTE PlaneOnOff;
+    struct Image *NextImage;
+};
+
+struct Gadget {
+    struct Gadget *NextGadget;
+    WORD LeftEdge;
+    WORD TopEdge;
+    WORD Width;
+    WORD Height;
+    UWORD Flags;
+    UWORD Activation;
+    UWORD GadgetType;
+    APTR GadgetRender;
+    APTR SelectRender;
+    APTR GadgetText;
+    LONG MutualExclude;
+    APTR SpecialInfo;
+    UWORD GadgetID;
+    APTR UserData;
+};
+
+struct Window {
+    struct Window *NextWindow;
+};
+
+struct Screen {
+    struct Screen *NextScreen;
+};
+
+struct IntuitionBase {
+    struct Library LibNode;
+};
+
+typedef struct IClass {
+    struct Node cl_Dispatcher;
+    ULONG cl_Reserved;
+} Class;
+
+typedef ULONG Object;
+
+struct ClassLibrary {
+    struct Library cl_Lib;
+    UWORD cl_Pad;
+    Class *cl_Class;
+};
+
+/* classes/requester.h */
+#define REQ_Dummy       (TAG_USER + 0x4000)
+#define REQ_Type        (REQ_Dummy + 1)
+#define REQ_TitleText   (REQ_Dummy + 2)
+#define REQ_BodyText    (REQ_Dummy + 3)
+#define REQ_GadgetText  (REQ_Dummy + 4)
+#define REQ_ReturnCode  (REQ_Dummy + 5)
+#define REQ_TabSize     (REQ_Dummy + 6)
+#define REQ_Image       (REQ_Dummy + 11)
+
+#define REQTYPE_INFO    0
+#define REQTYPE_INTEGER 1
+#define REQTYPE_STRING  2
+
+#define REQIMAGE_DEFAULT  0
+#define REQIMAGE_INFO     1
+#define REQIMAGE_WARNING  2
+#define REQIMAGE_ERROR    3
+#define REQIMAGE_QUESTION 4
+
+#define RM_OPENREQ      (0x650001)
+
+struct orRequest {
+    ULONG MethodID;
+    struct TagItem *or_Attrs;
+    struct Window *or_Window;
+    struct Screen *or_Screen;
+};
+
+/* rexx/storage.h, rexx/rxslib.h */
+struct RexxArg {
+    LONG ra_Size;
+    UWORD ra_Length;
+    UBYTE ra_Flags;
+    UBYTE ra_Hash;
+    BYTE ra_Buff[8];
+};
+
+struct RexxMsg {
+    struct Message rm_Node;
+    APTR rm_TaskBlock;
+    APTR rm_LibBase;
+    LONG rm_Action;
+    LONG rm_Result1;
+    LONG rm_Result2;
+    STRPTR rm_Args[16];
+    struct MsgPort *rm_PassPort;
+    STRPTR rm_CommAddr;
+    STRPTR rm_FileExt;
+    LONG rm_Stdin;
+    LONG rm_Stdout;
+    LONG rm_avail;
+};
+
+#define RXCOMM          0x01000000
+#define RXFUNC          0x02000000
+#define RXCODEMASK      0xFF000000
+#define RXARGMASK       0x0000000F
+#define RXFB_NOIO       16
+#define RXFB_RESULT     17
+#define RXFB_STRING     18
+#define RXFF_NOIO       (1L<<RXFB_NOIO)
+#define RXFF_RESULT     (1L<<RXFB_RESULT)
+#define RXFF_STRING     (1L<<RXFB_STRING)
+
+#define ARG0(rmp)       ((rmp)->rm_Args[0])
+
+#define RC_OK           0
+#define RC_WARN         5
+#define RC_ERROR        10
+#define RC_FATAL        20
+
+struct RxsLib {
+    struct Library rl_Node;
+};
+
+#define RXSNAME         "rexxsyslib.library"
+
+/* workbench/workbench.h, workbench/startup.h, workbench/icon.h */
+#define WBDISK          1
+#define WBDRAWER        2
+#define WBTOOL          3
+#define WBPROJECT       4
+#define WBGARBAGE       5
+#define WBDEVICE        6
+#define WBKICK          7
+#define WBAPPICON       8
+
+#define WB_DISKMAGIC    0xe310
+#define WB_DISKVERSION  1
+
+#define NO_ICON_POSITION (0x80000000UL)
+
+struct DrawerData {
+    struct Window *dd_Window;
+    LONG dd_CurrentX;
+    LONG dd_CurrentY;
+};
+
+struct DiskObject {
+    UWORD do_Magic;
+    UWORD do_Version;
+    struct Gadget do_Gadget;
+    UBYTE do_Type;
+    STRPTR do_DefaultTool;
+    STRPTR *do_ToolTypes;
+    LONG do_CurrentX;
+    LONG do_CurrentY;
+    struct DrawerData *do_DrawerData;
+    STRPTR do_ToolWindow;
+    LONG do_StackSize;
+};
+
+struct WBArg {
+    BPTR wa_Lock;
+    BYTE *wa_Name;
+};
+
+struct WBStartup {
+    struct Message sm_Message;
+    struct MsgPort *sm_Process;
+    BPTR sm_Segment;
+    LONG sm_NumArgs;
+    char *sm_ToolWindow;
+    struct WBArg *sm_ArgList;
+};
+
+struct AppMessage {
+    struct Message am_Message;
+    UWORD am_Type;
+    ULONG am_UserData;
+    ULONG am_ID;
+    LONG am_NumArgs;
+    struct WBArg *am_ArgList;
+    UWORD am_Version;
+    UWORD am_Class;
+    WORD am_MouseX;
+    WORD am_MouseY;
+    ULONG am_Seconds;
+    ULONG am_Micros;
+    ULONG am_Reserved[8];
+};
+
+#define AM_VERSION          1
+#define AMTYPE_APPWINDOW    7
+#define AMTYPE_APPICON      8
+#define AMTYPE_APPMENUITEM  9
+
+#define ICONA_Dummy                     (TAG_USER + 0x9000)
+#define ICONA_ErrorCode                 (ICONA_Dummy + 1)
+#define ICONGETA_GetDefaultType         (ICONA_Dummy + 45)
+#define ICONGETA_GetDefaultName         (ICONA_Dummy + 46)
+#define ICONGETA_FailIfUnavailable      (ICONA_Dummy + 47)
+#define ICONGETA_GetPaletteMappedIcon   (ICONA_Dummy + 48)
+#define ICONGETA_IsDefaultIcon          (ICONA_Dummy + 49)
+#define ICONGETA_RemapIcon              (ICONA_Dummy + 50)
+#define ICONGETA_GenerateImageMasks     (ICONA_Dummy + 51)
+#define ICONGETA_Label                  (ICONA_Dummy + 52)
+#define ICONGETA_Screen                 (ICONA_Dummy + 69)
+#define ICONGETA_IdentifyBuffer         (ICONA_Dummy + 122)
+#define ICONGETA_IdentifyOnly           (ICONA_Dummy + 123)
+#define ICONPUTA_NotifyWorkbench        (ICONA_Dummy + 53)
+#define ICONPUTA_PutDefaultType         (ICONA_Dummy + 54)
+#define ICONPUTA_PutDefaultName         (ICONA_Dummy + 55)
+#define ICONPUTA_DropPlanarIconImage    (ICONA_Dummy + 56)
+#define ICONPUTA_DropChunkyIconImage    (ICONA_Dummy + 57)
+#define ICONPUTA_DropNewIconsToolTypes  (ICONA_Dummy + 58)
+#define ICONPUTA_OptimizeImageSpace     (ICONA_Dummy + 59)
+#define ICONPUTA_OnlyUpdatePosition     (ICONA_Dummy + 72)
+#define ICONDUPA_DuplicateDrawerData    (ICONA_Dummy + 60)
+#define ICONDUPA_DuplicateImages        (ICONA_Dummy + 61)
+#define ICONDUPA_DuplicateImageData     (ICONA_Dummy + 62)
+#define ICONDUPA_ActivateImageData      (ICONA_Dummy + 63)
+#define ICONDUPA_DuplicateToolTypes     (ICONA_Dummy + 64)
+
+#define WBA_Dummy                       (TAG_USER + 0xA000)
+#define WBOPENA_ArgLock                 (WBA_Dummy + 5)
+#define WBOPENA_ArgName                 (WBA_Dummy + 6)
+#define WBCTRLA_IsOpen                  (WBA_Dummy + 7)
+#define WBCTRLA_GetOpenDrawerList       (WBA_Dummy + 22)
+#define WBCTRLA_FreeOpenDrawerList      (WBA_Dummy + 23)
+#define WBCTRLA_GetHiddenDeviceList     (WBA_Dummy + 24)
+#define WBOPENA_Show                    (WBA_Dummy + 75)
+#define WBOPENA_ViewBy                  (WBA_Dummy + 76)
+
+/* clib/alib_protos.h */
+#ifndef MAX
+#define MAX(a, b)       ((a) > (b) ? (a) : (b))
+#endif
+#ifndef MIN
+#define MIN(a, b)       ((a) < (b) ? (a) : (b))
+#endif
+
+/* exec.library */
+APTR AllocMem(ULONG size, ULONG flags);
+VOID FreeMem(APTR memory, ULONG size);
+APTR AllocVec(ULONG size, ULONG flags);
+VOID FreeVec(APTR memory);
+ULONG AvailMem(ULONG flags);
+VOID CopyMem(CONST_APTR source, APTR dest, ULONG size);
+VOID CopyMemQuick(CONST_APTR source, APTR dest, ULONG size);
+APTR CreatePool(ULONG flags, ULONG puddle, ULONG threshold);
+VOID DeletePool(APTR pool);
+APTR AllocPooled(APTR pool, ULONG size);
+VOID FreePooled(APTR pool, APTR memory, ULONG size);
+
+VOID NewList(struct List *list);
+VOID AddHead(struct List *list, struct Node *node);
+VOID AddTail(struct List *list, struct Node *node);
+VOID Insert(struct List *list, struct Node *node, struct Node *pred);
+VOID Enqueue(struct List *list, struct Node *node);
+VOID Remove(struct Node *node);
+struct Node *RemHead(struct List *list);
+struct Node *RemTail(struct List *list);
+struct Node *FindName(struct List *list, CONST_STRPTR name);
+
+VOID Forbid(VOID);
+VOID Permit(VOID);
+struct Task *FindTask(CONST_STRPTR name);
+BYTE SetTaskPri(struct Task *task, LONG priority);
+BYTE AllocSignal(LONG signal);
+VOID FreeSignal(LONG signal);
+ULONG Wait(ULONG signals);
+ULONG SetSignal(ULONG newSignals, ULONG mask);
+VOID Signal(struct Task *task, ULONG signals);
+
+struct MsgPort *CreateMsgPort(VOID);
+VOID DeleteMsgPort(struct MsgPort *port);
+VOID AddPort(struct MsgPort *port);
+VOID RemPort(struct MsgPort *port);
+struct MsgPort *FindPort(CONST_STRPTR name);
+VOID PutMsg(struct MsgPort *port, struct Message *message);
+struct Message *GetMsg(struct MsgPort *port);
+VOID ReplyMsg(struct Message *message);
+struct Message *WaitPort(struct MsgPort *port);
+
+VOID InitSemaphore(struct SignalSemaphore *semaphore);
+VOID ObtainSemaphore(struct SignalSemaphore *semaphore);
+VOID ObtainSemaphoreShared(struct SignalSemaphore *semaphore);
+ULONG AttemptSemaphore(struct SignalSemaphore *semaphore);
+VOID ReleaseSemaphore(struct SignalSemaphore *semaphore);
+VOID AddSemaphore(struct SignalSemaphore *semaphore);
+VOID RemSemaphore(struct SignalSemaphore *semaphore);
+struct SignalSemaphore *FindSemaphore(CONST_STRPTR name);
+
+struct Library *OpenLibrary(CONST_STRPTR name, ULONG version);
+VOID CloseLibrary(APTR library);
+APTR CreateIORequest(struct MsgPort *port, ULONG size);
+VOID DeleteIORequest(APTR request);
+BYTE OpenDevice(CONST_STRPTR name, ULONG unit, struct IORequest *request, ULONG flags);
+VOID CloseDevice(struct IORequest *request);
+BYTE DoIO(struct IORequest *request);
+VOID SendIO(struct IORequest *request);
+struct IORequest *CheckIO(struct IORequest *request);
+BYTE WaitIO(struct IORequest *request);
+VOID AbortIO(struct IORequest *request);
+
+/* timer.device, input.device */
+ULONG ReadEClock(struct EClockVal *eclock);
+VOID GetSysTime(struct TimeVal *time);
+VOID AddTime(struct TimeVal *dest, const struct TimeVal *source);
+VOID SubTime(struct TimeVal *dest, const struct TimeVal *source);
+LONG CmpTime(const struct TimeVal *a, const struct TimeVal *b);
+UWORD PeekQualifier(VOID);
+
+/* dos.library */
+BPTR Lock(CONST_STRPTR name, LONG mode);
+VOID UnLock(BPTR lock);
+BPTR DupLock(BPTR lock);
+BPTR ParentDir(BPTR lock);
+BPTR CurrentDir(BPTR lock);
+LONG SameLock(BPTR a, BPTR b);
+BPTR CreateDir(CONST_STRPTR name);
+LONG Examine(BPTR lock, struct FileInfoBlock *fib);
+LONG ExNext(BPTR lock, struct FileInfoBlock *fib);
+LONG ExamineFH(BPTR file, struct FileInfoBlock *fib);
+LONG ExAll(BPTR lock, struct ExAllData *buffer, LONG size, LONG type, struct ExAllControl *control);
+VOID ExAllEnd(BPTR lock, struct ExAllData *buffer, LONG size, LONG type, struct ExAllControl *control);
+LONG Info(BPTR lock, struct InfoData *info);
+LONG NameFromLock(BPTR lock, STRPTR buffer, LONG size);
+LONG NameFromFH(BPTR file, STRPTR buffer, LONG size);
+
+BPTR Open(CONST_STRPTR name, LONG mode);
+BPTR OpenFromLock(BPTR lock);
+LONG Close(BPTR file);
+LONG Read(BPTR file, APTR buffer, LONG length);
+LONG Write(BPTR file, CONST_APTR buffer, LONG length);
+LONG Seek(BPTR file, LONG position, LONG mode);
+LONG Flush(BPTR file);
+STRPTR FGets(BPTR file, STRPTR buffer, ULONG size);
+LONG FGetC(BPTR file);
+LONG FPutC(BPTR file, LONG c);
+LONG FPuts(BPTR file, CONST_STRPTR string);
+LONG PutStr(CONST_STRPTR string);
+LONG WriteChars(CONST_STRPTR buffer, ULONG length);
+LONG VPrintf(CONST_STRPTR format, CONST_APTR args);
+LONG VFPrintf(BPTR file, CONST_STRPTR format, CONST_APTR args);
+LONG Printf(CONST_STRPTR format, ...);
+LONG FPrintf(BPTR file, CONST_STRPTR format, ...);
+BPTR Input(VOID);
+BPTR Output(VOID);
+BPTR SelectOutput(BPTR file);
+
+LONG DeleteFile(CONST_STRPTR name);
+LONG Rename(CONST_STRPTR oldName, CONST_STRPTR newName);
+LONG SetProtection(CONST_STRPTR name, LONG protection);
+LONG SetComment(CONST_STRPTR name, CONST_STRPTR comment);
+LONG SetFileDate(CONST_STRPTR name, const struct DateStamp *date);
+
+APTR AllocDosObject(ULONG type, struct TagItem *tags);
+VOID FreeDosObject(ULONG type, APTR object);
+
+LONG IoErr(VOID);
+LONG SetIoErr(LONG code);
+LONG Fault(LONG code, CONST_STRPTR header, STRPTR buffer, LONG length);
+LONG PrintFault(LONG code, CONST_STRPTR header);
+
+struct RDArgs *ReadArgs(CONST_STRPTR arg_template, LONG *array, struct RDArgs *args);
+VOID FreeArgs(struct RDArgs *args);
+LONG ReadItem(STRPTR name, LONG maxchars, struct CSource *cSource);
+LONG StrToLong(CONST_STRPTR string, LONG *value);
+STRPTR FilePart(CONST_STRPTR path);
+STRPTR PathPart(CONST_STRPTR path);
+BOOL AddPart(STRPTR dirname, CONST_STRPTR filename, ULONG size);
+
+LONG GetVar(CONST_STRPTR name, STRPTR buffer, LONG size, ULONG flags);
+LONG SetVar(CONST_STRPTR name, CONST_STRPTR buffer, LONG size, ULONG flags);
+LONG DeleteVar(CONST_STRPTR name, ULONG flags);
+
+LONG ParsePattern(CONST_STRPTR source, STRPTR dest, LONG length);
+LONG ParsePatternNoCase(CONST_STRPTR source, STRPTR dest, LONG length);
+BOOL MatchPattern(CONST_STRPTR pattern, CONST_STRPTR string);
+BOOL MatchPatternNoCase(CONST_STRPTR pattern, CONST_STRPTR string);
+
+VOID Delay(LONG ticks);
+struct DateStamp *DateStamp(struct DateStamp *date);
+LONG CompareDates(const struct DateStamp *a, const struct DateStamp *b);
+
+BPTR LoadSeg(CONST_STRPTR name);
+VOID UnLoadSeg(BPTR seglist);
+struct Segment *FindSegment(CONST_STRPTR name, const struct Segment *start, LONG system);
+struct Process *CreateNewProc(struct TagItem *tags);
+struct Process *CreateNewProcTags(ULONG tag, ...);
+LONG System(CONST_STRPTR command, struct TagItem *tags);
+LONG SystemTagList(CONST_STRPTR command, struct TagItem *tags);
+LONG SystemTags(CONST_STRPTR command, ...);
+struct CommandLineInterface *Cli(VOID);
+BOOL GetProgramName(STRPTR buffer, LONG length);
+BPTR GetProgramDir(VOID);
+STRPTR GetArgStr(VOID);
+LONG CheckSignal(LONG mask);
+
+struct DosList *LockDosList(ULONG flags);
+VOID UnLockDosList(ULONG flags);
+struct DosList *FindDosEntry(struct DosList *list, CONST_STRPTR name, ULONG flags);
+struct DosList *NextDosEntry(struct DosList *list, ULONG flags);
+
+/* icon.library */
+struct DiskObject *GetDiskObject(CONST_STRPTR name);
+struct DiskObject *GetDiskObjectNew(CONST_STRPTR name);
+BOOL PutDiskObject(CONST_STRPTR name, struct DiskObject *icon);
+VOID FreeDiskObject(struct DiskObject *icon);
+BOOL DeleteDiskObject(CONST_STRPTR name);
+struct DiskObject *GetDefDiskObject(LONG type);
+struct DiskObject *GetIconTagList(CONST_STRPTR name, const struct TagItem *tags);
+struct DiskObject *GetIconTags(CONST_STRPTR name, ...);
+BOOL PutIconTagList(CONST_STRPTR name, struct DiskObject *icon, const struct TagItem *tags);
+BOOL PutIconTags(CONST_STRPTR name, struct DiskObject *icon, ...);
+struct DiskObject *DupDiskObjectA(struct DiskObject *icon, const struct TagItem *tags);
+UBYTE *FindToolType(STRPTR *toolTypes, CONST_STRPTR name);
+BOOL MatchToolValue(CONST_STRPTR value, CONST_STRPTR substring);
+
+/* workbench.library */
+BOOL OpenWorkbenchObjectA(CONST_STRPTR name, const struct TagItem *tags);
+BOOL OpenWorkbenchObject(CONST_STRPTR name, ...);
+BOOL CloseWorkbenchObjectA(CONST_STRPTR name, const struct TagItem *tags);
+BOOL WorkbenchControlA(CONST_STRPTR name, const struct TagItem *tags);
+BOOL WorkbenchControl(CONST_STRPTR name, ...);
+
+/* intuition.library, requester.class */
+Object *NewObject(Class *classPtr, CONST_STRPTR classID, ...);
+Object *NewObjectA(Class *classPtr, CONST_STRPTR classID, const struct TagItem *tags);
+VOID DisposeObject(Object *object);
+ULONG DoMethod(Object *object, ULONG methodID, ...);
+ULONG DoMethodA(Object *object, APTR message);
+Class *REQUESTER_GetClass(VOID);
+
+/* utility.library */
+LONG Stricmp(CONST_STRPTR a, CONST_STRPTR b);
+LONG Strnicmp(CONST_STRPTR a, CONST_STRPTR b, LONG length);
+UBYTE ToUpper(ULONG c);
+UBYTE ToLower(ULONG c);
+LONG Strncpy(STRPTR dest, CONST_STRPTR source, LONG size);
+LONG Strncat(STRPTR dest, CONST_STRPTR source, LONG size);
+LONG SNPrintf(STRPTR buffer, LONG size, CONST_STRPTR format, ...);
+LONG VSNPrintf(STRPTR buffer, LONG size, CONST_STRPTR format, va_list args);
+ULONG UDivMod32(ULONG dividend, ULONG divisor);
+ULONG UMult32(ULONG a, ULONG b);
+LONG SMult32(LONG a, LONG b);
+ULONG GetUniqueID(VOID);
+struct TagItem *FindTagItem(Tag tag, const struct TagItem *tags);
+ULONG GetTagData(Tag tag, ULONG defaultData, const struct TagItem *tags);
+struct TagItem *NextTagItem(struct TagItem **tags);
+
+/* rexxsyslib.library */
+struct RexxMsg *CreateRexxMsg(const struct MsgPort *port, CONST_STRPTR extension, CONST_STRPTR host);
+VOID DeleteRexxMsg(struct RexxMsg *message);
+STRPTR CreateArgstring(CONST_STRPTR string, ULONG length);
+VOID DeleteArgstring(STRPTR argstring);
+ULONG LengthArgstring(CONST_STRPTR argstring);
+VOID ClearRexxMsg(struct RexxMsg *message, ULONG count);
+BOOL FillRexxMsg(struct RexxMsg *message, ULONG count, ULONG mask);
+BOOL IsRexxMsg(const struct RexxMsg *message);
+
+#endif /* HOST_NDK_H */
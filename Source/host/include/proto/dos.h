@@ -0,0 +1,2 @@
+/* proto/dos.h - see ndk.h */
+#include <ndk.h>
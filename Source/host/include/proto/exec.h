@@ -0,0 +1,2 @@
+/* proto/exec.h - see ndk.h */
+#include <ndk.h>
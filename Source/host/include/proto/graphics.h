@@ -0,0 +1,2 @@
+/* proto/graphics.h - see ndk.h */
+#include <ndk.h>
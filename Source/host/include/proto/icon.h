@@ -0,0 +1,2 @@
+/* proto/icon.h - see ndk.h */
+#include <ndk.h>
@@ -0,0 +1,2 @@
+/* proto/input.h - see ndk.h */
+#include <ndk.h>
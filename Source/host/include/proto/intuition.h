@@ -0,0 +1,2 @@
+/* proto/intuition.h - see ndk.h */
+#include <ndk.h>
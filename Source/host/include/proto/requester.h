@@ -0,0 +1,2 @@
+/* proto/requester.h - see ndk.h */
+#include <ndk.h>
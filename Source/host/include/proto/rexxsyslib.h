@@ -0,0 +1,2 @@
+/* proto/rexxsyslib.h - see ndk.h */
+#include <ndk.h>
@@ -0,0 +1,2 @@
+/* proto/timer.h - see ndk.h */
+#include <ndk.h>
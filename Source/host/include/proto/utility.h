@@ -0,0 +1,2 @@
+/* proto/utility.h - see ndk.h */
+#include <ndk.h>
@@ -0,0 +1,2 @@
+/* proto/wb.h - see ndk.h */
+#include <ndk.h>
@@ -0,0 +1,2 @@
+/* reaction/reaction_macros.h - see ndk.h */
+#include <ndk.h>
@@ -0,0 +1,2 @@
+/* rexx/errors.h - see ndk.h */
+#include <ndk.h>
@@ -0,0 +1,2 @@
+/* rexx/rxslib.h - see ndk.h */
+#include <ndk.h>
@@ -0,0 +1,2 @@
+/* rexx/storage.h - see ndk.h */
+#include <ndk.h>
@@ -0,0 +1,13 @@
+/*
+ * string.h - the host C library's header, with the NDK definition of NULL
+ *
+ * Copyright (c) 2025 amigazen project
+ * Licensed under BSD 2-Clause License
+ */
+
+#include_next <string.h>
+
+#ifdef EXEC_TYPES_H
+#undef NULL
+#define NULL 0L
+#endif
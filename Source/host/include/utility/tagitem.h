@@ -0,0 +1,2 @@
+/* utility/tagitem.h - see ndk.h */
+#include <ndk.h>
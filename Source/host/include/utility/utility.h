@@ -0,0 +1,2 @@
+/* utility/utility.h - see ndk.h */
+#include <ndk.h>
@@ -0,0 +1,2 @@
+/* workbench/icon.h - see ndk.h */
+#include <ndk.h>
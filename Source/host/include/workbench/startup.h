@@ -0,0 +1,2 @@
+/* workbench/startup.h - see ndk.h */
+#include <ndk.h>
@@ -0,0 +1,2 @@
+/* workbench/workbench.h - see ndk.h */
+#include <ndk.h>
@@ -0,0 +1,53 @@
+/*
+ * test.h - checks for the host test drivers
+ *
+ * Copyright (c) 2025 amigazen project
+ * Licensed under BSD 2-Clause License
+ *
+ * A failed check is reported with its line and the test goes on; the
+ * driver's exit code says whether any check failed.
+ */
+
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdio.h>
+#include <string.h>
+
+static int testChecks = 0;
+static int testFailures = 0;
+static const char *testName = "";
+
+#define CHECK(condition) \
+    do { \
+        testChecks++; \
+        if (!(condition)) { \
+            testFailures++; \
+            fprintf(stderr, "%s:%d: %s: check failed: %s\n", __FILE__, __LINE__, testName, #condition); \
+        } \
+    } while (0)
+
+#define CHECK_STR(actual, expected) \
+    do { \
+        const char *checkActual = (const char *)(actual); \
+        testChecks++; \
+        if (checkActual == NULL || strcmp(checkActual, (expected)) != 0) { \
+            testFailures++; \
+            fprintf(stderr, "%s:%d: %s: %s is \"%s\", expected \"%s\"\n", __FILE__, __LINE__, testName, \
+                    #actual, checkActual != NULL ? checkActual : "(null)", (expected)); \
+        } \
+    } while (0)
+
+#define RUN(test) \
+    do { \
+        testName = #test; \
+        test(); \
+    } while (0)
+
+static int TestSummary(const char *driver)
+{
+    printf("%s: %d checks, %d failed\n", driver, testChecks, testFailures);
+    return testFailures == 0 ? 0 : 1;
+}
+
+#endif /* HOST_TEST_H */
@@ -0,0 +1,399 @@
+/*
+ * test_archive.c - LhA and Zip members, from their headers to the staged copy
+ *
+ * Copyright (c) 2025 amigazen project
+ * Licensed under BSD 2-Clause License
+ *
+ * FindLhaMember() and FindZipMember() are run on archives built here: LhA
+ * headers of levels 0, 1 and 2, and a Zip central directory with a comment.
+ * Every archive is also cut short at every length, which must never find a
+ * member whose header was cut. A stand-in LhA then extracts members for
+ * ProjectX, and the staged copy must be gone once the tool has quit or
+ * ProjectX has failed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hal.h"
+#include "test.h"
+
+int projectx_main(int argc, char *argv[]);
+BOOL FindLhaMember(BPTR file, STRPTR memberName, ULONG *sizeOut, STRPTR nameOut, ULONG nameSize);
+BOOL FindZipMember(BPTR file, STRPTR memberName, ULONG *sizeOut, STRPTR nameOut, ULONG nameSize);
+
+#define PROJECTX  "SYS:C/ProjectX"
+#define LHA       "SYS:C/LhA"
+#define VIEWER    "SYS:Tools/Viewer"
+#define MULTIVIEW "SYS:Utilities/MultiView"
+#define STAGE_DIR "RAM:ProjectX-Archive"
+#define ARCHIVE   "System:Work/Pack.lha"
+#define SCRATCH   "RAM:Archive"
+
+static UBYTE archive[1024];
+static LONG archiveLength = 0;
+
+/* Where each member's headers end in the LhA archive, and their original sizes */
+static LONG headerEnds[3];
+static const ULONG memberSizes[3] = { 6, 300, 1200 };
+static const char *const memberNames[3] = { "A.txt", "Docs/ReadMe.txt", "Src/Main.c" };
+
+static VOID PutWord(UBYTE *p, ULONG value)
+{
+    p[0] = (UBYTE)value;
+    p[1] = (UBYTE)(value >> 8);
+}
+
+static VOID PutLong(UBYTE *p, ULONG value)
+{
+    PutWord(p, value);
+    PutWord(p + 2, value >> 16);
+}
+
+/* The fields levels 0 and 1 share, up to and including the name */
+static LONG LhaBase(UBYTE *p, UBYTE level, const char *name, ULONG packed, ULONG size)
+{
+    LONG nameLength = (LONG)strlen(name);
+
+    memcpy(p + 2, "-lh0-", 5);
+    PutLong(p + 7, packed);
+    PutLong(p + 11, size);
+    p[20] = level;
+    p[21] = (UBYTE)nameLength;
+    memcpy(p + 22, name, nameLength);
+    return 22 + nameLength;
+}
+
+/* An extended header: its type, the data, then the size of the next one */
+static LONG LhaExtended(UBYTE *p, UBYTE type, const char *data, ULONG nextSize)
+{
+    LONG length = (LONG)strlen(data);
+    LONG i;
+
+    p[0] = type;
+    for (i = 0; i < length; i++) {
+        p[1 + i] = (data[i] == '/') ? 0xFF : (UBYTE)data[i];
+    }
+    PutWord(p + 1 + length, nextSize);
+    return 3 + length;
+}
+
+/* A.txt at level 0, Docs/ReadMe.txt at level 1, Src/Main.c at level 2 */
+static VOID MakeLha(VOID)
+{
+    UBYTE *p = archive;
+    LONG length;
+    LONG extended;
+
+    memset(archive, 0, sizeof(archive));
+
+    /* Level 0 - the name and a CRC */
+    length = LhaBase(p, 0, "A.txt", memberSizes[0], memberSizes[0]) + 2;
+    p[0] = (UBYTE)(length - 2);
+    headerEnds[0] = (LONG)(p - archive) + length;
+    p += length + memberSizes[0];
+
+    /* Level 1 - the file name, CRC, OS and the first extended header's size, */
+    /* then a directory header; the packed size counts the extended headers */
+    length = LhaBase(p, 1, "ReadMe.txt", 0, memberSizes[1]) + 5;
+    p[0] = (UBYTE)(length - 2);
+    p[length - 3] = 'A';
+    PutWord(p + length - 2, 3 + 5);
+    extended = LhaExtended(p + length, 0x02, "Docs/", 0);
+    PutLong(p + 7, extended + 40);
+    headerEnds[1] = (LONG)(p - archive) + length + extended;
+    p += length + extended + 40;
+
+    /* Level 2 - the total header size, then the name and directory as extended headers */
+    memcpy(p + 2, "-lh5-", 5);
+    PutLong(p + 7, 50);
+    PutLong(p + 11, memberSizes[2]);
+    p[20] = 2;
+    p[23] = 'A';
+    PutWord(p + 24, 3 + 6);
+    length = 26;
+    length += LhaExtended(p + length, 0x01, "Main.c", 3 + 4);
+    length += LhaExtended(p + length, 0x02, "Src/", 0);
+    PutWord(p, length);
+    headerEnds[2] = (LONG)(p - archive) + length;
+    p += length + 50;
+
+    /* The end mark */
+    *p++ = 0;
+    archiveLength = (LONG)(p - archive);
+}
+
+/* Look for a member in the first cut bytes of the archive */
+static BOOL FindMember(BOOL zip, LONG cut, const char *member, ULONG *size)
+{
+    UBYTE stored[256];
+    BPTR file;
+    BOOL found;
+
+    HalWriteFile((CONST_STRPTR)SCRATCH, archive, cut, 0);
+    file = Open((CONST_STRPTR)SCRATCH, MODE_OLDFILE);
+    if (file == NULL) {
+        return FALSE;
+    }
+    *size = 0;
+    found = zip ? FindZipMember(file, (STRPTR)member, size, stored, sizeof(stored))
+                : FindLhaMember(file, (STRPTR)member, size, stored, sizeof(stored));
+    Close(file);
+    return found;
+}
+
+static VOID TestLhaLevels(VOID)
+{
+    ULONG size;
+    LONG i;
+
+    MakeLha();
+    for (i = 0; i < 3; i++) {
+        CHECK(FindMember(FALSE, archiveLength, memberNames[i], &size));
+        CHECK(size == memberSizes[i]);
+    }
+    CHECK(FindMember(FALSE, archiveLength, "docs/readme.TXT", &size));
+    CHECK(!FindMember(FALSE, archiveLength, "ReadMe.txt", &size));
+    CHECK(!FindMember(FALSE, archiveLength, "Missing", &size));
+}
+
+/* A member is found only once all of its headers are there */
+static VOID TestLhaTruncated(VOID)
+{
+    ULONG size;
+    LONG cut;
+    LONG i;
+
+    MakeLha();
+    for (cut = 0; cut < archiveLength; cut++) {
+        for (i = 0; i < 3; i++) {
+            if (cut < headerEnds[i]) {
+                CHECK(!FindMember(FALSE, cut, memberNames[i], &size));
+            }
+        }
+    }
+
+    /* A name longer than the header that holds it */
+    MakeLha();
+    archive[21] = 200;
+    CHECK(!FindMember(FALSE, archiveLength, "A.txt", &size));
+}
+
+/* Readme.txt and Tools/Viewer, a central directory and an end record with a comment */
+static VOID MakeZip(LONG *directoryEnd)
+{
+    static const char *const names[2] = { "Readme.txt", "Tools/Viewer" };
+    static const ULONG sizes[2] = { 120, 4000 };
+    UBYTE *p = archive;
+    LONG directory;
+    LONG i;
+
+    memset(archive, 0, sizeof(archive));
+
+    /* Member data is never read, so a stand-in block will do */
+    memcpy(p, "PK\3\4", 4);
+    p += 100;
+
+    directory = (LONG)(p - archive);
+    for (i = 0; i < 2; i++) {
+        PutLong(p, 0x02014B50);
+        PutLong(p + 24, sizes[i]);
+        PutWord(p + 28, strlen(names[i]));
+        PutWord(p + 30, 4);
+        memcpy(p + 46, names[i], strlen(names[i]));
+        p += 46 + strlen(names[i]) + 4;
+    }
+    *directoryEnd = (LONG)(p - archive);
+
+    memcpy(p, "PK\5\6", 4);
+    PutWord(p + 8, 2);
+    PutWord(p + 10, 2);
+    PutLong(p + 12, *directoryEnd - directory);
+    PutLong(p + 16, directory);
+    PutWord(p + 20, 9);
+    memcpy(p + 22, "A comment", 9);
+    p += 22 + 9;
+    archiveLength = (LONG)(p - archive);
+}
+
+static VOID TestZip(VOID)
+{
+    ULONG size;
+    LONG directoryEnd;
+
+    MakeZip(&directoryEnd);
+    CHECK(FindMember(TRUE, archiveLength, "Readme.txt", &size));
+    CHECK(size == 120);
+    CHECK(FindMember(TRUE, archiveLength, "tools/viewer", &size));
+    CHECK(size == 4000);
+    CHECK(!FindMember(TRUE, archiveLength, "Viewer", &size));
+}
+
+/* Nothing is found without the whole end record, or past the end of the directory */
+static VOID TestZipTruncated(VOID)
+{
+    ULONG size;
+    LONG directoryEnd;
+    LONG cut;
+
+    MakeZip(&directoryEnd);
+    for (cut = 0; cut < directoryEnd + 22; cut++) {
+        CHECK(!FindMember(TRUE, cut, "Readme.txt", &size));
+        CHECK(!FindMember(TRUE, cut, "Tools/Viewer", &size));
+    }
+
+    /* More entries than the directory holds */
+    MakeZip(&directoryEnd);
+    PutWord(archive + directoryEnd + 10, 40);
+    CHECK(!FindMember(TRUE, archiveLength, "Missing", &size));
+
+    /* A directory said to start past the end of the file */
+    MakeZip(&directoryEnd);
+    PutLong(archive + directoryEnd + 16, 0x7FFFFF00);
+    CHECK(!FindMember(TRUE, archiveLength, "Readme.txt", &size));
+}
+
+/* Extracts a member to the drawer given, with the original size the test expects */
+/* Called as: LhA -q -m e <archive> <drawer>/ <member> */
+static int LhaMain(int argc, char *argv[])
+{
+    static UBYTE data[2048];
+    UBYTE path[256];
+    LONG i;
+
+    if (argc != 7) {
+        return RETURN_FAIL;
+    }
+    for (i = 0; i < 3 && strcmp(argv[6], memberNames[i]) != 0; i++) {
+    }
+    if (i == 3) {
+        return RETURN_WARN;
+    }
+    memset(data, 'x', sizeof(data));
+    snprintf((char *)path, sizeof(path), "%s%s", argv[5], (char *)FilePart((STRPTR)argv[6]));
+    return HalWriteFile(path, data, memberSizes[i], 0) ? RETURN_OK : RETURN_FAIL;
+}
+
+static LONG toolRuns = 0;
+
+static int ToolMain(int argc, char *argv[])
+{
+    (void)argv;
+    if (argc != 0) {
+        return RETURN_FAIL;
+    }
+    toolRuns++;
+    Delay(50);
+    return RETURN_OK;
+}
+
+static VOID MakeWorld(VOID)
+{
+    HalInit();
+    HalAddProgram((CONST_STRPTR)PROJECTX, projectx_main);
+    HalAddProgram((CONST_STRPTR)LHA, LhaMain);
+    HalAddProgram((CONST_STRPTR)VIEWER, ToolMain);
+    HalWriteFile((CONST_STRPTR)MULTIVIEW, "tool", 4, 0);
+    HalSetSystemRuns(TRUE);
+    HalWriteIcon((CONST_STRPTR)"ENV:Sys/def_ascii", WBPROJECT, (CONST_STRPTR)VIEWER, NULL, 256);
+    HalWriteIcon((CONST_STRPTR)"ENV:Sys/def_c", WBPROJECT, (CONST_STRPTR)MULTIVIEW, NULL, 256);
+    HalDefIconsRule((CONST_STRPTR)"#?.txt", NULL, (CONST_STRPTR)"ascii");
+    HalDefIconsRule((CONST_STRPTR)"#?.c", NULL, (CONST_STRPTR)"c");
+    HalDefIconsStart();
+    HalWriteFile((CONST_STRPTR)"ENV:ProjectX/LhA", LHA, strlen(LHA), 0);
+
+    /* Read once per ProjectX run, so set before the first */
+    HalWriteFile((CONST_STRPTR)"ENV:ProjectX/Launch", "DIRECT", 6, 0);
+
+    MakeLha();
+    HalWriteFile((CONST_STRPTR)ARCHIVE, archive, archiveLength, 0);
+}
+
+/* Drawers left in the staging area */
+static LONG StagedCount(VOID)
+{
+    struct FileInfoBlock *fib = AllocDosObject(DOS_FIB, NULL);
+    BPTR lock = Lock((CONST_STRPTR)STAGE_DIR, SHARED_LOCK);
+    LONG count = 0;
+
+    if (lock != NULL && fib != NULL && Examine(lock, fib)) {
+        while (ExNext(lock, fib)) {
+            count++;
+        }
+    }
+    if (lock != NULL) {
+        UnLock(lock);
+    }
+    FreeDosObject(DOS_FIB, fib);
+    return count;
+}
+
+static LONG Run(const char *member, const char *open)
+{
+    UBYTE arguments[256];
+    LONG result;
+
+    snprintf((char *)arguments, sizeof(arguments), "%s/%s%s", ARCHIVE, member, open);
+    result = HalRun((CONST_STRPTR)PROJECTX, arguments);
+    HalSettle(60 * 1000000UL);
+    HalReap();
+    CHECK(HalLiveProcesses() == 0);
+    return result;
+}
+
+/* Printing the tool needs the member only while ProjectX runs */
+static VOID TestStagedPrint(VOID)
+{
+    CHECK(Run("Docs/ReadMe.txt", "") == RETURN_OK);
+    CHECK(StagedCount() == 0);
+}
+
+/* A tool ProjectX started itself is seen to quit, and its copy goes with it */
+static VOID TestStagedDirect(VOID)
+{
+    LONG locks = HalOpenLocks();
+
+    toolRuns = 0;
+    CHECK(Run("A.txt", " OPEN") == RETURN_OK);
+    CHECK(toolRuns == 1);
+    CHECK(StagedCount() == 0);
+    CHECK(HalOpenLocks() == locks);
+}
+
+/* Workbench does not say when its tool quits, so that copy is left to the purge */
+static VOID TestStagedWorkbench(VOID)
+{
+    LONG before = HalLaunchCount(HAL_LAUNCH_WORKBENCH);
+
+    CHECK(Run("Src/Main.c", " OPEN") == RETURN_OK);
+    CHECK(HalLaunchCount(HAL_LAUNCH_WORKBENCH) == before + 1);
+    CHECK(StagedCount() == 1);
+}
+
+/* A member that cannot be opened is not kept */
+static VOID TestStagedFailure(VOID)
+{
+    LONG before = StagedCount();
+
+    HalDefIconsRule((CONST_STRPTR)"#?.txt", NULL, (CONST_STRPTR)"notype");
+    HalWriteFile((CONST_STRPTR)"ENV:Sys/def_ascii.info", "", 0, 0);
+    CHECK(Run("Docs/ReadMe.txt", " OPEN") == RETURN_FAIL);
+    CHECK(StagedCount() == before);
+}
+
+int main(void)
+{
+    MakeWorld();
+    RUN(TestLhaLevels);
+    RUN(TestLhaTruncated);
+    RUN(TestZip);
+    RUN(TestZipTruncated);
+    MakeLha();
+    HalWriteFile((CONST_STRPTR)ARCHIVE, archive, archiveLength, 0);
+    RUN(TestStagedPrint);
+    RUN(TestStagedDirect);
+    RUN(TestStagedWorkbench);
+    RUN(TestStagedFailure);
+    return TestSummary("test_archive");
+}
@@ -0,0 +1,266 @@
+/*
+ * test_core.c - host tests of pxcore.c
+ *
+ * Copyright (c) 2025 amigazen project
+ * Licensed under BSD 2-Clause License
+ *
+ * The suffix trie, name guesses, text classification, latency histograms
+ * and volume policy, with CoreAlloc() and CoreFree() on the host heap.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "pxcore.h"
+#include "test.h"
+
+static LONG coreBlocks = 0;
+
+APTR CoreAlloc(ULONG size)
+{
+    APTR memory = calloc(1, size);
+
+    if (memory != NULL) {
+        coreBlocks++;
+    }
+    return memory;
+}
+
+VOID CoreFree(APTR memory)
+{
+    if (memory != NULL) {
+        coreBlocks--;
+        free(memory);
+    }
+}
+
+static VOID TestTrie(VOID)
+{
+    struct CoreSuffix *root = NULL;
+    UWORD order = 0;
+
+    CHECK(CoreAddSuffix(&root, (STRPTR)"#?.txt", (APTR)"text", 3));
+    CHECK(CoreAddSuffix(&root, (STRPTR)"#?.(jpg|jpeg)", (APTR)"jpeg", 2));
+    CHECK(CoreAddSuffix(&root, (STRPTR)"#?.info", (APTR)"icon", 5));
+    CHECK(CoreAddSuffix(&root, (STRPTR)"#?.tar.gz", (APTR)"tgz", 1));
+    CHECK(CoreAddSuffix(&root, (STRPTR)"#?.gz", (APTR)"gzip", 4));
+
+    /* Anything but a plain suffix is left to the pattern rules */
+    CHECK(!CoreAddSuffix(&root, (STRPTR)"readme", (APTR)"x", 1));
+    CHECK(!CoreAddSuffix(&root, (STRPTR)"#?", (APTR)"x", 1));
+    CHECK(!CoreAddSuffix(&root, (STRPTR)"#?.c#?", (APTR)"x", 1));
+    CHECK(!CoreAddSuffix(&root, (STRPTR)"#?.(a|b", (APTR)"x", 1));
+    CHECK(!CoreAddSuffix(&root, (STRPTR)"#?.[ch]", (APTR)"x", 1));
+
+    CHECK_STR(CoreMatchSuffix(root, (STRPTR)"notes.txt", &order), "text");
+    CHECK(order == 3);
+    CHECK_STR(CoreMatchSuffix(root, (STRPTR)"NOTES.TXT", NULL), "text");
+    CHECK_STR(CoreMatchSuffix(root, (STRPTR)"photo.JPEG", NULL), "jpeg");
+    CHECK_STR(CoreMatchSuffix(root, (STRPTR)"photo.jpg", NULL), "jpeg");
+    CHECK(CoreMatchSuffix(root, (STRPTR)"photo.jpe", NULL) == NULL);
+    CHECK(CoreMatchSuffix(root, (STRPTR)"txt", NULL) == NULL);
+    CHECK(CoreMatchSuffix(root, (STRPTR)"", NULL) == NULL);
+
+    /* The lower order wins whichever suffix is longer */
+    CHECK_STR(CoreMatchSuffix(root, (STRPTR)"src.tar.gz", &order), "tgz");
+    CHECK(order == 1);
+    CHECK_STR(CoreMatchSuffix(root, (STRPTR)"src.gz", NULL), "gzip");
+    CHECK(CoreAddSuffix(&root, (STRPTR)"#?.gz", (APTR)"early", 0));
+    CHECK_STR(CoreMatchSuffix(root, (STRPTR)"src.tar.gz", NULL), "early");
+
+    /* Latin-1 folds as well */
+    CHECK(CoreAddSuffix(&root, (STRPTR)"#?.\xC4q", (APTR)"latin", 6));
+    CHECK_STR(CoreMatchSuffix(root, (STRPTR)"x.\xE4Q", NULL), "latin");
+
+    CoreFreeSuffixes(root);
+    CHECK(coreBlocks == 0);
+}
+
+static VOID TestGuesses(VOID)
+{
+    ULONG calls;
+    ULONG rules;
+    ULONG before;
+    LONG i;
+
+    CoreResetGuesses(TRUE);
+    CHECK_STR(CoreGuessType((STRPTR)"Read.Me.TXT"), "ascii");
+    CHECK_STR(CoreGuessType((STRPTR)"picture.iff"), "ilbm");
+    CHECK_STR(CoreGuessType((STRPTR)"main.c"), "c");
+    CHECK_STR(CoreGuessType((STRPTR)"defs.h"), "h");
+    CHECK_STR(CoreGuessType((STRPTR)"index.html"), "html");
+    CHECK_STR(CoreGuessType((STRPTR)"index.htm"), "html");
+    CHECK(CoreGuessType((STRPTR)"Makefile") == NULL);
+    CHECK(CoreGuessType((STRPTR)".txt") == NULL);
+    CoreGuessCost(&calls, &rules);
+    CHECK(calls == 8);
+
+    /* A stream of headers moves .h to the front, and costs less per guess */
+    CoreResetGuesses(FALSE);
+    for (i = 0; i < 256; i++) {
+        CoreGuessType((STRPTR)"x.h");
+    }
+    CoreGuessCost(&calls, &before);
+    CoreResetGuesses(TRUE);
+    for (i = 0; i < 256; i++) {
+        CHECK_STR(CoreGuessType((STRPTR)"x.h"), "h");
+    }
+    CoreGuessCost(&calls, &rules);
+    CHECK(rules < before / 4);
+
+    /* Reordering never changes what a name guesses */
+    CHECK_STR(CoreGuessType((STRPTR)"x.doc"), "ascii");
+    CHECK_STR(CoreGuessType((STRPTR)"x.lzh"), "lha");
+    CHECK_STR(CoreGuessType((STRPTR)"x.rexx"), "rexx");
+    CoreResetGuesses(TRUE);
+}
+
+/* Run first, while the guess order has not been set up yet, as in a new ProjectX */
+static VOID TestSeededGuesses(VOID)
+{
+    ULONG calls;
+    ULONG rules;
+
+    CoreAddGuessHits((STRPTR)"h", 1000);
+    CoreAddGuessHits((STRPTR)"html", 10);
+    CoreReorderGuesses();
+    CHECK_STR(CoreGuessType((STRPTR)"defs.h"), "h");
+    CoreGuessCost(&calls, &rules);
+    CHECK(calls == 1);
+    CHECK(rules == 1);
+
+    /* .html and .htm follow, ahead of the suffixes with no hits */
+    CHECK_STR(CoreGuessType((STRPTR)"index.htm"), "html");
+    CoreGuessCost(&calls, &rules);
+    CHECK(rules <= 4);
+    CoreResetGuesses(TRUE);
+}
+
+static UBYTE Classify(CONST_STRPTR text)
+{
+    UBYTE word = CoreClassifyText((UBYTE *)text, strlen((const char *)text));
+
+    CHECK(word == CoreClassifyTextBytes((UBYTE *)text, strlen((const char *)text)));
+    return word;
+}
+
+static VOID TestText(VOID)
+{
+    UBYTE buffer[256];
+    ULONG seed = 1;
+    LONG offset;
+    LONG length;
+    LONG round;
+    LONG i;
+
+    CHECK(Classify((CONST_STRPTR)"Plain text, nothing else.\n") == CORE_TEXT_ASCII);
+    CHECK(Classify((CONST_STRPTR)"Two lines\r\nboth CR LF\r\n") == (CORE_TEXT_ASCII | CORE_TEXT_CRLF));
+    CHECK(Classify((CONST_STRPTR)"Mixed\r\nlines\n") == CORE_TEXT_ASCII);
+    CHECK(Classify((CONST_STRPTR)"Bare\rCR line ends\r") == CORE_TEXT_ASCII);
+    CHECK(Classify((CONST_STRPTR)"Caf\xC3\xA9 au lait\n") == CORE_TEXT_UTF8);
+    CHECK(Classify((CONST_STRPTR)"Caf\xE9 au lait\n") == CORE_TEXT_LATIN1);
+    CHECK(Classify((CONST_STRPTR)"Cut off \xE2\x82") == CORE_TEXT_UTF8);
+    CHECK(Classify((CONST_STRPTR)"\x1B[1mBold\x1B[0m and a\ttab\f") == CORE_TEXT_ASCII);
+    CHECK(Classify((CONST_STRPTR)"Bell\x07") == CORE_TEXT_BINARY);
+    CHECK(CoreClassifyText((UBYTE *)"FORM\0\0\0\x10ILBM", 12) == CORE_TEXT_BINARY);
+    CHECK(CoreClassifyText((UBYTE *)"", 0) == CORE_TEXT_BINARY);
+
+    CHECK_STR(CoreTextType(CORE_TEXT_ASCII), "ascii");
+    CHECK_STR(CoreTextType(CORE_TEXT_UTF8 | CORE_TEXT_CRLF), "utf8-crlf");
+    CHECK(CoreTextType(CORE_TEXT_BINARY) == NULL);
+    CHECK_STR(CoreTextParent((STRPTR)"latin1"), "ascii");
+    CHECK_STR(CoreTextParent((STRPTR)"ascii-crlf"), "ascii");
+    CHECK(CoreTextParent((STRPTR)"ascii") == NULL);
+    CHECK(CoreTextParent((STRPTR)"ilbm") == NULL);
+
+    /* The word loop agrees with the byte loop at every alignment */
+    for (round = 0; round < 20000; round++) {
+        for (i = 0; i < (LONG)sizeof(buffer); i++) {
+            seed = seed * 1103515245UL + 12345UL;
+            buffer[i] = (UBYTE)(0x20 + (seed >> 16) % 0x5F);
+            if ((seed >> 8) % 61 == 0) {
+                buffer[i] = "\r\n\t\xC3\xA9\xE9\x80\x01"[(seed >> 4) % 8];
+            }
+        }
+        offset = round % 8;
+        length = (round * 7) % (sizeof(buffer) - 8);
+        CHECK(CoreClassifyText(buffer + offset, length) == CoreClassifyTextBytes(buffer + offset, length));
+    }
+}
+
+/* A header that ends right at an unmapped page is never read past */
+static VOID TestTextBounds(VOID)
+{
+    long page = sysconf(_SC_PAGESIZE);
+    UBYTE *pages;
+    UBYTE *end;
+    LONG length;
+
+    pages = mmap(NULL, page * 2, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    CHECK(pages != MAP_FAILED);
+    if (pages == MAP_FAILED) {
+        return;
+    }
+    CHECK(mprotect(pages + page, page, PROT_NONE) == 0);
+    end = pages + page;
+    memset(pages, 'a', page);
+
+    for (length = 0; length <= 64; length++) {
+        CHECK(CoreClassifyText(end - length, length) == CoreClassifyTextBytes(end - length, length));
+    }
+    munmap(pages, page * 2);
+}
+
+static VOID TestHistogram(VOID)
+{
+    ULONG counts[8];
+
+    CHECK(CoreBucket(0, 8) == 0);
+    CHECK(CoreBucket(255, 8) == 0);
+    CHECK(CoreBucket(256, 8) == 1);
+    CHECK(CoreBucket(511, 8) == 1);
+    CHECK(CoreBucket(512, 8) == 2);
+    CHECK(CoreBucket(10000000, 8) == 7);
+
+    memset(counts, 0, sizeof(counts));
+    CHECK(CorePercentile(counts, 8, 50) == 0);
+    counts[0] = 90;
+    counts[3] = 9;
+    counts[7] = 1;
+    CHECK(CorePercentile(counts, 8, 50) == 256);
+    CHECK(CorePercentile(counts, 8, 90) == 256);
+    CHECK(CorePercentile(counts, 8, 95) == 2048);
+    CHECK(CorePercentile(counts, 8, 99) == 2048);
+    CHECK(CorePercentile(counts, 8, 100) == 32768);
+
+    CHECK(CoreMovingMean(0, 0, 400) == 400);
+    CHECK(CoreMovingMean(400, 1, 800) == 500);
+    CHECK(CoreMovingMean(100, 5, 100) == 100);
+}
+
+static VOID TestPolicy(VOID)
+{
+    CHECK(CoreVolumePolicy(5000, 1, POLICY_AUTO) == POLICY_SNIFF);
+    CHECK(CoreVolumePolicy(5000, VOLUME_MIN_SAMPLES - 1, POLICY_AUTO) == POLICY_SNIFF);
+    CHECK(CoreVolumePolicy(VOLUME_NAME_MILLIS - 1, 100, POLICY_AUTO) == POLICY_SNIFF);
+    CHECK(CoreVolumePolicy(VOLUME_NAME_MILLIS, 100, POLICY_AUTO) == POLICY_NAME);
+    CHECK(CoreVolumePolicy(VOLUME_CACHE_MILLIS - 1, 100, POLICY_AUTO) == POLICY_NAME);
+    CHECK(CoreVolumePolicy(VOLUME_CACHE_MILLIS, 100, POLICY_AUTO) == POLICY_CACHE);
+    CHECK(CoreVolumePolicy(0, 0, POLICY_CACHE) == POLICY_CACHE);
+    CHECK(CoreVolumePolicy(5000, 100, POLICY_SNIFF) == POLICY_SNIFF);
+}
+
+int main(void)
+{
+    RUN(TestSeededGuesses);
+    RUN(TestTrie);
+    RUN(TestGuesses);
+    RUN(TestText);
+    RUN(TestTextBounds);
+    RUN(TestHistogram);
+    RUN(TestPolicy);
+    return TestSummary("test_core");
+}
@@ -0,0 +1,182 @@
+/*
+ * test_launch.c - the life of a direct launch, from LoadSeg() to UnLoadSeg()
+ *
+ * Copyright (c) 2025 amigazen project
+ * Licensed under BSD 2-Clause License
+ *
+ * With ProjectX/Launch set to DIRECT, ProjectX loads the tool itself and
+ * starts it with a WBStartup. A stand-in tool records what it was given and
+ * runs for as long as a test asks. Whether the tool ends before ProjectX or
+ * long after, its seglist must be unloaded and its locks freed once the
+ * WBStartup comes back.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hal.h"
+#include "test.h"
+
+int projectx_main(int argc, char *argv[]);
+
+#define PROJECTX  "SYS:C/ProjectX"
+#define VIEWER    "SYS:Tools/Viewer"
+#define MULTIVIEW "SYS:Utilities/MultiView"
+
+/* What the stand-in tool saw, and how long it runs */
+static LONG toolTicks = 0;
+static LONG toolRuns = 0;
+static LONG toolArgs = 0;
+static ULONG toolStack = 0;
+static UBYTE toolHome[256];
+static UBYTE toolFile[256];
+
+static int ToolMain(int argc, char *argv[])
+{
+    struct WBStartup *startup = (struct WBStartup *)argv;
+    struct Process *me = (struct Process *)FindTask(NULL);
+
+    if (argc != 0) {
+        return RETURN_FAIL;
+    }
+    toolRuns++;
+    toolArgs = startup->sm_NumArgs;
+    toolStack = me->pr_StackSize;
+    toolHome[0] = '\0';
+    toolFile[0] = '\0';
+    NameFromLock(me->pr_HomeDir, toolHome, sizeof(toolHome));
+    if (startup->sm_NumArgs > 1) {
+        NameFromLock(startup->sm_ArgList[1].wa_Lock, toolFile, sizeof(toolFile));
+        AddPart(toolFile, (STRPTR)startup->sm_ArgList[1].wa_Name, sizeof(toolFile));
+    }
+    Delay(toolTicks);
+    return RETURN_OK;
+}
+
+static VOID MakeWorld(VOID)
+{
+    static const UBYTE ilbm[] = "FORM\0\0\0\x40ILBMBMHD\0\0\0\x14";
+    static CONST_STRPTR bigStack[] = { (CONST_STRPTR)"STACK=32768", NULL };
+
+    HalInit();
+    HalAddProgram((CONST_STRPTR)PROJECTX, projectx_main);
+    HalAddProgram((CONST_STRPTR)VIEWER, ToolMain);
+    HalWriteFile((CONST_STRPTR)MULTIVIEW, "tool", 4, 0);
+    HalWriteIcon((CONST_STRPTR)"ENV:Sys/def_ascii", WBPROJECT, (CONST_STRPTR)VIEWER, NULL, 256);
+    HalWriteIcon((CONST_STRPTR)"ENV:Sys/def_ilbm", WBPROJECT, (CONST_STRPTR)VIEWER, bigStack, 512);
+    HalWriteIcon((CONST_STRPTR)"ENV:Sys/def_html", WBPROJECT, (CONST_STRPTR)MULTIVIEW, NULL, 512);
+    HalDefIconsRule((CONST_STRPTR)"#?.txt", NULL, (CONST_STRPTR)"ascii");
+    HalDefIconsRule((CONST_STRPTR)"#?.html", NULL, (CONST_STRPTR)"html");
+    HalDefIconsRule(NULL, (CONST_STRPTR)"FORM", (CONST_STRPTR)"ilbm");
+    HalDefIconsStart();
+
+    /* Read once per ProjectX run, so set before the first */
+    HalWriteFile((CONST_STRPTR)"ENV:ProjectX/Launch", "DIRECT", 6, 0);
+
+    HalWriteFile((CONST_STRPTR)"System:Work/ReadMe.txt", "Hello\n", 6, 0);
+    HalWriteFile((CONST_STRPTR)"System:Work/Picture", ilbm, sizeof(ilbm) - 1, 0);
+    HalWriteFile((CONST_STRPTR)"System:Work/Page.html", "<html></html>\n", 14, 0);
+}
+
+/* Open a file with the tool running for ticks, and leave ProjectX's helpers running */
+static VOID OpenFile(CONST_STRPTR file, LONG ticks)
+{
+    UBYTE arguments[256];
+
+    toolTicks = ticks;
+    toolRuns = 0;
+    snprintf((char *)arguments, sizeof(arguments), "%s OPEN", (const char *)file);
+    CHECK(HalRun((CONST_STRPTR)PROJECTX, arguments) == RETURN_OK);
+}
+
+/* Everything the launch took is given back once the tool has ended */
+/* hc_LoadSegs counts the calls, so a load that failed has no UnLoadSeg() */
+static VOID CheckFinished(LONG locks, ULONG memory, ULONG failedLoads)
+{
+    HalSettle(60 * 1000000UL);
+    HalReap();
+    CHECK(HalLiveProcesses() == 0);
+    CHECK(HalOpenLocks() == locks);
+    CHECK(HalMemoryUsed() == memory);
+    CHECK(halCounters.hc_LoadSegs == halCounters.hc_UnLoadSegs + failedLoads);
+}
+
+/* The tool is done before ProjectX is */
+static VOID TestShortTool(VOID)
+{
+    LONG locks = HalOpenLocks();
+    ULONG memory = HalMemoryUsed();
+    LONG before = HalLaunchCount(HAL_LAUNCH_WORKBENCH);
+
+    HalResetCounters();
+    OpenFile((CONST_STRPTR)"System:Work/ReadMe.txt", 0);
+    CheckFinished(locks, memory, 0);
+    CHECK(toolRuns == 1);
+    CHECK(toolArgs == 2);
+    CHECK_STR(toolHome, "System:Tools");
+    CHECK_STR(toolFile, "System:Work/ReadMe.txt");
+    CHECK(toolStack == 4096);
+    CHECK(HalLaunchCount(HAL_LAUNCH_WORKBENCH) == before);
+
+    /* ProjectX and the tool */
+    CHECK(halCounters.hc_LoadSegs == 2);
+}
+
+/* The tool outlives ProjectX, and the reaper waits for its WBStartup */
+static VOID TestLongTool(VOID)
+{
+    LONG locks = HalOpenLocks();
+    ULONG memory = HalMemoryUsed();
+
+    HalResetCounters();
+    OpenFile((CONST_STRPTR)"System:Work/ReadMe.txt", 50 * 30);
+    CHECK(toolRuns == 1);
+    CHECK(HalLiveProcesses() == 2);
+    CHECK(halCounters.hc_UnLoadSegs < halCounters.hc_LoadSegs);
+    CheckFinished(locks, memory, 0);
+}
+
+/* The type's def_ icon asks for more stack than the tool's own */
+static VOID TestProfileStack(VOID)
+{
+    LONG locks = HalOpenLocks();
+    ULONG memory = HalMemoryUsed();
+
+    HalResetCounters();
+    OpenFile((CONST_STRPTR)"System:Work/Picture", 0);
+    CheckFinished(locks, memory, 0);
+    CHECK(toolRuns == 1);
+    CHECK(toolStack == 32768);
+    CHECK_STR(toolFile, "System:Work/Picture");
+}
+
+/* A tool that does not load is left to Workbench, with nothing left behind */
+static VOID TestNotLoadable(VOID)
+{
+    LONG locks = HalOpenLocks();
+    ULONG memory = HalMemoryUsed();
+    LONG before = HalLaunchCount(HAL_LAUNCH_WORKBENCH);
+    struct HalLaunch *launch;
+
+    HalResetCounters();
+    OpenFile((CONST_STRPTR)"System:Work/Page.html", 0);
+    CheckFinished(locks, memory, 1);
+    CHECK(toolRuns == 0);
+    CHECK(HalLaunchCount(HAL_LAUNCH_WORKBENCH) == before + 1);
+    launch = HalLastLaunch(HAL_LAUNCH_WORKBENCH);
+    if (launch != NULL) {
+        CHECK_STR(launch->hl_Tool, MULTIVIEW);
+        CHECK_STR(launch->hl_Args, "Page.html");
+    }
+}
+
+int main(void)
+{
+    MakeWorld();
+    RUN(TestShortTool);
+    RUN(TestLongTool);
+    RUN(TestProfileStack);
+    RUN(TestNotLoadable);
+    return TestSummary("test_launch");
+}
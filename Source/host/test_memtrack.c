@@ -0,0 +1,117 @@
+/*
+ * test_memtrack.c - ProjectX_MemTrack's budgets checked on the host
+ *
+ * Copyright (c) 2025 amigazen project
+ * Licensed under BSD 2-Clause License
+ *
+ * projectx.c is built with MEMTRACK defined and run on the usual kinds of
+ * file, from a shell and from Workbench. Every report it appends to
+ * T:ProjectX.memory must be within its budgets and must show no leaks.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hal.h"
+#include "test.h"
+
+int projectx_main(int argc, char *argv[]);
+
+#define PROJECTX "SYS:C/ProjectX"
+#define REPORT   "T:ProjectX.memory"
+
+static const UBYTE ilbmHeader[] = "FORM\0\0\0\x40ILBMBMHD\0\0\0\x14";
+static UBYTE report[16384];
+
+static VOID MakeWorld(VOID)
+{
+    HalInit();
+    HalAddProgram((CONST_STRPTR)PROJECTX, projectx_main);
+    HalWriteFile((CONST_STRPTR)"SYS:Utilities/MultiView", "tool", 4, 0);
+    HalWriteFile((CONST_STRPTR)"SYS:Tools/Ed", "tool", 4, 0);
+    HalWriteIcon((CONST_STRPTR)"ENV:Sys/def_ascii", WBPROJECT, (CONST_STRPTR)"SYS:Tools/Ed", NULL, 256);
+    HalWriteIcon((CONST_STRPTR)"ENV:Sys/def_ilbm", WBPROJECT, (CONST_STRPTR)"SYS:Utilities/MultiView", NULL, 512);
+    HalDefIconsRule((CONST_STRPTR)"#?.txt", NULL, (CONST_STRPTR)"ascii");
+    HalDefIconsRule(NULL, (CONST_STRPTR)"FORM", (CONST_STRPTR)"ilbm");
+    HalDefIconsStart();
+
+    HalWriteFile((CONST_STRPTR)"System:Work/ReadMe.txt", "Hello\n", 6, 0);
+    HalWriteFile((CONST_STRPTR)"System:Work/Picture", ilbmHeader, sizeof(ilbmHeader) - 1, 0);
+    HalWriteFile((CONST_STRPTR)"System:Work/Notes", "No suffix, still text\n", 22, 0);
+}
+
+/* The value of "name=" in a report line, -1 if it is not there */
+static LONG Field(const char *line, const char *name)
+{
+    char key[32];
+    const char *found;
+
+    snprintf(key, sizeof(key), " %s=", name);
+    found = strstr(line, key);
+    return found != NULL ? atol(found + strlen(key)) : -1;
+}
+
+/* Check every memtrack line in the report, and return how many there were */
+static LONG CheckReport(VOID)
+{
+    LONG length = HalReadFile((CONST_STRPTR)REPORT, report, sizeof(report) - 1);
+    char *line;
+    char *next;
+    LONG runs = 0;
+
+    if (length < 0) {
+        return 0;
+    }
+    report[length] = '\0';
+
+    for (line = (char *)report; *line != '\0'; line = next) {
+        next = strchr(line, '\n');
+        if (next != NULL) {
+            *next++ = '\0';
+        } else {
+            next = line + strlen(line);
+        }
+        if (strncmp(line, "memtrack ", 9) != 0) {
+            continue;
+        }
+        runs++;
+        CHECK(Field(line, "peak") > 0);
+        CHECK(Field(line, "peak") <= Field(line, "peak_budget"));
+        CHECK(Field(line, "stack_used") > 0);
+        CHECK(Field(line, "stack_used") <= Field(line, "stack_budget"));
+        CHECK(Field(line, "leaked") == 0);
+        /* One identify worker at most, however many engines were tried */
+        CHECK(Field(line, "processes") >= 0 && Field(line, "processes") <= 1);
+        CHECK(Field(line, "process_stack") == Field(line, "processes") * 16384);
+        CHECK(strstr(line, " result=ok") != NULL);
+        if (strstr(line, " result=ok") == NULL) {
+            fprintf(stderr, "%s\n", line);
+        }
+    }
+    return runs;
+}
+
+static VOID TestShell(VOID)
+{
+    CHECK(HalRun((CONST_STRPTR)PROJECTX, (CONST_STRPTR)"System:Work/ReadMe.txt") == RETURN_OK);
+    CHECK(HalRun((CONST_STRPTR)PROJECTX, (CONST_STRPTR)"System:Work/Picture OPEN") == RETURN_OK);
+    CHECK(HalRun((CONST_STRPTR)PROJECTX, (CONST_STRPTR)"System:Work/Notes OPEN") == RETURN_OK);
+    CHECK(HalRun((CONST_STRPTR)PROJECTX, (CONST_STRPTR)"System:Work/Missing") == RETURN_FAIL);
+    CHECK(CheckReport() == 4);
+}
+
+static VOID TestWorkbench(VOID)
+{
+    HalRunWorkbench((CONST_STRPTR)PROJECTX, (CONST_STRPTR)"System:Work", (CONST_STRPTR)"ReadMe.txt");
+    HalRunWorkbench((CONST_STRPTR)PROJECTX, (CONST_STRPTR)"System:Work", (CONST_STRPTR)"Picture");
+    CHECK(CheckReport() == 6);
+}
+
+int main(void)
+{
+    MakeWorld();
+    RUN(TestShell);
+    RUN(TestWorkbench);
+    return TestSummary("test_memtrack");
+}
@@ -0,0 +1,261 @@
+/*
+ * test_projectx.c - ProjectX run against the host HAL
+ *
+ * Copyright (c) 2025 amigazen project
+ * Licensed under BSD 2-Clause License
+ *
+ * projectx.c is built with main() renamed and registered as SYS:C/ProjectX,
+ * then started from a shell and from Workbench as a user would. The checks
+ * are on what the recording launcher saw and on what was left behind.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hal.h"
+#include "test.h"
+
+int projectx_main(int argc, char *argv[]);
+
+#define PROJECTX "SYS:C/ProjectX"
+
+static const UBYTE ilbmHeader[] = "FORM\0\0\0\x40ILBMBMHD\0\0\0\x14";
+
+static VOID MakeWorld(VOID)
+{
+    HalInit();
+    HalAddProgram((CONST_STRPTR)PROJECTX, projectx_main);
+    HalWriteFile((CONST_STRPTR)"SYS:Utilities/MultiView", "tool", 4, 0);
+    HalWriteFile((CONST_STRPTR)"SYS:Tools/Ed", "tool", 4, 0);
+    HalWriteIcon((CONST_STRPTR)"ENV:Sys/def_ascii", WBPROJECT, (CONST_STRPTR)"SYS:Tools/Ed", NULL, 256);
+    HalWriteIcon((CONST_STRPTR)"ENV:Sys/def_ilbm", WBPROJECT, (CONST_STRPTR)"SYS:Utilities/MultiView", NULL, 512);
+    HalWriteIcon((CONST_STRPTR)"ENVARC:Sys/def_ascii", WBPROJECT, (CONST_STRPTR)"SYS:Tools/Ed", NULL, 256);
+    HalWriteIcon((CONST_STRPTR)"ENVARC:Sys/def_ilbm", WBPROJECT, (CONST_STRPTR)"SYS:Utilities/MultiView", NULL, 512);
+
+    HalDefIconsRule((CONST_STRPTR)"#?.txt", NULL, (CONST_STRPTR)"ascii");
+    HalDefIconsRule(NULL, (CONST_STRPTR)"FORM", (CONST_STRPTR)"ilbm");
+
+    HalWriteFile((CONST_STRPTR)"System:Work/ReadMe.txt", "Hello\n", 6, 0);
+    HalWriteFile((CONST_STRPTR)"System:Work/Picture", ilbmHeader, sizeof(ilbmHeader) - 1, 0);
+    HalWriteFile((CONST_STRPTR)"System:Work/Notes", "No suffix, still text\n", 22, 0);
+    HalWriteFile((CONST_STRPTR)"System:Work/Blob", "\x01\x02\x03\x04\x05\x06", 6, 0);
+}
+
+/* The run leaves no locks and no processes behind */
+static LONG Run(CONST_STRPTR arguments)
+{
+    LONG locks = HalOpenLocks();
+    LONG result;
+
+    HalClearOutput();
+    result = HalRun((CONST_STRPTR)PROJECTX, arguments);
+    HalSettle(0);
+    HalReap();
+    CHECK(HalOpenLocks() == locks);
+    CHECK(HalLiveProcesses() == 0);
+    return result;
+}
+
+static VOID TestNoDefIcons(VOID)
+{
+    CHECK(Run((CONST_STRPTR)"System:Work/ReadMe.txt") == RETURN_FAIL);
+    CHECK(strstr((const char *)HalOutput(), "DefIcons is not running") != NULL);
+    CHECK(Run((CONST_STRPTR)"BENCH=System:Work") == RETURN_FAIL);
+    CHECK(strstr((const char *)HalOutput(), "DefIcons is not running") != NULL);
+
+    /* Reading the statistics identifies nothing */
+    CHECK(Run((CONST_STRPTR)"STATS") == RETURN_OK);
+    CHECK(strstr((const char *)HalOutput(), "No launch statistics") != NULL);
+    CHECK(Run((CONST_STRPTR)"LOADTIME SYS:C/ProjectX") == RETURN_OK);
+    CHECK(strstr((const char *)HalOutput(), "loadtime file=SYS:C/ProjectX ") != NULL);
+    HalDefIconsStart();
+}
+
+static VOID TestPrintTool(VOID)
+{
+    CHECK(Run((CONST_STRPTR)"System:Work/ReadMe.txt") == RETURN_OK);
+    CHECK_STR(HalOutput(), "SYS:Tools/Ed\n");
+
+    /* DefIcons by contents */
+    CHECK(Run((CONST_STRPTR)"System:Work/Picture") == RETURN_OK);
+    CHECK_STR(HalOutput(), "SYS:Utilities/MultiView\n");
+
+    /* Nothing DefIcons knows, but text */
+    CHECK(Run((CONST_STRPTR)"System:Work/Notes") == RETURN_OK);
+    CHECK_STR(HalOutput(), "SYS:Tools/Ed\n");
+
+    CHECK(Run((CONST_STRPTR)"System:Work/Blob") == RETURN_FAIL);
+    CHECK(strstr((const char *)HalOutput(), "Could not identify") != NULL);
+
+    CHECK(Run((CONST_STRPTR)"System:Work/Missing") == RETURN_FAIL);
+    CHECK(HalLaunchCount(HAL_LAUNCH_WORKBENCH) == 0);
+}
+
+static VOID TestOpen(VOID)
+{
+    struct HalLaunch *launch;
+    LONG before = HalLaunchCount(HAL_LAUNCH_WORKBENCH);
+
+    CHECK(Run((CONST_STRPTR)"System:Work/Picture OPEN") == RETURN_OK);
+    CHECK(HalLaunchCount(HAL_LAUNCH_WORKBENCH) == before + 1);
+    launch = HalLastLaunch(HAL_LAUNCH_WORKBENCH);
+    CHECK(launch != NULL);
+    if (launch != NULL) {
+        CHECK_STR(launch->hl_Tool, "SYS:Utilities/MultiView");
+        CHECK_STR(launch->hl_Args, "Picture");
+        CHECK(launch->hl_NumArgs == 1);
+    }
+}
+
+static VOID TestWorkbench(VOID)
+{
+    struct HalLaunch *launch;
+    LONG locks = HalOpenLocks();
+    LONG before = HalLaunchCount(HAL_LAUNCH_WORKBENCH);
+
+    /* A project icon with ProjectX as its default tool, double-clicked */
+    HalRunWorkbench((CONST_STRPTR)PROJECTX, (CONST_STRPTR)"System:Work", (CONST_STRPTR)"ReadMe.txt");
+    CHECK(HalOpenLocks() == locks);
+    CHECK(HalLiveProcesses() == 0);
+    CHECK(HalLaunchCount(HAL_LAUNCH_WORKBENCH) == before + 1);
+    launch = HalLastLaunch(HAL_LAUNCH_WORKBENCH);
+    if (launch != NULL) {
+        CHECK_STR(launch->hl_Tool, "SYS:Tools/Ed");
+        CHECK_STR(launch->hl_Args, "ReadMe.txt");
+    }
+    CHECK(halDialogs == NULL);
+}
+
+/* Three projects selected together are identified as one batch before any launch */
+static VOID TestBatch(VOID)
+{
+    LONG locks = HalOpenLocks();
+    LONG before = HalLaunchCount(HAL_LAUNCH_WORKBENCH);
+    ULONG start;
+
+    HalResetCounters();
+    start = HalMicros();
+    HalRunWorkbench((CONST_STRPTR)PROJECTX, (CONST_STRPTR)"System:Work",
+                    (CONST_STRPTR)"ReadMe.txt\nPicture\nNotes");
+    CHECK(HalOpenLocks() == locks);
+    CHECK(HalLiveProcesses() == 0);
+    CHECK(HalLaunchCount(HAL_LAUNCH_WORKBENCH) == before + 3);
+
+    /* DefIcons sees each file once, and answers them one after the other */
+    CHECK(halCounters.hc_Identifies == 3);
+    CHECK(HalMicros() - start >= 3 * 2000);
+
+    /* ProjectX, and the one worker that every engine's job went to */
+    CHECK(halCounters.hc_Processes == 2);
+}
+
+static VOID TestLatency(VOID)
+{
+    static const struct HalLatency floppy = { 20000, 30000, 15000, 25000, 60000, 12 };
+    ULONG start;
+    ULONG local;
+    ULONG slow;
+
+    HalAddVolume((CONST_STRPTR)"Floppy", &floppy);
+    HalWriteFile((CONST_STRPTR)"Floppy:ReadMe.txt", "Hello\n", 6, 0);
+
+    start = HalMicros();
+    CHECK(Run((CONST_STRPTR)"System:Work/ReadMe.txt") == RETURN_OK);
+    local = HalMicros() - start;
+    start = HalMicros();
+    HalResetCounters();
+    CHECK(Run((CONST_STRPTR)"Floppy:ReadMe.txt") == RETURN_OK);
+    slow = HalMicros() - start;
+    CHECK_STR(HalOutput(), "SYS:Tools/Ed\n");
+    CHECK(slow > local);
+    CHECK(halCounters.hc_Identifies == 1);
+    CHECK(halCounters.hc_LoadSegs == 1);
+}
+
+/* Each run adds its own timings to the volumes file, read again under its lock file */
+static VOID TestVolumes(VOID)
+{
+    CHECK(Run((CONST_STRPTR)"STATS") == RETURN_OK);
+    CHECK(strstr((const char *)HalOutput(), "volume=Floppy policy=SNIFF override=no stage=no mean_ms=") != NULL);
+    CHECK(strstr((const char *)HalOutput(), " samples=1\n") != NULL);
+
+    CHECK(Run((CONST_STRPTR)"Floppy:ReadMe.txt") == RETURN_OK);
+    CHECK(Run((CONST_STRPTR)"Floppy:ReadMe.txt") == RETURN_OK);
+    CHECK(Run((CONST_STRPTR)"STATS") == RETURN_OK);
+    CHECK(strstr((const char *)HalOutput(), " samples=3\n") != NULL);
+    CHECK(HalExists((CONST_STRPTR)"ENV:ProjectX/Volumes.lock"));
+    CHECK(!HalExists((CONST_STRPTR)"ENV:ProjectX/Volumes.new"));
+}
+
+/* DefIcons stuck past the deadline - ProjectX guesses and ends, the worker is */
+/* left to the reaper, which makes it quit once it has caught up */
+static VOID TestStalled(VOID)
+{
+    LONG locks = HalOpenLocks();
+    ULONG start;
+
+    HalIconLatency(3000, 5000000);
+    HalResetCounters();
+    HalClearOutput();
+    start = HalMicros();
+    CHECK(HalRun((CONST_STRPTR)PROJECTX, (CONST_STRPTR)"System:Work/ReadMe.txt") == RETURN_OK);
+    CHECK(HalMicros() - start < 5000000);
+    CHECK_STR(HalOutput(), "SYS:Tools/Ed\n");
+
+    /* ProjectX, the worker and the reaper */
+    HalSettle(10 * 1000000UL);
+    HalReap();
+    CHECK(halCounters.hc_Processes == 3);
+    CHECK(HalLiveProcesses() == 0);
+    CHECK(HalOpenLocks() == locks);
+    HalIconLatency(3000, 2000);
+}
+
+/* Examines in a run resolving ReadMe.txt, whose type is already cached */
+static ULONG CachedExamines(VOID)
+{
+    HalResetCounters();
+    CHECK(Run((CONST_STRPTR)"System:Work/ReadMe.txt") == RETURN_OK);
+    return halCounters.hc_Examines;
+}
+
+/* The def_ icons are only probed after their drawer has a new datestamp */
+static VOID TestResolveCache(VOID)
+{
+    ULONG warm;
+
+    CachedExamines();
+    warm = CachedExamines();
+    CHECK_STR(HalOutput(), "SYS:Tools/Ed\n");
+
+    /* Another icon saved in ENVARC:Sys - both icons of each cached type are probed once */
+    HalSpend(1000000);
+    HalWriteIcon((CONST_STRPTR)"ENVARC:Sys/def_iff", WBPROJECT, (CONST_STRPTR)"SYS:Utilities/MultiView", NULL, 512);
+    CHECK(CachedExamines() >= warm + 4);
+    CHECK(CachedExamines() == warm);
+
+    /* A new default tool saved over the ascii icons is seen on the next run */
+    HalSpend(1000000);
+    HalWriteFile((CONST_STRPTR)"SYS:Tools/MoreEd", "tool", 4, 0);
+    HalWriteIcon((CONST_STRPTR)"ENV:Sys/def_ascii", WBPROJECT, (CONST_STRPTR)"SYS:Tools/MoreEd", NULL, 300);
+    HalWriteIcon((CONST_STRPTR)"ENVARC:Sys/def_ascii", WBPROJECT, (CONST_STRPTR)"SYS:Tools/MoreEd", NULL, 300);
+    CHECK(Run((CONST_STRPTR)"System:Work/ReadMe.txt") == RETURN_OK);
+    CHECK_STR(HalOutput(), "SYS:Tools/MoreEd\n");
+    CHECK(CachedExamines() == warm);
+}
+
+int main(void)
+{
+    MakeWorld();
+    RUN(TestNoDefIcons);
+    RUN(TestPrintTool);
+    RUN(TestOpen);
+    RUN(TestWorkbench);
+    RUN(TestBatch);
+    RUN(TestLatency);
+    RUN(TestVolumes);
+    RUN(TestStalled);
+    RUN(TestResolveCache);
+    return TestSummary("test_projectx");
+}
@@ -0,0 +1,245 @@
+/*
+ * test_route.c - routing to a running instance, against stand-in tools
+ *
+ * Copyright (c) 2025 amigazen project
+ * Licensed under BSD 2-Clause License
+ *
+ * Two stand-in tools run as processes with a public port each: Viewer takes
+ * ARexx commands and Painter takes AppMessages. Each can be told to accept a
+ * file, refuse it, or reply only after ProjectX has given up waiting. The
+ * checks are on what the tool received, on whether ProjectX fell back to
+ * Workbench, and on the late reply being freed by the reaper.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hal.h"
+#include "test.h"
+
+int projectx_main(int argc, char *argv[]);
+
+#define PROJECTX "SYS:C/ProjectX"
+#define VIEWER   "SYS:Tools/Viewer"
+#define PAINTER  "SYS:Tools/Painter"
+
+/* The running instances - a fresh launch of the tool is only recorded */
+#define VIEWER_SERVER  "SYS:Servers/Viewer"
+#define PAINTER_SERVER "SYS:Servers/Painter"
+
+/* How a stand-in tool answers */
+#define SERVER_ACCEPT 0
+#define SERVER_REFUSE 1
+#define SERVER_LATE   2                     /* After ProjectX's ROUTE_TIMEOUT has passed */
+
+#define SERVER_LATE_TICKS (50 * 8)
+
+struct Server {
+    CONST_STRPTR sv_Path;
+    CONST_STRPTR sv_Port;
+    struct Process *sv_Process;
+    ULONG sv_Signal;
+    LONG sv_Mode;
+    LONG sv_Messages;                       /* Messages received */
+    LONG sv_Replies;                        /* Messages replied */
+    UBYTE sv_Last[256];                     /* ARexx command, or the AppMessage's file */
+};
+
+static struct Server viewer = { (CONST_STRPTR)VIEWER_SERVER, (CONST_STRPTR)"VIEWER.1", NULL, 0, 0, 0, 0, "" };
+static struct Server painter = { (CONST_STRPTR)PAINTER_SERVER, (CONST_STRPTR)"PAINTER", NULL, 0, 0, 0, 0, "" };
+
+/* Take messages on a public port until CTRL-C - Viewer or Painter by the command name */
+static int ServerMain(int argc, char *argv[])
+{
+    struct Server *server = (argc > 0 && strcmp(argv[0], PAINTER_SERVER) == 0) ? &painter : &viewer;
+    struct MsgPort *port = CreateMsgPort();
+    struct Message *message;
+    struct RexxMsg *rexxMsg;
+    struct AppMessage *appMsg;
+    ULONG signals;
+
+    if (port == NULL) {
+        return RETURN_FAIL;
+    }
+    port->mp_Node.ln_Name = (char *)server->sv_Port;
+    AddPort(port);
+
+    for (;;) {
+        signals = Wait((1UL << port->mp_SigBit) | SIGBREAKF_CTRL_C);
+        while ((message = GetMsg(port)) != NULL) {
+            server->sv_Messages++;
+            if (IsRexxMsg((struct RexxMsg *)message)) {
+                rexxMsg = (struct RexxMsg *)message;
+                snprintf((char *)server->sv_Last, sizeof(server->sv_Last), "%s", (char *)ARG0(rexxMsg));
+                rexxMsg->rm_Result1 = (server->sv_Mode == SERVER_REFUSE) ? RC_ERROR : RC_OK;
+            } else {
+                appMsg = (struct AppMessage *)message;
+                snprintf((char *)server->sv_Last, sizeof(server->sv_Last), "%s",
+                         (char *)appMsg->am_ArgList[0].wa_Name);
+            }
+            if (server->sv_Mode == SERVER_LATE) {
+                Delay(SERVER_LATE_TICKS);
+            }
+            ReplyMsg(message);
+            server->sv_Replies++;
+        }
+        if (signals & SIGBREAKF_CTRL_C) {
+            break;
+        }
+    }
+
+    RemPort(port);
+    DeleteMsgPort(port);
+    return RETURN_OK;
+}
+
+static VOID StartServer(struct Server *server, LONG mode)
+{
+    LONG signal = AllocSignal(-1);
+
+    server->sv_Mode = mode;
+    server->sv_Messages = 0;
+    server->sv_Replies = 0;
+    server->sv_Last[0] = '\0';
+    server->sv_Signal = 1UL << signal;
+    server->sv_Process = HalStartCommand(LoadSeg(server->sv_Path), server->sv_Path, (CONST_STRPTR)"\n",
+                                         Output(), FindTask(NULL), server->sv_Signal);
+    HalSettle(0);
+    CHECK(FindPort(server->sv_Port) != NULL);
+}
+
+static VOID StopServer(struct Server *server)
+{
+    Signal((struct Task *)server->sv_Process, SIGBREAKF_CTRL_C);
+    CHECK(HalWaitCommand(server->sv_Process, server->sv_Signal) == RETURN_OK);
+    SetSignal(0, server->sv_Signal);
+    FreeSignal(__builtin_ctzl(server->sv_Signal));
+    HalReap();
+    CHECK(FindPort(server->sv_Port) == NULL);
+}
+
+static VOID MakeWorld(VOID)
+{
+    static const UBYTE ilbm[] = "FORM\0\0\0\x40ILBMBMHD\0\0\0\x14";
+    static const char routes[] =
+        "; Tools that take files while running\n"
+        "Viewer AREXX VIEWER.#?\n"
+        "Painter APPMSG PAINTER\n";
+
+    HalInit();
+    HalAddProgram((CONST_STRPTR)PROJECTX, projectx_main);
+    HalAddProgram((CONST_STRPTR)VIEWER_SERVER, ServerMain);
+    HalAddProgram((CONST_STRPTR)PAINTER_SERVER, ServerMain);
+    HalWriteFile((CONST_STRPTR)VIEWER, "tool", 4, 0);
+    HalWriteFile((CONST_STRPTR)PAINTER, "tool", 4, 0);
+    HalWriteIcon((CONST_STRPTR)"ENV:Sys/def_ascii", WBPROJECT, (CONST_STRPTR)VIEWER, NULL, 256);
+    HalWriteIcon((CONST_STRPTR)"ENV:Sys/def_ilbm", WBPROJECT, (CONST_STRPTR)PAINTER, NULL, 512);
+    HalDefIconsRule((CONST_STRPTR)"#?.txt", NULL, (CONST_STRPTR)"ascii");
+    HalDefIconsRule(NULL, (CONST_STRPTR)"FORM", (CONST_STRPTR)"ilbm");
+    HalDefIconsStart();
+    HalWriteFile((CONST_STRPTR)"ENV:ProjectX/Routes", routes, sizeof(routes) - 1, 0);
+
+    HalWriteFile((CONST_STRPTR)"System:Work/ReadMe.txt", "Hello\n", 6, 0);
+    HalWriteFile((CONST_STRPTR)"System:Work/Picture", ilbm, sizeof(ilbm) - 1, 0);
+}
+
+/* Open a file, and count the Workbench launches it fell back to */
+static LONG OpenFile(CONST_STRPTR file)
+{
+    UBYTE arguments[256];
+    LONG before = HalLaunchCount(HAL_LAUNCH_WORKBENCH);
+
+    snprintf((char *)arguments, sizeof(arguments), "%s OPEN", (const char *)file);
+    CHECK(HalRun((CONST_STRPTR)PROJECTX, arguments) == RETURN_OK);
+    return HalLaunchCount(HAL_LAUNCH_WORKBENCH) - before;
+}
+
+static VOID TestNotRunning(VOID)
+{
+    CHECK(OpenFile((CONST_STRPTR)"System:Work/ReadMe.txt") == 1);
+    CHECK(OpenFile((CONST_STRPTR)"System:Work/Picture") == 1);
+}
+
+static VOID TestAccept(VOID)
+{
+    LONG locks = HalOpenLocks();
+    ULONG memory = HalMemoryUsed();
+
+    StartServer(&viewer, SERVER_ACCEPT);
+    CHECK(OpenFile((CONST_STRPTR)"System:Work/ReadMe.txt") == 0);
+    CHECK(viewer.sv_Messages == 1);
+    CHECK_STR(viewer.sv_Last, "OPEN \"System:Work/ReadMe.txt\"");
+    StopServer(&viewer);
+
+    StartServer(&painter, SERVER_ACCEPT);
+    CHECK(OpenFile((CONST_STRPTR)"System:Work/Picture") == 0);
+    CHECK(painter.sv_Messages == 1);
+    CHECK_STR(painter.sv_Last, "Picture");
+    StopServer(&painter);
+
+    CHECK(HalOpenLocks() == locks);
+    CHECK(HalMemoryUsed() == memory);
+}
+
+static VOID TestRefuse(VOID)
+{
+    LONG locks = HalOpenLocks();
+    ULONG memory = HalMemoryUsed();
+
+    StartServer(&viewer, SERVER_REFUSE);
+    CHECK(OpenFile((CONST_STRPTR)"System:Work/ReadMe.txt") == 1);
+    CHECK(viewer.sv_Messages == 1);
+    CHECK(viewer.sv_Replies == 1);
+    StopServer(&viewer);
+
+    CHECK(HalOpenLocks() == locks);
+    CHECK(HalMemoryUsed() == memory);
+}
+
+/* ProjectX gives up, launches the tool anew and leaves the reply to the reaper */
+static VOID TestLate(struct Server *server, CONST_STRPTR file)
+{
+    LONG locks = HalOpenLocks();
+    ULONG memory = HalMemoryUsed();
+    ULONG start;
+
+    StartServer(server, SERVER_LATE);
+    start = HalMicros();
+    CHECK(OpenFile(file) == 1);
+    CHECK(HalMicros() - start < SERVER_LATE_TICKS * 20000UL);
+    CHECK(server->sv_Messages == 1);
+    CHECK(server->sv_Replies == 0);
+
+    /* ProjectX is gone, the reaper waits on */
+    CHECK(HalLiveProcesses() == 2);
+    HalSettle(SERVER_LATE_TICKS * 20000UL);
+    CHECK(server->sv_Replies == 1);
+    HalReap();
+    CHECK(HalLiveProcesses() == 1);
+    StopServer(server);
+
+    CHECK(HalOpenLocks() == locks);
+    CHECK(HalMemoryUsed() == memory);
+}
+
+static VOID TestLateRexx(VOID)
+{
+    TestLate(&viewer, (CONST_STRPTR)"System:Work/ReadMe.txt");
+}
+
+static VOID TestLateAppMessage(VOID)
+{
+    TestLate(&painter, (CONST_STRPTR)"System:Work/Picture");
+}
+
+int main(void)
+{
+    MakeWorld();
+    RUN(TestNotRunning);
+    RUN(TestAccept);
+    RUN(TestRefuse);
+    RUN(TestLateRexx);
+    RUN(TestLateAppMessage);
+    return TestSummary("test_route");
+}
@@ -0,0 +1,298 @@
+/*
+ * memtrack.h - memory and stack accounting for the MEMTRACK debug builds
+ *
+ * Copyright (c) 2025 amigazen project
+ * Licensed under BSD 2-Clause License
+ *
+ * Included by projectx.c and appx.c when built with DEFINE=MEMTRACK
+ * (smake memtrack). Every AllocVec, AllocMem, AllocDosObject and icon
+ * allocation made by the program goes through the wrappers below, which
+ * keep current and peak bytes and allocation counts per phase. The unused
+ * part of the stack is filled with a pattern at startup so the high-water
+ * mark can be found at exit. Processes the program starts are counted
+ * with the stack they were given. One report per run is appended to
+ * MEMTRACK_FILE, with the peak and stack use checked against budgets.
+ *
+ * The including file defines MEMTRACK_FILE, MEMTRACK_PEAK_BUDGET and
+ * MEMTRACK_STACK_BUDGET before including this header.
+ */
+
+#ifndef MEMTRACK_H
+#define MEMTRACK_H
+
+/* In the host build a ULONG or a pointer takes eight bytes, and the library */
+/* stand-ins run on the program's stack with larger frames, so the budgets grow */
+#if defined(__SASC) || defined(AMIGA)
+#define MEMTRACK_PEAK_LIMIT   MEMTRACK_PEAK_BUDGET
+#define MEMTRACK_STACK_LIMIT  MEMTRACK_STACK_BUDGET
+#else
+#define MEMTRACK_PEAK_LIMIT   (MEMTRACK_PEAK_BUDGET * 2)
+#define MEMTRACK_STACK_LIMIT  (MEMTRACK_STACK_BUDGET * 3)
+#endif
+
+#define MEMTRACK_PHASES   8
+#define MEMTRACK_OBJECTS  32
+#define MEMTRACK_PATTERN  0xDEADF00DUL
+
+struct MemPhase {
+    STRPTR mp_Name;
+    ULONG mp_Allocs;                        /* Allocations made in this phase */
+    ULONG mp_Bytes;                         /* Bytes allocated in this phase */
+    ULONG mp_Peak;                          /* Highest current bytes seen in this phase */
+};
+
+/* Objects whose size is not known when they are freed (DOS objects, icons) */
+struct MemObject {
+    APTR mo_Address;
+    ULONG mo_Size;
+};
+
+static struct MemPhase memPhases[MEMTRACK_PHASES];
+static struct MemObject memObjects[MEMTRACK_OBJECTS];
+static LONG memPhaseCount = 0;
+static LONG memPhase = 0;
+static ULONG memCurrent = 0;
+static ULONG memPeak = 0;
+static ULONG memAllocs = 0;
+static ULONG *memStackLow = NULL;           /* Lowest longword filled with the pattern */
+static ULONG *memStackTop = NULL;           /* Stack pointer when tracking started */
+static ULONG memProcesses = 0;              /* Processes started, such as identify workers */
+static ULONG memProcessStack = 0;           /* Stack bytes given to them, not part of the peak */
+
+/* Switch to the named phase, creating it on first use */
+static VOID MemTrackPhase(STRPTR name)
+{
+    LONG i;
+
+    for (i = 0; i < memPhaseCount; i++) {
+        if (strcmp((char *)memPhases[i].mp_Name, (char *)name) == 0) {
+            memPhase = i;
+            return;
+        }
+    }
+    if (memPhaseCount < MEMTRACK_PHASES) {
+        memPhases[memPhaseCount].mp_Name = name;
+        memPhase = memPhaseCount++;
+    }
+}
+
+static VOID MemTrackAdd(APTR address, ULONG size)
+{
+    struct MemPhase *phase = &memPhases[memPhase];
+
+    if (address == NULL) {
+        return;
+    }
+    memAllocs++;
+    memCurrent += size;
+    if (memCurrent > memPeak) {
+        memPeak = memCurrent;
+    }
+    phase->mp_Allocs++;
+    phase->mp_Bytes += size;
+    if (memCurrent > phase->mp_Peak) {
+        phase->mp_Peak = memCurrent;
+    }
+}
+
+/* Count a process started with the given stack size */
+static VOID MemTrackProcess(ULONG stackSize)
+{
+    memProcesses++;
+    memProcessStack += stackSize;
+}
+
+static VOID MemTrackRemove(ULONG size)
+{
+    memCurrent = (size <= memCurrent) ? memCurrent - size : 0;
+}
+
+static VOID MemTrackObject(APTR address, ULONG size)
+{
+    LONG i;
+
+    MemTrackAdd(address, size);
+    for (i = 0; address != NULL && i < MEMTRACK_OBJECTS; i++) {
+        if (memObjects[i].mo_Address == NULL) {
+            memObjects[i].mo_Address = address;
+            memObjects[i].mo_Size = size;
+            break;
+        }
+    }
+}
+
+static VOID MemTrackObjectFreed(APTR address)
+{
+    LONG i;
+
+    for (i = 0; address != NULL && i < MEMTRACK_OBJECTS; i++) {
+        if (memObjects[i].mo_Address == address) {
+            MemTrackRemove(memObjects[i].mo_Size);
+            memObjects[i].mo_Address = NULL;
+            break;
+        }
+    }
+}
+
+static APTR MemAllocVec(ULONG size, ULONG flags)
+{
+    APTR memory = AllocVec(size, flags);
+
+    MemTrackAdd(memory, size);
+    return memory;
+}
+
+static VOID MemFreeVec(APTR memory)
+{
+    if (memory != NULL) {
+        /* AllocVec() keeps the allocation size, including itself, in the longword before */
+        MemTrackRemove(((ULONG *)memory)[-1] - sizeof(ULONG));
+        FreeVec(memory);
+    }
+}
+
+static APTR MemAllocMem(ULONG size, ULONG flags)
+{
+    APTR memory = AllocMem(size, flags);
+
+    MemTrackAdd(memory, size);
+    return memory;
+}
+
+static VOID MemFreeMem(APTR memory, ULONG size)
+{
+    if (memory != NULL) {
+        MemTrackRemove(size);
+        FreeMem(memory, size);
+    }
+}
+
+static APTR MemAllocDosObject(ULONG type, struct TagItem *tags)
+{
+    APTR object = AllocDosObject(type, tags);
+
+    MemTrackObject(object, type == DOS_FIB ? sizeof(struct FileInfoBlock) : 0);
+    return object;
+}
+
+static VOID MemFreeDosObject(ULONG type, APTR object)
+{
+    MemTrackObjectFreed(object);
+    FreeDosObject(type, object);
+}
+
+/* icon.library does not say how much an icon took, so it is measured from free memory */
+static struct DiskObject *MemGetDiskObject(CONST_STRPTR name)
+{
+    ULONG before = AvailMem(MEMF_ANY);
+    struct DiskObject *icon = GetDiskObject(name);
+    ULONG after = AvailMem(MEMF_ANY);
+
+    MemTrackObject(icon, before > after ? before - after : 0);
+    return icon;
+}
+
+static struct DiskObject *MemGetIconTagList(CONST_STRPTR name, struct TagItem *tags)
+{
+    ULONG before = AvailMem(MEMF_ANY);
+    struct DiskObject *icon = GetIconTagList(name, tags);
+    ULONG after = AvailMem(MEMF_ANY);
+
+    MemTrackObject(icon, before > after ? before - after : 0);
+    return icon;
+}
+
+static VOID MemFreeDiskObject(struct DiskObject *icon)
+{
+    MemTrackObjectFreed(icon);
+    FreeDiskObject(icon);
+}
+
+/* Start tracking - fill the unused stack below the caller with the pattern */
+static VOID MemTrackBegin(VOID)
+{
+    struct Task *task = FindTask(NULL);
+    ULONG marker;
+    ULONG *sp = &marker;
+    ULONG *low = (ULONG *)task->tc_SPLower;
+    ULONG *fill;
+
+    /* Nothing carries over from an earlier run of a resident copy */
+    memset(memPhases, 0, sizeof(memPhases));
+    memset(memObjects, 0, sizeof(memObjects));
+    memPhaseCount = 0;
+    memCurrent = 0;
+    memPeak = 0;
+    memAllocs = 0;
+    memStackLow = NULL;
+    memStackTop = NULL;
+    memProcesses = 0;
+    memProcessStack = 0;
+    MemTrackPhase("startup");
+
+    /* RunCommand() and StackSwap() keep these up to date, so anything else is no stack we know */
+    if (sp < low || sp > (ULONG *)task->tc_SPUpper) {
+        return;
+    }
+
+    memStackTop = sp;
+    memStackLow = low;
+
+    /* Leave room for this frame and for the registers saved on a task switch */
+    for (fill = low; fill < sp - 64; fill++) {
+        *fill = MEMTRACK_PATTERN;
+    }
+}
+
+/* Append the report for this run to MEMTRACK_FILE */
+static VOID MemTrackDump(VOID)
+{
+    ULONG *scan;
+    ULONG stackUsed = 0;
+    LONG i;
+    BPTR file;
+
+    if (memStackLow != NULL) {
+        for (scan = memStackLow; scan < memStackTop && *scan == MEMTRACK_PATTERN; scan++) {
+        }
+        stackUsed = (ULONG)((UBYTE *)memStackTop - (UBYTE *)scan);
+    }
+
+    file = Open(MEMTRACK_FILE, MODE_READWRITE);
+    if (file == NULL) {
+        return;
+    }
+    Seek(file, 0, OFFSET_END);
+
+    FPrintf(file, "memtrack peak=%lu peak_budget=%lu allocs=%lu leaked=%lu stack_used=%lu stack_budget=%lu "
+            "processes=%lu process_stack=%lu result=%s\n",
+            memPeak, (ULONG)MEMTRACK_PEAK_LIMIT, memAllocs, memCurrent,
+            stackUsed, (ULONG)MEMTRACK_STACK_LIMIT, memProcesses, memProcessStack,
+            (memPeak <= MEMTRACK_PEAK_LIMIT && stackUsed <= MEMTRACK_STACK_LIMIT &&
+             memCurrent == 0) ? "ok" : "over");
+    for (i = 0; i < memPhaseCount; i++) {
+        FPrintf(file, "phase=%s allocs=%lu bytes=%lu peak=%lu\n",
+                memPhases[i].mp_Name, memPhases[i].mp_Allocs,
+                memPhases[i].mp_Bytes, memPhases[i].mp_Peak);
+    }
+
+    Close(file);
+}
+
+/* Route the allocations below this point through the accounting wrappers */
+#define AllocVec(s, f)              MemAllocVec(s, f)
+#define FreeVec(m)                  MemFreeVec(m)
+#define AllocMem(s, f)              MemAllocMem(s, f)
+#define FreeMem(m, s)               MemFreeMem(m, s)
+#define AllocDosObject(t, g)        MemAllocDosObject(t, g)
+#define FreeDosObject(t, o)         MemFreeDosObject(t, o)
+#define GetDiskObject(n)            MemGetDiskObject(n)
+#define GetIconTagList(n, t)        MemGetIconTagList(n, t)
+#define FreeDiskObject(i)           MemFreeDiskObject(i)
+
+#define MEMTRACK_BEGIN()            MemTrackBegin()
+#define MEMTRACK_PHASE(name)        MemTrackPhase(name)
+#define MEMTRACK_PROCESS(stack)     MemTrackProcess(stack)
+#define MEMTRACK_DUMP()             MemTrackDump()
+
+#endif /* MEMTRACK_H */
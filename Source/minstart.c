@@ -0,0 +1,238 @@
+/*
+ * minstart.c - minimal startup for the ProjectX and AppX minimal builds
+ *
+ * Copyright (c) 2025 amigazen project
+ * Licensed under BSD 2-Clause License
+ *
+ * Linked first, in place of c.o or cback.o, by "smake minimal". It does
+ * only what the two programs need: clear BSS, open dos.library and
+ * utility.library (the compiler calls utility.library for 32-bit
+ * multiply and divide with UTILITYLIBRARY), fetch the WBStartup when run
+ * from Workbench, call main() as c.o would, and reply the WBStartup
+ * afterwards. No stdio, no exit() handling, no argv parsing - both
+ * programs read their arguments with ReadArgs().
+ *
+ * Built with DEFINE=MINSTART_BACKGROUND for AppX, it detaches from the
+ * shell as cback.o does: the shell's copy hands its own seglist to a new
+ * process with the same arguments and returns at once, so nothing is
+ * loaded from disk again. A resident copy, whose code is shared, starts
+ * itself by name as a background shell instead.
+ */
+
+#include <exec/types.h>
+#include <exec/execbase.h>
+#include <dos/dos.h>
+#include <dos/dosextens.h>
+#include <dos/dostags.h>
+#include <workbench/startup.h>
+#include <proto/exec.h>
+#include <proto/dos.h>
+
+/* Library bases c.o and sc.lib would otherwise provide */
+struct ExecBase *SysBase = NULL;
+struct DosLibrary *DOSBase = NULL;
+struct IntuitionBase *IntuitionBase = NULL;
+struct Library *IconBase = NULL;
+struct Library *WorkbenchBase = NULL;
+struct Library *UtilityBase = NULL;
+
+/* Set by slink: start of BSS in the merged near data hunk, and its length in longwords */
+extern ULONG __far _BSSBAS[];
+extern ULONG __far _BSSLEN;
+
+int main(int argc, char *argv[]);
+
+static LONG RunFromShell(VOID);
+#ifdef MINSTART_BACKGROUND
+static LONG StartInBackground(VOID);
+static BOOL IsResident(BPTR segList, STRPTR name);
+#endif
+
+/* Entry point - must stay the first function in the first object linked */
+LONG __saveds MinStart(VOID)
+{
+    struct Process *process;
+    struct WBStartup *wbs = NULL;
+    struct Library *utility;
+#ifdef MINSTART_BACKGROUND
+    struct CommandLineInterface *cli;
+#endif
+    ULONG *bss;
+    ULONG count;
+    LONG result;
+
+    /* Near data is addressed through A4, set up by __saveds; clear the BSS part */
+    bss = _BSSBAS;
+    for (count = (ULONG)&_BSSLEN; count > 0; count--) {
+        *bss++ = 0;
+    }
+
+    SysBase = *((struct ExecBase **)4L);
+    process = (struct Process *)FindTask(NULL);
+
+    /* Without a CLI we were started by Workbench, which sends a WBStartup first */
+    if (process->pr_CLI == NULL) {
+        WaitPort(&process->pr_MsgPort);
+        wbs = (struct WBStartup *)GetMsg(&process->pr_MsgPort);
+    }
+
+    DOSBase = (struct DosLibrary *)OpenLibrary("dos.library", 47L);
+    utility = OpenLibrary("utility.library", 47L);
+    UtilityBase = utility;
+
+    if (DOSBase == NULL || utility == NULL) {
+        result = RETURN_FAIL;
+    } else if (wbs != NULL) {
+        result = main(0, (char **)wbs);
+    } else {
+#ifdef MINSTART_BACKGROUND
+        cli = (struct CommandLineInterface *)BADDR(process->pr_CLI);
+        if (cli->cli_Module == NULL) {
+            /* The detached copy - its seglist came with the process, not from the shell */
+            SetTaskPri(&process->pr_Task, process->pr_Task.tc_Node.ln_Pri + 1);
+            result = RunFromShell();
+        } else if (!cli->cli_Background) {
+            result = StartInBackground();
+        } else {
+            result = RunFromShell();
+        }
+#else
+        result = RunFromShell();
+#endif
+    }
+
+    /* main() closes the bases it opened itself and clears UtilityBase */
+    if (utility != NULL) {
+        CloseLibrary(utility);
+    }
+    if (DOSBase != NULL) {
+        CloseLibrary((struct Library *)DOSBase);
+    }
+
+    /* Workbench unloads us once it has the reply, so nothing may run after it */
+    if (wbs != NULL) {
+        Forbid();
+        ReplyMsg((struct Message *)wbs);
+    }
+
+    return result;
+}
+
+/* Call main() as c.o does for a shell, with the command name as the only argument */
+static LONG RunFromShell(VOID)
+{
+    UBYTE programName[108];
+    char *argv[2];
+
+    programName[0] = '\0';
+    GetProgramName(programName, sizeof(programName));
+    argv[0] = (char *)programName;
+    argv[1] = NULL;
+
+    return main(1, argv);
+}
+
+#ifdef MINSTART_BACKGROUND
+/* Detach from the shell, as cback.o does */
+/* The new process gets our seglist and frees it when it ends. It starts one priority */
+/* below us, so it cannot run our code's BSS clear before we have returned to the shell */
+static LONG StartInBackground(VOID)
+{
+    struct Process *process = (struct Process *)FindTask(NULL);
+    struct CommandLineInterface *cli;
+    struct Process *child;
+    UBYTE command[512];
+    UBYTE name[108];
+    BPTR segList;
+    BPTR input;
+    BPTR output;
+    LONG length;
+    STRPTR arguments;
+
+    cli = (struct CommandLineInterface *)BADDR(process->pr_CLI);
+    if (!GetProgramName(name, sizeof(name))) {
+        return RETURN_FAIL;
+    }
+
+    input = Open("NIL:", MODE_OLDFILE);
+    output = Open("NIL:", MODE_NEWFILE);
+    if (input == NULL || output == NULL) {
+        if (input != NULL) {
+            Close(input);
+        }
+        if (output != NULL) {
+            Close(output);
+        }
+        return RETURN_FAIL;
+    }
+
+    /* The argument string ends with a newline, which ends the command line too */
+    arguments = GetArgStr();
+    segList = cli->cli_Module;
+
+    if (!IsResident(segList, FilePart(name))) {
+        /* The shell unloads cli_Module after the command, unless it has been cleared */
+        cli->cli_Module = NULL;
+        child = CreateNewProcTags(NP_Seglist, segList,
+                                  NP_FreeSeglist, TRUE,
+                                  NP_Cli, TRUE,
+                                  NP_Name, FilePart(name),
+                                  NP_Arguments, arguments,
+                                  NP_Input, input,
+                                  NP_Output, output,
+                                  NP_StackSize, cli->cli_DefaultStack * 4,
+                                  NP_Priority, process->pr_Task.tc_Node.ln_Pri - 1,
+                                  TAG_DONE);
+        if (child == NULL) {
+            cli->cli_Module = segList;
+            Close(input);
+            Close(output);
+            return RETURN_FAIL;
+        }
+        return RETURN_OK;
+    }
+
+    /* Resident - the shell finds the same code again by its name */
+    Close(output);
+    length = 0;
+    for (arguments = FilePart(name); *arguments != '\0' && length < sizeof(command) - 2; arguments++) {
+        command[length++] = *arguments;
+    }
+    command[length++] = ' ';
+    for (arguments = GetArgStr(); arguments != NULL && *arguments != '\0' && length < sizeof(command) - 1; arguments++) {
+        command[length++] = *arguments;
+    }
+    command[length] = '\0';
+
+    /* Asynchronous - the new shell closes its input when it ends */
+    if (SystemTags(command,
+                   SYS_Input, input,
+                   SYS_Output, NULL,
+                   SYS_Asynch, TRUE,
+                   TAG_DONE) == -1) {
+        Close(input);
+        return RETURN_FAIL;
+    }
+
+    return RETURN_OK;
+}
+
+/* Whether a seglist is the resident command of that name, shared with every shell running it */
+static BOOL IsResident(BPTR segList, STRPTR name)
+{
+    struct Segment *segment;
+    LONG system;
+    BOOL resident = FALSE;
+
+    Forbid();
+    for (system = 0; system <= 1 && !resident; system++) {
+        segment = FindSegment(name, NULL, system);
+        if (segment != NULL && segment->seg_Seg == segList) {
+            resident = TRUE;
+        }
+    }
+    Permit();
+
+    return resident;
+}
+#endif
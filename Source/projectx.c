@@ -30,12 +30,33 @@
 #include <proto/input.h>
 #include <devices/input.h>
 #include <devices/inputevent.h>
+#include <devices/timer.h>
+#include <proto/timer.h>
 #include <dos/rdargs.h>
+#include <dos/exall.h>
+#include <exec/semaphores.h>
 #include <dos/dostags.h>
+#include <rexx/storage.h>
+#include <rexx/rxslib.h>
+#include <proto/rexxsyslib.h>
 #include <string.h>
-#include <stdlib.h>
 #include <stdarg.h>
 
+#include "pxcore.h"
+
+#ifdef MEMTRACK
+/* Memory accounting build (smake memtrack) */
+#define MEMTRACK_FILE         "T:ProjectX.memory"
+#define MEMTRACK_PEAK_BUDGET  32768         /* Bytes, leaves room for the tool on 2 MB machines */
+#define MEMTRACK_STACK_BUDGET 3072          /* Bytes, of the 4096 asked for by $STACK */
+#include "memtrack.h"
+#else
+#define MEMTRACK_BEGIN()
+#define MEMTRACK_PHASE(name)
+#define MEMTRACK_PROCESS(stack)
+#define MEMTRACK_DUMP()
+#endif
+
 /* Library base pointers */
 extern struct ExecBase *SysBase;
 extern struct DosLibrary *DOSBase;
@@ -46,16 +67,491 @@ extern struct Library *UtilityBase;
 struct MsgPort *InputPort = NULL;
 struct IOStdReq *InputIO = NULL;
 struct Library *InputBase = NULL;
+struct timerequest *TimerIO = NULL;
+struct Device *TimerBase = NULL;
+
+/* E-clock ticks per second, set by the first ReadTimer() */
+static ULONG eclockFrequency = 0;
 
 /* Reaction class library bases */
 struct ClassLibrary *RequesterBase = NULL;
 
+/* rexxsyslib.library - opened on demand for ARexx routing */
+struct RxsLib *RexxSysBase = NULL;
+
 /* Reaction class handles */
 Class *RequesterClass = NULL;
 
 /* Log file handle */
 static BPTR logFile = NULL;
 
+/* Routing rules file - hands files to an already running tool instance */
+#define ROUTES_FILE "ENV:ProjectX/Routes"
+
+/* Routing methods */
+#define ROUTE_AREXX  1
+#define ROUTE_APPMSG 2
+
+#define ROUTE_TIMEOUT 5000           /* Milliseconds for a reply before launching normally */
+
+/* One routing rule from the routes file */
+struct ToolRoute {
+    struct ToolRoute *tr_Next;
+    UBYTE tr_Method;             /* ROUTE_AREXX or ROUTE_APPMSG */
+    UBYTE tr_Tool[64];           /* Tool name, matched against the default tool */
+    UBYTE tr_Port[64];           /* Public port name, may contain wildcards */
+    UBYTE tr_Command[256];       /* ARexx command template, %s is the file path */
+};
+
+static struct ToolRoute *toolRoutes = NULL;
+static BOOL routesLoaded = FALSE;
+
+/* A routed message the running instance did not reply to in time, with its reply port */
+static struct Message *routePending = NULL;
+static struct MsgPort *routePort = NULL;
+static UBYTE routeMethod = 0;
+
+/* Identification engine - one way of getting a type identifier for a file */
+/* Engines fill the caller's typeBuffer of IDENTIFY_TYPE_SIZE bytes and return it, */
+/* or NULL if they have no answer. They keep no state of their own, as several */
+/* worker processes may run one at once. bytesRead gets the bytes of file content */
+/* read, -1 if not known. */
+#define IDENTIFY_TYPE_SIZE 64               /* As icon.library's identify buffer needs */
+
+struct IdentifyEngine {
+    STRPTR ie_Name;
+    STRPTR (*ie_Identify)(STRPTR fileName, BPTR fileLock, UBYTE *typeBuffer, LONG *bytesRead);
+};
+
+/* Text identification - files DefIcons does not know are checked for plain text */
+#define TEXT_HEADER_SIZE 512                /* Bytes classified from the start of the file */
+#define TEXT_BENCH_RUNS  4                  /* Passes of each kernel per file in the benchmark */
+
+/* Launch profile of a type, from STACK, PRI and CLI tooltypes in its def_ icon */
+#define PROFILE_STACK 0x01                  /* lp_Stack is set */
+#define PROFILE_PRI   0x02                  /* lp_Priority is set */
+#define PROFILE_CLI   0x04                  /* Start from a shell with lp_Cli as the arguments */
+
+struct LaunchProfile {
+    LONG lp_Stack;
+    BYTE lp_Priority;
+    UBYTE lp_Flags;                         /* PROFILE_ flags */
+    UBYTE lp_Cli[128];                      /* Argument template, %s is the file path */
+};
+
+/* Prefetch cache - published by the resident companion (ProjectX RESIDENT) */
+/* and checked by every ProjectX launch before any content is read */
+#define PREFETCH_SEMAPHORE "ProjectX.prefetch"
+
+struct PrefetchCache {
+    struct SignalSemaphore pc_Semaphore;    /* Public, found by name */
+    struct MinList pc_Entries;              /* Oldest first */
+    LONG pc_Count;
+    struct DrawerRules *pc_Rules;           /* Drawer rules shared by every ProjectX */
+    struct PatternRules *pc_Patterns;       /* Compiled global name rules */
+    struct MinList pc_Spares;               /* StandbyTools kept warm by the companion */
+    struct MsgPort *pc_LaunchPort;          /* Takes the replies of direct launches */
+    LONG pc_Launches;                       /* Direct launches not yet replied */
+    UBYTE pc_Name[20];
+};
+
+/* One pre-identified file, the strings follow the structure in the same allocation */
+struct PrefetchEntry {
+    struct MinNode pe_Node;
+    ULONG pe_AllocSize;
+    struct DateStamp pe_Date;               /* File datestamp when identified */
+    LONG pe_Size;                           /* File size when identified */
+    STRPTR pe_Path;                         /* Full path of the file */
+    STRPTR pe_Type;                         /* Type identifier */
+    STRPTR pe_Tool;                         /* Default tool, may be empty */
+    struct LaunchProfile pe_Profile;        /* Launch profile of the type */
+};
+
+/* Archive members - a path into an LhA or Zip archive stages just that member in RAM: */
+#define ARCHIVE_STAGE_DIR      "RAM:ProjectX-Archive"
+#define ARCHIVE_LHA_VAR        "ProjectX/LhA"       /* Archiver commands, default LhA and UnZip */
+#define ARCHIVE_UNZIP_VAR      "ProjectX/UnZip"
+#define ARCHIVE_MAX_MEMBER     (8UL * 1024 * 1024)
+#define ARCHIVE_MEMORY_RESERVE (512UL * 1024)       /* Free memory left after staging */
+#define ARCHIVE_STAGE_MINUTES  10                   /* Age before a staged member may be purged */
+#define ARCHIVE_PURGE_MAX      32
+#define ZIP_TAIL_SIZE          1024                 /* First look for the Zip end record here */
+#define ZIP_TAIL_MAX           (22 + 65535)         /* End record with the longest comment */
+
+/* RAM staging cache - files on volumes marked STAGE are launched from a copy in RAM: */
+#define STAGE_DIR         "RAM:ProjectX-Cache"
+#define STAGE_INDEX       "RAM:ProjectX-Cache/Index"
+#define STAGE_INDEX_TEMP  "RAM:ProjectX-Cache/Index.new"
+#define STAGE_INDEX_LOCK  "RAM:ProjectX-Cache/Index.lock"
+#define STAGE_MAGIC       0x50585347        /* 'PXSG' */
+#define STAGE_VERSION     1
+#define STAGE_MAX         32
+#define STAGE_BUDGET_VAR  "ProjectX/StageBudget"
+#define STAGE_BUDGET      4096              /* KB, when STAGE_BUDGET_VAR is not set */
+#define STAGE_CHUNK       65536             /* Bytes per read when copying */
+#define STAGE_PROTECTION  (FIBF_WRITE | FIBF_DELETE)  /* Staged copies are read-only */
+
+/* Lock files serialise the read-modify-write of files shared by several ProjectX */
+#define LOCK_FILE_TRIES   50                /* Two ticks apart, a second in all */
+
+struct StageHeader {
+    ULONG sgh_Magic;
+    UWORD sgh_Version;
+    UWORD sgh_Count;
+};
+
+/* One staged copy, kept in drawer s<slot> of STAGE_DIR under the source's name */
+struct StageRecord {
+    UBYTE sg_Path[256];                     /* Source file, empty for a free slot */
+    struct DateStamp sg_Date;               /* Source datestamp when copied */
+    LONG sg_Size;
+    struct DateStamp sg_Used;               /* Last launch from this copy */
+};
+
+/* Type memo - the identified type kept with the file, so a repeat open reads no content */
+#define MEMO_VAR      "ProjectX/Memo"       /* COMMENT or SIDECAR, no memos when not set */
+#define MEMO_PREFIX   "PX:"                 /* File comments starting with this are ours */
+#define MEMO_FILE     "ENV:ProjectX/Memo"   /* In ENV:, so memoing a file never writes to disk */
+#define MEMO_TEMP     "ENV:ProjectX/Memo.new"
+#define MEMO_LOCK     "ENV:ProjectX/Memo.lock"
+#define MEMO_ARCHIVE  "ENVARC:ProjectX/Memo" /* A copy kept there is read after a reboot */
+#define MEMO_MAGIC    0x50584D4D            /* 'PXMM' */
+#define MEMO_VERSION  1
+#define MEMO_MAX      32
+#define MEMO_TYPE_MAX 32                    /* Longer type identifiers are not memoed */
+
+/* Memo modes */
+#define MEMO_OFF     0
+#define MEMO_COMMENT 1                      /* In the file comment, the sidecar when it is in use */
+#define MEMO_SIDECAR 2                      /* Sidecar only, comments are left alone */
+
+struct MemoHeader {
+    ULONG mmh_Magic;
+    UWORD mmh_Version;
+    UWORD mmh_Count;
+};
+
+/* One sidecar memo, for a file whose comment is already in use */
+struct MemoRecord {
+    UBYTE mm_Path[256];                     /* Full path of the file, empty for a free slot */
+    struct DateStamp mm_Date;               /* File datestamp when identified */
+    LONG mm_Size;                           /* File size when identified */
+    UBYTE mm_Type[MEMO_TYPE_MAX];
+    struct DateStamp mm_Written;            /* The oldest memo is replaced when all slots are used */
+};
+
+/* Warm standby - the resident companion keeps one idle instance of selected tools */
+/* running, and ProjectX hands the next file for that tool to it through its route */
+#define STANDBY_FILE        "ENV:ProjectX/Standby"
+#define STANDBY_MINFREE     1024            /* KB free below which no spare is started */
+#define STANDBY_PRIORITY    -10             /* Spares load and wait at this priority */
+#define STANDBY_START_TICKS 30              /* Seconds to wait for a spare's port */
+#define STANDBY_RETRY_TICKS 60              /* Seconds before trying again after a failure */
+#define STANDBY_KNOWN_PORTS 8
+
+/* Spare states */
+#define SPARE_IDLE     0                    /* None running, start one when memory allows */
+#define SPARE_STARTING 1                    /* Started, waiting for its port to appear */
+#define SPARE_READY    2                    /* Idle and waiting for a file */
+#define SPARE_TAKEN    3                    /* Handed a file by ProjectX, to be replaced */
+
+/* One standby tool, in the companion's shared cache */
+struct StandbyTool {
+    struct MinNode st_Node;
+    UBYTE st_State;                         /* SPARE_IDLE ... SPARE_TAKEN */
+    LONG st_Ticks;                          /* Seconds in this state, negative while backing off */
+    LONG st_MinFree;                        /* KB */
+    UBYTE st_Tool[64];                      /* Tool name, matched like a route */
+    UBYTE st_PortPattern[64];               /* From the tool's route */
+    UBYTE st_Port[64];                      /* Port of the ready spare */
+    UBYTE st_Command[256];                  /* Command line that starts a spare */
+    UBYTE st_Known[STANDBY_KNOWN_PORTS][64]; /* Matching ports that existed before the start */
+};
+
+/* Direct launching - the tool is loaded and started by ProjectX, not by Workbench */
+#define LAUNCH_VAR        "ProjectX/Launch"  /* DIRECT or WORKBENCH, default DIRECT only without Workbench */
+#define LAUNCH_WB_PORT    "WORKBENCH"        /* Workbench's ARexx port, present while it runs */
+#define LAUNCH_MIN_STACK  4096
+
+/* One direct launch, from LoadSeg() until the WBStartup comes back */
+/* Allocated as one block, so whoever takes the reply can free it */
+struct DirectLaunch {
+    struct WBStartup dl_Startup;
+    struct WBArg dl_Args[2];                /* The tool, then the file */
+    UBYTE dl_ToolName[108];
+    UBYTE dl_FileName[108];
+    UBYTE dl_StagedPath[256];               /* An archive member only this tool uses, or empty */
+};
+
+/* Loads per executable timed by LOADTIME */
+#define LOADTIME_RUNS 10
+
+/* Launch waiting for its reply on our own port, when no companion takes it */
+static struct DirectLaunch *directPending = NULL;
+static struct MsgPort *directPort = NULL;
+
+/* Persistent resolution cache - type identifier to default tool, kept across reboots */
+#define RESOLVE_CACHE_DIR   "ENVARC:ProjectX"
+#define RESOLVE_CACHE_FILE  "ENVARC:ProjectX/Resolve.cache"
+#define RESOLVE_CACHE_TEMP  "ENVARC:ProjectX/Resolve.cache.new"
+#define RESOLVE_CACHE_MAGIC 0x50585243    /* 'PXRC' */
+#define RESOLVE_CACHE_VERSION 4
+#define RESOLVE_CACHE_MAX   64
+#define RESOLVE_BOOT_VAR    "ProjectX/ResolveBoot"  /* Set in ENV: only, so gone after a reboot */
+
+/* Cache file header, followed by the packed entries */
+struct ResolveCacheHeader {
+    ULONG rh_Magic;
+    UWORD rh_Version;
+    UWORD rh_Count;
+    struct DateStamp rh_ArcDirDate;         /* ENVARC:Sys datestamp when written */
+    struct DateStamp rh_EnvDirDate;         /* ENV:Sys datestamp when written */
+};
+
+/* Entry on disk, followed by the type, tool and CLI template strings (not terminated) */
+/* and a pad byte when their total length is odd, so every record starts word aligned */
+struct ResolveCacheRecord {
+    struct DateStamp rr_ArcDate;            /* ENVARC:Sys def_ icon datestamp */
+    struct DateStamp rr_EnvDate;            /* ENV:Sys def_ icon datestamp */
+    LONG rr_ArcSize;                        /* ENVARC:Sys def_ icon size, -1 if none */
+    LONG rr_EnvSize;                        /* ENV:Sys def_ icon size, -1 if none */
+    LONG rr_Stack;                          /* Launch profile from the def_ icon */
+    BYTE rr_Priority;
+    UBYTE rr_Flags;
+    UBYTE rr_TypeLength;
+    UBYTE rr_ToolLength;
+    UBYTE rr_CliLength;
+    UBYTE rr_Pad;
+};
+
+/* Entry in memory */
+struct ResolveEntry {
+    struct ResolveEntry *re_Next;
+    struct DateStamp re_ArcDate;
+    struct DateStamp re_EnvDate;
+    LONG re_ArcSize;
+    LONG re_EnvSize;
+    BOOL re_Checked;                        /* Validated during this run, or both Sys drawers unchanged */
+    UBYTE re_Type[64];
+    UBYTE re_Tool[256];
+    struct LaunchProfile re_Profile;
+};
+
+static struct ResolveEntry *resolveEntries = NULL;
+static BOOL resolveCacheLoaded = FALSE;
+static BOOL resolveCacheDirty = FALSE;
+static BOOL resolveDirsChanged = TRUE;     /* ENV:Sys or ENVARC:Sys changed since the cache was written */
+static BOOL resolveNewBoot = TRUE;          /* First run since ENV: was copied from ENVARC: */
+static BOOL resolveCacheHit = FALSE;        /* Last GetDefaultToolFromType() came from the cache */
+static struct LaunchProfile resolvedProfile; /* Launch profile of the last GetDefaultToolFromType() type */
+
+/* Launch statistics - counters and latency histograms per type and per tool */
+/* Kept in ENV: so gathering them never writes to disk; copy to ENVARC: to keep them */
+#define STATS_FILE      "ENV:ProjectX/Stats"
+#define STATS_TEMP      "ENV:ProjectX/Stats.new"
+#define STATS_LOCK      "ENV:ProjectX/Stats.lock"
+#define STATS_MAGIC     0x50585354          /* 'PXST' */
+#define STATS_VERSION   2
+#define STATS_MAX       64
+#define STATS_BUCKETS   16                  /* Bucket n counts latencies below CORE_BUCKET_BASE << n us */
+
+/* Statistics kinds */
+#define STATS_TYPE 1
+#define STATS_TOOL 2
+
+struct StatsHeader {
+    ULONG sh_Magic;
+    UWORD sh_Version;
+    UWORD sh_Count;
+};
+
+/* One type or tool, stored in the stats file as is */
+struct StatsRecord {
+    UBYTE sr_Kind;                          /* STATS_TYPE or STATS_TOOL */
+    UBYTE sr_Name[63];
+    ULONG sr_Launches;
+    ULONG sr_Errors;
+    ULONG sr_CacheHits;                     /* Tool known without reading a def_ icon */
+    ULONG sr_CacheMisses;
+    ULONG sr_Timeouts;                      /* Identification missed its deadline */
+    LONG sr_LastError;                      /* Last non-zero IoErr() of a failed launch */
+    ULONG sr_Resolve[STATS_BUCKETS];        /* Time from start to default tool known */
+    ULONG sr_Launch[STATS_BUCKETS];         /* Time spent routing or launching the tool */
+};
+
+static struct StatsRecord *statsRecords = NULL;
+static UWORD statsCount = 0;
+static BOOL statsDirty = FALSE;
+
+/* What this run added, merged into the file as it is when saving */
+static struct StatsRecord *statsAdded = NULL;
+static UWORD statsAddedCount = 0;
+
+/* Asynchronous identification - an engine runs in a worker process with a deadline, */
+/* so a stalled device cannot hang ProjectX. One worker is started per run and kept */
+/* for every later job, whichever engine it is for */
+#define IDENTIFY_TIMEOUT_VAR     "ProjectX/IdentifyTimeout"
+#define IDENTIFY_TIMEOUT_DEFAULT 3000       /* Milliseconds, 0 identifies synchronously */
+#define IDENTIFY_WORKER_STACK    16384
+
+/* One file of a job, answered by the worker */
+struct IdentifyJobFile {
+    LONG jf_Entry;                          /* Index in the caller's batch */
+    BPTR jf_Lock;                           /* Our own lock on the file's drawer */
+    STRPTR jf_Name;                         /* Follows the files in the same allocation */
+    ULONG jf_Micros;                        /* Time the engine took */
+    UBYTE jf_Type[IDENTIFY_TYPE_SIZE];      /* Result, empty if not identified */
+};
+
+struct IdentifyJob {
+    struct Message ij_Message;
+    STRPTR (*ij_Identify)(STRPTR, BPTR, UBYTE *, LONG *);
+    struct MsgPort *ij_WorkerPort;          /* Set in the reply while the worker waits for more */
+    LONG ij_Count;                          /* No files asks the worker to quit */
+    LONG ij_Done;                           /* Files answered so far, set by the worker */
+    struct IdentifyJobFile *ij_Files;       /* Follow the structure in the same allocation */
+};
+
+static struct MsgPort *identifyPort = NULL;
+static struct MsgPort *identifyWorkerPort = NULL;   /* The worker's own port, while it is idle */
+static struct IdentifyJob identifyQuitJob;          /* Sent to the idle worker at the end of the run */
+static struct MsgPort *identifyTimerPort = NULL;
+static struct timerequest *identifyTimerIO = NULL;
+static LONG identifyStalled = 0;            /* Jobs that missed their deadline, freed on reply */
+static LONG identifyTimeout = -1;           /* Milliseconds, -1 until read */
+static BOOL identifyTimedOut = FALSE;       /* Last identification fell back to the name */
+
+/* Reaper - a process that takes over the replies still due when ProjectX ends, */
+/* so ProjectX need not wait for them. It owns our seglist from then on, as those */
+/* replies come from code in it, and unloads it after the last one. */
+#define REAPER_STACK 4096
+
+struct Reaper {
+    struct Message rp_Message;
+    BPTR rp_SegList;
+    struct MsgPort *rp_IdentifyPort;        /* Stalled identify jobs reply here */
+    LONG rp_Stalled;
+    struct MsgPort *rp_LaunchPort;          /* The direct launch's WBStartup comes back here */
+    struct DirectLaunch *rp_Launch;
+    struct MsgPort *rp_RoutePort;           /* A late reply from a running instance */
+    struct Message *rp_Route;
+    UBYTE rp_RouteMethod;
+    struct RxsLib *rp_RexxBase;             /* Kept open for the route's RexxMsg */
+};
+
+static struct WBStartup *startupMessage = NULL;  /* From Workbench, NULL from a shell */
+
+/* Batched identification - the files of one multi-file open go to one worker */
+/* as a single job, and are all identified before any of them is launched */
+
+struct IdentifyBatchEntry {
+    STRPTR be_Name;
+    BPTR be_Lock;                           /* The file's drawer, not ours */
+    STRPTR be_Type;                         /* Points into be_Buffer, NULL if not identified */
+    BOOL be_TimedOut;                       /* Guessed from the name after the deadline */
+    ULONG be_Micros;                        /* From submission to answer */
+    UBYTE be_Buffer[IDENTIFY_TYPE_SIZE];
+};
+
+static struct IdentifyBatchEntry *identifyBatch = NULL;
+static LONG identifyBatchCount = 0;
+
+/* Per-volume identification policy, adapted from measured identification latency */
+#define VOLUMES_FILE          "ENV:ProjectX/Volumes"
+#define VOLUMES_TEMP          "ENV:ProjectX/Volumes.new"
+#define VOLUMES_LOCK          "ENV:ProjectX/Volumes.lock"
+#define VOLUME_POLICY_FILE    "ENV:ProjectX/VolumePolicy"
+#define VOLUMES_MAGIC         0x5058564C    /* 'PXVL' */
+#define VOLUMES_VERSION       1
+#define VOLUMES_MAX           16
+#define VOLUME_PROBE_INTERVAL 32            /* Identify every n-th skipped file anyway */
+
+/* Policies and their thresholds are in pxcore.h */
+
+struct VolumesHeader {
+    ULONG vh_Magic;
+    UWORD vh_Version;
+    UWORD vh_Count;
+};
+
+/* One volume, stored in the volumes file as is */
+struct VolumeRecord {
+    UBYTE vr_Name[32];
+    ULONG vr_MeanMillis;                    /* Moving average of identification time */
+    ULONG vr_Samples;
+    ULONG vr_Skipped;                       /* Files not identified since the last probe */
+    UBYTE vr_Override;                      /* From VOLUME_POLICY_FILE, not kept in the file */
+    UBYTE vr_Stage;                         /* Launch from a RAM: copy, from VOLUME_POLICY_FILE too */
+    UBYTE vr_Pad[2];
+};
+
+static struct VolumeRecord *volumeRecords = NULL;
+static UWORD volumeCount = 0;
+static BOOL volumesDirty = FALSE;
+
+/* What this run measured, merged into the file as it is when saving */
+static struct VolumeRecord *volumesAdded = NULL;
+static UWORD volumesAddedCount = 0;
+
+static STRPTR policyNames[] = { "AUTO", "SNIFF", "NAME", "CACHE" };
+
+/* Tool rules - per-drawer ProjectX.rules files map names or types to tools */
+#define DRAWER_RULES_FILE "ProjectX.rules"
+#define MAX_RULES_DEPTH 32
+
+/* Rule kinds */
+#define RULE_NAME 1                         /* Match the file name with a pattern */
+#define RULE_TYPE 2                         /* Match the type identifier */
+#define RULE_SUFFIX 3                       /* Name pattern compiled into the suffix trie */
+
+struct ToolRule {
+    struct ToolRule *tl_Next;
+    UBYTE tl_Kind;                          /* RULE_NAME, RULE_TYPE or RULE_SUFFIX */
+    UWORD tl_Order;                         /* Line order, lower wins */
+    UBYTE *tl_Pattern;                      /* ParsePatternNoCase() result for RULE_NAME */
+    UBYTE tl_Key[64];                       /* Pattern or type identifier as written */
+    UBYTE tl_Tool[256];
+};
+
+/* Global name rules - ENV:ProjectX/Rules, checked before the file is identified */
+#define PATTERN_RULES_FILE "ENV:ProjectX/Rules"
+
+/* Compiled global name rules */
+/* Patterns of the form #?suffix and #?prefix(a|b) go into the trie, the rest */
+/* stay RULE_NAME and are matched in line order after the trie walk */
+struct PatternRules {
+    struct DateStamp pr_Date;               /* Rules file datestamp when compiled */
+    struct ToolRule *pr_Rules;              /* All rules in line order */
+    struct CoreSuffix *pr_Suffixes;         /* Payloads are the ToolRules, ordered by tl_Order */
+    BOOL pr_HasGeneral;                     /* Some rules are not suffix rules */
+};
+
+/* Used when the resident companion is not running, otherwise its shared copy is used */
+static struct PatternRules *patternRules = NULL;
+
+#define MAX_CACHED_DRAWERS 128
+
+/* Parsed rules of one drawer, cached per directory */
+/* Keyed by volume and lock key rather than by a lock, so cached drawers stay deletable */
+struct DrawerRules {
+    struct DrawerRules *dr_Next;
+    BPTR dr_Volume;                         /* fl_Volume of the drawer lock */
+    LONG dr_Key;                            /* fl_Key of the drawer lock */
+    BOOL dr_HasFile;                        /* Drawer has a ProjectX.rules file */
+    struct DateStamp dr_Date;               /* Rules file datestamp, or drawer datestamp if none */
+    struct ToolRule *dr_Rules;
+};
+
+/* Used when the resident companion is not running, otherwise its shared cache is used */
+static struct DrawerRules *drawerRulesCache = NULL;
+
+/* Drawer known to the resident companion */
+struct PrefetchDrawer {
+    struct MinNode pd_Node;
+    BOOL pd_Seen;                           /* Still open at the last poll */
+    UBYTE pd_Path[1];                       /* Allocated to length */
+};
+
 /* Forward declarations */
 VOID LogMessage(STRPTR format, ...);
 BOOL InitializeLibraries(VOID);
@@ -65,10 +561,135 @@ BOOL IsDefIconsRunning(VOID);
 VOID ShowErrorDialog(STRPTR title, STRPTR message);
 BOOL OpenFileWithDefaultTool(STRPTR fileName, BPTR fileLock);
 STRPTR GetFileTypeIdentifier(STRPTR fileName, BPTR fileLock);
+STRPTR IdentifyWithDefIcons(STRPTR fileName, BPTR fileLock, UBYTE *typeBuffer, LONG *bytesRead);
+STRPTR IdentifyTextHeader(STRPTR fileName, BPTR fileLock, UBYTE *typeBuffer, LONG *bytesRead);
+ULONG ReadTimer(struct EClockVal *eclock);
+ULONG ElapsedMicros(struct EClockVal *start, struct EClockVal *end);
+VOID SortLatencies(ULONG *values, LONG count);
+BOOL GenerateBenchCorpus(STRPTR drawerPath, LONG fileCount);
+BOOL RunIdentifyBenchmark(STRPTR drawerPath, BPTR outFile);
+BOOL LookupPrefetched(STRPTR fileName, BPTR fileLock, STRPTR *typeOut, STRPTR *toolOut,
+                      struct LaunchProfile *profileOut);
+struct PrefetchEntry *FindPrefetchEntry(struct PrefetchCache *cache, STRPTR path);
+BOOL AddPrefetchEntry(struct PrefetchCache *cache, STRPTR path, struct FileInfoBlock *fib,
+                      STRPTR typeIdentifier, STRPTR tool, struct LaunchProfile *profile, LONG maxEntries);
+LONG PrefetchDrawerFiles(struct PrefetchCache *cache, STRPTR drawerPath, LONG budget, LONG maxEntries);
+BOOL RunResident(LONG budget, LONG interval, LONG maxEntries, LONG priority);
+BOOL ExamineIcon(STRPTR dirName, STRPTR iconName, struct DateStamp *dateOut, LONG *sizeOut);
+VOID LoadResolveCache(VOID);
+VOID SaveResolveCache(VOID);
+VOID FreeResolveCache(VOID);
+VOID ExamineDirDate(STRPTR dirName, struct DateStamp *dateOut);
+BOOL ValidateResolveEntry(struct ResolveEntry *entry);
+STRPTR LookupResolveCache(STRPTR typeIdentifier, struct LaunchProfile *profileOut);
+VOID RecordResolveCache(STRPTR typeIdentifier, STRPTR defaultTool, struct LaunchProfile *profile);
+STRPTR IdentifyWithDeadline(struct IdentifyEngine *engine, STRPTR fileName, BPTR fileLock);
+VOID __saveds IdentifyWorker(VOID);
+BOOL OpenIdentifyPorts(VOID);
+struct IdentifyJob *StartIdentifyJob(struct IdentifyEngine *engine, struct IdentifyBatchEntry *entries, LONG count);
+BOOL WaitIdentifyJob(struct IdentifyJob *job);
+VOID CollectStalledJobs(VOID);
+LONG IdentifyBatch(struct IdentifyEngine *engine, struct IdentifyBatchEntry *entries, LONG count);
+VOID PrepareIdentifyBatch(struct WBStartup *wbs);
+struct IdentifyBatchEntry *FindBatchEntry(STRPTR fileName, BPTR fileLock);
+VOID FreeIdentifyBatch(VOID);
+VOID FreeIdentifyJob(struct IdentifyJob *job);
+BOOL RetireIdentifyJob(struct IdentifyJob *job);
+VOID StopIdentifyWorker(VOID);
+VOID FreeIdentifyWorkers(VOID);
+STRPTR GuessTypeOrProject(STRPTR fileName);
+STRPTR GuessFromName(STRPTR fileName);
+VOID LoadVolumes(VOID);
+VOID SaveVolumes(VOID);
+struct VolumeRecord *FindVolume(BPTR lock);
+struct VolumeRecord *GetVolumeRecord(struct VolumeRecord *records, UWORD *count, STRPTR name);
+struct VolumeRecord *GetAddedVolume(struct VolumeRecord *volume);
+VOID MergeVolumeRecord(struct VolumeRecord *into, struct VolumeRecord *from);
+VOID RecordVolumeSkip(struct VolumeRecord *volume);
+UBYTE GetVolumePolicy(struct VolumeRecord *volume);
+VOID RecordVolumeLatency(struct VolumeRecord *volume, ULONG micros);
+VOID PrintVolumes(VOID);
+struct ToolRule *ParseToolRules(BPTR rulesFile);
+VOID FreeToolRules(struct ToolRule *rules);
+BOOL ReadDrawerRules(struct DrawerRules *drawer, BPTR drawerLock);
+struct DrawerRules *GetDrawerRules(struct DrawerRules **cache, BPTR drawerLock);
+VOID FreeDrawerRules(struct DrawerRules *drawers);
+STRPTR FindOverrideTool(STRPTR fileName, BPTR fileLock, STRPTR *typeIdentifier);
+STRPTR MatchDrawerRules(STRPTR fileName, BPTR fileLock, STRPTR typeIdentifier, BOOL *typeRules);
+VOID FreePatternRules(struct PatternRules *rules);
+struct PatternRules *GetPatternRules(struct PatternRules **cache);
+STRPTR FindPatternTool(STRPTR fileName);
+VOID LoadStats(VOID);
+VOID SaveStats(VOID);
+struct StatsRecord *GetStatsRecord(struct StatsRecord *records, UWORD *count, UBYTE kind, STRPTR name);
+VOID AddStatsSample(UBYTE kind, STRPTR name, ULONG resolveMicros, ULONG launchMicros,
+                    BOOL cacheHit, LONG errorCode);
+VOID MergeStatsRecord(struct StatsRecord *into, struct StatsRecord *from);
+VOID RecordLaunchStats(STRPTR typeIdentifier, STRPTR toolName, ULONG resolveMicros,
+                       ULONG launchMicros, BOOL cacheHit, LONG errorCode);
+BOOL PrintStats(VOID);
 STRPTR GetDefaultToolFromType(STRPTR typeIdentifier, STRPTR defIconNameOut, ULONG defIconNameSize);
 BOOL IsProjectX(STRPTR toolName);
 STRPTR GetProjectXName(struct WBStartup *wbs);
 BOOL IsLeftShiftHeld(VOID);
+VOID LoadToolRoutes(VOID);
+VOID FreeToolRoutes(VOID);
+struct ToolRoute *FindToolRoute(STRPTR toolName);
+struct MsgPort *FindRoutePort(STRPTR portName);
+BOOL RouteToRunningInstance(STRPTR toolName, STRPTR portName, STRPTR fileName, BPTR fileLock);
+struct Message *WaitReplyTimeout(struct MsgPort *port, ULONG millis);
+BOOL CollectRoute(VOID);
+VOID FreeRouteMessage(struct Message *message, UBYTE method);
+BOOL HandToSpare(STRPTR toolName, STRPTR fileName, BPTR fileLock);
+VOID LoadStandbyTools(struct PrefetchCache *cache);
+VOID MaintainSpares(struct PrefetchCache *cache);
+BOOL StartSpare(struct StandbyTool *standby);
+ULONG ArchiveWord(UBYTE *p);
+ULONG ArchiveLong(UBYTE *p);
+LONG ReadArchiveAt(BPTR file, LONG offset, UBYTE *buffer, LONG length);
+VOID ReadLhaExtended(BPTR file, LONG offset, ULONG size, UBYTE *dirName, UBYTE *fileName, ULONG nameSize);
+BOOL FindLhaMember(BPTR file, STRPTR memberName, ULONG *sizeOut, STRPTR nameOut, ULONG nameSize);
+BOOL FindZipMember(BPTR file, STRPTR memberName, ULONG *sizeOut, STRPTR nameOut, ULONG nameSize);
+BOOL StageArchiveMember(STRPTR path, STRPTR stagedPath, ULONG stagedSize);
+BOOL RemoveStagedMember(STRPTR stagedPath);
+VOID PurgeStagedMembers(VOID);
+VOID LoadStageIndex(struct StageRecord *records);
+VOID SaveStageIndex(struct StageRecord *records);
+BOOL DropStagedCopy(struct StageRecord *record, LONG slot);
+BOOL CopyToStage(BPTR *sourceLock, STRPTR stagedPath);
+LONG StageIntoSlot(struct StageRecord *records, struct FileInfoBlock *fib, BPTR *sourceLock,
+                   STRPTR sourcePath, LONG budget);
+BOOL StageForLaunch(STRPTR fileName, BPTR fileLock, BPTR *stageLockOut);
+BOOL UseDirectLaunch(VOID);
+BOOL DirectLaunch(STRPTR toolName, STRPTR fileName, BPTR fileLock, struct LaunchProfile *profile,
+                  STRPTR stagedPath);
+VOID FreeDirectLaunch(struct DirectLaunch *launch);
+VOID CollectLaunches(struct PrefetchCache *cache);
+VOID FinishDirectLaunch(VOID);
+VOID ReadLaunchProfile(struct DiskObject *defIcon, struct LaunchProfile *profile);
+BOOL LaunchFromShell(STRPTR toolName, STRPTR fileName, BPTR fileLock, struct LaunchProfile *profile);
+BOOL LaunchWithProfile(STRPTR toolName, struct LaunchProfile *profile, STRPTR fileName, BPTR fileLock,
+                       STRPTR stagedPath);
+VOID ExpandFileTemplate(STRPTR template, STRPTR filePath, STRPTR out, ULONG outSize);
+BOOL PrintLoadTimes(STRPTR *programs);
+UBYTE GetMemoMode(VOID);
+VOID FormatMemoStamp(struct FileInfoBlock *fib, STRPTR out, ULONG outSize);
+STRPTR ReadTypeMemo(STRPTR fileName, BPTR fileLock);
+VOID WriteTypeMemo(STRPTR fileName, BPTR fileLock, STRPTR typeIdentifier);
+VOID LoadMemos(struct MemoRecord *records);
+VOID SaveMemos(struct MemoRecord *records);
+BPTR OpenLockFile(STRPTR lockPath);
+BPTR TakeOwnSegList(VOID);
+BOOL StartReaper(VOID);
+VOID __saveds RunReaper(VOID);
+VOID FreeReaperRoute(struct Reaper *reaper);
+
+/* Engines measured by the benchmark, in the order GetFileTypeIdentifier() tries them */
+static struct IdentifyEngine identifyEngines[] = {
+    { "deficons", IdentifyWithDefIcons },
+    { "text", IdentifyTextHeader },
+    { NULL, NULL }
+};
 
 static const char *verstag = "$VER: ProjectX 47.2 (2/1/2026)\n";
 static const char *stack_cookie = "$STACK: 4096\n";
@@ -86,48 +707,59 @@ int main(int argc, char *argv[])
     BOOL success = TRUE;
     BOOL fromWorkbench = FALSE;
     
+    MEMTRACK_BEGIN();
+    
     /* Check if running from Workbench */
     fromWorkbench = (argc == 0);
     
+    /* A resident copy keeps its data from the run before */
+    startupMessage = NULL;
+    
     if (!fromWorkbench) {
         /* CLI mode - parse arguments and handle file */
         struct RDArgs *rdargs;
         STRPTR fileName = NULL;
         LONG openFlag = 0; /* OPEN/S - boolean switch */
-        LONG args[2] = {0, 0}; /* FILE/A, OPEN/S */
-        CONST_STRPTR template = "FILE/A,OPEN/S";
+        LONG args[13] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+        /* FILE, OPEN/S, BENCH/K, GENERATE/N, TO/K, RESIDENT/S, BUDGET/N, INTERVAL/N, MAXFILES/N, PRI/N, STATS/S, LOADTIME/S, PROGRAMS/M */
+        CONST_STRPTR template = "FILE,OPEN/S,BENCH/K,GENERATE/N,TO/K,RESIDENT/S,BUDGET/N,INTERVAL/N,MAXFILES/N,PRI/N,STATS/S,LOADTIME/S,PROGRAMS/M";
         LONG errorCode;
         STRPTR typeIdentifier = NULL;
         STRPTR defaultTool = NULL;
         UBYTE defIconName[64];
+        struct LaunchProfile profile;
         BPTR fileLock = NULL;
         BPTR oldDir = NULL;
         BOOL success = FALSE;
         struct TagItem tags[3];
+        UBYTE stagedPath[256];
         
         /* Initialize libraries first (needed for ReadArgs and file operations) */
         if (!InitializeLibraries()) {
             return RETURN_FAIL;
         }
         
-        /* Check if DefIcons is running */
-        if (!IsDefIconsRunning()) {
-            PutStr("ProjectX: DefIcons is not running.\n");
-            PutStr("ProjectX requires DefIcons to identify file types.\n");
-            Cleanup();
-            return RETURN_FAIL;
-        }
-        
         SetIoErr(0);
         rdargs = ReadArgs(template, (LONG *)args, NULL);
         errorCode = IoErr();
         
         if (rdargs == NULL || errorCode != 0) {
             /* ReadArgs failed - show usage */
-            PutStr("Usage: ProjectX FILE/A [OPEN/S]\n");
-            PutStr("  FILE/A  - File to get default tool for\n");
+            PutStr("Usage: ProjectX FILE [OPEN/S] | BENCH=<drawer> [GENERATE=<n>] [TO=<file>] | RESIDENT | STATS | LOADTIME <program>...\n");
+            PutStr("  FILE    - File to get default tool for\n");
             PutStr("  OPEN/S - If set, immediately launch the tool with the file\n");
             PutStr("           If not set, print the default tool name\n");
+            PutStr("  BENCH   - Benchmark identification over every file in a drawer\n");
+            PutStr("  GENERATE/N - Fill the BENCH drawer with a generated corpus first\n");
+            PutStr("  TO      - Write benchmark results to a file instead of the console\n");
+            PutStr("  RESIDENT/S - Stay resident and pre-identify files in opened drawers\n");
+            PutStr("  BUDGET/N   - Files to pre-identify per drawer (default 32)\n");
+            PutStr("  INTERVAL/N - Seconds between checks for opened drawers (default 2)\n");
+            PutStr("  MAXFILES/N - Files kept in the prefetch cache (default 256)\n");
+            PutStr("  PRI/N      - Task priority while resident (default -5)\n");
+            PutStr("  STATS/S    - Print launch statistics per file type and tool\n");
+            PutStr("  LOADTIME/S - Print the size and load time of the executables named, to compare builds\n");
+            PutStr("  PROGRAMS/M - The executables for LOADTIME, after the first one given as FILE\n");
             if (rdargs != NULL) {
                 FreeArgs(rdargs);
             }
@@ -138,6 +770,95 @@ int main(int argc, char *argv[])
         fileName = (STRPTR)args[0];
         openFlag = args[1]; /* OPEN/S - 1 if set, 0 if not */
         
+        if (args[10] != 0) {
+            /* STATS/S - print the gathered launch statistics */
+            success = PrintStats();
+            FreeArgs(rdargs);
+            Cleanup();
+            return success ? RETURN_OK : RETURN_FAIL;
+        }
+        
+        if (args[11] != 0) {
+            /* LOADTIME/S - size and LoadSeg() time of each executable; the first */
+            /* name given lands in FILE, the rest in PROGRAMS/M */
+            STRPTR *programs;
+            STRPTR *more = (STRPTR *)args[12];
+            LONG count = 0;
+            LONG i;
+            
+            while (more != NULL && more[count] != NULL) {
+                count++;
+            }
+            programs = AllocVec(sizeof(STRPTR) * (count + 2), MEMF_CLEAR);
+            if (programs != NULL) {
+                i = 0;
+                if (fileName != NULL) {
+                    programs[i++] = fileName;
+                }
+                for (count = 0; more != NULL && more[count] != NULL; count++) {
+                    programs[i++] = more[count];
+                }
+                success = PrintLoadTimes(programs);
+                FreeVec(programs);
+            }
+            FreeArgs(rdargs);
+            Cleanup();
+            return success ? RETURN_OK : RETURN_FAIL;
+        }
+        
+        /* FILE, BENCH and RESIDENT identify files, which needs DefIcons */
+        if (!IsDefIconsRunning()) {
+            PutStr("ProjectX: DefIcons is not running.\n");
+            PutStr("ProjectX requires DefIcons to identify file types.\n");
+            FreeArgs(rdargs);
+            Cleanup();
+            return RETURN_FAIL;
+        }
+        
+        if (args[5] != 0) {
+            /* RESIDENT/S - prefetch companion, runs until Ctrl-C */
+            success = RunResident(args[6] ? *(LONG *)args[6] : 32,
+                                  args[7] ? *(LONG *)args[7] : 2,
+                                  args[8] ? *(LONG *)args[8] : 256,
+                                  args[9] ? *(LONG *)args[9] : -5);
+            FreeArgs(rdargs);
+            Cleanup();
+            return success ? RETURN_OK : RETURN_FAIL;
+        }
+        
+        if (args[2] != 0) {
+            /* BENCH=<drawer> - identification benchmark mode */
+            STRPTR benchPath = (STRPTR)args[2];
+            STRPTR toPath = (STRPTR)args[4];
+            BPTR outFile = Output();
+            
+            if (args[3] != 0 && !GenerateBenchCorpus(benchPath, *(LONG *)args[3])) {
+                PutStr("ProjectX: Could not generate benchmark corpus.\n");
+                FreeArgs(rdargs);
+                Cleanup();
+                return RETURN_FAIL;
+            }
+            
+            if (toPath != NULL && *toPath != '\0') {
+                outFile = Open(toPath, MODE_NEWFILE);
+                if (outFile == NULL) {
+                    PutStr("ProjectX: Could not open benchmark output file.\n");
+                    FreeArgs(rdargs);
+                    Cleanup();
+                    return RETURN_FAIL;
+                }
+            }
+            
+            success = RunIdentifyBenchmark(benchPath, outFile);
+            
+            if (outFile != Output()) {
+                Close(outFile);
+            }
+            FreeArgs(rdargs);
+            Cleanup();
+            return success ? RETURN_OK : RETURN_FAIL;
+        }
+        
         if (fileName == NULL || *fileName == '\0') {
             PutStr("ProjectX: No file specified.\n");
             FreeArgs(rdargs);
@@ -145,10 +866,19 @@ int main(int argc, char *argv[])
             return RETURN_FAIL;
         }
         
-        /* Lock the file to get its directory */
+        /* Lock the file to get its directory - a path into an LhA or Zip archive */
+        /* gets just that member extracted to RAM: and opened from there */
+        stagedPath[0] = '\0';
         fileLock = Lock((UBYTE *)fileName, SHARED_LOCK);
+        if (fileLock == NULL && StageArchiveMember(fileName, stagedPath, sizeof(stagedPath))) {
+            fileName = stagedPath;
+            fileLock = Lock((UBYTE *)fileName, SHARED_LOCK);
+        }
         if (fileLock == NULL) {
             PutStr("ProjectX: Could not lock file.\n");
+            if (stagedPath[0] != '\0') {
+                RemoveStagedMember(stagedPath);
+            }
             FreeArgs(rdargs);
             Cleanup();
             return RETURN_FAIL;
@@ -157,6 +887,8 @@ int main(int argc, char *argv[])
         /* Get the file's directory lock and filename part */
         {
             BPTR parentLock;
+            BPTR launchLock;
+            BPTR stageLock = NULL;
             STRPTR filePartPtr;
             UBYTE fileNameCopy[256];
             STRPTR fileNamePart = NULL;
@@ -181,6 +913,9 @@ int main(int argc, char *argv[])
             
             if (parentLock == NULL) {
                 PutStr("ProjectX: Could not get parent directory.\n");
+                if (stagedPath[0] != '\0') {
+                    RemoveStagedMember(stagedPath);
+                }
                 FreeArgs(rdargs);
                 Cleanup();
                 return RETURN_FAIL;
@@ -189,15 +924,24 @@ int main(int argc, char *argv[])
             fileLock = parentLock;
             oldDir = CurrentDir(fileLock);
             
+            /* Per-drawer override rules may name the tool, possibly without identifying the file */
+            MEMTRACK_PHASE("identify");
+            defaultTool = FindOverrideTool(fileNamePart, fileLock, &typeIdentifier);
+            
             /* Get file type identifier using filename and directory lock */
-            typeIdentifier = GetFileTypeIdentifier(fileNamePart, fileLock);
+            if (defaultTool == NULL && typeIdentifier == NULL) {
+                typeIdentifier = GetFileTypeIdentifier(fileNamePart, fileLock);
+            }
             
-            if (!typeIdentifier || *typeIdentifier == '\0') {
+            if (defaultTool == NULL && (!typeIdentifier || *typeIdentifier == '\0')) {
                 PutStr("ProjectX: Could not identify file type.\n");
                 if (oldDir != NULL) {
                     CurrentDir(oldDir);
                 }
                 UnLock(fileLock);
+                if (stagedPath[0] != '\0') {
+                    RemoveStagedMember(stagedPath);
+                }
                 FreeArgs(rdargs);
                 Cleanup();
                 return RETURN_FAIL;
@@ -205,7 +949,12 @@ int main(int argc, char *argv[])
             
             /* Get default tool from deficon */
             defIconName[0] = '\0';
-            defaultTool = GetDefaultToolFromType(typeIdentifier, defIconName, sizeof(defIconName));
+            MEMTRACK_PHASE("resolve");
+            memset(&profile, 0, sizeof(profile));
+            if (defaultTool == NULL) {
+                defaultTool = GetDefaultToolFromType(typeIdentifier, defIconName, sizeof(defIconName));
+                profile = resolvedProfile;
+            }
             
             if (!defaultTool || *defaultTool == '\0') {
                 PutStr("ProjectX: No default tool found for this file type.\n");
@@ -213,21 +962,36 @@ int main(int argc, char *argv[])
                     CurrentDir(oldDir);
                 }
                 UnLock(fileLock);
+                if (stagedPath[0] != '\0') {
+                    RemoveStagedMember(stagedPath);
+                }
                 FreeArgs(rdargs);
                 Cleanup();
                 return RETURN_FAIL;
             }
             
+            MEMTRACK_PHASE("launch");
+            
+            /* Files on slow volumes marked STAGE are given to the tool as a copy in RAM: */
+            launchLock = fileLock;
+            if (openFlag != 0 && StageForLaunch(fileNamePart, fileLock, &stageLock)) {
+                launchLock = stageLock;
+            }
+            
             if (openFlag == 0) {
                 /* OPEN/S not set - just print the default tool name */
                 PutStr(defaultTool);
                 PutStr("\n");
                 success = TRUE;
+            } else if (HandToSpare(defaultTool, fileNamePart, launchLock) ||
+                       RouteToRunningInstance(defaultTool, NULL, fileNamePart, launchLock)) {
+                /* OPEN/S set - a spare or running instance of the tool accepted the file */
+                success = TRUE;
             } else {
                 /* OPEN/S set - launch the tool with the file */
                 /* Build TagItem array for OpenWorkbenchObjectA */
                 tags[0].ti_Tag = WBOPENA_ArgLock;
-                tags[0].ti_Data = (ULONG)fileLock;
+                tags[0].ti_Data = (ULONG)launchLock;
                 tags[1].ti_Tag = WBOPENA_ArgName;
                 tags[1].ti_Data = (ULONG)fileNamePart;
                 tags[2].ti_Tag = TAG_DONE;
@@ -235,14 +999,27 @@ int main(int argc, char *argv[])
                 /* Clear any previous error */
                 SetIoErr(0);
                 
-                success = OpenWorkbenchObjectA(defaultTool, tags);
-                errorCode = IoErr();
+                /* Start the tool ourselves if its profile or ProjectX/Launch says so, */
+                /* with Workbench as the fallback */
+                if (LaunchWithProfile(defaultTool, &profile, fileNamePart, launchLock,
+                                      stagedPath[0] != '\0' ? (STRPTR)stagedPath : (STRPTR)NULL)) {
+                    success = TRUE;
+                    errorCode = 0;
+                } else {
+                    SetIoErr(0);
+                    success = OpenWorkbenchObjectA(defaultTool, tags);
+                    errorCode = IoErr();
+                }
                 
                 if (!success || errorCode != 0) {
                     PutStr("ProjectX: Failed to launch tool.\n");
                     success = FALSE;
                 }
             }
+            
+            if (stageLock != NULL) {
+                UnLock(stageLock);
+            }
         }
         
         
@@ -256,6 +1033,11 @@ int main(int argc, char *argv[])
         if (defaultTool != NULL) {
             FreeVec(defaultTool);
         }
+        /* A staged member a tool was given is deleted when a direct launch's tool quits, */
+        /* or by a later purge once nothing has it open after a Workbench launch */
+        if (stagedPath[0] != '\0' && (!success || openFlag == 0)) {
+            RemoveStagedMember(stagedPath);
+        }
         FreeArgs(rdargs);
         Cleanup();
         
@@ -264,6 +1046,7 @@ int main(int argc, char *argv[])
     
     /* Get WBStartup message */
     wbs = (struct WBStartup *)argv;
+    startupMessage = wbs;
     
     /* LogMessage("ProjectX: Starting, argc=%ld\n", argc); */
     
@@ -310,6 +1093,9 @@ int main(int argc, char *argv[])
     
     /* LogMessage("ProjectX: Processing %ld file arguments\n", wbs->sm_NumArgs - 1); */
     
+    /* Several files - identify them all at once rather than one per launch */
+    PrepareIdentifyBatch(wbs);
+    
     /* Process each file argument (skip index 0 which is our tool) */
     for (i = 1, wbarg = &wbs->sm_ArgList[i]; i < wbs->sm_NumArgs; i++, wbarg++) {
         BPTR oldDir = NULL;
@@ -398,6 +1184,18 @@ BOOL InitializeLibraries(VOID)
         }
     }
     
+    /* Open timer.device for latency measurement (optional - not critical) */
+    /* Only the library functions are used, so the request needs no reply port */
+    TimerIO = (struct timerequest *)AllocVec(sizeof(struct timerequest), MEMF_PUBLIC | MEMF_CLEAR);
+    if (TimerIO != NULL) {
+        if (OpenDevice(TIMERNAME, UNIT_MICROHZ, (struct IORequest *)TimerIO, 0) == 0) {
+            TimerBase = TimerIO->tr_node.io_Device;
+        } else {
+            FreeVec(TimerIO);
+            TimerIO = NULL;
+        }
+    }
+    
     /* Open log file */
     /* logFile = Open("codecraft:projectx.log", MODE_NEWFILE); */
     /* if (logFile == NULL) { */
@@ -459,6 +1257,56 @@ VOID Cleanup(VOID)
 {
     /* LogMessage("ProjectX: Cleanup starting\n"); */
     
+    MEMTRACK_PHASE("cleanup");
+    FreeToolRoutes();
+    FreeDrawerRules(drawerRulesCache);
+    drawerRulesCache = NULL;
+    FreePatternRules(patternRules);
+    patternRules = NULL;
+    
+    /* Write back resolutions learned during this run, then free them */
+    SaveResolveCache();
+    FreeResolveCache();
+    
+    /* Workers that missed their deadline run our code, and a tool started directly */
+    /* replies to our port - a reaper waits for them, or we do if there can be none */
+    FreeIdentifyBatch();
+    StopIdentifyWorker();
+    StartReaper();
+    FreeIdentifyWorkers();
+    
+    /* Merge this run's launch statistics and volume timings into their files */
+    SaveStats();
+    SaveVolumes();
+    if (volumeRecords != NULL) {
+        FreeVec(volumeRecords);
+        volumeRecords = NULL;
+    }
+    if (statsRecords != NULL) {
+        FreeVec(statsRecords);
+        statsRecords = NULL;
+    }
+    if (statsAdded != NULL) {
+        FreeVec(statsAdded);
+        statsAdded = NULL;
+    }
+    if (volumesAdded != NULL) {
+        FreeVec(volumesAdded);
+        volumesAdded = NULL;
+    }
+    
+    /* A tool started directly holds our WBStartup until it quits - unless the reaper */
+    /* has it, wait for it last, as for a routed message still out */
+    FinishDirectLaunch();
+    while (!CollectRoute()) {
+        WaitPort(routePort);
+    }
+    
+    if (RexxSysBase != NULL) {
+        CloseLibrary((struct Library *)RexxSysBase);
+        RexxSysBase = NULL;
+    }
+    
     if (RequesterClass != NULL) {
         RequesterClass = NULL;
     }
@@ -499,10 +1347,20 @@ VOID Cleanup(VOID)
         InputPort = NULL;
     }
     
+    if (TimerIO != NULL) {
+        CloseDevice((struct IORequest *)TimerIO);
+        FreeVec(TimerIO);
+        TimerIO = NULL;
+        TimerBase = NULL;
+    }
+    
     /* if (logFile != NULL) { */
     /*     Close(logFile); */
     /*     logFile = NULL; */
     /* } */
+    
+    /* Anything still allocated now is reported as leaked */
+    MEMTRACK_DUMP();
 }
 
 /* Check if DefIcons is running by looking for its message port */
@@ -519,10 +1377,87 @@ BOOL IsDefIconsRunning(VOID)
     return FALSE;
 }
 
-/* Get file type identifier using icon.library identification */
+/* Get file type identifier for a file */
+/* Tries each identification engine in turn and returns the first answer. */
+/* If an engine misses its deadline, the name-only guess is returned instead. */
 STRPTR GetFileTypeIdentifier(STRPTR fileName, BPTR fileLock)
 {
-    static UBYTE typeBuffer[256];
+    struct IdentifyEngine *engine;
+    struct IdentifyBatchEntry *batchEntry;
+    struct VolumeRecord *volume;
+    struct EClockVal start;
+    struct EClockVal end;
+    STRPTR typeIdentifier = NULL;
+    STRPTR guess;
+    UBYTE policy;
+    
+    identifyTimedOut = FALSE;
+    
+    /* A memo left by an earlier identification needs only the file's metadata */
+    if (GetMemoMode() != MEMO_OFF) {
+        typeIdentifier = ReadTypeMemo(fileName, fileLock);
+        if (typeIdentifier != NULL) {
+            return typeIdentifier;
+        }
+    }
+    
+    /* Answered already by the batch for a multi-file open */
+    batchEntry = FindBatchEntry(fileName, fileLock);
+    if (batchEntry != NULL) {
+        identifyTimedOut = batchEntry->be_TimedOut;
+        if (batchEntry->be_Type != NULL && !identifyTimedOut && GetMemoMode() != MEMO_OFF) {
+            WriteTypeMemo(fileName, fileLock, batchEntry->be_Type);
+        }
+        return batchEntry->be_Type;
+    }
+    
+    /* Slow volumes are not read when the name is good enough */
+    volume = FindVolume(fileLock);
+    policy = GetVolumePolicy(volume);
+    if (policy != POLICY_SNIFF) {
+        guess = GuessFromName(fileName);
+        /* Only a volume fixed to CACHE is never read; a measured one identifies unknown names */
+        if (policy == POLICY_CACHE && guess == NULL && volume->vr_Override == POLICY_CACHE) {
+            guess = "project";
+        }
+        /* Every so often identify anyway, so a volume that got faster is noticed */
+        if (guess != NULL && volume->vr_Override != POLICY_AUTO) {
+            return guess;
+        }
+        if (guess != NULL && volume->vr_Skipped + 1 < VOLUME_PROBE_INTERVAL) {
+            RecordVolumeSkip(volume);
+            return guess;
+        }
+    }
+    
+    ReadTimer(&start);
+    for (engine = identifyEngines; engine->ie_Name != NULL; engine++) {
+        typeIdentifier = IdentifyWithDeadline(engine, fileName, fileLock);
+        if (identifyTimedOut ||
+            (typeIdentifier != NULL && *typeIdentifier != '\0')) {
+            break;
+        }
+        typeIdentifier = NULL;
+    }
+    ReadTimer(&end);
+    
+    if (volume != NULL) {
+        /* A missed deadline counts as taking the whole deadline */
+        RecordVolumeLatency(volume, identifyTimedOut ? (ULONG)identifyTimeout * 1000 :
+                                                       ElapsedMicros(&start, &end));
+    }
+    
+    /* Only a real answer is memoed, never a guess made after a missed deadline */
+    if (typeIdentifier != NULL && !identifyTimedOut && GetMemoMode() != MEMO_OFF) {
+        WriteTypeMemo(fileName, fileLock, typeIdentifier);
+    }
+    
+    return typeIdentifier;
+}
+
+/* Get file type identifier using icon.library identification (DefIcons) */
+STRPTR IdentifyWithDefIcons(STRPTR fileName, BPTR fileLock, UBYTE *typeBuffer, LONG *bytesRead)
+{
     struct TagItem tags[4];
     LONG errorCode = 0;
     struct DiskObject *icon = NULL;
@@ -531,6 +1466,9 @@ STRPTR GetFileTypeIdentifier(STRPTR fileName, BPTR fileLock)
     /* Initialize buffer */
     typeBuffer[0] = '\0';
     
+    /* DefIcons reads the file itself, so the amount read is not known */
+    *bytesRead = -1;
+    
     /* Change to file's directory for identification */
     if (fileLock != NULL) {
         oldDir = CurrentDir(fileLock);
@@ -555,8 +1493,8 @@ STRPTR GetFileTypeIdentifier(STRPTR fileName, BPTR fileLock)
         FreeDiskObject(icon);
     }
     
-    /* Restore original directory */
-    if (oldDir != NULL) {
+    /* Restore original directory, which may be the boot volume's NULL lock */
+    if (fileLock != NULL) {
         CurrentDir(oldDir);
     }
     
@@ -569,6 +1507,45 @@ STRPTR GetFileTypeIdentifier(STRPTR fileName, BPTR fileLock)
     return NULL;
 }
 
+/* Identify plain text from the start of the file, for files DefIcons does not know */
+/* Returns ascii, latin1 or utf8, with -crlf for CR LF line ends, or NULL for binary */
+STRPTR IdentifyTextHeader(STRPTR fileName, BPTR fileLock, UBYTE *typeBuffer, LONG *bytesRead)
+{
+    UBYTE *header;
+    STRPTR textType = NULL;
+    BPTR oldDir;
+    BPTR file;
+    LONG length;
+    
+    *bytesRead = 0;
+    
+    /* AllocVec() memory is longword aligned, as the classification kernel likes it */
+    header = AllocVec(TEXT_HEADER_SIZE, MEMF_ANY);
+    if (header == NULL) {
+        return NULL;
+    }
+    
+    oldDir = CurrentDir(fileLock);
+    file = Open(fileName, MODE_OLDFILE);
+    CurrentDir(oldDir);
+    
+    if (file != NULL) {
+        length = Read(file, header, TEXT_HEADER_SIZE);
+        Close(file);
+        if (length > 0) {
+            *bytesRead = length;
+            textType = CoreTextType(CoreClassifyText(header, length));
+        }
+    }
+    FreeVec(header);
+    
+    if (textType == NULL) {
+        return NULL;
+    }
+    Strncpy(typeBuffer, textType, IDENTIFY_TYPE_SIZE);
+    return typeBuffer;
+}
+
 /* Get default tool from file type identifier */
 /* Returns the default tool, or NULL if not found */
 /* defIconNameOut will contain the name of the def_ icon that was tried */
@@ -579,6 +1556,10 @@ STRPTR GetDefaultToolFromType(STRPTR typeIdentifier, STRPTR defIconNameOut, ULON
     UBYTE defIconName[64];
     BPTR oldDir = NULL;
     BPTR envDir = NULL;
+    struct LaunchProfile profile;
+    
+    memset(&profile, 0, sizeof(profile));
+    memset(&resolvedProfile, 0, sizeof(resolvedProfile));
     
     if (!typeIdentifier || *typeIdentifier == '\0') {
         if (defIconNameOut && defIconNameSize > 0) {
@@ -595,6 +1576,13 @@ STRPTR GetDefaultToolFromType(STRPTR typeIdentifier, STRPTR defIconNameOut, ULON
         SNPrintf(defIconNameOut, defIconNameSize, "%s", defIconName);
     }
     
+    /* Use the persistent cache if this type was resolved before and its icons are unchanged */
+    defaultTool = LookupResolveCache(typeIdentifier, &resolvedProfile);
+    resolveCacheHit = (defaultTool != NULL);
+    if (defaultTool != NULL) {
+        return defaultTool;
+    }
+    
     /* Get the default icon from ENVARC:Sys/ or ENV:Sys/ */
     /* Use GetDiskObject directly, same as the diagnostic code */
     
@@ -638,9 +1626,18 @@ STRPTR GetDefaultToolFromType(STRPTR typeIdentifier, STRPTR defIconNameOut, ULON
         }
         /* Note: If icon was found but has no default tool, defaultTool will be NULL */
         
+        ReadLaunchProfile(defaultIcon, &profile);
         FreeDiskObject(defaultIcon);
     }
     
+    if (defaultTool != NULL) {
+        RecordResolveCache(typeIdentifier, defaultTool, &profile);
+        resolvedProfile = profile;
+    } else if (CoreTextParent(typeIdentifier) != NULL) {
+        /* No def_ icon for this kind of text - open it as plain ASCII */
+        defaultTool = GetDefaultToolFromType(CoreTextParent(typeIdentifier), defIconNameOut, defIconNameSize);
+    }
+    
     return defaultTool;
 }
 
@@ -705,53 +1702,423 @@ BOOL IsLeftShiftHeld(VOID)
     return FALSE;
 }
 
-/* Show error dialog */
-VOID ShowErrorDialog(STRPTR title, STRPTR message)
+/* Load routing rules from ENV:ProjectX/Routes */
+/* Each line is: <tool> AREXX <port> "<command>" or <tool> APPMSG <port> */
+/* Lines starting with ; or # are comments; the port may contain wildcards */
+VOID LoadToolRoutes(VOID)
 {
-    Object *reqobj;
+    BPTR routesFile;
+    UBYTE line[512];
+    UBYTE method[16];
+    struct CSource cs;
+    struct ToolRoute *route;
+    struct ToolRoute *lastRoute = NULL;
+    LONG item;
     
-    if (RequesterClass == NULL) {
-        /* Requester class not available - log error */
-        /* LogMessage("ProjectX Error: %s\n", message); */
+    if (routesLoaded) {
         return;
     }
+    routesLoaded = TRUE;
     
-    /* Create the requester object with error type */
-    reqobj = NewObject(RequesterClass, NULL,
-                       REQ_TitleText, title,
-                       REQ_BodyText, message,
-                       REQ_Type, REQTYPE_INFO,
-                       REQ_GadgetText, "OK",
-                       REQ_Image, REQIMAGE_ERROR,
-                       TAG_END);
+    routesFile = Open(ROUTES_FILE, MODE_OLDFILE);
+    if (routesFile == NULL) {
+        /* No routes file - every tool is launched normally */
+        return;
+    }
     
-    if (reqobj != NULL) {
-        /* Show the requester and wait for user response */
-        DoMethod(reqobj, RM_OPENREQ, NULL, 0L, NULL, TAG_DONE);
+    while (FGets(routesFile, line, sizeof(line) - 1) != NULL) {
+        if (line[0] == ';' || line[0] == '#' || line[0] == '\n' || line[0] == '\0') {
+            continue;
+        }
         
-        /* Clean up the requester object */
-        DisposeObject(reqobj);
+        route = AllocVec(sizeof(struct ToolRoute), MEMF_CLEAR);
+        if (route == NULL) {
+            break;
+        }
+        
+        cs.CS_Buffer = line;
+        cs.CS_Length = strlen((char *)line);
+        cs.CS_CurChr = 0;
+        
+        /* Tool name, method and port are required */
+        if (ReadItem(route->tr_Tool, sizeof(route->tr_Tool), &cs) <= ITEM_NOTHING ||
+            ReadItem(method, sizeof(method), &cs) <= ITEM_NOTHING ||
+            ReadItem(route->tr_Port, sizeof(route->tr_Port), &cs) <= ITEM_NOTHING) {
+            FreeVec(route);
+            continue;
+        }
+        
+        if (Stricmp(method, "AREXX") == 0) {
+            route->tr_Method = ROUTE_AREXX;
+            /* Command template is optional, default is the common OPEN command */
+            item = ReadItem(route->tr_Command, sizeof(route->tr_Command), &cs);
+            if (item <= ITEM_NOTHING) {
+                Strncpy(route->tr_Command, "OPEN \"%s\"", sizeof(route->tr_Command));
+            }
+        } else if (Stricmp(method, "APPMSG") == 0) {
+            route->tr_Method = ROUTE_APPMSG;
+        } else {
+            /* Unknown method - ignore the line */
+            FreeVec(route);
+            continue;
+        }
+        
+        /* Keep rules in file order so the first matching rule wins */
+        if (lastRoute == NULL) {
+            toolRoutes = route;
+        } else {
+            lastRoute->tr_Next = route;
+        }
+        lastRoute = route;
     }
+    
+    Close(routesFile);
 }
 
-/* Show confirmation dialog before launching tool */
-/* BOOL ShowConfirmDialog(STRPTR fileName, STRPTR toolName) */
-/* { */
-/*     Object *reqobj; */
-/*     char title[256]; */
-/*     char message[512]; */
-/*     ULONG result; */
-/*      */
-/*     if (RequesterClass == NULL) { */
-/*         Requester class not available - default to yes */
-/*         return TRUE; */
-/*     } */
-/*      */
-/*     Format the title and message */
-/*     Strncpy(title, "ProjectX", 255); */
-/*     title[255] = '\0'; */
-/*      */
-/*     SNPrintf(message, sizeof(message), */
+/* Free the routing rules */
+VOID FreeToolRoutes(VOID)
+{
+    struct ToolRoute *route;
+    struct ToolRoute *nextRoute;
+    
+    for (route = toolRoutes; route != NULL; route = nextRoute) {
+        nextRoute = route->tr_Next;
+        FreeVec(route);
+    }
+    toolRoutes = NULL;
+    routesLoaded = FALSE;
+}
+
+/* Find the routing rule for a tool */
+/* Matches the full tool name or just its file part, case-insensitive */
+struct ToolRoute *FindToolRoute(STRPTR toolName)
+{
+    struct ToolRoute *route;
+    STRPTR toolPart;
+    
+    if (toolName == NULL || *toolName == '\0') {
+        return NULL;
+    }
+    
+    LoadToolRoutes();
+    
+    toolPart = FilePart(toolName);
+    for (route = toolRoutes; route != NULL; route = route->tr_Next) {
+        if (Stricmp(route->tr_Tool, toolName) == 0 || Stricmp(route->tr_Tool, toolPart) == 0) {
+            return route;
+        }
+    }
+    
+    return NULL;
+}
+
+/* Find a public message port by name or wildcard pattern */
+/* Must be called under Forbid() and the port used before Permit() */
+struct MsgPort *FindRoutePort(STRPTR portName)
+{
+    UBYTE patternBuffer[130];
+    struct Node *node;
+    LONG isWild;
+    
+    isWild = ParsePatternNoCase(portName, patternBuffer, sizeof(patternBuffer));
+    if (isWild == 0) {
+        return FindPort(portName);
+    }
+    if (isWild < 0) {
+        return NULL;
+    }
+    
+    /* Wildcard - take the first public port that matches, e.g. MULTIVIEW.#? */
+    for (node = SysBase->PortList.lh_Head; node->ln_Succ != NULL; node = node->ln_Succ) {
+        if (node->ln_Name != NULL && MatchPatternNoCase(patternBuffer, (STRPTR)node->ln_Name)) {
+            return (struct MsgPort *)node;
+        }
+    }
+    
+    return NULL;
+}
+
+/* Hand a file to an already running instance of a tool */
+/* portName picks one instance by its exact port, NULL uses the route's port */
+/* Returns TRUE if the running instance accepted the file, FALSE if the */
+/* tool has no route, is not running, refused it or did not reply within */
+/* ROUTE_TIMEOUT - caller then launches normally */
+BOOL RouteToRunningInstance(STRPTR toolName, STRPTR portName, STRPTR fileName, BPTR fileLock)
+{
+    struct ToolRoute *route;
+    struct MsgPort *replyPort;
+    struct MsgPort *targetPort;
+    UBYTE filePath[512];
+    BOOL success = FALSE;
+    BOOL late = FALSE;
+    
+    route = FindToolRoute(toolName);
+    if (route == NULL) {
+        return FALSE;
+    }
+    
+    /* A message from an earlier file still out means a hung instance - do not add to it */
+    if (!CollectRoute()) {
+        return FALSE;
+    }
+    
+    if (portName == NULL) {
+        portName = route->tr_Port;
+    }
+    
+    /* Quick check before building anything - no port means no running instance */
+    Forbid();
+    targetPort = FindRoutePort(portName);
+    Permit();
+    if (targetPort == NULL) {
+        return FALSE;
+    }
+    
+    replyPort = CreateMsgPort();
+    if (replyPort == NULL) {
+        return FALSE;
+    }
+    
+    if (route->tr_Method == ROUTE_AREXX) {
+        struct RexxMsg *rexxMsg;
+        UBYTE command[768];
+        
+        if (RexxSysBase == NULL) {
+            RexxSysBase = (struct RxsLib *)OpenLibrary("rexxsyslib.library", 36L);
+        }
+        
+        /* ARexx hosts need a full path - the host has its own current directory */
+        filePath[0] = '\0';
+        if (RexxSysBase == NULL ||
+            !NameFromLock(fileLock, filePath, sizeof(filePath)) ||
+            !AddPart(filePath, fileName, sizeof(filePath))) {
+            DeleteMsgPort(replyPort);
+            return FALSE;
+        }
+        
+        ExpandFileTemplate(route->tr_Command, filePath, command, sizeof(command));
+        
+        rexxMsg = CreateRexxMsg(replyPort, NULL, NULL);
+        if (rexxMsg != NULL) {
+            rexxMsg->rm_Args[0] = CreateArgstring(command, strlen((char *)command));
+            rexxMsg->rm_Action = RXCOMM;
+            
+            if (rexxMsg->rm_Args[0] != NULL) {
+                /* The port may have gone away since the first check */
+                Forbid();
+                targetPort = FindRoutePort(portName);
+                if (targetPort != NULL) {
+                    PutMsg(targetPort, (struct Message *)rexxMsg);
+                }
+                Permit();
+                
+                if (targetPort != NULL) {
+                    /* The host must reply before the message can be freed */
+                    if (WaitReplyTimeout(replyPort, ROUTE_TIMEOUT) != NULL) {
+                        /* rm_Result1 is the ARexx return code, 0 means the host accepted it */
+                        success = (rexxMsg->rm_Result1 == 0);
+                    } else {
+                        late = TRUE;
+                    }
+                }
+            }
+            if (late) {
+                routePending = (struct Message *)rexxMsg;
+                routeMethod = ROUTE_AREXX;
+            } else {
+                FreeRouteMessage((struct Message *)rexxMsg, ROUTE_AREXX);
+            }
+        }
+    } else if (route->tr_Method == ROUTE_APPMSG) {
+        struct AppMessage *appMsg;
+        struct WBArg *appArg;
+        ULONG nameSize = strlen((char *)fileName) + 1;
+        
+        /* AppMessage, its argument and the name must be in public memory */
+        /* The name goes along too - a late receiver may read it after we are gone */
+        appMsg = AllocVec(sizeof(struct AppMessage) + sizeof(struct WBArg) + nameSize,
+                          MEMF_PUBLIC | MEMF_CLEAR);
+        if (appMsg != NULL) {
+            appArg = (struct WBArg *)(appMsg + 1);
+            /* Give the receiver a lock of its own rather than the Workbench-owned one */
+            appArg->wa_Lock = DupLock(fileLock);
+            appArg->wa_Name = (BYTE *)(appArg + 1);
+            CopyMem(fileName, appArg->wa_Name, nameSize);
+            
+            appMsg->am_Message.mn_Node.ln_Type = NT_MESSAGE;
+            appMsg->am_Message.mn_ReplyPort = replyPort;
+            appMsg->am_Message.mn_Length = sizeof(struct AppMessage);
+            appMsg->am_Type = AMTYPE_APPWINDOW;
+            appMsg->am_NumArgs = 1;
+            appMsg->am_ArgList = appArg;
+            appMsg->am_Version = AM_VERSION;
+            
+            if (appArg->wa_Lock != NULL) {
+                Forbid();
+                targetPort = FindRoutePort(portName);
+                if (targetPort != NULL) {
+                    PutMsg(targetPort, (struct Message *)appMsg);
+                }
+                Permit();
+                
+                if (targetPort != NULL) {
+                    if (WaitReplyTimeout(replyPort, ROUTE_TIMEOUT) != NULL) {
+                        success = TRUE;
+                    } else {
+                        late = TRUE;
+                    }
+                }
+            }
+            if (late) {
+                routePending = (struct Message *)appMsg;
+                routeMethod = ROUTE_APPMSG;
+            } else {
+                FreeRouteMessage((struct Message *)appMsg, ROUTE_APPMSG);
+            }
+        }
+    }
+    
+    /* The late reply still needs the port - it is freed once the reply is in */
+    if (late) {
+        routePort = replyPort;
+    } else {
+        DeleteMsgPort(replyPort);
+    }
+    
+    return success;
+}
+
+/* Wait for a reply on a port, at most millis milliseconds */
+/* Returns the reply, or NULL if the time ran out first */
+struct Message *WaitReplyTimeout(struct MsgPort *port, ULONG millis)
+{
+    struct MsgPort *timerPort;
+    struct timerequest *timerIO = NULL;
+    struct Message *reply = NULL;
+    
+    timerPort = CreateMsgPort();
+    if (timerPort != NULL) {
+        timerIO = (struct timerequest *)CreateIORequest(timerPort, sizeof(struct timerequest));
+        if (timerIO != NULL && OpenDevice(TIMERNAME, UNIT_VBLANK, (struct IORequest *)timerIO, 0) != 0) {
+            DeleteIORequest((struct IORequest *)timerIO);
+            timerIO = NULL;
+        }
+    }
+    
+    if (timerIO == NULL) {
+        /* No timer - wait as long as it takes */
+        WaitPort(port);
+        reply = GetMsg(port);
+    } else {
+        timerIO->tr_node.io_Command = TR_ADDREQUEST;
+        timerIO->tr_time.tv_secs = millis / 1000;
+        timerIO->tr_time.tv_micro = (millis % 1000) * 1000;
+        SendIO((struct IORequest *)timerIO);
+        
+        for (;;) {
+            reply = GetMsg(port);
+            if (reply != NULL || CheckIO((struct IORequest *)timerIO)) {
+                break;
+            }
+            Wait((1UL << port->mp_SigBit) | (1UL << timerPort->mp_SigBit));
+        }
+        
+        if (!CheckIO((struct IORequest *)timerIO)) {
+            AbortIO((struct IORequest *)timerIO);
+        }
+        WaitIO((struct IORequest *)timerIO);
+        CloseDevice((struct IORequest *)timerIO);
+        DeleteIORequest((struct IORequest *)timerIO);
+    }
+    if (timerPort != NULL) {
+        DeleteMsgPort(timerPort);
+    }
+    
+    return reply;
+}
+
+/* Free a routed message that came back late, if it has */
+/* Returns TRUE if no routed message is still out */
+BOOL CollectRoute(VOID)
+{
+    if (routePending != NULL && GetMsg(routePort) != NULL) {
+        FreeRouteMessage(routePending, routeMethod);
+        DeleteMsgPort(routePort);
+        routePending = NULL;
+        routePort = NULL;
+    }
+    
+    return (BOOL)(routePending == NULL);
+}
+
+/* Free a routed message once it has been replied, or if it was never sent */
+VOID FreeRouteMessage(struct Message *message, UBYTE method)
+{
+    struct RexxMsg *rexxMsg;
+    struct AppMessage *appMsg;
+    
+    if (method == ROUTE_AREXX) {
+        rexxMsg = (struct RexxMsg *)message;
+        if (rexxMsg->rm_Args[0] != NULL) {
+            DeleteArgstring(rexxMsg->rm_Args[0]);
+        }
+        DeleteRexxMsg(rexxMsg);
+    } else {
+        appMsg = (struct AppMessage *)message;
+        if (appMsg->am_ArgList[0].wa_Lock != NULL) {
+            UnLock(appMsg->am_ArgList[0].wa_Lock);
+        }
+        FreeVec(appMsg);
+    }
+}
+
+/* Show error dialog */
+VOID ShowErrorDialog(STRPTR title, STRPTR message)
+{
+    Object *reqobj;
+    
+    if (RequesterClass == NULL) {
+        /* Requester class not available - log error */
+        /* LogMessage("ProjectX Error: %s\n", message); */
+        return;
+    }
+    
+    /* Create the requester object with error type */
+    reqobj = NewObject(RequesterClass, NULL,
+                       REQ_TitleText, title,
+                       REQ_BodyText, message,
+                       REQ_Type, REQTYPE_INFO,
+                       REQ_GadgetText, "OK",
+                       REQ_Image, REQIMAGE_ERROR,
+                       TAG_END);
+    
+    if (reqobj != NULL) {
+        /* Show the requester and wait for user response */
+        DoMethod(reqobj, RM_OPENREQ, NULL, 0L, NULL, TAG_DONE);
+        
+        /* Clean up the requester object */
+        DisposeObject(reqobj);
+    }
+}
+
+/* Show confirmation dialog before launching tool */
+/* BOOL ShowConfirmDialog(STRPTR fileName, STRPTR toolName) */
+/* { */
+/*     Object *reqobj; */
+/*     char title[256]; */
+/*     char message[512]; */
+/*     ULONG result; */
+/*      */
+/*     if (RequesterClass == NULL) { */
+/*         Requester class not available - default to yes */
+/*         return TRUE; */
+/*     } */
+/*      */
+/*     Format the title and message */
+/*     Strncpy(title, "ProjectX", 255); */
+/*     title[255] = '\0'; */
+/*      */
+/*     SNPrintf(message, sizeof(message), */
 /*             "\n\n" */
 /*             "File: %s\n\n" */
 /*             "Tool: %s\n\n" */
@@ -818,19 +2185,43 @@ BOOL OpenFileWithDefaultTool(STRPTR fileName, BPTR fileLock)
 {
     STRPTR typeIdentifier = NULL;
     STRPTR defaultTool = NULL;
+    STRPTR prefetchedTool = NULL;
+    STRPTR overrideTool = NULL;
     BOOL success = FALSE;
+    BOOL cacheHit = FALSE;
+    struct LaunchProfile prefetchedProfile;
+    struct LaunchProfile profile;
     struct TagItem tags[4];
+    BPTR launchLock = fileLock;
+    BPTR stageLock = NULL;
+    struct EClockVal startClock;
+    struct EClockVal resolvedClock;
+    struct EClockVal launchedClock;
+    ULONG resolveMicros;
     UBYTE defIconName[64];
     UBYTE errorMsg[512];
     LONG errorCode;
     
     /* LogMessage("ProjectX: OpenFileWithDefaultTool called for file=%s\n", fileName); */
     
-    /* Step 1: Get file type identifier */
-    typeIdentifier = GetFileTypeIdentifier(fileName, fileLock);
+    ReadTimer(&startClock);
+    MEMTRACK_PHASE("identify");
+    
+    /* Only an identification for this file may count as timed out in its statistics */
+    identifyTimedOut = FALSE;
+    
+    /* Step 1: Get file type identifier - the resident companion may already have it */
+    LookupPrefetched(fileName, fileLock, &typeIdentifier, &prefetchedTool, &prefetchedProfile);
+    
+    /* Per-drawer override rules win over DefIcons, and name rules need no identification */
+    overrideTool = FindOverrideTool(fileName, fileLock, &typeIdentifier);
+    
+    if (overrideTool == NULL && typeIdentifier == NULL) {
+        typeIdentifier = GetFileTypeIdentifier(fileName, fileLock);
+    }
     /* LogMessage("ProjectX: File type identifier=%s\n", typeIdentifier ? typeIdentifier : (STRPTR)"(null)"); */
     
-    if (!typeIdentifier || *typeIdentifier == '\0') {
+    if (overrideTool == NULL && (!typeIdentifier || *typeIdentifier == '\0')) {
         /* File type could not be identified */
         /* DefIcons is running (we checked earlier), so file type is unknown */
         ShowErrorDialog("ProjectX", 
@@ -842,6 +2233,9 @@ BOOL OpenFileWithDefaultTool(STRPTR fileName, BPTR fileLock)
     }
     
     /* Step 2: Get default tool for this file type */
+    /* Only the type's own tool is started with the type's launch profile */
+    MEMTRACK_PHASE("resolve");
+    memset(&profile, 0, sizeof(profile));
     /* Check if Left Shift is held - if so, use MultiView instead of DefIcons default tool */
     if (IsLeftShiftHeld()) {
         /* Left Shift held - use MultiView as universal fallback viewer */
@@ -849,13 +2243,37 @@ BOOL OpenFileWithDefaultTool(STRPTR fileName, BPTR fileLock)
         if (defaultTool != NULL) {
             Strncpy((UBYTE *)defaultTool, "MultiView", strlen("MultiView") + 1);
         }
+    } else if (overrideTool != NULL) {
+        /* Named by a ProjectX.rules file in this drawer or a parent */
+        defIconName[0] = '\0';
+        defaultTool = overrideTool;
+        overrideTool = NULL;
+        cacheHit = TRUE;
+    } else if (prefetchedTool != NULL) {
+        /* Resolved in advance by the resident companion */
+        SNPrintf(defIconName, sizeof(defIconName), "def_%s", typeIdentifier);
+        defaultTool = prefetchedTool;
+        prefetchedTool = NULL;
+        profile = prefetchedProfile;
+        cacheHit = TRUE;
     } else {
         /* Normal path - get default tool from DefIcons */
         defIconName[0] = '\0';
         defaultTool = GetDefaultToolFromType(typeIdentifier, defIconName, sizeof(defIconName));
+        profile = resolvedProfile;
+        cacheHit = resolveCacheHit;
     }
+    ReadTimer(&resolvedClock);
+    resolveMicros = ElapsedMicros(&startClock, &resolvedClock);
     /* LogMessage("ProjectX: Default tool=%s defIconName=%s\n", defaultTool ? defaultTool : (STRPTR)"(null)", defIconName); */
     
+    if (prefetchedTool != NULL) {
+        FreeVec(prefetchedTool);
+    }
+    if (overrideTool != NULL) {
+        FreeVec(overrideTool);
+    }
+    
     if (!defaultTool || *defaultTool == '\0') {
         /* No default tool found for this file type */
         /* Try to determine if icon exists and what its default tool actually is */
@@ -966,12 +2384,33 @@ BOOL OpenFileWithDefaultTool(STRPTR fileName, BPTR fileLock)
     
     /* LogMessage("ProjectX: No infinite loop, proceeding to launch tool\n"); */
     
-    /* Step 4: Open the file using OpenWorkbenchObjectA (no confirmation dialog) */
+    MEMTRACK_PHASE("launch");
+    
+    /* Files on slow volumes marked STAGE are given to the tool as a copy in RAM: */
+    if (StageForLaunch(fileName, fileLock, &stageLock)) {
+        launchLock = stageLock;
+    }
+    
+    /* Step 4: Hand the file to a warm spare, or to an already running instance of the tool */
+    /* if a route is configured */
+    if (HandToSpare(defaultTool, fileName, launchLock) ||
+        RouteToRunningInstance(defaultTool, NULL, fileName, launchLock)) {
+        ReadTimer(&launchedClock);
+        RecordLaunchStats(typeIdentifier, defaultTool, resolveMicros,
+                          ElapsedMicros(&resolvedClock, &launchedClock), cacheHit, 0);
+        FreeVec(defaultTool);
+        if (stageLock != NULL) {
+            UnLock(stageLock);
+        }
+        return TRUE;
+    }
+    
+    /* Step 5: Open the file using OpenWorkbenchObjectA (no confirmation dialog) */
     /* LogMessage("ProjectX: About to call OpenWorkbenchObjectA tool=%s file=%s\n", defaultTool, fileName); */
     
     /* Build TagItem array for OpenWorkbenchObjectA */
     tags[0].ti_Tag = WBOPENA_ArgLock;
-    tags[0].ti_Data = (ULONG)fileLock;
+    tags[0].ti_Data = (ULONG)launchLock;
     tags[1].ti_Tag = WBOPENA_ArgName;
     tags[1].ti_Data = (ULONG)fileName;
     tags[2].ti_Tag = TAG_DONE;
@@ -979,14 +2418,33 @@ BOOL OpenFileWithDefaultTool(STRPTR fileName, BPTR fileLock)
     /* Clear any previous error */
     SetIoErr(0);
     
-    /* LogMessage("ProjectX: Calling OpenWorkbenchObjectA...\n"); */
-    success = OpenWorkbenchObjectA(defaultTool, tags);
-    /* LogMessage("ProjectX: OpenWorkbenchObjectA returned success=%ld\n", success); */
-    
-    /* Check IoErr() regardless of return value, as OpenWorkbenchObjectA may return TRUE even on failure */
-    errorCode = IoErr();
+    /* Start the tool ourselves if its profile or ProjectX/Launch says so, */
+    /* without a round trip through Workbench */
+    if (LaunchWithProfile(defaultTool, &profile, fileName, launchLock, NULL)) {
+        success = TRUE;
+        errorCode = 0;
+    } else {
+        SetIoErr(0);
+        
+        /* LogMessage("ProjectX: Calling OpenWorkbenchObjectA...\n"); */
+        success = OpenWorkbenchObjectA(defaultTool, tags);
+        /* LogMessage("ProjectX: OpenWorkbenchObjectA returned success=%ld\n", success); */
+        
+        /* Check IoErr() regardless of return value, as OpenWorkbenchObjectA may return TRUE even on failure */
+        errorCode = IoErr();
+    }
     /* LogMessage("ProjectX: IoErr() returned errorCode=%ld\n", errorCode); */
     
+    /* Workbench has its own lock on the drawer by now */
+    if (stageLock != NULL) {
+        UnLock(stageLock);
+    }
+    
+    ReadTimer(&launchedClock);
+    RecordLaunchStats(typeIdentifier, defaultTool, resolveMicros,
+                      ElapsedMicros(&resolvedClock, &launchedClock), cacheHit,
+                      (!success && errorCode == 0) ? ERROR_OBJECT_NOT_FOUND : errorCode);
+    
     if (!success || errorCode != 0) {
         /* OpenWorkbenchObjectA failed - show error code */
         /* LogMessage("ProjectX: OpenWorkbenchObjectA failed success=%ld errorCode=%ld\n", success, errorCode); */
@@ -1017,4 +2475,4751 @@ BOOL OpenFileWithDefaultTool(STRPTR fileName, BPTR fileLock)
     }
     
     return success;
-}
\ No newline at end of file
+}
+
+/* Read the E-clock, returns the E-clock frequency or 0 if timer.device is not open */
+ULONG ReadTimer(struct EClockVal *eclock)
+{
+    if (TimerBase == NULL) {
+        eclock->ev_hi = 0;
+        eclock->ev_lo = 0;
+        return 0;
+    }
+    
+    eclockFrequency = ReadEClock(eclock);
+    return eclockFrequency;
+}
+
+/* Microseconds between two E-clock readings (up to about 100 minutes) */
+ULONG ElapsedMicros(struct EClockVal *start, struct EClockVal *end)
+{
+    ULONG ticks;
+    ULONG freqKHz;
+    
+    if (eclockFrequency == 0) {
+        return 0;
+    }
+    
+    /* Unsigned subtraction of the low words handles the carry into ev_hi */
+    ticks = end->ev_lo - start->ev_lo;
+    freqKHz = eclockFrequency / 1000;
+    
+    /* Split to stay within 32 bits: whole seconds, then the remainder */
+    return (ticks / eclockFrequency) * 1000000 +
+           ((ticks % eclockFrequency) * 1000) / freqKHz;
+}
+
+/* Sort latencies in ascending order (Shell sort, no C library needed) */
+VOID SortLatencies(ULONG *values, LONG count)
+{
+    LONG gap;
+    LONG i;
+    LONG j;
+    ULONG value;
+    
+    for (gap = count / 2; gap > 0; gap /= 2) {
+        for (i = gap; i < count; i++) {
+            value = values[i];
+            for (j = i; j >= gap && values[j - gap] > value; j -= gap) {
+                values[j] = values[j - gap];
+            }
+            values[j] = value;
+        }
+    }
+}
+
+/* Sample file headers for the generated benchmark corpus */
+struct BenchSample {
+    STRPTR bs_Extension;    /* File name extension, NULL for none */
+    BOOL bs_Text;           /* Fill with text rather than binary data */
+    UBYTE bs_HeaderLength;
+    UBYTE bs_Header[12];
+};
+
+static const struct BenchSample benchSamples[] = {
+    { "iff",  FALSE, 12, { 'F','O','R','M',0x00,0x00,0x10,0x00,'I','L','B','M' } },
+    { "8svx", FALSE, 12, { 'F','O','R','M',0x00,0x00,0x10,0x00,'8','S','V','X' } },
+    { "jpg",  FALSE, 4,  { 0xFF,0xD8,0xFF,0xE0 } },
+    { "png",  FALSE, 8,  { 0x89,'P','N','G',0x0D,0x0A,0x1A,0x0A } },
+    { "gif",  FALSE, 6,  { 'G','I','F','8','9','a' } },
+    { "pdf",  FALSE, 8,  { '%','P','D','F','-','1','.','4' } },
+    { "html", TRUE,  6,  { '<','h','t','m','l','>' } },
+    { "lha",  FALSE, 7,  { 0x20,0x00,'-','l','h','5','-' } },
+    { "zip",  FALSE, 4,  { 'P','K',0x03,0x04 } },
+    { NULL,   FALSE, 4,  { 0x00,0x00,0x03,0xF3 } },                              /* Executable */
+    { "txt",  TRUE,  0,  { 0 } },
+    { "dat",  FALSE, 0,  { 0 } },                                                /* Random binary */
+    { NULL,   FALSE, 12, { 'F','O','R','M',0xFF,0xFF,0xFF,0xFF,'I','L','B','M' } } /* Bogus chunk length */
+};
+
+#define BENCH_SAMPLE_COUNT (sizeof(benchSamples) / sizeof(benchSamples[0]))
+
+/* File sizes for the generated corpus - sizes below the header length give truncated headers */
+static const LONG benchSizes[] = { 0, 3, 64, 512, 4096, 32768 };
+
+#define BENCH_SIZE_COUNT (sizeof(benchSizes) / sizeof(benchSizes[0]))
+
+/* Fill a drawer with a generated corpus of files of many types and sizes */
+BOOL GenerateBenchCorpus(STRPTR drawerPath, LONG fileCount)
+{
+    BPTR drawerLock;
+    BPTR oldDir;
+    BPTR file;
+    UBYTE *buffer;
+    UBYTE fileName[32];
+    const struct BenchSample *sample;
+    STRPTR text = "The quick brown fox jumps over the lazy dog.\n";
+    ULONG seed = 12345;
+    LONG size;
+    LONG written;
+    LONG chunk;
+    LONG i;
+    LONG j;
+    BOOL success = TRUE;
+    
+    if (fileCount <= 0) {
+        return FALSE;
+    }
+    
+    /* Create the drawer if it does not exist yet */
+    drawerLock = Lock(drawerPath, SHARED_LOCK);
+    if (drawerLock == NULL) {
+        drawerLock = CreateDir(drawerPath);
+        if (drawerLock == NULL) {
+            return FALSE;
+        }
+        UnLock(drawerLock);
+        drawerLock = Lock(drawerPath, SHARED_LOCK);
+        if (drawerLock == NULL) {
+            return FALSE;
+        }
+    }
+    
+    buffer = AllocVec(4096, MEMF_ANY);
+    if (buffer == NULL) {
+        UnLock(drawerLock);
+        return FALSE;
+    }
+    
+    oldDir = CurrentDir(drawerLock);
+    
+    for (i = 0; i < fileCount && success; i++) {
+        sample = &benchSamples[i % BENCH_SAMPLE_COUNT];
+        size = benchSizes[(i / BENCH_SAMPLE_COUNT) % BENCH_SIZE_COUNT];
+        
+        /* Every other round drops the extension so only content can identify the file */
+        if (sample->bs_Extension != NULL && ((i / BENCH_SAMPLE_COUNT) & 1) == 0) {
+            SNPrintf(fileName, sizeof(fileName), "f%05ld.%s", i, sample->bs_Extension);
+        } else {
+            SNPrintf(fileName, sizeof(fileName), "f%05ld", i);
+        }
+        
+        file = Open(fileName, MODE_NEWFILE);
+        if (file == NULL) {
+            success = FALSE;
+            break;
+        }
+        
+        for (written = 0; written < size; written += chunk) {
+            chunk = size - written;
+            if (chunk > 4096) {
+                chunk = 4096;
+            }
+            
+            for (j = 0; j < chunk; j++) {
+                if (written + j < sample->bs_HeaderLength) {
+                    buffer[j] = sample->bs_Header[written + j];
+                } else if (sample->bs_Text) {
+                    buffer[j] = text[(written + j) % 45];
+                } else {
+                    seed = seed * 1103515245 + 12345;
+                    buffer[j] = (UBYTE)(seed >> 16);
+                }
+            }
+            
+            if (Write(file, buffer, chunk) != chunk) {
+                success = FALSE;
+                break;
+            }
+        }
+        
+        Close(file);
+    }
+    
+    CurrentDir(oldDir);
+    FreeVec(buffer);
+    UnLock(drawerLock);
+    
+    return success;
+}
+
+/* Benchmark every identification engine over the files in a drawer */
+/* Results are written as one line of key=value pairs per engine */
+BOOL RunIdentifyBenchmark(STRPTR drawerPath, BPTR outFile)
+{
+    BPTR drawerLock;
+    struct ExAllControl *eac;
+    struct ExAllData *ead;
+    struct ExAllData *exAllBuffer;
+    STRPTR *names = NULL;
+    LONG nameCount = 0;
+    LONG nameMax = 0;
+    ULONG *latencies = NULL;
+    struct IdentifyEngine *engine;
+    struct EClockVal runStart;
+    struct EClockVal runEnd;
+    struct EClockVal start;
+    struct EClockVal end;
+    UBYTE line[256];
+    ULONG fixedCalls;
+    ULONG fixedRules;
+    ULONG adaptiveCalls;
+    ULONG adaptiveRules;
+    ULONG byteMicros;
+    ULONG wordMicros;
+    UBYTE *header;
+    BPTR file;
+    BPTR oldDir;
+    LONG headerBytes;
+    LONG length;
+    LONG mismatches;
+    LONG guessed;
+    LONG run;
+    BOOL more;
+    BOOL success = TRUE;
+    LONG i;
+    
+    if (TimerBase == NULL) {
+        PutStr("ProjectX: timer.device is needed for benchmarking.\n");
+        return FALSE;
+    }
+    
+    drawerLock = Lock(drawerPath, SHARED_LOCK);
+    if (drawerLock == NULL) {
+        PutStr("ProjectX: Could not lock benchmark drawer.\n");
+        return FALSE;
+    }
+    
+    exAllBuffer = AllocVec(4096, MEMF_ANY);
+    eac = (struct ExAllControl *)AllocDosObject(DOS_EXALLCONTROL, NULL);
+    if (exAllBuffer == NULL || eac == NULL) {
+        success = FALSE;
+    }
+    
+    /* Collect the file names first so every engine sees the same corpus */
+    if (success) {
+        eac->eac_LastKey = 0;
+        do {
+            more = ExAll(drawerLock, exAllBuffer, 4096, ED_TYPE, eac);
+            if (!more && IoErr() != ERROR_NO_MORE_ENTRIES) {
+                success = FALSE;
+                break;
+            }
+            
+            for (ead = exAllBuffer; eac->eac_Entries > 0 && ead != NULL; ead = ead->ed_Next) {
+                LONG len;
+                
+                /* Only files, and not their icons */
+                len = strlen((char *)ead->ed_Name);
+                if (ead->ed_Type >= 0 || (len > 5 && Stricmp(ead->ed_Name + len - 5, ".info") == 0)) {
+                    continue;
+                }
+                
+                if (nameCount == nameMax) {
+                    STRPTR *newNames;
+                    
+                    nameMax = nameMax ? nameMax * 2 : 256;
+                    newNames = AllocVec(nameMax * sizeof(STRPTR), MEMF_ANY);
+                    if (newNames == NULL) {
+                        success = FALSE;
+                        break;
+                    }
+                    if (names != NULL) {
+                        CopyMem(names, newNames, nameCount * sizeof(STRPTR));
+                        FreeVec(names);
+                    }
+                    names = newNames;
+                }
+                
+                names[nameCount] = AllocVec(len + 1, MEMF_ANY);
+                if (names[nameCount] == NULL) {
+                    success = FALSE;
+                    break;
+                }
+                Strncpy(names[nameCount], ead->ed_Name, len + 1);
+                nameCount++;
+            }
+        } while (more && success);
+        
+        if (more) {
+            ExAllEnd(drawerLock, exAllBuffer, 4096, ED_TYPE, eac);
+        }
+    }
+    
+    if (success && nameCount == 0) {
+        PutStr("ProjectX: Benchmark drawer has no files.\n");
+        success = FALSE;
+    }
+    
+    if (success) {
+        latencies = AllocVec(nameCount * sizeof(ULONG), MEMF_ANY);
+        if (latencies == NULL) {
+            success = FALSE;
+        }
+    }
+    
+    if (success) {
+        SNPrintf(line, sizeof(line), "projectx-bench version=3 files=%ld eclock=%lu\n",
+            nameCount, eclockFrequency);
+        FPuts(outFile, line);
+    }
+    
+    for (engine = identifyEngines; success && engine->ie_Name != NULL; engine++) {
+        LONG identified = 0;
+        LONG bytesRead = 0;
+        BOOL bytesKnown = TRUE;
+        ULONG totalMicros;
+        ULONG filesPerSecond = 0;
+        STRPTR typeIdentifier;
+        UBYTE typeBuffer[IDENTIFY_TYPE_SIZE];
+        LONG fileBytes;
+        
+        ReadTimer(&runStart);
+        for (i = 0; i < nameCount; i++) {
+            ReadTimer(&start);
+            typeIdentifier = engine->ie_Identify(names[i], drawerLock, typeBuffer, &fileBytes);
+            ReadTimer(&end);
+            
+            latencies[i] = ElapsedMicros(&start, &end);
+            if (typeIdentifier != NULL && *typeIdentifier != '\0') {
+                identified++;
+            }
+            if (fileBytes >= 0) {
+                bytesRead += fileBytes;
+            } else {
+                bytesKnown = FALSE;
+            }
+            
+            if (SetSignal(0L, SIGBREAKF_CTRL_C) & SIGBREAKF_CTRL_C) {
+                PrintFault(ERROR_BREAK, NULL);
+                success = FALSE;
+                break;
+            }
+        }
+        ReadTimer(&runEnd);
+        
+        if (!success) {
+            break;
+        }
+        
+        totalMicros = ElapsedMicros(&runStart, &runEnd);
+        if (totalMicros >= 1000) {
+            filesPerSecond = (nameCount * 1000) / (totalMicros / 1000);
+        }
+        
+        SortLatencies(latencies, nameCount);
+        
+        SNPrintf(line, sizeof(line),
+            "engine=%s mode=serial files=%ld identified=%ld total_us=%lu files_per_sec=%lu "
+            "bytes_per_file=%ld p50_us=%lu p90_us=%lu p99_us=%lu max_us=%lu\n",
+            engine->ie_Name, nameCount, identified, totalMicros, filesPerSecond,
+            bytesKnown ? bytesRead / nameCount : -1L,
+            latencies[(nameCount - 1) * 50 / 100],
+            latencies[(nameCount - 1) * 90 / 100],
+            latencies[(nameCount - 1) * 99 / 100],
+            latencies[nameCount - 1]);
+        FPuts(outFile, line);
+    }
+    
+    /* Name guesses over the same names - the fixed table order, then adapting to the hits */
+    if (success) {
+        guessed = 0;
+        CoreResetGuesses(FALSE);
+        for (i = 0; i < nameCount; i++) {
+            if (CoreGuessType(names[i]) != NULL) {
+                guessed++;
+            }
+        }
+        CoreGuessCost(&fixedCalls, &fixedRules);
+        
+        CoreResetGuesses(TRUE);
+        for (i = 0; i < nameCount; i++) {
+            CoreGuessType(names[i]);
+        }
+        CoreGuessCost(&adaptiveCalls, &adaptiveRules);
+        
+        SNPrintf(line, sizeof(line),
+            "rules=name-guess files=%ld guessed=%ld fixed_mean_rules=%lu.%02lu adaptive_mean_rules=%lu.%02lu\n",
+            nameCount, guessed,
+            fixedRules / fixedCalls, (fixedRules * 100 / fixedCalls) % 100,
+            adaptiveRules / adaptiveCalls, (adaptiveRules * 100 / adaptiveCalls) % 100);
+        FPuts(outFile, line);
+    }
+    
+#if defined(__SASC) || defined(AMIGA)
+    /* Text classification kernels over the same file headers, byte loop against longword loop */
+    /* Not in the host build, whose clock does not count CPU time - bench_core times them there */
+    header = success ? AllocVec(TEXT_HEADER_SIZE, MEMF_ANY) : NULL;
+    if (header != NULL) {
+        byteMicros = 0;
+        wordMicros = 0;
+        headerBytes = 0;
+        mismatches = 0;
+        
+        oldDir = CurrentDir(drawerLock);
+        for (i = 0; i < nameCount; i++) {
+            file = Open(names[i], MODE_OLDFILE);
+            if (file == NULL) {
+                continue;
+            }
+            length = Read(file, header, TEXT_HEADER_SIZE);
+            Close(file);
+            if (length <= 0) {
+                continue;
+            }
+            headerBytes += length;
+            
+            ReadTimer(&start);
+            for (run = 0; run < TEXT_BENCH_RUNS; run++) {
+                CoreClassifyTextBytes(header, length);
+            }
+            ReadTimer(&end);
+            byteMicros += ElapsedMicros(&start, &end);
+            
+            ReadTimer(&start);
+            for (run = 0; run < TEXT_BENCH_RUNS; run++) {
+                CoreClassifyText(header, length);
+            }
+            ReadTimer(&end);
+            wordMicros += ElapsedMicros(&start, &end);
+            
+            if (CoreClassifyText(header, length) != CoreClassifyTextBytes(header, length)) {
+                mismatches++;
+            }
+        }
+        CurrentDir(oldDir);
+        FreeVec(header);
+        
+        SNPrintf(line, sizeof(line),
+            "kernel=text files=%ld bytes=%ld runs=%ld byte_loop_us=%lu word_loop_us=%lu mismatches=%ld\n",
+            nameCount, headerBytes, (LONG)TEXT_BENCH_RUNS, byteMicros, wordMicros, mismatches);
+        FPuts(outFile, line);
+    }
+#endif
+    
+    if (latencies != NULL) {
+        FreeVec(latencies);
+    }
+    for (i = 0; i < nameCount; i++) {
+        FreeVec(names[i]);
+    }
+    if (names != NULL) {
+        FreeVec(names);
+    }
+    if (eac != NULL) {
+        FreeDosObject(DOS_EXALLCONTROL, eac);
+    }
+    if (exAllBuffer != NULL) {
+        FreeVec(exAllBuffer);
+    }
+    UnLock(drawerLock);
+    
+    return success;
+}
+
+/* Look up a file in the resident companion's prefetch cache */
+/* Only metadata is read: the entry must match the file's current size and datestamp */
+/* On success typeOut points to a static buffer and toolOut to an AllocVec'd */
+/* default tool (or NULL if none was resolved), which the caller must FreeVec */
+BOOL LookupPrefetched(STRPTR fileName, BPTR fileLock, STRPTR *typeOut, STRPTR *toolOut,
+                      struct LaunchProfile *profileOut)
+{
+    static UBYTE typeBuffer[64];
+    struct PrefetchCache *cache;
+    struct PrefetchEntry *entry;
+    struct FileInfoBlock *fib;
+    UBYTE filePath[512];
+    BPTR lock;
+    BPTR oldDir;
+    BOOL found = FALSE;
+    
+    *typeOut = NULL;
+    *toolOut = NULL;
+    if (profileOut != NULL) {
+        memset(profileOut, 0, sizeof(struct LaunchProfile));
+    }
+    
+    /* Cheap check first - without the companion there is nothing to look up */
+    Forbid();
+    cache = (struct PrefetchCache *)FindSemaphore(PREFETCH_SEMAPHORE);
+    Permit();
+    if (cache == NULL) {
+        return FALSE;
+    }
+    
+    if (!NameFromLock(fileLock, filePath, sizeof(filePath)) ||
+        !AddPart(filePath, fileName, sizeof(filePath))) {
+        return FALSE;
+    }
+    
+    fib = (struct FileInfoBlock *)AllocDosObject(DOS_FIB, NULL);
+    if (fib == NULL) {
+        return FALSE;
+    }
+    
+    oldDir = CurrentDir(fileLock);
+    lock = Lock(fileName, SHARED_LOCK);
+    CurrentDir(oldDir);
+    
+    if (lock != NULL && Examine(lock, fib)) {
+        /* Find it again - the companion may have quit in the meantime */
+        Forbid();
+        cache = (struct PrefetchCache *)FindSemaphore(PREFETCH_SEMAPHORE);
+        if (cache != NULL) {
+            ObtainSemaphoreShared(&cache->pc_Semaphore);
+        }
+        Permit();
+        
+        if (cache != NULL) {
+            entry = FindPrefetchEntry(cache, filePath);
+            if (entry != NULL &&
+                entry->pe_Size == fib->fib_Size &&
+                CompareDates(&entry->pe_Date, &fib->fib_Date) == 0) {
+                Strncpy(typeBuffer, entry->pe_Type, sizeof(typeBuffer));
+                *typeOut = typeBuffer;
+                if (profileOut != NULL) {
+                    *profileOut = entry->pe_Profile;
+                }
+                if (entry->pe_Tool[0] != '\0') {
+                    ULONG toolLen = strlen((char *)entry->pe_Tool);
+                    
+                    *toolOut = AllocVec(toolLen + 1, MEMF_CLEAR);
+                    if (*toolOut != NULL) {
+                        Strncpy(*toolOut, entry->pe_Tool, toolLen + 1);
+                    }
+                }
+                found = TRUE;
+            }
+            ReleaseSemaphore(&cache->pc_Semaphore);
+        }
+    }
+    
+    if (lock != NULL) {
+        UnLock(lock);
+    }
+    FreeDosObject(DOS_FIB, fib);
+    
+    return found;
+}
+
+/* Find a prefetch entry by full path, caller must hold the cache semaphore */
+struct PrefetchEntry *FindPrefetchEntry(struct PrefetchCache *cache, STRPTR path)
+{
+    struct PrefetchEntry *entry;
+    
+    for (entry = (struct PrefetchEntry *)cache->pc_Entries.mlh_Head;
+         entry->pe_Node.mln_Succ != NULL;
+         entry = (struct PrefetchEntry *)entry->pe_Node.mln_Succ) {
+        if (Stricmp(entry->pe_Path, path) == 0) {
+            return entry;
+        }
+    }
+    
+    return NULL;
+}
+
+/* Add or replace a prefetch entry, dropping the oldest entries beyond maxEntries */
+BOOL AddPrefetchEntry(struct PrefetchCache *cache, STRPTR path, struct FileInfoBlock *fib,
+                      STRPTR typeIdentifier, STRPTR tool, struct LaunchProfile *profile, LONG maxEntries)
+{
+    struct PrefetchEntry *entry;
+    struct PrefetchEntry *oldEntry;
+    ULONG pathLen;
+    ULONG typeLen;
+    ULONG toolLen;
+    ULONG allocSize;
+    
+    pathLen = strlen((char *)path) + 1;
+    typeLen = strlen((char *)typeIdentifier) + 1;
+    toolLen = (tool != NULL ? strlen((char *)tool) : 0) + 1;
+    allocSize = sizeof(struct PrefetchEntry) + pathLen + typeLen + toolLen;
+    
+    /* Shared with other processes, so it must be public memory */
+    entry = AllocMem(allocSize, MEMF_PUBLIC | MEMF_CLEAR);
+    if (entry == NULL) {
+        return FALSE;
+    }
+    
+    entry->pe_AllocSize = allocSize;
+    entry->pe_Date = fib->fib_Date;
+    entry->pe_Size = fib->fib_Size;
+    entry->pe_Path = (STRPTR)(entry + 1);
+    entry->pe_Type = entry->pe_Path + pathLen;
+    entry->pe_Tool = entry->pe_Type + typeLen;
+    Strncpy(entry->pe_Path, path, pathLen);
+    Strncpy(entry->pe_Type, typeIdentifier, typeLen);
+    if (tool != NULL) {
+        Strncpy(entry->pe_Tool, tool, toolLen);
+    }
+    if (profile != NULL) {
+        entry->pe_Profile = *profile;
+    }
+    
+    ObtainSemaphore(&cache->pc_Semaphore);
+    
+    oldEntry = FindPrefetchEntry(cache, path);
+    if (oldEntry != NULL) {
+        Remove((struct Node *)oldEntry);
+        FreeMem(oldEntry, oldEntry->pe_AllocSize);
+        cache->pc_Count--;
+    }
+    
+    AddTail((struct List *)&cache->pc_Entries, (struct Node *)entry);
+    cache->pc_Count++;
+    
+    while (cache->pc_Count > maxEntries) {
+        oldEntry = (struct PrefetchEntry *)RemHead((struct List *)&cache->pc_Entries);
+        FreeMem(oldEntry, oldEntry->pe_AllocSize);
+        cache->pc_Count--;
+    }
+    
+    ReleaseSemaphore(&cache->pc_Semaphore);
+    
+    return TRUE;
+}
+
+/* Pre-identify and pre-resolve up to budget files in a drawer */
+/* Returns the number of files identified, or -1 if interrupted by Ctrl-C */
+LONG PrefetchDrawerFiles(struct PrefetchCache *cache, STRPTR drawerPath, LONG budget, LONG maxEntries)
+{
+    BPTR drawerLock;
+    BPTR oldDir;
+    struct FileInfoBlock *fib;
+    struct PrefetchEntry *entry;
+    UBYTE filePath[512];
+    UBYTE defIconName[64];
+    UBYTE typeBuffer[IDENTIFY_TYPE_SIZE];
+    STRPTR typeIdentifier;
+    STRPTR defaultTool;
+    LONG identified = 0;
+    LONG bytesRead;
+    LONG len;
+    BOOL current;
+    
+    drawerLock = Lock(drawerPath, SHARED_LOCK);
+    if (drawerLock == NULL) {
+        return 0;
+    }
+    
+    fib = (struct FileInfoBlock *)AllocDosObject(DOS_FIB, NULL);
+    if (fib == NULL || !Examine(drawerLock, fib) || fib->fib_DirEntryType < 0) {
+        if (fib != NULL) {
+            FreeDosObject(DOS_FIB, fib);
+        }
+        UnLock(drawerLock);
+        return 0;
+    }
+    
+    oldDir = CurrentDir(drawerLock);
+    
+    while (identified < budget && ExNext(drawerLock, fib)) {
+        if (SetSignal(0L, SIGBREAKF_CTRL_C) & SIGBREAKF_CTRL_C) {
+            identified = -1;
+            break;
+        }
+        
+        /* Project files only - skip drawers and icons */
+        len = strlen(fib->fib_FileName);
+        if (fib->fib_DirEntryType >= 0 ||
+            (len > 5 && Stricmp((STRPTR)fib->fib_FileName + len - 5, ".info") == 0)) {
+            continue;
+        }
+        
+        Strncpy(filePath, drawerPath, sizeof(filePath));
+        if (!AddPart(filePath, fib->fib_FileName, sizeof(filePath))) {
+            continue;
+        }
+        
+        /* Skip files that are already cached and unchanged */
+        ObtainSemaphoreShared(&cache->pc_Semaphore);
+        entry = FindPrefetchEntry(cache, filePath);
+        current = (entry != NULL &&
+                   entry->pe_Size == fib->fib_Size &&
+                   CompareDates(&entry->pe_Date, &fib->fib_Date) == 0);
+        ReleaseSemaphore(&cache->pc_Semaphore);
+        if (current) {
+            continue;
+        }
+        
+        typeIdentifier = IdentifyWithDefIcons(fib->fib_FileName, drawerLock, typeBuffer, &bytesRead);
+        if (typeIdentifier != NULL && *typeIdentifier != '\0') {
+            defIconName[0] = '\0';
+            defaultTool = GetDefaultToolFromType(typeIdentifier, defIconName, sizeof(defIconName));
+            AddPrefetchEntry(cache, filePath, fib, typeIdentifier, defaultTool, &resolvedProfile, maxEntries);
+            if (defaultTool != NULL) {
+                FreeVec(defaultTool);
+            }
+        }
+        identified++;
+    }
+    
+    CurrentDir(oldDir);
+    FreeDosObject(DOS_FIB, fib);
+    UnLock(drawerLock);
+    
+    return identified;
+}
+
+/* Resident companion - watches for drawers opened on Workbench and */
+/* pre-identifies the files in them at low priority, until Ctrl-C */
+BOOL RunResident(LONG budget, LONG interval, LONG maxEntries, LONG priority)
+{
+    struct PrefetchCache *cache;
+    struct PrefetchEntry *entry;
+    struct StandbyTool *standby;
+    struct PrefetchDrawer *drawer;
+    struct PrefetchDrawer *nextDrawer;
+    struct MinList knownDrawers;
+    struct List *openDrawers;
+    struct Node *node;
+    struct TagItem wbTags[2];
+    LONG oldPriority;
+    LONG tick;
+    BOOL running = TRUE;
+    
+    if (budget <= 0 || interval <= 0 || maxEntries <= 0) {
+        PutStr("ProjectX: BUDGET, INTERVAL and MAXFILES must be positive.\n");
+        return FALSE;
+    }
+    
+    /* Only one companion at a time */
+    Forbid();
+    cache = (struct PrefetchCache *)FindSemaphore(PREFETCH_SEMAPHORE);
+    Permit();
+    if (cache != NULL) {
+        PutStr("ProjectX: Resident companion is already running.\n");
+        return FALSE;
+    }
+    
+    cache = AllocMem(sizeof(struct PrefetchCache), MEMF_PUBLIC | MEMF_CLEAR);
+    if (cache == NULL) {
+        return FALSE;
+    }
+    
+    NewList((struct List *)&cache->pc_Entries);
+    NewList((struct List *)&cache->pc_Spares);
+    LoadStandbyTools(cache);
+    cache->pc_LaunchPort = CreateMsgPort();
+    Strncpy(cache->pc_Name, PREFETCH_SEMAPHORE, sizeof(cache->pc_Name));
+    cache->pc_Semaphore.ss_Link.ln_Name = (char *)cache->pc_Name;
+    cache->pc_Semaphore.ss_Link.ln_Pri = 0;
+    AddSemaphore(&cache->pc_Semaphore);
+    
+    NewList((struct List *)&knownDrawers);
+    oldPriority = SetTaskPri(FindTask(NULL), priority);
+    
+    PutStr("ProjectX: Resident, press Ctrl-C to quit.\n");
+    
+    while (running) {
+        /* Mark every known drawer as closed, then look at what Workbench has open */
+        for (drawer = (struct PrefetchDrawer *)knownDrawers.mlh_Head;
+             drawer->pd_Node.mln_Succ != NULL;
+             drawer = (struct PrefetchDrawer *)drawer->pd_Node.mln_Succ) {
+            drawer->pd_Seen = FALSE;
+        }
+        
+        openDrawers = NULL;
+        wbTags[0].ti_Tag = WBCTRLA_GetOpenDrawerList;
+        wbTags[0].ti_Data = (ULONG)&openDrawers;
+        wbTags[1].ti_Tag = TAG_DONE;
+        
+        if (WorkbenchControlA(NULL, wbTags) && openDrawers != NULL) {
+            for (node = openDrawers->lh_Head; node->ln_Succ != NULL && running; node = node->ln_Succ) {
+                for (drawer = (struct PrefetchDrawer *)knownDrawers.mlh_Head;
+                     drawer->pd_Node.mln_Succ != NULL;
+                     drawer = (struct PrefetchDrawer *)drawer->pd_Node.mln_Succ) {
+                    if (Stricmp(drawer->pd_Path, (STRPTR)node->ln_Name) == 0) {
+                        break;
+                    }
+                }
+                
+                if (drawer->pd_Node.mln_Succ != NULL) {
+                    /* Already open at the last poll */
+                    drawer->pd_Seen = TRUE;
+                    continue;
+                }
+                
+                /* Newly opened drawer - remember it and prefetch its files */
+                drawer = AllocVec(sizeof(struct PrefetchDrawer) + strlen(node->ln_Name), MEMF_CLEAR);
+                if (drawer != NULL) {
+                    Strncpy(drawer->pd_Path, (STRPTR)node->ln_Name, strlen(node->ln_Name) + 1);
+                    drawer->pd_Seen = TRUE;
+                    AddTail((struct List *)&knownDrawers, (struct Node *)drawer);
+                    
+                    if (PrefetchDrawerFiles(cache, drawer->pd_Path, budget, maxEntries) < 0) {
+                        running = FALSE;
+                    }
+                }
+            }
+            
+            wbTags[0].ti_Tag = WBCTRLA_FreeOpenDrawerList;
+            wbTags[0].ti_Data = (ULONG)openDrawers;
+            WorkbenchControlA(NULL, wbTags);
+        }
+        
+        /* Forget drawers that have been closed so reopening them prefetches again */
+        for (drawer = (struct PrefetchDrawer *)knownDrawers.mlh_Head;
+             drawer->pd_Node.mln_Succ != NULL;
+             drawer = nextDrawer) {
+            nextDrawer = (struct PrefetchDrawer *)drawer->pd_Node.mln_Succ;
+            if (!drawer->pd_Seen) {
+                Remove((struct Node *)drawer);
+                FreeVec(drawer);
+            }
+        }
+        
+        /* Sleep in one second steps so Ctrl-C is noticed promptly, and taken spares */
+        /* are replaced within a second */
+        for (tick = 0; tick < interval && running; tick++) {
+            MaintainSpares(cache);
+            CollectLaunches(cache);
+            Delay(TICKS_PER_SECOND);
+            if (SetSignal(0L, SIGBREAKF_CTRL_C) & SIGBREAKF_CTRL_C) {
+                running = FALSE;
+            }
+        }
+    }
+    
+    SetTaskPri(FindTask(NULL), oldPriority);
+    
+    /* Withdraw the cache, then wait for any ProjectX still reading it */
+    Forbid();
+    RemSemaphore(&cache->pc_Semaphore);
+    Permit();
+    ObtainSemaphore(&cache->pc_Semaphore);
+    ReleaseSemaphore(&cache->pc_Semaphore);
+    
+    /* Tools started directly reply to our port when they quit, so it must outlive them */
+    if (cache->pc_LaunchPort != NULL) {
+        if (cache->pc_Launches > 0) {
+            Printf("ProjectX: Waiting for %ld directly launched tools to quit.\n", cache->pc_Launches);
+        }
+        while (cache->pc_Launches > 0) {
+            WaitPort(cache->pc_LaunchPort);
+            CollectLaunches(cache);
+        }
+        DeleteMsgPort(cache->pc_LaunchPort);
+    }
+    
+    while ((entry = (struct PrefetchEntry *)RemHead((struct List *)&cache->pc_Entries)) != NULL) {
+        FreeMem(entry, entry->pe_AllocSize);
+    }
+    /* Spares that are still idle keep running as ordinary instances */
+    while ((standby = (struct StandbyTool *)RemHead((struct List *)&cache->pc_Spares)) != NULL) {
+        FreeVec(standby);
+    }
+    FreeDrawerRules(cache->pc_Rules);
+    FreePatternRules(cache->pc_Patterns);
+    FreeMem(cache, sizeof(struct PrefetchCache));
+    
+    while ((drawer = (struct PrefetchDrawer *)RemHead((struct List *)&knownDrawers)) != NULL) {
+        FreeVec(drawer);
+    }
+    
+    return TRUE;
+}
+
+/* Get the datestamp and size of dirName/iconName.info without reading the icon */
+BOOL ExamineIcon(STRPTR dirName, STRPTR iconName, struct DateStamp *dateOut, LONG *sizeOut)
+{
+    UBYTE iconPath[128];
+    struct FileInfoBlock *fib;
+    BPTR lock;
+    BOOL found = FALSE;
+    
+    SNPrintf(iconPath, sizeof(iconPath), "%s/%s.info", dirName, iconName);
+    
+    lock = Lock(iconPath, SHARED_LOCK);
+    if (lock != NULL) {
+        fib = (struct FileInfoBlock *)AllocDosObject(DOS_FIB, NULL);
+        if (fib != NULL) {
+            if (Examine(lock, fib)) {
+                *dateOut = fib->fib_Date;
+                *sizeOut = fib->fib_Size;
+                found = TRUE;
+            }
+            FreeDosObject(DOS_FIB, fib);
+        }
+        UnLock(lock);
+    }
+    
+    if (!found) {
+        dateOut->ds_Days = 0;
+        dateOut->ds_Minute = 0;
+        dateOut->ds_Tick = 0;
+        *sizeOut = -1;
+    }
+    
+    return found;
+}
+
+/* Load the resolution cache with a single read */
+VOID LoadResolveCache(VOID)
+{
+    struct ResolveCacheHeader *header;
+    struct ResolveCacheRecord record;
+    struct ResolveEntry *entry;
+    struct ResolveEntry *lastEntry = NULL;
+    struct FileInfoBlock *fib;
+    struct DateStamp arcDirDate;
+    struct DateStamp envDirDate;
+    UBYTE bootVar[4];
+    UBYTE *buffer = NULL;
+    UBYTE *pos;
+    UBYTE *end;
+    BPTR file;
+    LONG size = 0;
+    LONG i;
+    
+    if (resolveCacheLoaded) {
+        return;
+    }
+    resolveCacheLoaded = TRUE;
+    
+    /* ENV:Sys icons get new datestamps from the copy made at every boot */
+    if (GetVar(RESOLVE_BOOT_VAR, bootVar, sizeof(bootVar), GVF_GLOBAL_ONLY) >= 0) {
+        resolveNewBoot = FALSE;
+    } else {
+        SetVar(RESOLVE_BOOT_VAR, "1", 1, GVF_GLOBAL_ONLY);
+    }
+    
+    /* The drawer datestamps tell whether any def_ icon was saved, added or removed since */
+    ExamineDirDate("ENVARC:Sys", &arcDirDate);
+    ExamineDirDate("ENV:Sys", &envDirDate);
+    
+    fib = (struct FileInfoBlock *)AllocDosObject(DOS_FIB, NULL);
+    if (fib == NULL) {
+        return;
+    }
+    
+    file = Open(RESOLVE_CACHE_FILE, MODE_OLDFILE);
+    if (file != NULL) {
+        if (ExamineFH(file, fib)) {
+            size = fib->fib_Size;
+        }
+        if (size >= sizeof(struct ResolveCacheHeader) && size <= 32768) {
+            buffer = AllocVec(size, MEMF_ANY);
+            if (buffer != NULL && Read(file, buffer, size) != size) {
+                FreeVec(buffer);
+                buffer = NULL;
+            }
+        }
+        Close(file);
+    }
+    FreeDosObject(DOS_FIB, fib);
+    
+    if (buffer == NULL) {
+        return;
+    }
+    
+    header = (struct ResolveCacheHeader *)buffer;
+    if (header->rh_Magic == RESOLVE_CACHE_MAGIC && header->rh_Version == RESOLVE_CACHE_VERSION) {
+        resolveDirsChanged = (CompareDates(&header->rh_ArcDirDate, &arcDirDate) != 0 ||
+                              CompareDates(&header->rh_EnvDirDate, &envDirDate) != 0);
+        
+        /* Written back with the new datestamps, so the icons are probed once per change */
+        if (resolveDirsChanged) {
+            resolveCacheDirty = TRUE;
+        }
+        
+        pos = buffer + sizeof(struct ResolveCacheHeader);
+        end = buffer + size;
+        for (i = 0; i < header->rh_Count; i++) {
+            if (pos + sizeof(struct ResolveCacheRecord) > end) {
+                break;
+            }
+            /* Copied out rather than read in place, a damaged file must not cause an odd address access */
+            CopyMem(pos, &record, sizeof(struct ResolveCacheRecord));
+            if (pos + sizeof(struct ResolveCacheRecord) + record.rr_TypeLength + record.rr_ToolLength +
+                record.rr_CliLength > end ||
+                record.rr_TypeLength >= sizeof(entry->re_Type) || record.rr_ToolLength == 0 ||
+                record.rr_CliLength >= sizeof(entry->re_Profile.lp_Cli)) {
+                /* Truncated or corrupt - keep what was read so far */
+                break;
+            }
+            
+            entry = AllocVec(sizeof(struct ResolveEntry), MEMF_CLEAR);
+            if (entry == NULL) {
+                break;
+            }
+            entry->re_ArcDate = record.rr_ArcDate;
+            entry->re_EnvDate = record.rr_EnvDate;
+            entry->re_ArcSize = record.rr_ArcSize;
+            entry->re_EnvSize = record.rr_EnvSize;
+            entry->re_Checked = !resolveDirsChanged;
+            entry->re_Profile.lp_Stack = record.rr_Stack;
+            entry->re_Profile.lp_Priority = record.rr_Priority;
+            entry->re_Profile.lp_Flags = record.rr_Flags;
+            pos += sizeof(struct ResolveCacheRecord);
+            CopyMem(pos, entry->re_Type, record.rr_TypeLength);
+            pos += record.rr_TypeLength;
+            CopyMem(pos, entry->re_Tool, record.rr_ToolLength);
+            pos += record.rr_ToolLength;
+            CopyMem(pos, entry->re_Profile.lp_Cli, record.rr_CliLength);
+            pos += record.rr_CliLength;
+            pos += (record.rr_TypeLength + record.rr_ToolLength + record.rr_CliLength) & 1;
+            
+            if (lastEntry == NULL) {
+                resolveEntries = entry;
+            } else {
+                lastEntry->re_Next = entry;
+            }
+            lastEntry = entry;
+        }
+    }
+    
+    FreeVec(buffer);
+}
+
+/* Write the resolution cache back if it changed, via a temporary file and rename */
+VOID SaveResolveCache(VOID)
+{
+    struct ResolveCacheHeader header;
+    struct ResolveCacheRecord record;
+    struct ResolveEntry *entry;
+    struct ResolveEntry **link;
+    UBYTE pad = 0;
+    LONG padLength;
+    BPTR file;
+    BPTR lock;
+    BOOL success = TRUE;
+    
+    if (!resolveCacheDirty) {
+        return;
+    }
+    resolveCacheDirty = FALSE;
+    
+    memset(&header, 0, sizeof(header));
+    header.rh_Magic = RESOLVE_CACHE_MAGIC;
+    header.rh_Version = RESOLVE_CACHE_VERSION;
+    ExamineDirDate("ENVARC:Sys", &header.rh_ArcDirDate);
+    ExamineDirDate("ENV:Sys", &header.rh_EnvDirDate);
+    
+    /* The new datestamps vouch for every entry, so those not used this run are checked now */
+    link = &resolveEntries;
+    while ((entry = *link) != NULL) {
+        if (!entry->re_Checked && !ValidateResolveEntry(entry)) {
+            *link = entry->re_Next;
+            FreeVec(entry);
+            continue;
+        }
+        if (entry->re_Tool[0] != '\0') {
+            header.rh_Count++;
+        }
+        link = &entry->re_Next;
+    }
+    
+    /* Make sure ENVARC:ProjectX exists */
+    lock = Lock(RESOLVE_CACHE_DIR, SHARED_LOCK);
+    if (lock == NULL) {
+        lock = CreateDir(RESOLVE_CACHE_DIR);
+    }
+    if (lock == NULL) {
+        return;
+    }
+    UnLock(lock);
+    
+    file = Open(RESOLVE_CACHE_TEMP, MODE_NEWFILE);
+    if (file == NULL) {
+        return;
+    }
+    
+    if (Write(file, &header, sizeof(header)) != sizeof(header)) {
+        success = FALSE;
+    }
+    
+    for (entry = resolveEntries; entry != NULL && success; entry = entry->re_Next) {
+        if (entry->re_Tool[0] == '\0') {
+            continue;
+        }
+        
+        record.rr_ArcDate = entry->re_ArcDate;
+        record.rr_EnvDate = entry->re_EnvDate;
+        record.rr_ArcSize = entry->re_ArcSize;
+        record.rr_EnvSize = entry->re_EnvSize;
+        record.rr_Stack = entry->re_Profile.lp_Stack;
+        record.rr_Priority = entry->re_Profile.lp_Priority;
+        record.rr_Flags = entry->re_Profile.lp_Flags;
+        record.rr_TypeLength = strlen((char *)entry->re_Type);
+        record.rr_ToolLength = strlen((char *)entry->re_Tool);
+        record.rr_CliLength = strlen((char *)entry->re_Profile.lp_Cli);
+        record.rr_Pad = 0;
+        padLength = (record.rr_TypeLength + record.rr_ToolLength + record.rr_CliLength) & 1;
+        
+        if (Write(file, &record, sizeof(record)) != sizeof(record) ||
+            Write(file, entry->re_Type, record.rr_TypeLength) != record.rr_TypeLength ||
+            Write(file, entry->re_Tool, record.rr_ToolLength) != record.rr_ToolLength ||
+            Write(file, entry->re_Profile.lp_Cli, record.rr_CliLength) != record.rr_CliLength ||
+            Write(file, &pad, padLength) != padLength) {
+            success = FALSE;
+        }
+    }
+    
+    Close(file);
+    
+    /* Only replace the old cache once the new one is completely written */
+    if (success) {
+        DeleteFile(RESOLVE_CACHE_FILE);
+        if (!Rename(RESOLVE_CACHE_TEMP, RESOLVE_CACHE_FILE)) {
+            DeleteFile(RESOLVE_CACHE_TEMP);
+        }
+    } else {
+        DeleteFile(RESOLVE_CACHE_TEMP);
+    }
+}
+
+/* Free the resolution cache */
+VOID FreeResolveCache(VOID)
+{
+    struct ResolveEntry *entry;
+    struct ResolveEntry *nextEntry;
+    
+    for (entry = resolveEntries; entry != NULL; entry = nextEntry) {
+        nextEntry = entry->re_Next;
+        FreeVec(entry);
+    }
+    resolveEntries = NULL;
+    resolveCacheLoaded = FALSE;
+}
+
+/* Get the datestamp of a drawer, zero if it cannot be examined */
+VOID ExamineDirDate(STRPTR dirName, struct DateStamp *dateOut)
+{
+    struct FileInfoBlock *fib;
+    BPTR lock;
+    
+    dateOut->ds_Days = 0;
+    dateOut->ds_Minute = 0;
+    dateOut->ds_Tick = 0;
+    
+    lock = Lock(dirName, SHARED_LOCK);
+    if (lock != NULL) {
+        fib = (struct FileInfoBlock *)AllocDosObject(DOS_FIB, NULL);
+        if (fib != NULL) {
+            if (Examine(lock, fib)) {
+                *dateOut = fib->fib_Date;
+            }
+            FreeDosObject(DOS_FIB, fib);
+        }
+        UnLock(lock);
+    }
+}
+
+/* Check a cache entry against its ENV:Sys and ENVARC:Sys def_ icons by datestamp and size */
+/* Returns FALSE if either icon changed, and marks the entry checked otherwise */
+BOOL ValidateResolveEntry(struct ResolveEntry *entry)
+{
+    struct DateStamp iconDate;
+    struct DateStamp envDate;
+    UBYTE defIconName[72];
+    LONG iconSize;
+    
+    SNPrintf(defIconName, sizeof(defIconName), "def_%s", entry->re_Type);
+    
+    /* ENV:Sys is in RAM, so this check is cheap and done first */
+    ExamineIcon("ENV:Sys", defIconName, &envDate, &iconSize);
+    if (iconSize != entry->re_EnvSize) {
+        return FALSE;
+    }
+    
+    ExamineIcon("ENVARC:Sys", defIconName, &iconDate, &iconSize);
+    if (iconSize != entry->re_ArcSize || CompareDates(&iconDate, &entry->re_ArcDate) != 0) {
+        return FALSE;
+    }
+    
+    /* A new ENV:Sys datestamp is only the boot copy of an unchanged ENVARC:Sys icon on the first run */
+    if (CompareDates(&envDate, &entry->re_EnvDate) != 0) {
+        if (!resolveNewBoot) {
+            return FALSE;
+        }
+        entry->re_EnvDate = envDate;
+        resolveCacheDirty = TRUE;
+    }
+    
+    entry->re_Checked = TRUE;
+    return TRUE;
+}
+
+/* Look up a type in the resolution cache */
+/* Returns an AllocVec'd copy of the default tool, or NULL on a miss; */
+/* on a hit the type's launch profile is copied to profileOut if given */
+/* The def_ icons are only examined once ENV:Sys or ENVARC:Sys has a new datestamp, */
+/* as saving, adding or removing an icon gives its drawer */
+STRPTR LookupResolveCache(STRPTR typeIdentifier, struct LaunchProfile *profileOut)
+{
+    struct ResolveEntry *entry;
+    struct ResolveEntry **link;
+    STRPTR defaultTool;
+    ULONG toolLen;
+    
+    LoadResolveCache();
+    
+    for (link = &resolveEntries; (entry = *link) != NULL; link = &entry->re_Next) {
+        if (Stricmp(entry->re_Type, typeIdentifier) == 0) {
+            break;
+        }
+    }
+    if (entry == NULL) {
+        return NULL;
+    }
+    
+    if (!entry->re_Checked && !ValidateResolveEntry(entry)) {
+        /* Stale - drop it, the caller resolves afresh and records the new result */
+        *link = entry->re_Next;
+        FreeVec(entry);
+        resolveCacheDirty = TRUE;
+        return NULL;
+    }
+    
+    toolLen = strlen((char *)entry->re_Tool);
+    defaultTool = AllocVec(toolLen + 1, MEMF_CLEAR);
+    if (defaultTool != NULL) {
+        Strncpy(defaultTool, entry->re_Tool, toolLen + 1);
+    }
+    if (profileOut != NULL) {
+        *profileOut = entry->re_Profile;
+    }
+    
+    return defaultTool;
+}
+
+/* Record a fresh resolution in the cache, to be written back at exit */
+VOID RecordResolveCache(STRPTR typeIdentifier, STRPTR defaultTool, struct LaunchProfile *profile)
+{
+    struct ResolveEntry *entry;
+    struct ResolveEntry **link;
+    UBYTE defIconName[72];
+    LONG count = 0;
+    
+    if (strlen((char *)typeIdentifier) >= sizeof(entry->re_Type) ||
+        strlen((char *)defaultTool) >= sizeof(entry->re_Tool)) {
+        return;
+    }
+    
+    LoadResolveCache();
+    
+    /* Replace an existing entry for the type, or drop the last one when full */
+    for (link = &resolveEntries; (entry = *link) != NULL; link = &entry->re_Next) {
+        if (Stricmp(entry->re_Type, typeIdentifier) == 0 || ++count >= RESOLVE_CACHE_MAX) {
+            *link = entry->re_Next;
+            FreeVec(entry);
+            break;
+        }
+    }
+    
+    entry = AllocVec(sizeof(struct ResolveEntry), MEMF_CLEAR);
+    if (entry == NULL) {
+        return;
+    }
+    
+    SNPrintf(defIconName, sizeof(defIconName), "def_%s", typeIdentifier);
+    ExamineIcon("ENV:Sys", defIconName, &entry->re_EnvDate, &entry->re_EnvSize);
+    ExamineIcon("ENVARC:Sys", defIconName, &entry->re_ArcDate, &entry->re_ArcSize);
+    Strncpy(entry->re_Type, typeIdentifier, sizeof(entry->re_Type));
+    Strncpy(entry->re_Tool, defaultTool, sizeof(entry->re_Tool));
+    if (profile != NULL) {
+        entry->re_Profile = *profile;
+    }
+    entry->re_Checked = TRUE;
+    
+    /* Most recently resolved first */
+    entry->re_Next = resolveEntries;
+    resolveEntries = entry;
+    resolveCacheDirty = TRUE;
+}
+
+/* Parse a ProjectX.rules file */
+/* Each line is NAME <pattern> <tool> or TYPE <type> <tool>, first matching line wins */
+struct ToolRule *ParseToolRules(BPTR rulesFile)
+{
+    struct ToolRule *rules = NULL;
+    struct ToolRule *lastRule = NULL;
+    struct ToolRule *rule;
+    struct CSource cs;
+    UBYTE line[512];
+    UBYTE kind[16];
+    ULONG patternSize;
+    UWORD order = 0;
+    
+    while (FGets(rulesFile, line, sizeof(line) - 1) != NULL) {
+        if (line[0] == ';' || line[0] == '#' || line[0] == '\n' || line[0] == '\0') {
+            continue;
+        }
+        
+        /* Public memory, the rules may end up in the resident companion's cache */
+        rule = AllocVec(sizeof(struct ToolRule), MEMF_PUBLIC | MEMF_CLEAR);
+        if (rule == NULL) {
+            break;
+        }
+        
+        cs.CS_Buffer = line;
+        cs.CS_Length = strlen((char *)line);
+        cs.CS_CurChr = 0;
+        
+        if (ReadItem(kind, sizeof(kind), &cs) <= ITEM_NOTHING ||
+            ReadItem(rule->tl_Key, sizeof(rule->tl_Key), &cs) <= ITEM_NOTHING ||
+            ReadItem(rule->tl_Tool, sizeof(rule->tl_Tool), &cs) <= ITEM_NOTHING) {
+            FreeVec(rule);
+            continue;
+        }
+        
+        if (Stricmp(kind, "NAME") == 0) {
+            /* Compile the pattern once, matching is then cheap */
+            rule->tl_Kind = RULE_NAME;
+            patternSize = strlen((char *)rule->tl_Key) * 2 + 2;
+            rule->tl_Pattern = AllocVec(patternSize, MEMF_PUBLIC | MEMF_CLEAR);
+            if (rule->tl_Pattern == NULL ||
+                ParsePatternNoCase(rule->tl_Key, rule->tl_Pattern, patternSize) < 0) {
+                FreeToolRules(rule);
+                continue;
+            }
+        } else if (Stricmp(kind, "TYPE") == 0) {
+            rule->tl_Kind = RULE_TYPE;
+        } else {
+            /* Unknown rule kind - ignore the line */
+            FreeVec(rule);
+            continue;
+        }
+        
+        rule->tl_Order = order++;
+        if (lastRule == NULL) {
+            rules = rule;
+        } else {
+            lastRule->tl_Next = rule;
+        }
+        lastRule = rule;
+    }
+    
+    return rules;
+}
+
+/* Free a list of tool rules */
+VOID FreeToolRules(struct ToolRule *rules)
+{
+    struct ToolRule *rule;
+    struct ToolRule *nextRule;
+    
+    for (rule = rules; rule != NULL; rule = nextRule) {
+        nextRule = rule->tl_Next;
+        if (rule->tl_Pattern != NULL) {
+            FreeVec(rule->tl_Pattern);
+        }
+        FreeVec(rule);
+    }
+}
+
+/* Bring a cached drawer up to date, reading its ProjectX.rules only if it changed */
+/* A drawer with rules is checked by the rules file datestamp; a drawer without is */
+/* checked by its own datestamp, which changes when a rules file is created in it */
+BOOL ReadDrawerRules(struct DrawerRules *drawer, BPTR drawerLock)
+{
+    struct FileInfoBlock *fib;
+    BPTR rulesLock = NULL;
+    BPTR rulesFile;
+    BPTR oldDir;
+    
+    fib = (struct FileInfoBlock *)AllocDosObject(DOS_FIB, NULL);
+    if (fib == NULL) {
+        return FALSE;
+    }
+    
+    if (drawer->dr_HasFile) {
+        oldDir = CurrentDir(drawerLock);
+        rulesLock = Lock(DRAWER_RULES_FILE, SHARED_LOCK);
+        CurrentDir(oldDir);
+        if (rulesLock != NULL && Examine(rulesLock, fib) &&
+            CompareDates(&drawer->dr_Date, &fib->fib_Date) == 0) {
+            UnLock(rulesLock);
+            FreeDosObject(DOS_FIB, fib);
+            return TRUE;
+        }
+    } else if (Examine(drawerLock, fib) &&
+               drawer->dr_Date.ds_Days != 0 &&
+               CompareDates(&drawer->dr_Date, &fib->fib_Date) == 0) {
+        FreeDosObject(DOS_FIB, fib);
+        return TRUE;
+    }
+    
+    /* New or changed - (re)read the rules */
+    FreeToolRules(drawer->dr_Rules);
+    drawer->dr_Rules = NULL;
+    drawer->dr_HasFile = FALSE;
+    
+    if (rulesLock == NULL) {
+        oldDir = CurrentDir(drawerLock);
+        rulesLock = Lock(DRAWER_RULES_FILE, SHARED_LOCK);
+        CurrentDir(oldDir);
+    }
+    
+    if (rulesLock != NULL && Examine(rulesLock, fib)) {
+        drawer->dr_Date = fib->fib_Date;
+        rulesFile = OpenFromLock(rulesLock);
+        if (rulesFile != NULL) {
+            /* OpenFromLock took over the lock */
+            rulesLock = NULL;
+            drawer->dr_HasFile = TRUE;
+            drawer->dr_Rules = ParseToolRules(rulesFile);
+            Close(rulesFile);
+        }
+    } else if (Examine(drawerLock, fib)) {
+        drawer->dr_Date = fib->fib_Date;
+    }
+    
+    if (rulesLock != NULL) {
+        UnLock(rulesLock);
+    }
+    FreeDosObject(DOS_FIB, fib);
+    return TRUE;
+}
+
+/* Get the up to date rules of a drawer from a cache, adding the drawer if needed */
+struct DrawerRules *GetDrawerRules(struct DrawerRules **cache, BPTR drawerLock)
+{
+    struct FileLock *fileLock = (struct FileLock *)BADDR(drawerLock);
+    struct DrawerRules *drawer;
+    struct DrawerRules **link;
+    LONG count = 0;
+    
+    for (link = cache; (drawer = *link) != NULL; link = &drawer->dr_Next) {
+        if (drawer->dr_Volume == fileLock->fl_Volume && drawer->dr_Key == fileLock->fl_Key) {
+            break;
+        }
+        /* Full - drop the last drawer to make room */
+        if (++count >= MAX_CACHED_DRAWERS) {
+            *link = drawer->dr_Next;
+            FreeToolRules(drawer->dr_Rules);
+            FreeVec(drawer);
+            drawer = NULL;
+            break;
+        }
+    }
+    
+    if (drawer == NULL) {
+        drawer = AllocVec(sizeof(struct DrawerRules), MEMF_PUBLIC | MEMF_CLEAR);
+        if (drawer == NULL) {
+            return NULL;
+        }
+        drawer->dr_Volume = fileLock->fl_Volume;
+        drawer->dr_Key = fileLock->fl_Key;
+        drawer->dr_Next = *cache;
+        *cache = drawer;
+    }
+    
+    if (!ReadDrawerRules(drawer, drawerLock)) {
+        return NULL;
+    }
+    
+    return drawer;
+}
+
+/* Free a list of cached drawer rules */
+VOID FreeDrawerRules(struct DrawerRules *drawers)
+{
+    struct DrawerRules *drawer;
+    struct DrawerRules *nextDrawer;
+    
+    for (drawer = drawers; drawer != NULL; drawer = nextDrawer) {
+        nextDrawer = drawer->dr_Next;
+        FreeToolRules(drawer->dr_Rules);
+        FreeVec(drawer);
+    }
+}
+
+/* Find an override tool for a file in ProjectX.rules of its drawer or any parent, */
+/* or in the global name rules. Name rules win over type rules, so a name match never */
+/* identifies the file: the nearest drawer with a matching NAME rule, then the global */
+/* name rules, then the nearest drawer with a matching TYPE rule. The file is only */
+/* identified for that last step; *typeIdentifier then holds the result for the caller. */
+/* With typeIdentifier NULL only name rules are checked. */
+/* Returns an AllocVec'd tool name, or NULL if no rule matches */
+STRPTR FindOverrideTool(STRPTR fileName, BPTR fileLock, STRPTR *typeIdentifier)
+{
+    STRPTR tool;
+    BOOL typeRules = FALSE;
+    
+    if (fileLock == NULL) {
+        return NULL;
+    }
+    
+    tool = MatchDrawerRules(fileName, fileLock, NULL, &typeRules);
+    if (tool == NULL) {
+        tool = FindPatternTool(fileName);
+    }
+    if (tool != NULL || !typeRules || typeIdentifier == NULL) {
+        return tool;
+    }
+    
+    if (*typeIdentifier == NULL) {
+        *typeIdentifier = GetFileTypeIdentifier(fileName, fileLock);
+    }
+    if (*typeIdentifier != NULL) {
+        tool = MatchDrawerRules(fileName, fileLock, *typeIdentifier, NULL);
+    }
+    
+    return tool;
+}
+
+/* Walk ProjectX.rules from the file's drawer upwards for the first matching rule */
+/* With typeIdentifier NULL only NAME rules are matched, and *typeRules tells whether */
+/* any TYPE rule was passed; otherwise only TYPE rules for that type are matched */
+/* Returns an AllocVec'd tool name, or NULL if no rule matches */
+STRPTR MatchDrawerRules(STRPTR fileName, BPTR fileLock, STRPTR typeIdentifier, BOOL *typeRules)
+{
+    struct PrefetchCache *shared;
+    struct DrawerRules **cache;
+    struct DrawerRules *drawer;
+    struct ToolRule *rule;
+    BPTR drawerLock;
+    BPTR parentLock;
+    LONG depth;
+    STRPTR tool = NULL;
+    ULONG toolLen;
+    
+    /* Share the resident companion's cache if it is running */
+    Forbid();
+    shared = (struct PrefetchCache *)FindSemaphore(PREFETCH_SEMAPHORE);
+    if (shared != NULL) {
+        ObtainSemaphore(&shared->pc_Semaphore);
+    }
+    Permit();
+    cache = (shared != NULL) ? &shared->pc_Rules : &drawerRulesCache;
+    
+    drawerLock = DupLock(fileLock);
+    for (depth = 0; drawerLock != NULL && depth < MAX_RULES_DEPTH; depth++) {
+        drawer = GetDrawerRules(cache, drawerLock);
+        rule = (drawer != NULL) ? drawer->dr_Rules : NULL;
+        for (; rule != NULL; rule = rule->tl_Next) {
+            if (rule->tl_Kind == RULE_NAME) {
+                if (typeIdentifier == NULL && MatchPatternNoCase(rule->tl_Pattern, fileName)) {
+                    break;
+                }
+            } else if (typeIdentifier == NULL) {
+                *typeRules = TRUE;
+            } else if (Stricmp(rule->tl_Key, typeIdentifier) == 0) {
+                break;
+            }
+        }
+        
+        if (rule != NULL) {
+            toolLen = strlen((char *)rule->tl_Tool);
+            tool = AllocVec(toolLen + 1, MEMF_CLEAR);
+            if (tool != NULL) {
+                Strncpy(tool, rule->tl_Tool, toolLen + 1);
+            }
+            break;
+        }
+        
+        parentLock = ParentDir(drawerLock);
+        UnLock(drawerLock);
+        drawerLock = parentLock;
+    }
+    
+    if (drawerLock != NULL) {
+        UnLock(drawerLock);
+    }
+    if (shared != NULL) {
+        ReleaseSemaphore(&shared->pc_Semaphore);
+    }
+    
+    return tool;
+}
+
+/* Free compiled global name rules */
+VOID FreePatternRules(struct PatternRules *rules)
+{
+    if (rules != NULL) {
+        CoreFreeSuffixes(rules->pr_Suffixes);
+        FreeToolRules(rules->pr_Rules);
+        FreeVec(rules);
+    }
+}
+
+/* Get the compiled global name rules, compiling them again only if the file changed */
+struct PatternRules *GetPatternRules(struct PatternRules **cache)
+{
+    struct PatternRules *rules;
+    struct ToolRule *rule;
+    struct FileInfoBlock *fib;
+    BPTR rulesLock;
+    BPTR rulesFile;
+    
+    rulesLock = Lock(PATTERN_RULES_FILE, SHARED_LOCK);
+    if (rulesLock == NULL) {
+        /* No rules file (any more) */
+        FreePatternRules(*cache);
+        *cache = NULL;
+        return NULL;
+    }
+    
+    fib = (struct FileInfoBlock *)AllocDosObject(DOS_FIB, NULL);
+    if (fib == NULL || !Examine(rulesLock, fib)) {
+        if (fib != NULL) {
+            FreeDosObject(DOS_FIB, fib);
+        }
+        UnLock(rulesLock);
+        return *cache;
+    }
+    
+    if (*cache != NULL && CompareDates(&(*cache)->pr_Date, &fib->fib_Date) == 0) {
+        FreeDosObject(DOS_FIB, fib);
+        UnLock(rulesLock);
+        return *cache;
+    }
+    
+    FreePatternRules(*cache);
+    *cache = NULL;
+    
+    rules = AllocVec(sizeof(struct PatternRules), MEMF_PUBLIC | MEMF_CLEAR);
+    if (rules != NULL) {
+        rules->pr_Date = fib->fib_Date;
+        rulesFile = OpenFromLock(rulesLock);
+        if (rulesFile != NULL) {
+            /* OpenFromLock took over the lock */
+            rulesLock = NULL;
+            rules->pr_Rules = ParseToolRules(rulesFile);
+            Close(rulesFile);
+        }
+        
+        for (rule = rules->pr_Rules; rule != NULL; rule = rule->tl_Next) {
+            if (rule->tl_Kind != RULE_NAME) {
+                continue;
+            }
+            if (CoreAddSuffix(&rules->pr_Suffixes, rule->tl_Key, rule, rule->tl_Order)) {
+                rule->tl_Kind = RULE_SUFFIX;
+            } else {
+                rules->pr_HasGeneral = TRUE;
+            }
+        }
+        *cache = rules;
+    }
+    
+    FreeDosObject(DOS_FIB, fib);
+    if (rulesLock != NULL) {
+        UnLock(rulesLock);
+    }
+    return rules;
+}
+
+/* Find a tool for a file name in the global name rules */
+/* One backwards walk of the name through the suffix trie finds the best suffix rule, */
+/* then only general patterns on earlier lines still need to be matched. TYPE lines */
+/* are ignored here, as they would need the file to be identified. */
+/* Returns an AllocVec'd tool name, or NULL if no rule matches */
+STRPTR FindPatternTool(STRPTR fileName)
+{
+    struct PrefetchCache *shared;
+    struct PatternRules *rules;
+    struct ToolRule *best = NULL;
+    struct ToolRule *rule;
+    STRPTR tool = NULL;
+    ULONG toolLen;
+    
+    /* Share the resident companion's compiled rules if it is running */
+    Forbid();
+    shared = (struct PrefetchCache *)FindSemaphore(PREFETCH_SEMAPHORE);
+    if (shared != NULL) {
+        ObtainSemaphore(&shared->pc_Semaphore);
+    }
+    Permit();
+    
+    rules = GetPatternRules((shared != NULL) ? &shared->pc_Patterns : &patternRules);
+    if (rules != NULL) {
+        best = (struct ToolRule *)CoreMatchSuffix(rules->pr_Suffixes, fileName, NULL);
+        
+        if (rules->pr_HasGeneral) {
+            for (rule = rules->pr_Rules; rule != NULL; rule = rule->tl_Next) {
+                if (best != NULL && rule->tl_Order >= best->tl_Order) {
+                    break;
+                }
+                if (rule->tl_Kind == RULE_NAME && MatchPatternNoCase(rule->tl_Pattern, fileName)) {
+                    best = rule;
+                    break;
+                }
+            }
+        }
+        
+        if (best != NULL) {
+            toolLen = strlen((char *)best->tl_Tool);
+            tool = AllocVec(toolLen + 1, MEMF_CLEAR);
+            if (tool != NULL) {
+                Strncpy(tool, best->tl_Tool, toolLen + 1);
+            }
+        }
+    }
+    
+    if (shared != NULL) {
+        ReleaseSemaphore(&shared->pc_Semaphore);
+    }
+    
+    return tool;
+}
+
+/* Load the launch statistics, once per run */
+VOID LoadStats(VOID)
+{
+    struct StatsHeader header;
+    BPTR file;
+    
+    if (statsRecords != NULL) {
+        return;
+    }
+    
+    statsRecords = AllocVec(sizeof(struct StatsRecord) * STATS_MAX, MEMF_CLEAR);
+    if (statsRecords == NULL) {
+        return;
+    }
+    statsCount = 0;
+    
+    file = Open(STATS_FILE, MODE_OLDFILE);
+    if (file == NULL) {
+        return;
+    }
+    
+    /* Ignore a file of another version, it is rebuilt from scratch */
+    if (Read(file, &header, sizeof(header)) == sizeof(header) &&
+        header.sh_Magic == STATS_MAGIC && header.sh_Version == STATS_VERSION &&
+        header.sh_Count <= STATS_MAX &&
+        Read(file, statsRecords, sizeof(struct StatsRecord) * header.sh_Count) ==
+            (LONG)(sizeof(struct StatsRecord) * header.sh_Count)) {
+        statsCount = header.sh_Count;
+    } else {
+        memset(statsRecords, 0, sizeof(struct StatsRecord) * STATS_MAX);
+    }
+    
+    Close(file);
+}
+
+/* Merge what this run added into the launch statistics file */
+/* The file is read again under STATS_LOCK, so runs that overlap all keep their counts */
+VOID SaveStats(VOID)
+{
+    struct StatsHeader header;
+    struct StatsRecord *record;
+    BPTR file;
+    BPTR lock;
+    BPTR statsLock;
+    BOOL success = FALSE;
+    UWORD i;
+    
+    if (!statsDirty || statsAdded == NULL) {
+        return;
+    }
+    statsDirty = FALSE;
+    
+    lock = Lock("ENV:ProjectX", SHARED_LOCK);
+    if (lock == NULL) {
+        lock = CreateDir("ENV:ProjectX");
+    }
+    if (lock == NULL) {
+        return;
+    }
+    UnLock(lock);
+    
+    statsLock = OpenLockFile(STATS_LOCK);
+    if (statsLock == NULL) {
+        return;
+    }
+    
+    /* Start from the file as another run may have left it since we loaded it */
+    if (statsRecords != NULL) {
+        FreeVec(statsRecords);
+        statsRecords = NULL;
+    }
+    LoadStats();
+    if (statsRecords == NULL) {
+        Close(statsLock);
+        return;
+    }
+    for (i = 0; i < statsAddedCount; i++) {
+        record = GetStatsRecord(statsRecords, &statsCount, statsAdded[i].sr_Kind, statsAdded[i].sr_Name);
+        MergeStatsRecord(record, &statsAdded[i]);
+    }
+    
+    file = Open(STATS_TEMP, MODE_NEWFILE);
+    if (file == NULL) {
+        Close(statsLock);
+        return;
+    }
+    
+    header.sh_Magic = STATS_MAGIC;
+    header.sh_Version = STATS_VERSION;
+    header.sh_Count = statsCount;
+    
+    if (Write(file, &header, sizeof(header)) == sizeof(header) &&
+        Write(file, statsRecords, sizeof(struct StatsRecord) * statsCount) ==
+            (LONG)(sizeof(struct StatsRecord) * statsCount)) {
+        success = TRUE;
+    }
+    Close(file);
+    
+    /* Only replace the old statistics once the new ones are completely written */
+    if (success) {
+        DeleteFile(STATS_FILE);
+        if (!Rename(STATS_TEMP, STATS_FILE)) {
+            DeleteFile(STATS_TEMP);
+        }
+    } else {
+        DeleteFile(STATS_TEMP);
+    }
+    Close(statsLock);
+}
+
+/* The record of a type or tool in a table of STATS_MAX, added if it is not there yet */
+struct StatsRecord *GetStatsRecord(struct StatsRecord *records, UWORD *count, UBYTE kind, STRPTR name)
+{
+    struct StatsRecord *record = NULL;
+    struct StatsRecord *least = NULL;
+    UWORD i;
+    
+    for (i = 0; i < *count; i++) {
+        if (records[i].sr_Kind == kind && Stricmp(records[i].sr_Name, name) == 0) {
+            return &records[i];
+        }
+        if (least == NULL || records[i].sr_Launches < least->sr_Launches) {
+            least = &records[i];
+        }
+    }
+    
+    /* New type or tool - take a free slot, or the least used one when full */
+    if (*count < STATS_MAX) {
+        record = &records[(*count)++];
+    } else {
+        record = least;
+    }
+    memset(record, 0, sizeof(struct StatsRecord));
+    record->sr_Kind = kind;
+    Strncpy(record->sr_Name, name, sizeof(record->sr_Name));
+    
+    return record;
+}
+
+/* Add one launch to this run's record of a type or tool */
+VOID AddStatsSample(UBYTE kind, STRPTR name, ULONG resolveMicros, ULONG launchMicros,
+                    BOOL cacheHit, LONG errorCode)
+{
+    struct StatsRecord *record;
+    
+    record = GetStatsRecord(statsAdded, &statsAddedCount, kind, name);
+    
+    record->sr_Launches++;
+    if (cacheHit) {
+        record->sr_CacheHits++;
+    } else {
+        record->sr_CacheMisses++;
+    }
+    if (identifyTimedOut) {
+        record->sr_Timeouts++;
+    }
+    if (errorCode != 0) {
+        record->sr_Errors++;
+        record->sr_LastError = errorCode;
+    }
+    
+    record->sr_Resolve[CoreBucket(resolveMicros, STATS_BUCKETS)]++;
+    record->sr_Launch[CoreBucket(launchMicros, STATS_BUCKETS)]++;
+}
+
+/* Add the counts of one record to another of the same type or tool */
+VOID MergeStatsRecord(struct StatsRecord *into, struct StatsRecord *from)
+{
+    LONG i;
+    
+    into->sr_Launches += from->sr_Launches;
+    into->sr_Errors += from->sr_Errors;
+    into->sr_CacheHits += from->sr_CacheHits;
+    into->sr_CacheMisses += from->sr_CacheMisses;
+    into->sr_Timeouts += from->sr_Timeouts;
+    if (from->sr_Errors > 0) {
+        into->sr_LastError = from->sr_LastError;
+    }
+    for (i = 0; i < STATS_BUCKETS; i++) {
+        into->sr_Resolve[i] += from->sr_Resolve[i];
+        into->sr_Launch[i] += from->sr_Launch[i];
+    }
+}
+
+/* Record one launch for its type and for its tool */
+VOID RecordLaunchStats(STRPTR typeIdentifier, STRPTR toolName, ULONG resolveMicros,
+                       ULONG launchMicros, BOOL cacheHit, LONG errorCode)
+{
+    if (statsAdded == NULL) {
+        statsAdded = AllocVec(sizeof(struct StatsRecord) * STATS_MAX, MEMF_CLEAR);
+        if (statsAdded == NULL) {
+            return;
+        }
+        statsAddedCount = 0;
+    }
+    
+    /* Name rules can pick the tool without the file ever being identified */
+    AddStatsSample(STATS_TYPE,
+                   (typeIdentifier != NULL && *typeIdentifier != '\0') ? typeIdentifier : (STRPTR)"(unidentified)",
+                   resolveMicros, launchMicros, cacheHit, errorCode);
+    AddStatsSample(STATS_TOOL, toolName, resolveMicros, launchMicros, cacheHit, errorCode);
+    statsDirty = TRUE;
+}
+
+/* Print the launch statistics, one line of key=value pairs per type and per tool */
+BOOL PrintStats(VOID)
+{
+    struct StatsRecord *record;
+    UBYTE line[512];
+    UWORD i;
+    
+    LoadStats();
+    if (statsRecords == NULL) {
+        return FALSE;
+    }
+    
+    if (statsCount == 0) {
+        PutStr("ProjectX: No launch statistics gathered yet.\n");
+        PrintVolumes();
+        return TRUE;
+    }
+    
+    PutStr("projectx-stats version=2 bucket_us=256<<n\n");
+    for (i = 0; i < statsCount; i++) {
+        record = &statsRecords[i];
+        SNPrintf(line, sizeof(line),
+            "%s=%s launches=%lu errors=%lu last_error=%ld hits=%lu misses=%lu timeouts=%lu "
+            "resolve_p50_us=%lu resolve_p95_us=%lu resolve_p99_us=%lu "
+            "launch_p50_us=%lu launch_p95_us=%lu launch_p99_us=%lu\n",
+            record->sr_Kind == STATS_TYPE ? (STRPTR)"type" : (STRPTR)"tool",
+            record->sr_Name,
+            record->sr_Launches, record->sr_Errors, record->sr_LastError,
+            record->sr_CacheHits, record->sr_CacheMisses, record->sr_Timeouts,
+            CorePercentile(record->sr_Resolve, STATS_BUCKETS, 50),
+            CorePercentile(record->sr_Resolve, STATS_BUCKETS, 95),
+            CorePercentile(record->sr_Resolve, STATS_BUCKETS, 99),
+            CorePercentile(record->sr_Launch, STATS_BUCKETS, 50),
+            CorePercentile(record->sr_Launch, STATS_BUCKETS, 95),
+            CorePercentile(record->sr_Launch, STATS_BUCKETS, 99));
+        PutStr(line);
+    }
+    
+    PrintVolumes();
+    return TRUE;
+}
+
+/* Run an identification engine in a worker process, waiting at most identifyTimeout ms */
+/* Past the deadline the worker is left to finish on its own, identifyTimedOut is set */
+/* and the name-only guess is returned. While that worker is still stuck, later files */
+/* are guessed straight away, as the device they are on is most likely still stalled. */
+STRPTR IdentifyWithDeadline(struct IdentifyEngine *engine, STRPTR fileName, BPTR fileLock)
+{
+    static struct IdentifyBatchEntry entry;
+    
+    memset(&entry, 0, sizeof(entry));
+    entry.be_Name = fileName;
+    entry.be_Lock = fileLock;
+    IdentifyBatch(engine, &entry, 1);
+    identifyTimedOut = entry.be_TimedOut;
+    
+    return entry.be_Type;
+}
+
+/* Read the deadline and set up the reply and timer ports, once per run */
+/* Returns FALSE if identification should run synchronously instead */
+BOOL OpenIdentifyPorts(VOID)
+{
+    UBYTE value[16];
+    
+    if (identifyTimeout < 0) {
+        identifyTimeout = IDENTIFY_TIMEOUT_DEFAULT;
+        if (GetVar(IDENTIFY_TIMEOUT_VAR, value, sizeof(value), GVF_GLOBAL_ONLY) > 0) {
+            StrToLong(value, &identifyTimeout);
+            if (identifyTimeout < 0) {
+                identifyTimeout = 0;
+            }
+        }
+    }
+    
+    if (identifyTimeout == 0) {
+        return FALSE;
+    }
+    
+    if (identifyPort == NULL) {
+        identifyPort = CreateMsgPort();
+        identifyTimerPort = CreateMsgPort();
+        if (identifyTimerPort != NULL) {
+            identifyTimerIO = (struct timerequest *)CreateIORequest(identifyTimerPort, sizeof(struct timerequest));
+        }
+        if (identifyTimerIO != NULL &&
+            OpenDevice(TIMERNAME, UNIT_VBLANK, (struct IORequest *)identifyTimerIO, 0) != 0) {
+            DeleteIORequest((struct IORequest *)identifyTimerIO);
+            identifyTimerIO = NULL;
+        }
+    }
+    
+    return (BOOL)(identifyPort != NULL && identifyTimerIO != NULL);
+}
+
+/* Send the entries not answered yet to the worker in one job, starting it on first use */
+/* Returns NULL if it could not be started */
+struct IdentifyJob *StartIdentifyJob(struct IdentifyEngine *engine, struct IdentifyBatchEntry *entries, LONG count)
+{
+    struct IdentifyJob *job;
+    struct IdentifyJobFile *file;
+    struct Process *worker;
+    STRPTR names;
+    ULONG size;
+    LONG pending = 0;
+    LONG nameLen;
+    LONG i;
+    
+    size = sizeof(struct IdentifyJob);
+    for (i = 0; i < count; i++) {
+        if (entries[i].be_Type == NULL && !entries[i].be_TimedOut) {
+            size += sizeof(struct IdentifyJobFile) + strlen((char *)entries[i].be_Name) + 1;
+            pending++;
+        }
+    }
+    
+    job = AllocVec(size, MEMF_PUBLIC | MEMF_CLEAR);
+    if (job == NULL) {
+        return NULL;
+    }
+    job->ij_Message.mn_ReplyPort = identifyPort;
+    job->ij_Message.mn_Length = sizeof(struct IdentifyJob);
+    job->ij_Identify = engine->ie_Identify;
+    job->ij_Files = (struct IdentifyJobFile *)(job + 1);
+    
+    /* The names follow the files in the same allocation */
+    names = (STRPTR)(job->ij_Files + pending);
+    for (i = 0; i < count; i++) {
+        if (entries[i].be_Type != NULL || entries[i].be_TimedOut) {
+            continue;
+        }
+        file = &job->ij_Files[job->ij_Count++];
+        file->jf_Entry = i;
+        nameLen = strlen((char *)entries[i].be_Name);
+        file->jf_Name = names;
+        Strncpy(file->jf_Name, entries[i].be_Name, nameLen + 1);
+        names += nameLen + 1;
+        file->jf_Lock = DupLock(entries[i].be_Lock);
+        if (file->jf_Lock == NULL && entries[i].be_Lock != NULL) {
+            FreeIdentifyJob(job);
+            return NULL;
+        }
+    }
+    
+    if (identifyWorkerPort != NULL) {
+        PutMsg(identifyWorkerPort, &job->ij_Message);
+        identifyWorkerPort = NULL;
+        return job;
+    }
+    
+    /* It outlives this job, so it must not keep a copy of our current directory */
+    worker = CreateNewProcTags(NP_Entry, (ULONG)IdentifyWorker,
+                               NP_Name, (ULONG)"ProjectX identify",
+                               NP_StackSize, IDENTIFY_WORKER_STACK,
+                               NP_CurrentDir, NULL,
+                               TAG_DONE);
+    if (worker == NULL) {
+        FreeIdentifyJob(job);
+        return NULL;
+    }
+    MEMTRACK_PROCESS(IDENTIFY_WORKER_STACK);
+    PutMsg(&worker->pr_MsgPort, &job->ij_Message);
+    
+    return job;
+}
+
+/* Wait for a job's reply, allowing each of its files identifyTimeout ms */
+/* The deadline starts again whenever the worker has answered another file */
+/* Returns FALSE if one file took longer, and the job was left to finish on its own */
+BOOL WaitIdentifyJob(struct IdentifyJob *job)
+{
+    struct Message *reply = NULL;
+    ULONG signals;
+    LONG done = 0;
+    BOOL progress;
+    
+    signals = (1UL << identifyPort->mp_SigBit) | (1UL << identifyTimerPort->mp_SigBit);
+    for (;;) {
+        identifyTimerIO->tr_node.io_Command = TR_ADDREQUEST;
+        identifyTimerIO->tr_time.tv_secs = identifyTimeout / 1000;
+        identifyTimerIO->tr_time.tv_micro = (identifyTimeout % 1000) * 1000;
+        SendIO((struct IORequest *)identifyTimerIO);
+        
+        for (;;) {
+            reply = GetMsg(identifyPort);
+            if (reply != NULL || CheckIO((struct IORequest *)identifyTimerIO)) {
+                break;
+            }
+            Wait(signals);
+        }
+        
+        if (!CheckIO((struct IORequest *)identifyTimerIO)) {
+            AbortIO((struct IORequest *)identifyTimerIO);
+        }
+        WaitIO((struct IORequest *)identifyTimerIO);
+        
+        /* Only one job is out at a time, so any reply is this one */
+        if (reply != NULL || (reply = GetMsg(identifyPort)) != NULL) {
+            return TRUE;
+        }
+        
+        Forbid();
+        progress = (BOOL)(job->ij_Done > done);
+        done = job->ij_Done;
+        Permit();
+        if (!progress) {
+            return FALSE;
+        }
+    }
+}
+
+/* Free the jobs that missed their deadline and have replied since */
+/* Their worker is idle again, and takes the next job */
+VOID CollectStalledJobs(VOID)
+{
+    struct IdentifyJob *job;
+    
+    while (identifyStalled > 0 && (job = (struct IdentifyJob *)GetMsg(identifyPort)) != NULL) {
+        identifyWorkerPort = job->ij_WorkerPort;
+        FreeIdentifyJob(job);
+        identifyStalled--;
+    }
+}
+
+/* Identify a batch of files with one engine, sent to one worker as a single job */
+/* Only entries without an answer yet are tried. DefIcons still answers them one */
+/* after the other, but ProjectX waits for the whole batch at once. If a file misses */
+/* its deadline, it and the rest of the batch are guessed from their names. */
+/* Returns the number of entries identified */
+LONG IdentifyBatch(struct IdentifyEngine *engine, struct IdentifyBatchEntry *entries, LONG count)
+{
+    struct IdentifyJob *job = NULL;
+    struct IdentifyJobFile *file;
+    struct IdentifyBatchEntry *entry;
+    struct EClockVal start;
+    struct EClockVal end;
+    LONG identified = 0;
+    LONG bytesRead;
+    LONG answered;
+    LONG i;
+    BOOL replied;
+    
+    if (identifyStalled > 0) {
+        CollectStalledJobs();
+    }
+    
+    /* While an earlier worker is stuck, its device most likely still is too */
+    if (identifyStalled > 0) {
+        for (i = 0; i < count; i++) {
+            entry = &entries[i];
+            if (entry->be_Type == NULL && !entry->be_TimedOut) {
+                Strncpy(entry->be_Buffer, GuessTypeOrProject(entry->be_Name), sizeof(entry->be_Buffer));
+                entry->be_Type = entry->be_Buffer;
+                entry->be_TimedOut = TRUE;
+            }
+        }
+        return 0;
+    }
+    
+    if (OpenIdentifyPorts()) {
+        job = StartIdentifyJob(engine, entries, count);
+    }
+    
+    /* No worker - one file after the other, here */
+    if (job == NULL) {
+        for (i = 0; i < count; i++) {
+            entry = &entries[i];
+            if (entry->be_Type != NULL || entry->be_TimedOut) {
+                continue;
+            }
+            ReadTimer(&start);
+            if (engine->ie_Identify(entry->be_Name, entry->be_Lock, entry->be_Buffer, &bytesRead) != NULL &&
+                entry->be_Buffer[0] != '\0') {
+                entry->be_Type = entry->be_Buffer;
+                identified++;
+            }
+            ReadTimer(&end);
+            entry->be_Micros = ElapsedMicros(&start, &end);
+        }
+        return identified;
+    }
+    
+    replied = WaitIdentifyJob(job);
+    
+    /* The files the worker got to are final, even if it is stuck on the next */
+    Forbid();
+    answered = job->ij_Done;
+    Permit();
+    for (i = 0; i < answered; i++) {
+        file = &job->ij_Files[i];
+        entry = &entries[file->jf_Entry];
+        entry->be_Micros = file->jf_Micros;
+        if (file->jf_Type[0] != '\0') {
+            Strncpy(entry->be_Buffer, file->jf_Type, sizeof(entry->be_Buffer));
+            entry->be_Type = entry->be_Buffer;
+            identified++;
+        }
+    }
+    
+    if (replied) {
+        identifyWorkerPort = job->ij_WorkerPort;
+        FreeIdentifyJob(job);
+        return identified;
+    }
+    
+    /* Past the deadline - the worker is left to finish on its own, */
+    /* and everything it did not answer is guessed from its name */
+    identifyStalled++;
+    for (i = answered; i < job->ij_Count; i++) {
+        entry = &entries[job->ij_Files[i].jf_Entry];
+        Strncpy(entry->be_Buffer, GuessTypeOrProject(entry->be_Name), sizeof(entry->be_Buffer));
+        entry->be_Type = entry->be_Buffer;
+        entry->be_TimedOut = TRUE;
+        entry->be_Micros = (ULONG)identifyTimeout * 1000;
+    }
+    
+    return identified;
+}
+
+/* Worker process entry - identifies every file of a job in turn and replies, */
+/* then waits for the next job until one without files tells it to quit */
+VOID __saveds IdentifyWorker(VOID)
+{
+    struct Process *me = (struct Process *)FindTask(NULL);
+    struct IdentifyJob *job;
+    struct IdentifyJobFile *file;
+    struct MsgPort *port;
+    struct EClockVal start;
+    struct EClockVal end;
+    LONG bytesRead;
+    LONG i;
+    
+    WaitPort(&me->pr_MsgPort);
+    job = (struct IdentifyJob *)GetMsg(&me->pr_MsgPort);
+    
+    /* Later jobs come to a port of our own, as dos.library uses pr_MsgPort for packets */
+    port = CreateMsgPort();
+    
+    for (;;) {
+        for (i = 0; i < job->ij_Count; i++) {
+            file = &job->ij_Files[i];
+            ReadTimer(&start);
+            if (job->ij_Identify(file->jf_Name, file->jf_Lock, file->jf_Type, &bytesRead) == NULL) {
+                file->jf_Type[0] = '\0';
+            }
+            ReadTimer(&end);
+            file->jf_Micros = ElapsedMicros(&start, &end);
+            job->ij_Done = i + 1;
+        }
+        
+        if (job->ij_Count == 0 || port == NULL) {
+            break;
+        }
+        job->ij_WorkerPort = port;
+        ReplyMsg(&job->ij_Message);
+        WaitPort(port);
+        job = (struct IdentifyJob *)GetMsg(port);
+    }
+    
+    if (port != NULL) {
+        DeleteMsgPort(port);
+    }
+    job->ij_WorkerPort = NULL;
+    
+    /* ProjectX may unload as soon as it has the reply - stay in Forbid() until we are gone */
+    Forbid();
+    ReplyMsg(&job->ij_Message);
+}
+
+/* Free a job that has been replied */
+VOID FreeIdentifyJob(struct IdentifyJob *job)
+{
+    LONG i;
+    
+    for (i = 0; i < job->ij_Count; i++) {
+        if (job->ij_Files[i].jf_Lock != NULL) {
+            UnLock(job->ij_Files[i].jf_Lock);
+        }
+    }
+    FreeVec(job);
+}
+
+/* Free a job that has been replied, or if its worker is still waiting for more, */
+/* send the same message back without files to make it quit */
+/* Returns TRUE once the job is freed, FALSE if it is out again */
+BOOL RetireIdentifyJob(struct IdentifyJob *job)
+{
+    struct MsgPort *workerPort = job->ij_WorkerPort;
+    LONG i;
+    
+    if (workerPort == NULL) {
+        FreeIdentifyJob(job);
+        return TRUE;
+    }
+    
+    for (i = 0; i < job->ij_Count; i++) {
+        if (job->ij_Files[i].jf_Lock != NULL) {
+            UnLock(job->ij_Files[i].jf_Lock);
+        }
+    }
+    job->ij_Count = 0;
+    job->ij_WorkerPort = NULL;
+    PutMsg(workerPort, &job->ij_Message);
+    return FALSE;
+}
+
+/* Make the idle worker quit, and wait until it has */
+VOID StopIdentifyWorker(VOID)
+{
+    if (identifyWorkerPort == NULL) {
+        return;
+    }
+    
+    memset(&identifyQuitJob, 0, sizeof(identifyQuitJob));
+    identifyQuitJob.ij_Message.mn_ReplyPort = identifyPort;
+    identifyQuitJob.ij_Message.mn_Length = sizeof(struct IdentifyJob);
+    PutMsg(identifyWorkerPort, &identifyQuitJob.ij_Message);
+    identifyWorkerPort = NULL;
+    
+    /* An idle worker means no job is out, so the next reply is this one */
+    WaitPort(identifyPort);
+    GetMsg(identifyPort);
+}
+
+/* Wait for the workers that missed their deadline, then free the ports */
+/* Normally a reaper has taken them over; this waits only if none could be started */
+VOID FreeIdentifyWorkers(VOID)
+{
+    struct Message *reply;
+    
+    while (identifyStalled > 0) {
+        WaitPort(identifyPort);
+        while (identifyStalled > 0 && (reply = GetMsg(identifyPort)) != NULL) {
+            if (RetireIdentifyJob((struct IdentifyJob *)reply)) {
+                identifyStalled--;
+            }
+        }
+    }
+    
+    if (identifyTimerIO != NULL) {
+        CloseDevice((struct IORequest *)identifyTimerIO);
+        DeleteIORequest((struct IORequest *)identifyTimerIO);
+        identifyTimerIO = NULL;
+    }
+    if (identifyTimerPort != NULL) {
+        DeleteMsgPort(identifyTimerPort);
+        identifyTimerPort = NULL;
+    }
+    if (identifyPort != NULL) {
+        DeleteMsgPort(identifyPort);
+        identifyPort = NULL;
+    }
+}
+
+/* Guess a type from the file name alone, falling back to a plain project */
+STRPTR GuessTypeOrProject(STRPTR fileName)
+{
+    STRPTR typeIdentifier = GuessFromName(fileName);
+    
+    return typeIdentifier != NULL ? typeIdentifier : (STRPTR)"project";
+}
+
+/* Guess a type from the file name alone, NULL if the suffix is not known */
+/* The suffixes of the types launched most in earlier runs are tried first */
+STRPTR GuessFromName(STRPTR fileName)
+{
+    static BOOL seeded = FALSE;
+    LONG i;
+    
+    if (!seeded) {
+        seeded = TRUE;
+        LoadStats();
+        if (statsRecords != NULL) {
+            for (i = 0; i < statsCount; i++) {
+                if (statsRecords[i].sr_Kind == STATS_TYPE) {
+                    CoreAddGuessHits(statsRecords[i].sr_Name, statsRecords[i].sr_Launches);
+                }
+            }
+            CoreReorderGuesses();
+        }
+    }
+    
+    return CoreGuessType(fileName);
+}
+
+/* Load the volume timings and the policy overrides, once per run */
+VOID LoadVolumes(VOID)
+{
+    struct VolumesHeader header;
+    struct VolumeRecord *volume;
+    struct CSource cs;
+    UBYTE line[128];
+    UBYTE name[32];
+    UBYTE policy[16];
+    UBYTE override;
+    UWORD i;
+    BPTR file;
+    
+    if (volumeRecords != NULL) {
+        return;
+    }
+    
+    volumeRecords = AllocVec(sizeof(struct VolumeRecord) * VOLUMES_MAX, MEMF_CLEAR);
+    if (volumeRecords == NULL) {
+        return;
+    }
+    volumeCount = 0;
+    
+    file = Open(VOLUMES_FILE, MODE_OLDFILE);
+    if (file != NULL) {
+        if (Read(file, &header, sizeof(header)) == sizeof(header) &&
+            header.vh_Magic == VOLUMES_MAGIC && header.vh_Version == VOLUMES_VERSION &&
+            header.vh_Count <= VOLUMES_MAX &&
+            Read(file, volumeRecords, sizeof(struct VolumeRecord) * header.vh_Count) ==
+                (LONG)(sizeof(struct VolumeRecord) * header.vh_Count)) {
+            volumeCount = header.vh_Count;
+        } else {
+            memset(volumeRecords, 0, sizeof(struct VolumeRecord) * VOLUMES_MAX);
+        }
+        Close(file);
+    }
+    
+    for (i = 0; i < volumeCount; i++) {
+        volumeRecords[i].vr_Override = POLICY_AUTO;
+        volumeRecords[i].vr_Stage = FALSE;
+    }
+    
+    /* Overrides - one "<volume> SNIFF|NAME|CACHE|AUTO [STAGE]" per line */
+    file = Open(VOLUME_POLICY_FILE, MODE_OLDFILE);
+    if (file == NULL) {
+        return;
+    }
+    
+    while (FGets(file, line, sizeof(line) - 1) != NULL) {
+        if (line[0] == ';' || line[0] == '#' || line[0] == '\n' || line[0] == '\0') {
+            continue;
+        }
+        
+        cs.CS_Buffer = line;
+        cs.CS_Length = strlen((char *)line);
+        cs.CS_CurChr = 0;
+        
+        if (ReadItem(name, sizeof(name), &cs) <= ITEM_NOTHING ||
+            ReadItem(policy, sizeof(policy), &cs) <= ITEM_NOTHING) {
+            continue;
+        }
+        
+        /* Accept the volume name with or without its colon */
+        i = strlen((char *)name);
+        if (i > 0 && name[i - 1] == ':') {
+            name[i - 1] = '\0';
+        }
+        
+        for (override = POLICY_AUTO; override <= POLICY_CACHE; override++) {
+            if (Stricmp(policy, policyNames[override]) == 0) {
+                break;
+            }
+        }
+        if (override > POLICY_CACHE) {
+            continue;
+        }
+        
+        volume = NULL;
+        for (i = 0; i < volumeCount; i++) {
+            if (Stricmp(volumeRecords[i].vr_Name, name) == 0) {
+                volume = &volumeRecords[i];
+                break;
+            }
+        }
+        if (volume == NULL && volumeCount < VOLUMES_MAX) {
+            volume = &volumeRecords[volumeCount++];
+            Strncpy(volume->vr_Name, name, sizeof(volume->vr_Name));
+        }
+        if (volume != NULL) {
+            volume->vr_Override = override;
+            volume->vr_Stage = (ReadItem(policy, sizeof(policy), &cs) > ITEM_NOTHING &&
+                                Stricmp(policy, "STAGE") == 0);
+        }
+    }
+    
+    Close(file);
+}
+
+/* Merge what this run measured into the volume timings file */
+/* The file is read again under VOLUMES_LOCK, so runs that overlap all keep their samples */
+VOID SaveVolumes(VOID)
+{
+    struct VolumesHeader header;
+    struct VolumeRecord *volume;
+    BPTR file;
+    BPTR lock;
+    BPTR volumesLock;
+    BOOL success = FALSE;
+    UWORD i;
+    
+    if (!volumesDirty || volumesAdded == NULL) {
+        return;
+    }
+    volumesDirty = FALSE;
+    
+    lock = Lock("ENV:ProjectX", SHARED_LOCK);
+    if (lock == NULL) {
+        lock = CreateDir("ENV:ProjectX");
+    }
+    if (lock == NULL) {
+        return;
+    }
+    UnLock(lock);
+    
+    volumesLock = OpenLockFile(VOLUMES_LOCK);
+    if (volumesLock == NULL) {
+        return;
+    }
+    
+    /* Start from the file as another run may have left it since we loaded it */
+    if (volumeRecords != NULL) {
+        FreeVec(volumeRecords);
+        volumeRecords = NULL;
+    }
+    LoadVolumes();
+    if (volumeRecords == NULL) {
+        Close(volumesLock);
+        return;
+    }
+    for (i = 0; i < volumesAddedCount; i++) {
+        volume = GetVolumeRecord(volumeRecords, &volumeCount, volumesAdded[i].vr_Name);
+        if (volume != NULL) {
+            MergeVolumeRecord(volume, &volumesAdded[i]);
+        }
+    }
+    
+    file = Open(VOLUMES_TEMP, MODE_NEWFILE);
+    if (file == NULL) {
+        Close(volumesLock);
+        return;
+    }
+    
+    header.vh_Magic = VOLUMES_MAGIC;
+    header.vh_Version = VOLUMES_VERSION;
+    header.vh_Count = volumeCount;
+    
+    if (Write(file, &header, sizeof(header)) == sizeof(header) &&
+        Write(file, volumeRecords, sizeof(struct VolumeRecord) * volumeCount) ==
+            (LONG)(sizeof(struct VolumeRecord) * volumeCount)) {
+        success = TRUE;
+    }
+    Close(file);
+    
+    if (success) {
+        DeleteFile(VOLUMES_FILE);
+        if (!Rename(VOLUMES_TEMP, VOLUMES_FILE)) {
+            DeleteFile(VOLUMES_TEMP);
+        }
+    } else {
+        DeleteFile(VOLUMES_TEMP);
+    }
+    Close(volumesLock);
+}
+
+/* Find the record of the volume a lock is on, adding it if needed */
+/* Returns NULL if the volume cannot be told */
+struct VolumeRecord *FindVolume(BPTR lock)
+{
+    struct FileLock *fileLock;
+    struct DosList *dosList;
+    UBYTE *bstr;
+    UBYTE name[32];
+    LONG len;
+    
+    if (lock == NULL) {
+        return NULL;
+    }
+    
+    fileLock = (struct FileLock *)BADDR(lock);
+    dosList = (struct DosList *)BADDR(fileLock->fl_Volume);
+    if (dosList == NULL || dosList->dol_Name == NULL) {
+        return NULL;
+    }
+    
+    /* The volume name is a BCPL string */
+    bstr = (UBYTE *)BADDR(dosList->dol_Name);
+    len = bstr[0];
+    if (len >= (LONG)sizeof(name)) {
+        len = sizeof(name) - 1;
+    }
+    CopyMem(bstr + 1, name, len);
+    name[len] = '\0';
+    
+    LoadVolumes();
+    if (volumeRecords == NULL) {
+        return NULL;
+    }
+    
+    return GetVolumeRecord(volumeRecords, &volumeCount, name);
+}
+
+/* The record of a volume in a table of VOLUMES_MAX, added if it is not there yet */
+/* Returns NULL if the table is full of volumes with a fixed policy */
+struct VolumeRecord *GetVolumeRecord(struct VolumeRecord *records, UWORD *count, STRPTR name)
+{
+    struct VolumeRecord *volume = NULL;
+    struct VolumeRecord *least = NULL;
+    UWORD i;
+    
+    for (i = 0; i < *count; i++) {
+        if (Stricmp(records[i].vr_Name, name) == 0) {
+            return &records[i];
+        }
+        if (records[i].vr_Override == POLICY_AUTO && !records[i].vr_Stage &&
+            (least == NULL || records[i].vr_Samples < least->vr_Samples)) {
+            least = &records[i];
+        }
+    }
+    
+    /* New volume - take a free slot, or the least measured one when full */
+    if (*count < VOLUMES_MAX) {
+        volume = &records[(*count)++];
+    } else if (least != NULL) {
+        volume = least;
+    } else {
+        return NULL;
+    }
+    memset(volume, 0, sizeof(struct VolumeRecord));
+    Strncpy(volume->vr_Name, name, sizeof(volume->vr_Name));
+    
+    return volume;
+}
+
+/* This run's record of a volume, which SaveVolumes() merges into the file */
+/* Returns NULL if there is no memory for it */
+struct VolumeRecord *GetAddedVolume(struct VolumeRecord *volume)
+{
+    if (volumesAdded == NULL) {
+        volumesAdded = AllocVec(sizeof(struct VolumeRecord) * VOLUMES_MAX, MEMF_CLEAR);
+        if (volumesAdded == NULL) {
+            return NULL;
+        }
+        volumesAddedCount = 0;
+    }
+    
+    return GetVolumeRecord(volumesAdded, &volumesAddedCount, volume->vr_Name);
+}
+
+/* Add what one run measured on a volume to its record */
+VOID MergeVolumeRecord(struct VolumeRecord *into, struct VolumeRecord *from)
+{
+    ULONG i;
+    
+    /* The run's own mean counts once for each sample it took */
+    for (i = 0; i < from->vr_Samples; i++) {
+        into->vr_MeanMillis = CoreMovingMean(into->vr_MeanMillis, into->vr_Samples, from->vr_MeanMillis);
+        into->vr_Samples++;
+    }
+    
+    /* A probe in this run started the count of skipped files again */
+    if (from->vr_Samples > 0) {
+        into->vr_Skipped = from->vr_Skipped;
+    } else {
+        into->vr_Skipped += from->vr_Skipped;
+    }
+}
+
+/* The policy in force for a volume */
+UBYTE GetVolumePolicy(struct VolumeRecord *volume)
+{
+    if (volume == NULL) {
+        return POLICY_SNIFF;
+    }
+    return CoreVolumePolicy(volume->vr_MeanMillis, volume->vr_Samples, volume->vr_Override);
+}
+
+/* Fold one identification time into a volume's moving average */
+VOID RecordVolumeLatency(struct VolumeRecord *volume, ULONG micros)
+{
+    struct VolumeRecord *added;
+    ULONG millis = micros / 1000;
+    
+    /* Without timer.device there is nothing to learn from */
+    if (micros == 0 && eclockFrequency == 0) {
+        return;
+    }
+    
+    volume->vr_MeanMillis = CoreMovingMean(volume->vr_MeanMillis, volume->vr_Samples, millis);
+    volume->vr_Samples++;
+    volume->vr_Skipped = 0;
+    
+    added = GetAddedVolume(volume);
+    if (added != NULL) {
+        added->vr_MeanMillis = CoreMovingMean(added->vr_MeanMillis, added->vr_Samples, millis);
+        added->vr_Samples++;
+        added->vr_Skipped = 0;
+        volumesDirty = TRUE;
+    }
+}
+
+/* Count one file on a volume that was guessed from its name without being identified */
+VOID RecordVolumeSkip(struct VolumeRecord *volume)
+{
+    struct VolumeRecord *added;
+    
+    volume->vr_Skipped++;
+    
+    added = GetAddedVolume(volume);
+    if (added != NULL) {
+        added->vr_Skipped++;
+        volumesDirty = TRUE;
+    }
+}
+
+/* Print the per-volume policy table */
+VOID PrintVolumes(VOID)
+{
+    struct VolumeRecord *volume;
+    UBYTE line[160];
+    UWORD i;
+    
+    LoadVolumes();
+    if (volumeRecords == NULL) {
+        return;
+    }
+    
+    for (i = 0; i < volumeCount; i++) {
+        volume = &volumeRecords[i];
+        SNPrintf(line, sizeof(line),
+            "volume=%s policy=%s override=%s stage=%s mean_ms=%lu samples=%lu\n",
+            volume->vr_Name, policyNames[GetVolumePolicy(volume)],
+            volume->vr_Override != POLICY_AUTO ? (STRPTR)"yes" : (STRPTR)"no",
+            volume->vr_Stage ? (STRPTR)"yes" : (STRPTR)"no",
+            volume->vr_MeanMillis, volume->vr_Samples);
+        PutStr(line);
+    }
+}
+
+/* Hand a file to a warm spare of its tool, kept by the resident companion */
+/* Returns FALSE if the companion is not running, has no ready spare for the tool, */
+/* or the spare refused the file - caller then routes or launches normally */
+BOOL HandToSpare(STRPTR toolName, STRPTR fileName, BPTR fileLock)
+{
+    struct PrefetchCache *shared;
+    struct StandbyTool *standby;
+    struct MsgPort *sparePort;
+    UBYTE portName[64];
+    STRPTR toolPart;
+    BYTE oldPri = STANDBY_PRIORITY;
+    BOOL handed;
+    
+    Forbid();
+    shared = (struct PrefetchCache *)FindSemaphore(PREFETCH_SEMAPHORE);
+    if (shared != NULL) {
+        ObtainSemaphore(&shared->pc_Semaphore);
+    }
+    Permit();
+    if (shared == NULL) {
+        return FALSE;
+    }
+    
+    /* Take the spare, so no other ProjectX hands it a file too */
+    portName[0] = '\0';
+    toolPart = FilePart(toolName);
+    for (standby = (struct StandbyTool *)shared->pc_Spares.mlh_Head;
+         standby->st_Node.mln_Succ != NULL;
+         standby = (struct StandbyTool *)standby->st_Node.mln_Succ) {
+        if (standby->st_State == SPARE_READY &&
+            (Stricmp(standby->st_Tool, toolName) == 0 || Stricmp(standby->st_Tool, toolPart) == 0)) {
+            Strncpy(portName, standby->st_Port, sizeof(portName));
+            standby->st_State = SPARE_TAKEN;
+            break;
+        }
+    }
+    ReleaseSemaphore(&shared->pc_Semaphore);
+    
+    if (portName[0] == '\0') {
+        return FALSE;
+    }
+    
+    /* The spare waited at low priority, give it a normal one before it loads the file */
+    Forbid();
+    sparePort = FindPort(portName);
+    if (sparePort != NULL && sparePort->mp_SigTask != NULL) {
+        oldPri = SetTaskPri((struct Task *)sparePort->mp_SigTask, 0);
+    }
+    Permit();
+    
+    handed = RouteToRunningInstance(toolName, portName, fileName, fileLock);
+    
+    /* Refused or gone - put the spare back as it was, unless it is still busy with */
+    /* the file after a late reply, or the companion has moved on from it meanwhile */
+    if (!handed && routePending == NULL) {
+        Forbid();
+        sparePort = FindPort(portName);
+        if (sparePort != NULL && sparePort->mp_SigTask != NULL) {
+            SetTaskPri((struct Task *)sparePort->mp_SigTask, oldPri);
+        }
+        
+        /* The companion may have quit meanwhile, so look the cache up again */
+        shared = (struct PrefetchCache *)FindSemaphore(PREFETCH_SEMAPHORE);
+        if (shared != NULL) {
+            ObtainSemaphore(&shared->pc_Semaphore);
+        }
+        Permit();
+        if (shared != NULL) {
+            for (standby = (struct StandbyTool *)shared->pc_Spares.mlh_Head;
+                 standby->st_Node.mln_Succ != NULL;
+                 standby = (struct StandbyTool *)standby->st_Node.mln_Succ) {
+                if (standby->st_State == SPARE_TAKEN && Stricmp(standby->st_Port, portName) == 0) {
+                    standby->st_State = SPARE_READY;
+                    break;
+                }
+            }
+            ReleaseSemaphore(&shared->pc_Semaphore);
+        }
+    }
+    
+    return handed;
+}
+
+/* Read the standby tools into the companion's cache */
+/* Each line is: tool [minfree KB] "command"; the tool must also have a route, */
+/* as that is how files are handed to its spare */
+VOID LoadStandbyTools(struct PrefetchCache *cache)
+{
+    struct StandbyTool *standby;
+    struct ToolRoute *route;
+    struct CSource cs;
+    UBYTE line[512];
+    UBYTE minFree[16];
+    BPTR standbyFile;
+    LONG item;
+    
+    standbyFile = Open(STANDBY_FILE, MODE_OLDFILE);
+    if (standbyFile == NULL) {
+        return;
+    }
+    
+    while (FGets(standbyFile, line, sizeof(line) - 1) != NULL) {
+        if (line[0] == ';' || line[0] == '#' || line[0] == '\n' || line[0] == '\0') {
+            continue;
+        }
+        
+        standby = AllocVec(sizeof(struct StandbyTool), MEMF_PUBLIC | MEMF_CLEAR);
+        if (standby == NULL) {
+            break;
+        }
+        
+        cs.CS_Buffer = line;
+        cs.CS_Length = strlen((char *)line);
+        cs.CS_CurChr = 0;
+        
+        /* Tool and command are required, the memory threshold in between is optional */
+        standby->st_MinFree = STANDBY_MINFREE;
+        if (ReadItem(standby->st_Tool, sizeof(standby->st_Tool), &cs) <= ITEM_NOTHING ||
+            (item = ReadItem(minFree, sizeof(minFree), &cs)) <= ITEM_NOTHING) {
+            FreeVec(standby);
+            continue;
+        }
+        if (item == ITEM_UNQUOTED && StrToLong(minFree, &standby->st_MinFree) == (LONG)strlen((char *)minFree)) {
+            item = ReadItem(standby->st_Command, sizeof(standby->st_Command), &cs);
+        } else {
+            standby->st_MinFree = STANDBY_MINFREE;
+            Strncpy(standby->st_Command, minFree, sizeof(standby->st_Command));
+        }
+        
+        route = FindToolRoute(standby->st_Tool);
+        if (item <= ITEM_NOTHING || route == NULL) {
+            Printf("ProjectX: Standby tool %s needs a command and a route, ignored.\n", standby->st_Tool);
+            FreeVec(standby);
+            continue;
+        }
+        Strncpy(standby->st_PortPattern, route->tr_Port, sizeof(standby->st_PortPattern));
+        
+        AddTail((struct List *)&cache->pc_Spares, (struct Node *)standby);
+    }
+    
+    Close(standbyFile);
+}
+
+/* Advance every standby tool by one second: notice ports that appeared or went */
+/* away, and start a replacement for spares that were taken or quit */
+VOID MaintainSpares(struct PrefetchCache *cache)
+{
+    struct StandbyTool *standby;
+    struct Node *node;
+    UBYTE patternBuffer[130];
+    LONG known;
+    LONG i;
+    
+    ObtainSemaphore(&cache->pc_Semaphore);
+    
+    for (standby = (struct StandbyTool *)cache->pc_Spares.mlh_Head;
+         standby->st_Node.mln_Succ != NULL;
+         standby = (struct StandbyTool *)standby->st_Node.mln_Succ) {
+        standby->st_Ticks++;
+        
+        switch (standby->st_State) {
+            case SPARE_READY:
+                /* Quit by the user, or handed a file through a wildcard route */
+                Forbid();
+                if (FindPort(standby->st_Port) == NULL) {
+                    standby->st_State = SPARE_IDLE;
+                    standby->st_Ticks = 0;
+                }
+                Permit();
+                break;
+                
+            case SPARE_TAKEN:
+                standby->st_State = SPARE_IDLE;
+                standby->st_Ticks = 0;
+                /* Fall through to start the replacement right away */
+                
+            case SPARE_IDLE:
+                if (standby->st_Ticks < 0 ||
+                    AvailMem(MEMF_ANY) < (ULONG)standby->st_MinFree * 1024) {
+                    break;
+                }
+                
+                /* Remember the instances already running, the spare is the port that is new */
+                if (ParsePatternNoCase(standby->st_PortPattern, patternBuffer, sizeof(patternBuffer)) < 0) {
+                    break;
+                }
+                known = 0;
+                Forbid();
+                for (node = SysBase->PortList.lh_Head;
+                     node->ln_Succ != NULL && known < STANDBY_KNOWN_PORTS;
+                     node = node->ln_Succ) {
+                    if (node->ln_Name != NULL && MatchPatternNoCase(patternBuffer, (STRPTR)node->ln_Name)) {
+                        Strncpy(standby->st_Known[known++], (STRPTR)node->ln_Name, sizeof(standby->st_Known[0]));
+                    }
+                }
+                Permit();
+                for (; known < STANDBY_KNOWN_PORTS; known++) {
+                    standby->st_Known[known][0] = '\0';
+                }
+                
+                if (StartSpare(standby)) {
+                    standby->st_State = SPARE_STARTING;
+                    standby->st_Ticks = 0;
+                } else {
+                    standby->st_Ticks = -STANDBY_RETRY_TICKS;
+                }
+                break;
+                
+            case SPARE_STARTING:
+                if (ParsePatternNoCase(standby->st_PortPattern, patternBuffer, sizeof(patternBuffer)) < 0) {
+                    break;
+                }
+                Forbid();
+                for (node = SysBase->PortList.lh_Head; node->ln_Succ != NULL; node = node->ln_Succ) {
+                    if (node->ln_Name == NULL || !MatchPatternNoCase(patternBuffer, (STRPTR)node->ln_Name)) {
+                        continue;
+                    }
+                    for (i = 0; i < STANDBY_KNOWN_PORTS; i++) {
+                        if (Stricmp(standby->st_Known[i], (STRPTR)node->ln_Name) == 0) {
+                            break;
+                        }
+                    }
+                    if (i == STANDBY_KNOWN_PORTS) {
+                        Strncpy(standby->st_Port, (STRPTR)node->ln_Name, sizeof(standby->st_Port));
+                        standby->st_State = SPARE_READY;
+                        standby->st_Ticks = 0;
+                        break;
+                    }
+                }
+                Permit();
+                
+                /* Never opened its port - try again later */
+                if (standby->st_State == SPARE_STARTING && standby->st_Ticks > STANDBY_START_TICKS) {
+                    standby->st_State = SPARE_IDLE;
+                    standby->st_Ticks = -STANDBY_RETRY_TICKS;
+                }
+                break;
+        }
+    }
+    
+    ReleaseSemaphore(&cache->pc_Semaphore);
+}
+
+/* Start a spare instance in the background at low priority */
+BOOL StartSpare(struct StandbyTool *standby)
+{
+    BPTR input;
+    LONG result;
+    
+    input = Open("NIL:", MODE_OLDFILE);
+    if (input == NULL) {
+        return FALSE;
+    }
+    
+    /* Asynchronous - the new process closes its input when it ends */
+    result = SystemTags(standby->st_Command,
+                        SYS_Input, input,
+                        SYS_Output, NULL,
+                        SYS_Asynch, TRUE,
+                        NP_Priority, STANDBY_PRIORITY,
+                        TAG_DONE);
+    if (result == -1) {
+        Close(input);
+        return FALSE;
+    }
+    
+    return TRUE;
+}
+
+/* Little-endian fields in LhA and Zip headers */
+ULONG ArchiveWord(UBYTE *p)
+{
+    return (ULONG)p[0] | ((ULONG)p[1] << 8);
+}
+
+ULONG ArchiveLong(UBYTE *p)
+{
+    return (ULONG)p[0] | ((ULONG)p[1] << 8) | ((ULONG)p[2] << 16) | ((ULONG)p[3] << 24);
+}
+
+/* Read length bytes at offset, returns the number of bytes read */
+LONG ReadArchiveAt(BPTR file, LONG offset, UBYTE *buffer, LONG length)
+{
+    if (Seek(file, offset, OFFSET_BEGINNING) < 0) {
+        return -1;
+    }
+    return Read(file, buffer, length);
+}
+
+/* Walk LhA level 1 and 2 extended headers for the file and directory names */
+VOID ReadLhaExtended(BPTR file, LONG offset, ULONG size, UBYTE *dirName, UBYTE *fileName, ULONG nameSize)
+{
+    UBYTE ext[260];
+    ULONG length;
+    ULONG i;
+    
+    while (size >= 3) {
+        if (size > sizeof(ext) || ReadArchiveAt(file, offset, ext, size) != (LONG)size) {
+            /* Too large to be a name - skip it by its trailing size field */
+            if (ReadArchiveAt(file, offset + size - 2, ext, 2) != 2) {
+                break;
+            }
+            offset += size;
+            size = ArchiveWord(ext);
+            continue;
+        }
+        
+        length = size - 3;
+        if (length >= nameSize) {
+            length = nameSize - 1;
+        }
+        if (ext[0] == 0x01) {
+            CopyMem(ext + 1, fileName, length);
+            fileName[length] = '\0';
+        } else if (ext[0] == 0x02) {
+            /* Directory parts are separated by 0xFF */
+            for (i = 0; i < length; i++) {
+                dirName[i] = (ext[1 + i] == 0xFF) ? '/' : ext[1 + i];
+            }
+            dirName[length] = '\0';
+        }
+        
+        offset += size;
+        size = ArchiveWord(ext + size - 2);
+    }
+}
+
+/* Find a member in an LhA archive from its headers alone */
+/* Returns TRUE with the member's original size and its name as stored, if it is found */
+BOOL FindLhaMember(BPTR file, STRPTR memberName, ULONG *sizeOut, STRPTR nameOut, ULONG nameSize)
+{
+    UBYTE header[260];
+    UBYTE dirName[256];
+    UBYTE fileName[256];
+    UBYTE fullName[512];
+    LONG offset = 0;
+    LONG headerSize;
+    LONG nameLength;
+    ULONG packedSize;
+    UBYTE level;
+    STRPTR c;
+    
+    while (ReadArchiveAt(file, offset, header, 26) >= 22 && header[0] != 0) {
+        if (header[2] != '-' || header[6] != '-') {
+            break;
+        }
+        packedSize = ArchiveLong(header + 7);
+        level = header[20];
+        dirName[0] = '\0';
+        fileName[0] = '\0';
+        
+        if (level == 0 || level == 1) {
+            headerSize = header[0] + 2;
+            if (ReadArchiveAt(file, offset, header, headerSize) != headerSize) {
+                break;
+            }
+            nameLength = header[21];
+            if (22 + nameLength > headerSize) {
+                break;
+            }
+            CopyMem(header + 22, fileName, nameLength);
+            fileName[nameLength] = '\0';
+            if (level == 1) {
+                /* Extended headers follow, and are counted in the packed size */
+                ReadLhaExtended(file, offset + headerSize, ArchiveWord(header + headerSize - 2),
+                                dirName, fileName, sizeof(fileName));
+            }
+        } else if (level == 2) {
+            headerSize = (LONG)ArchiveWord(header);
+            ReadLhaExtended(file, offset + 26, ArchiveWord(header + 24),
+                            dirName, fileName, sizeof(fileName));
+        } else {
+            break;
+        }
+        
+        SNPrintf(fullName, sizeof(fullName), "%s%s", dirName, fileName);
+        for (c = fullName; *c != '\0'; c++) {
+            if (*c == '\\') {
+                *c = '/';
+            }
+        }
+        if (Stricmp(fullName, memberName) == 0) {
+            *sizeOut = ArchiveLong(header + 11);
+            Strncpy(nameOut, fullName, nameSize);
+            return TRUE;
+        }
+        
+        offset += headerSize + packedSize;
+    }
+    
+    return FALSE;
+}
+
+/* Find a member in a Zip archive from its central directory */
+/* Returns TRUE with the member's uncompressed size and its name as stored, if it is found */
+BOOL FindZipMember(BPTR file, STRPTR memberName, ULONG *sizeOut, STRPTR nameOut, ULONG nameSize)
+{
+    UBYTE *tail;
+    UBYTE header[46];
+    UBYTE name[256];
+    LONG fileSize;
+    LONG tailSize;
+    LONG directory = -1;
+    LONG entries = 0;
+    LONG nameLength;
+    LONG i;
+    BOOL found = FALSE;
+    
+    if (Seek(file, 0, OFFSET_END) < 0 || (fileSize = Seek(file, 0, OFFSET_BEGINNING)) < 22) {
+        return FALSE;
+    }
+    
+    /* The end record is in the last 22 bytes unless the archive has a comment, */
+    /* so only a long comment makes it worth reading the largest possible tail */
+    for (tailSize = ZIP_TAIL_SIZE; directory < 0; tailSize = ZIP_TAIL_MAX) {
+        if (tailSize > fileSize) {
+            tailSize = fileSize;
+        }
+        tail = AllocVec(tailSize, MEMF_ANY);
+        if (tail == NULL) {
+            return FALSE;
+        }
+        if (ReadArchiveAt(file, fileSize - tailSize, tail, tailSize) == tailSize) {
+            for (i = tailSize - 22; i >= 0; i--) {
+                if (tail[i] == 'P' && tail[i + 1] == 'K' && tail[i + 2] == 5 && tail[i + 3] == 6) {
+                    entries = (LONG)ArchiveWord(tail + i + 10);
+                    directory = (LONG)ArchiveLong(tail + i + 16);
+                    break;
+                }
+            }
+        }
+        FreeVec(tail);
+        if (tailSize == fileSize || tailSize == ZIP_TAIL_MAX) {
+            break;
+        }
+    }
+    
+    for (i = 0; i < entries && directory >= 0 && !found; i++) {
+        if (ReadArchiveAt(file, directory, header, sizeof(header)) != sizeof(header) ||
+            ArchiveLong(header) != 0x02014B50) {
+            break;
+        }
+        nameLength = (LONG)ArchiveWord(header + 28);
+        if (nameLength < (LONG)sizeof(name) &&
+            ReadArchiveAt(file, directory + sizeof(header), name, nameLength) == nameLength) {
+            name[nameLength] = '\0';
+            if (Stricmp(name, memberName) == 0) {
+                *sizeOut = ArchiveLong(header + 24);
+                Strncpy(nameOut, name, nameSize);
+                found = TRUE;
+            }
+        }
+        directory += sizeof(header) + nameLength + ArchiveWord(header + 30) + ArchiveWord(header + 32);
+    }
+    
+    return found;
+}
+
+/* Extract one member of an LhA or Zip archive into its own drawer in RAM: */
+/* path is archive/member, e.g. Work:Downloads/Tools.lha/Docs/ReadMe.txt */
+/* Returns TRUE with the staged file's path, FALSE if the path is not inside an */
+/* archive, the member is not there, is too large, or could not be extracted */
+BOOL StageArchiveMember(STRPTR path, STRPTR stagedPath, ULONG stagedSize)
+{
+    struct FileInfoBlock *fib;
+    struct DateStamp now;
+    UBYTE archivePath[256];
+    UBYTE storedName[256];
+    UBYTE stageDir[64];
+    UBYTE tool[128];
+    UBYTE command[768];
+    STRPTR member = NULL;
+    STRPTR c;
+    BPTR archiveFile;
+    BPTR lock;
+    BPTR input;
+    BPTR output;
+    ULONG memberSize = 0;
+    BOOL isZip = FALSE;
+    BOOL found = FALSE;
+    LONG attempt;
+    LONG length;
+    
+    /* The archive is the first path part with an archive suffix that is followed by more */
+    for (c = path; *c != '\0'; c++) {
+        if (*c != '/') {
+            continue;
+        }
+        length = (LONG)(c - path);
+        if (length >= (LONG)sizeof(archivePath)) {
+            return FALSE;
+        }
+        CopyMem(path, archivePath, length);
+        archivePath[length] = '\0';
+        if (length > 4 && (Stricmp(archivePath + length - 4, ".lha") == 0 ||
+                           Stricmp(archivePath + length - 4, ".lzh") == 0)) {
+            member = c + 1;
+            break;
+        }
+        if (length > 4 && Stricmp(archivePath + length - 4, ".zip") == 0) {
+            member = c + 1;
+            isZip = TRUE;
+            break;
+        }
+    }
+    if (member == NULL || *member == '\0') {
+        return FALSE;
+    }
+    
+    archiveFile = Open(archivePath, MODE_OLDFILE);
+    if (archiveFile == NULL) {
+        return FALSE;
+    }
+    found = isZip ? FindZipMember(archiveFile, member, &memberSize, storedName, sizeof(storedName))
+                  : FindLhaMember(archiveFile, member, &memberSize, storedName, sizeof(storedName));
+    Close(archiveFile);
+    
+    if (!found) {
+        Printf("ProjectX: %s is not in %s.\n", member, archivePath);
+        return FALSE;
+    }
+    if (memberSize > ARCHIVE_MAX_MEMBER ||
+        AvailMem(MEMF_ANY) < memberSize + ARCHIVE_MEMORY_RESERVE) {
+        Printf("ProjectX: %s is too large to stage (%lu bytes).\n", member, memberSize);
+        return FALSE;
+    }
+    
+    PurgeStagedMembers();
+    
+    /* A drawer of its own, so the member keeps its name */
+    lock = CreateDir(ARCHIVE_STAGE_DIR);
+    if (lock != NULL) {
+        UnLock(lock);
+    }
+    DateStamp(&now);
+    lock = NULL;
+    for (attempt = 0; attempt < 16 && lock == NULL; attempt++) {
+        SNPrintf(stageDir, sizeof(stageDir), "%s/%08lx",
+                 ARCHIVE_STAGE_DIR, (now.ds_Minute * 3000 + now.ds_Tick + attempt) ^ (ULONG)FindTask(NULL));
+        lock = CreateDir(stageDir);
+    }
+    if (lock == NULL) {
+        return FALSE;
+    }
+    UnLock(lock);
+    
+    /* Extract just this member with the archiver, without its drawer path */
+    if (isZip) {
+        if (GetVar(ARCHIVE_UNZIP_VAR, tool, sizeof(tool), 0) <= 0) {
+            Strncpy(tool, "UnZip", sizeof(tool));
+        }
+        SNPrintf(command, sizeof(command), "%s -qq -o -j \"%s\" \"%s\" -d \"%s\"",
+                 tool, archivePath, storedName, stageDir);
+    } else {
+        if (GetVar(ARCHIVE_LHA_VAR, tool, sizeof(tool), 0) <= 0) {
+            Strncpy(tool, "LhA", sizeof(tool));
+        }
+        SNPrintf(command, sizeof(command), "%s -q -m e \"%s\" \"%s/\" \"%s\"",
+                 tool, archivePath, stageDir, storedName);
+    }
+    
+    input = Open("NIL:", MODE_OLDFILE);
+    output = Open("NIL:", MODE_NEWFILE);
+    if (input != NULL && output != NULL) {
+        SystemTags(command, SYS_Input, input, SYS_Output, output, TAG_DONE);
+    }
+    if (input != NULL) {
+        Close(input);
+    }
+    if (output != NULL) {
+        Close(output);
+    }
+    
+    /* The staged copy must be complete */
+    Strncpy(stagedPath, stageDir, stagedSize);
+    AddPart(stagedPath, FilePart(member), stagedSize);
+    found = FALSE;
+    lock = Lock(stagedPath, SHARED_LOCK);
+    if (lock != NULL) {
+        fib = AllocDosObject(DOS_FIB, NULL);
+        if (fib != NULL) {
+            found = Examine(lock, fib) && fib->fib_DirEntryType < 0 &&
+                    (ULONG)fib->fib_Size == memberSize;
+            FreeDosObject(DOS_FIB, fib);
+        }
+        UnLock(lock);
+    }
+    
+    if (!found) {
+        Printf("ProjectX: Could not extract %s from %s.\n", member, archivePath);
+        RemoveStagedMember(stagedPath);
+        return FALSE;
+    }
+    
+    return TRUE;
+}
+
+/* Delete a staged member and its drawer, fails quietly if a tool still has it open */
+BOOL RemoveStagedMember(STRPTR stagedPath)
+{
+    UBYTE stageDir[256];
+    BOOL removed;
+    
+    Strncpy(stageDir, stagedPath, sizeof(stageDir));
+    *PathPart(stageDir) = '\0';
+    
+    removed = DeleteFile(stagedPath);
+    return (BOOL)(DeleteFile(stageDir) && removed);
+}
+
+/* Remove staged members older than ARCHIVE_STAGE_MINUTES that no tool has open */
+/* Run before every new member is staged, for the tools Workbench started, whose exit ProjectX does not see */
+VOID PurgeStagedMembers(VOID)
+{
+    struct FileInfoBlock *fib;
+    struct DateStamp now;
+    UBYTE stale[ARCHIVE_PURGE_MAX][16];
+    UBYTE stageDir[64];
+    UBYTE stagedPath[256];
+    BPTR lock;
+    LONG age;
+    LONG count = 0;
+    LONG i;
+    
+    lock = Lock(ARCHIVE_STAGE_DIR, SHARED_LOCK);
+    if (lock == NULL) {
+        return;
+    }
+    fib = AllocDosObject(DOS_FIB, NULL);
+    if (fib == NULL) {
+        UnLock(lock);
+        return;
+    }
+    
+    /* Collect the stale drawers first, as deleting would upset ExNext() */
+    DateStamp(&now);
+    if (Examine(lock, fib)) {
+        while (count < ARCHIVE_PURGE_MAX && ExNext(lock, fib)) {
+            age = (now.ds_Days - fib->fib_Date.ds_Days) * 1440 + now.ds_Minute - fib->fib_Date.ds_Minute;
+            if (fib->fib_DirEntryType > 0 && age >= ARCHIVE_STAGE_MINUTES) {
+                Strncpy(stale[count++], fib->fib_FileName, sizeof(stale[0]));
+            }
+        }
+    }
+    UnLock(lock);
+    
+    for (i = 0; i < count; i++) {
+        SNPrintf(stageDir, sizeof(stageDir), "%s/%s", ARCHIVE_STAGE_DIR, stale[i]);
+        lock = Lock(stageDir, SHARED_LOCK);
+        if (lock == NULL) {
+            continue;
+        }
+        
+        /* Each drawer holds one member */
+        stagedPath[0] = '\0';
+        if (Examine(lock, fib) && ExNext(lock, fib)) {
+            SNPrintf(stagedPath, sizeof(stagedPath), "%s/%s", stageDir, fib->fib_FileName);
+        }
+        UnLock(lock);
+        
+        if (stagedPath[0] != '\0') {
+            RemoveStagedMember(stagedPath);
+        } else {
+            DeleteFile(stageDir);
+        }
+    }
+    
+    FreeDosObject(DOS_FIB, fib);
+}
+
+/* Read the staging index, or start an empty one */
+VOID LoadStageIndex(struct StageRecord *records)
+{
+    struct StageHeader header;
+    BPTR file;
+    
+    memset(records, 0, sizeof(struct StageRecord) * STAGE_MAX);
+    
+    file = Open(STAGE_INDEX, MODE_OLDFILE);
+    if (file == NULL) {
+        return;
+    }
+    if (Read(file, &header, sizeof(header)) != sizeof(header) ||
+        header.sgh_Magic != STAGE_MAGIC || header.sgh_Version != STAGE_VERSION ||
+        header.sgh_Count != STAGE_MAX ||
+        Read(file, records, sizeof(struct StageRecord) * STAGE_MAX) !=
+            (LONG)(sizeof(struct StageRecord) * STAGE_MAX)) {
+        memset(records, 0, sizeof(struct StageRecord) * STAGE_MAX);
+    }
+    Close(file);
+}
+
+/* Write the staging index through a temporary file */
+VOID SaveStageIndex(struct StageRecord *records)
+{
+    struct StageHeader header;
+    BPTR file;
+    BOOL success = FALSE;
+    
+    file = Open(STAGE_INDEX_TEMP, MODE_NEWFILE);
+    if (file == NULL) {
+        return;
+    }
+    
+    header.sgh_Magic = STAGE_MAGIC;
+    header.sgh_Version = STAGE_VERSION;
+    header.sgh_Count = STAGE_MAX;
+    if (Write(file, &header, sizeof(header)) == sizeof(header) &&
+        Write(file, records, sizeof(struct StageRecord) * STAGE_MAX) ==
+            (LONG)(sizeof(struct StageRecord) * STAGE_MAX)) {
+        success = TRUE;
+    }
+    Close(file);
+    
+    if (success) {
+        DeleteFile(STAGE_INDEX);
+        Rename(STAGE_INDEX_TEMP, STAGE_INDEX);
+    } else {
+        DeleteFile(STAGE_INDEX_TEMP);
+    }
+}
+
+/* Delete the staged copy in a slot, fails if a tool still has it open */
+BOOL DropStagedCopy(struct StageRecord *record, LONG slot)
+{
+    UBYTE slotDir[64];
+    UBYTE stagedPath[128];
+    
+    SNPrintf(slotDir, sizeof(slotDir), "%s/s%02ld", STAGE_DIR, slot);
+    Strncpy(stagedPath, slotDir, sizeof(stagedPath));
+    AddPart(stagedPath, FilePart(record->sg_Path), sizeof(stagedPath));
+    
+    /* The copy is delete-protected, put that back if a tool still has it open */
+    SetProtection(stagedPath, 0);
+    if (!DeleteFile(stagedPath) && IoErr() != ERROR_OBJECT_NOT_FOUND) {
+        SetProtection(stagedPath, STAGE_PROTECTION);
+        return FALSE;
+    }
+    DeleteFile(slotDir);
+    memset(record, 0, sizeof(struct StageRecord));
+    
+    return TRUE;
+}
+
+/* Copy a file into a staging slot in large sequential reads */
+/* Takes over the source lock once the file is open, and clears it */
+BOOL CopyToStage(BPTR *sourceLock, STRPTR stagedPath)
+{
+    BPTR source;
+    BPTR target;
+    UBYTE *buffer;
+    ULONG chunk = STAGE_CHUNK;
+    LONG length;
+    BOOL success = FALSE;
+    
+    buffer = AllocVec(chunk, MEMF_ANY);
+    if (buffer == NULL) {
+        chunk = STAGE_CHUNK / 8;
+        buffer = AllocVec(chunk, MEMF_ANY);
+        if (buffer == NULL) {
+            return FALSE;
+        }
+    }
+    
+    source = OpenFromLock(*sourceLock);
+    if (source == NULL) {
+        FreeVec(buffer);
+        return FALSE;
+    }
+    *sourceLock = NULL;
+    target = Open(stagedPath, MODE_NEWFILE);
+    if (target != NULL) {
+        success = TRUE;
+        while ((length = Read(source, buffer, chunk)) > 0) {
+            if (Write(target, buffer, length) != length) {
+                success = FALSE;
+                break;
+            }
+        }
+        if (length < 0) {
+            success = FALSE;
+        }
+        Close(target);
+        if (!success) {
+            DeleteFile(stagedPath);
+        } else {
+            /* Tools may save over the file they were given - a save to RAM: would be lost */
+            SetProtection(stagedPath, STAGE_PROTECTION);
+        }
+    }
+    
+    /* OpenFromLock took over the lock */
+    Close(source);
+    FreeVec(buffer);
+    
+    return success;
+}
+
+/* Find or make the staged copy of a file, returns its slot or -1 */
+/* Takes over the source lock once it opens the file to copy it, and clears it */
+LONG StageIntoSlot(struct StageRecord *records, struct FileInfoBlock *fib, BPTR *sourceLock,
+                   STRPTR sourcePath, LONG budget)
+{
+    struct StageRecord *record;
+    BOOL tried[STAGE_MAX];
+    UBYTE slotDir[64];
+    UBYTE stagedPath[128];
+    BPTR lock;
+    LONG used = 0;
+    LONG slot = -1;
+    LONG oldest;
+    LONG i;
+    
+    /* Look for this file, and add up what the other copies use */
+    for (i = 0; i < STAGE_MAX; i++) {
+        tried[i] = FALSE;
+        if (records[i].sg_Path[0] == '\0') {
+            continue;
+        }
+        if (Stricmp(records[i].sg_Path, sourcePath) == 0) {
+            slot = i;
+        } else {
+            used += records[i].sg_Size;
+        }
+    }
+    
+    if (slot >= 0) {
+        record = &records[slot];
+        SNPrintf(slotDir, sizeof(slotDir), "%s/s%02ld", STAGE_DIR, slot);
+        Strncpy(stagedPath, slotDir, sizeof(stagedPath));
+        AddPart(stagedPath, FilePart(sourcePath), sizeof(stagedPath));
+        
+        /* Reuse the copy only if the source has not changed since */
+        lock = Lock(stagedPath, SHARED_LOCK);
+        if (lock != NULL) {
+            UnLock(lock);
+            if (record->sg_Size == fib->fib_Size && CompareDates(&record->sg_Date, &fib->fib_Date) == 0) {
+                DateStamp(&record->sg_Used);
+                return slot;
+            }
+        }
+        if (!DropStagedCopy(record, slot)) {
+            /* The old copy is still open - launch from the source this time */
+            return -1;
+        }
+    } else {
+        for (i = 0; i < STAGE_MAX && slot < 0; i++) {
+            if (records[i].sg_Path[0] == '\0') {
+                slot = i;
+            }
+        }
+    }
+    
+    /* Drop the least recently used copies until this one fits in a free slot */
+    while (slot < 0 || used + fib->fib_Size > budget) {
+        oldest = -1;
+        for (i = 0; i < STAGE_MAX; i++) {
+            if (records[i].sg_Path[0] != '\0' && i != slot && !tried[i] &&
+                (oldest < 0 || CompareDates(&records[i].sg_Used, &records[oldest].sg_Used) > 0)) {
+                oldest = i;
+            }
+        }
+        if (oldest < 0) {
+            return -1;
+        }
+        tried[oldest] = TRUE;
+        used -= records[oldest].sg_Size;
+        if (!DropStagedCopy(&records[oldest], oldest)) {
+            /* Still open in a tool - keep it and try the next oldest */
+            used += records[oldest].sg_Size;
+        } else if (slot < 0) {
+            slot = oldest;
+        }
+    }
+    
+    record = &records[slot];
+    SNPrintf(slotDir, sizeof(slotDir), "%s/s%02ld", STAGE_DIR, slot);
+    lock = CreateDir(slotDir);
+    if (lock != NULL) {
+        UnLock(lock);
+    }
+    Strncpy(stagedPath, slotDir, sizeof(stagedPath));
+    AddPart(stagedPath, FilePart(sourcePath), sizeof(stagedPath));
+    
+    if (!CopyToStage(sourceLock, stagedPath)) {
+        DeleteFile(slotDir);
+        return -1;
+    }
+    
+    Strncpy(record->sg_Path, sourcePath, sizeof(record->sg_Path));
+    record->sg_Date = fib->fib_Date;
+    record->sg_Size = fib->fib_Size;
+    DateStamp(&record->sg_Used);
+    
+    return slot;
+}
+
+/* Launch files on volumes marked STAGE from a copy in RAM: */
+/* Repeat opens of an unchanged file reuse the copy; the least recently used copies */
+/* are dropped to stay within the budget. Returns TRUE with a lock on the drawer */
+/* holding the copy, under the same name, which the caller must UnLock() */
+BOOL StageForLaunch(STRPTR fileName, BPTR fileLock, BPTR *stageLockOut)
+{
+    struct StageRecord *records;
+    struct VolumeRecord *volume;
+    struct FileInfoBlock *fib;
+    UBYTE sourcePath[256];
+    UBYTE slotDir[64];
+    UBYTE budgetVar[16];
+    BPTR sourceLock;
+    BPTR indexLock;
+    BPTR oldDir;
+    BPTR lock;
+    LONG budget = STAGE_BUDGET;
+    LONG slot;
+    
+    *stageLockOut = NULL;
+    
+    volume = FindVolume(fileLock);
+    if (volume == NULL || !volume->vr_Stage) {
+        return FALSE;
+    }
+    
+    if (GetVar(STAGE_BUDGET_VAR, budgetVar, sizeof(budgetVar), 0) > 0) {
+        StrToLong(budgetVar, &budget);
+    }
+    budget *= 1024;
+    
+    oldDir = CurrentDir(fileLock);
+    sourceLock = Lock(fileName, SHARED_LOCK);
+    CurrentDir(oldDir);
+    if (sourceLock == NULL) {
+        return FALSE;
+    }
+    
+    fib = AllocDosObject(DOS_FIB, NULL);
+    records = AllocVec(sizeof(struct StageRecord) * STAGE_MAX, MEMF_CLEAR);
+    
+    /* No single file may take more than half the budget */
+    if (fib != NULL && records != NULL &&
+        Examine(sourceLock, fib) && fib->fib_DirEntryType < 0 &&
+        fib->fib_Size <= budget / 2 &&
+        NameFromLock(sourceLock, sourcePath, sizeof(sourcePath))) {
+        lock = CreateDir(STAGE_DIR);
+        if (lock != NULL) {
+            UnLock(lock);
+        }
+        
+        /* Another ProjectX staging at the same time would lose one index update */
+        indexLock = OpenLockFile(STAGE_INDEX_LOCK);
+        if (indexLock != NULL) {
+            LoadStageIndex(records);
+            slot = StageIntoSlot(records, fib, &sourceLock, sourcePath, budget);
+            SaveStageIndex(records);
+            
+            if (slot >= 0) {
+                SNPrintf(slotDir, sizeof(slotDir), "%s/s%02ld", STAGE_DIR, slot);
+                *stageLockOut = Lock(slotDir, SHARED_LOCK);
+            }
+            Close(indexLock);
+        }
+    }
+    
+    if (sourceLock != NULL) {
+        UnLock(sourceLock);
+    }
+    if (records != NULL) {
+        FreeVec(records);
+    }
+    if (fib != NULL) {
+        FreeDosObject(DOS_FIB, fib);
+    }
+    
+    return (BOOL)(*stageLockOut != NULL);
+}
+
+/* Whether to start tools directly rather than through Workbench */
+/* ProjectX/Launch set to DIRECT or WORKBENCH decides; otherwise tools are */
+/* started directly only when Workbench is not running */
+BOOL UseDirectLaunch(VOID)
+{
+    static LONG direct = -1;
+    UBYTE value[16];
+    
+    if (direct < 0) {
+        if (GetVar(LAUNCH_VAR, value, sizeof(value), 0) > 0) {
+            direct = (Stricmp(value, "DIRECT") == 0) ? 1 : 0;
+        } else {
+            Forbid();
+            direct = (FindPort(LAUNCH_WB_PORT) == NULL) ? 1 : 0;
+            Permit();
+        }
+    }
+    
+    return direct != 0;
+}
+
+/* Load the tool and start it with a WBStartup naming the file, as Workbench would */
+/* The reply goes to the resident companion if it runs, otherwise to our own port */
+/* and is waited for in Cleanup(). Returns FALSE, with nothing left behind, if the */
+/* tool cannot be started this way - the caller then asks Workbench. A stagedPath */
+/* is deleted with the launch once the tool has quit. */
+BOOL DirectLaunch(STRPTR toolName, STRPTR fileName, BPTR fileLock, struct LaunchProfile *profile,
+                  STRPTR stagedPath)
+{
+    struct DirectLaunch *launch;
+    struct PrefetchCache *shared;
+    struct DiskObject *toolIcon;
+    struct MsgPort *replyPort;
+    struct Process *process;
+    BPTR toolLock;
+    BPTR toolDir;
+    BPTR segment;
+    BPTR currentDir;
+    BPTR homeDir;
+    LONG stackSize = LAUNCH_MIN_STACK;
+    LONG priority = 0;
+    
+    /* Only one launch of our own at a time - a second is left to Workbench */
+    if (directPending != NULL) {
+        return FALSE;
+    }
+    
+    toolLock = Lock(toolName, SHARED_LOCK);
+    if (toolLock == NULL) {
+        return FALSE;
+    }
+    toolDir = ParentDir(toolLock);
+    UnLock(toolLock);
+    if (toolDir == NULL) {
+        return FALSE;
+    }
+    
+    /* The type's launch profile gives the stack, otherwise the tool's icon does as for Workbench */
+    if (profile != NULL && (profile->lp_Flags & PROFILE_STACK)) {
+        if (profile->lp_Stack > stackSize) {
+            stackSize = profile->lp_Stack;
+        }
+    } else {
+        toolIcon = GetDiskObject(toolName);
+        if (toolIcon != NULL) {
+            if (toolIcon->do_Type == WBTOOL && toolIcon->do_StackSize > stackSize) {
+                stackSize = toolIcon->do_StackSize;
+            }
+            FreeDiskObject(toolIcon);
+        }
+    }
+    if (profile != NULL && (profile->lp_Flags & PROFILE_PRI)) {
+        priority = profile->lp_Priority;
+    }
+    
+    /* Scripts and other non-executables fail here and go to Workbench */
+    segment = LoadSeg(toolName);
+    if (segment == NULL) {
+        UnLock(toolDir);
+        return FALSE;
+    }
+    
+    launch = AllocVec(sizeof(struct DirectLaunch), MEMF_PUBLIC | MEMF_CLEAR);
+    if (launch == NULL) {
+        UnLoadSeg(segment);
+        UnLock(toolDir);
+        return FALSE;
+    }
+    
+    Strncpy(launch->dl_ToolName, FilePart(toolName), sizeof(launch->dl_ToolName));
+    Strncpy(launch->dl_FileName, fileName, sizeof(launch->dl_FileName));
+    launch->dl_Args[0].wa_Lock = toolDir;
+    launch->dl_Args[0].wa_Name = (BYTE *)launch->dl_ToolName;
+    launch->dl_Args[1].wa_Lock = DupLock(fileLock);
+    launch->dl_Args[1].wa_Name = (BYTE *)launch->dl_FileName;
+    launch->dl_Startup.sm_Message.mn_Node.ln_Type = NT_MESSAGE;
+    launch->dl_Startup.sm_Message.mn_Length = sizeof(struct WBStartup);
+    launch->dl_Startup.sm_Segment = segment;
+    launch->dl_Startup.sm_NumArgs = 2;
+    launch->dl_Startup.sm_ArgList = launch->dl_Args;
+    if (launch->dl_Args[1].wa_Lock == NULL) {
+        FreeDirectLaunch(launch);
+        return FALSE;
+    }
+    
+    /* Hold the companion while starting, so its port cannot go away under us */
+    Forbid();
+    shared = (struct PrefetchCache *)FindSemaphore(PREFETCH_SEMAPHORE);
+    if (shared != NULL) {
+        ObtainSemaphore(&shared->pc_Semaphore);
+    }
+    Permit();
+    if (shared != NULL && shared->pc_LaunchPort == NULL) {
+        ReleaseSemaphore(&shared->pc_Semaphore);
+        shared = NULL;
+    }
+    
+    if (shared != NULL) {
+        replyPort = shared->pc_LaunchPort;
+    } else {
+        if (directPort == NULL) {
+            directPort = CreateMsgPort();
+        }
+        replyPort = directPort;
+    }
+    if (replyPort == NULL) {
+        FreeDirectLaunch(launch);
+        return FALSE;
+    }
+    launch->dl_Startup.sm_Message.mn_ReplyPort = replyPort;
+    
+    /* The new process owns these two and unlocks them when it ends */
+    currentDir = DupLock(toolDir);
+    homeDir = DupLock(toolDir);
+    process = NULL;
+    if (currentDir != NULL && homeDir != NULL) {
+        process = CreateNewProcTags(NP_Seglist, (ULONG)segment,
+                                    NP_FreeSeglist, FALSE,
+                                    NP_Name, (ULONG)launch->dl_ToolName,
+                                    NP_StackSize, stackSize,
+                                    NP_Priority, priority,
+                                    NP_CurrentDir, (ULONG)currentDir,
+                                    NP_HomeDir, (ULONG)homeDir,
+                                    TAG_DONE);
+    }
+    
+    if (process == NULL) {
+        if (shared != NULL) {
+            ReleaseSemaphore(&shared->pc_Semaphore);
+        }
+        if (currentDir != NULL) {
+            UnLock(currentDir);
+        }
+        if (homeDir != NULL) {
+            UnLock(homeDir);
+        }
+        FreeDirectLaunch(launch);
+        return FALSE;
+    }
+    
+    /* The startup code of the tool waits for this before running main() */
+    if (stagedPath != NULL) {
+        Strncpy(launch->dl_StagedPath, stagedPath, sizeof(launch->dl_StagedPath));
+    }
+    launch->dl_Startup.sm_Process = &process->pr_MsgPort;
+    PutMsg(&process->pr_MsgPort, (struct Message *)&launch->dl_Startup);
+    
+    if (shared != NULL) {
+        shared->pc_Launches++;
+        ReleaseSemaphore(&shared->pc_Semaphore);
+    } else {
+        directPending = launch;
+    }
+    
+    return TRUE;
+}
+
+/* Free a direct launch once its WBStartup has been replied, or if it never started */
+/* The tool has quit by then, so the archive member staged for it goes too */
+VOID FreeDirectLaunch(struct DirectLaunch *launch)
+{
+    if (launch->dl_Startup.sm_Segment != NULL) {
+        UnLoadSeg(launch->dl_Startup.sm_Segment);
+    }
+    if (launch->dl_Args[0].wa_Lock != NULL) {
+        UnLock(launch->dl_Args[0].wa_Lock);
+    }
+    if (launch->dl_Args[1].wa_Lock != NULL) {
+        UnLock(launch->dl_Args[1].wa_Lock);
+    }
+    if (launch->dl_StagedPath[0] != '\0') {
+        RemoveStagedMember(launch->dl_StagedPath);
+    }
+    FreeVec(launch);
+}
+
+/* Free the direct launches whose tools have quit, in the resident companion */
+VOID CollectLaunches(struct PrefetchCache *cache)
+{
+    struct Message *reply;
+    
+    if (cache->pc_LaunchPort == NULL) {
+        return;
+    }
+    
+    while ((reply = GetMsg(cache->pc_LaunchPort)) != NULL) {
+        FreeDirectLaunch((struct DirectLaunch *)reply);
+        ObtainSemaphore(&cache->pc_Semaphore);
+        cache->pc_Launches--;
+        ReleaseSemaphore(&cache->pc_Semaphore);
+    }
+}
+
+/* Wait for the tool we started ourselves to quit, then free what it used */
+/* Normally a reaper has taken it over; this waits only if none could be started */
+VOID FinishDirectLaunch(VOID)
+{
+    if (directPending != NULL) {
+        while (GetMsg(directPort) == NULL) {
+            WaitPort(directPort);
+        }
+        FreeDirectLaunch(directPending);
+        directPending = NULL;
+    }
+    
+    if (directPort != NULL) {
+        DeleteMsgPort(directPort);
+        directPort = NULL;
+    }
+}
+
+/* Read the launch profile from the tooltypes of a def_ icon */
+/* STACK=<bytes>, PRI=<-20..20> and CLI or CLI=<argument template> */
+VOID ReadLaunchProfile(struct DiskObject *defIcon, struct LaunchProfile *profile)
+{
+    STRPTR value;
+    LONG number;
+    
+    memset(profile, 0, sizeof(struct LaunchProfile));
+    if (defIcon->do_ToolTypes == NULL) {
+        return;
+    }
+    
+    value = FindToolType(defIcon->do_ToolTypes, "STACK");
+    if (value != NULL && StrToLong(value, &number) > 0 && number > 0) {
+        profile->lp_Stack = number;
+        profile->lp_Flags |= PROFILE_STACK;
+    }
+    
+    value = FindToolType(defIcon->do_ToolTypes, "PRI");
+    if (value != NULL && StrToLong(value, &number) > 0) {
+        if (number < -20) {
+            number = -20;
+        } else if (number > 20) {
+            number = 20;
+        }
+        profile->lp_Priority = (BYTE)number;
+        profile->lp_Flags |= PROFILE_PRI;
+    }
+    
+    /* A bare CLI passes the quoted file path as the only argument */
+    value = FindToolType(defIcon->do_ToolTypes, "CLI");
+    if (value != NULL) {
+        Strncpy(profile->lp_Cli, (*value != '\0') ? value : (STRPTR)"\"%s\"", sizeof(profile->lp_Cli));
+        profile->lp_Flags |= PROFILE_CLI;
+    }
+}
+
+/* Start the tool from a shell with the profile's argument template */
+BOOL LaunchFromShell(STRPTR toolName, STRPTR fileName, BPTR fileLock, struct LaunchProfile *profile)
+{
+    struct TagItem tags[7];
+    UBYTE filePath[256];
+    UBYTE arguments[384];
+    UBYTE command[512];
+    BPTR input;
+    LONG result;
+    LONG tag = 0;
+    
+    /* The tool runs in its own current directory, so it needs the full path */
+    if (!NameFromLock(fileLock, filePath, sizeof(filePath)) ||
+        !AddPart(filePath, fileName, sizeof(filePath))) {
+        return FALSE;
+    }
+    ExpandFileTemplate(profile->lp_Cli, filePath, arguments, sizeof(arguments));
+    
+    /* NP_StackSize only sizes the shell, the shell's Stack command sizes the tool it runs */
+    if (profile->lp_Flags & PROFILE_STACK) {
+        SNPrintf(command, sizeof(command), "Stack %ld\n\"%s\" %s",
+                 (profile->lp_Stack > LAUNCH_MIN_STACK) ? profile->lp_Stack : LAUNCH_MIN_STACK,
+                 toolName, arguments);
+    } else {
+        SNPrintf(command, sizeof(command), "\"%s\" %s", toolName, arguments);
+    }
+    
+    input = Open("NIL:", MODE_OLDFILE);
+    if (input == NULL) {
+        return FALSE;
+    }
+    
+    tags[tag].ti_Tag = SYS_Input;
+    tags[tag++].ti_Data = (ULONG)input;
+    tags[tag].ti_Tag = SYS_Output;
+    tags[tag++].ti_Data = 0;
+    tags[tag].ti_Tag = SYS_Asynch;
+    tags[tag++].ti_Data = TRUE;
+    if (profile->lp_Flags & PROFILE_STACK) {
+        tags[tag].ti_Tag = NP_StackSize;
+        tags[tag++].ti_Data = (profile->lp_Stack > LAUNCH_MIN_STACK) ? profile->lp_Stack : LAUNCH_MIN_STACK;
+    }
+    if (profile->lp_Flags & PROFILE_PRI) {
+        tags[tag].ti_Tag = NP_Priority;
+        tags[tag++].ti_Data = (ULONG)(LONG)profile->lp_Priority;
+    }
+    tags[tag].ti_Tag = TAG_DONE;
+    
+    /* Asynchronous - the new process closes its input when it ends */
+    result = SystemTagList(command, tags);
+    if (result == -1) {
+        Close(input);
+        return FALSE;
+    }
+    
+    return TRUE;
+}
+
+/* Start the tool as its type's launch profile says, or directly if ProjectX/Launch says so */
+/* Returns FALSE if neither applies or the launch failed - the caller then asks Workbench */
+/* A direct launch deletes stagedPath when the tool quits; otherwise it is left to the purge */
+BOOL LaunchWithProfile(STRPTR toolName, struct LaunchProfile *profile, STRPTR fileName, BPTR fileLock,
+                       STRPTR stagedPath)
+{
+    if ((profile->lp_Flags & PROFILE_CLI) && LaunchFromShell(toolName, fileName, fileLock, profile)) {
+        return TRUE;
+    }
+    
+    /* Workbench cannot be told the stack or priority, so a profile means a direct launch */
+    if ((profile->lp_Flags & (PROFILE_STACK | PROFILE_PRI)) || UseDirectLaunch()) {
+        return DirectLaunch(toolName, fileName, fileLock, profile, stagedPath);
+    }
+    
+    return FALSE;
+}
+
+/* Expand a command template: %s is the file path, %% a literal % */
+VOID ExpandFileTemplate(STRPTR template, STRPTR filePath, STRPTR out, ULONG outSize)
+{
+    STRPTR src;
+    STRPTR dst;
+    STRPTR end;
+    STRPTR p;
+    
+    dst = out;
+    end = out + outSize - 1;
+    for (src = template; *src != '\0' && dst < end; src++) {
+        if (src[0] == '%' && src[1] == 's') {
+            for (p = filePath; *p != '\0' && dst < end; p++) {
+                *dst++ = *p;
+            }
+            src++;
+        } else if (src[0] == '%' && src[1] == '%') {
+            *dst++ = '%';
+            src++;
+        } else {
+            *dst++ = *src;
+        }
+    }
+    *dst = '\0';
+}
+
+/* Print the file size and mean LoadSeg() time of each program, and the */
+/* difference to the first one, to compare the normal and minimal builds */
+BOOL PrintLoadTimes(STRPTR *programs)
+{
+    struct FileInfoBlock *fib;
+    struct EClockVal start;
+    struct EClockVal end;
+    BPTR lock;
+    BPTR segment;
+    LONG size;
+    LONG firstSize = 0;
+    ULONG micros;
+    ULONG firstMicros = 0;
+    LONG run;
+    LONG i;
+    BOOL success = TRUE;
+    
+    if (ReadTimer(&start) == 0) {
+        PutStr("ProjectX: LOADTIME needs timer.device.\n");
+        return FALSE;
+    }
+    
+    fib = (struct FileInfoBlock *)AllocDosObject(DOS_FIB, NULL);
+    if (fib == NULL) {
+        return FALSE;
+    }
+    
+    for (i = 0; programs[i] != NULL; i++) {
+        size = -1;
+        lock = Lock(programs[i], SHARED_LOCK);
+        if (lock != NULL) {
+            if (Examine(lock, fib)) {
+                size = fib->fib_Size;
+            }
+            UnLock(lock);
+        }
+        
+        /* The first load may come from disk, later ones from the buffers - the mean shows both */
+        micros = 0;
+        for (run = 0; run < LOADTIME_RUNS && size >= 0; run++) {
+            ReadTimer(&start);
+            segment = LoadSeg(programs[i]);
+            ReadTimer(&end);
+            if (segment == NULL) {
+                size = -1;
+                break;
+            }
+            UnLoadSeg(segment);
+            micros += ElapsedMicros(&start, &end);
+        }
+        
+        if (size < 0) {
+            Printf("loadtime file=%s result=failed\n", programs[i]);
+            success = FALSE;
+            continue;
+        }
+        micros /= LOADTIME_RUNS;
+        if (i == 0) {
+            firstSize = size;
+            firstMicros = micros;
+        }
+        
+        Printf("loadtime file=%s size=%ld load_us=%lu size_delta=%ld load_delta_us=%ld\n",
+               programs[i], size, micros, size - firstSize, (LONG)micros - (LONG)firstMicros);
+    }
+    
+    FreeDosObject(DOS_FIB, fib);
+    
+    return success;
+}
+
+/* Whether and where identified types are memoed, from ProjectX/Memo */
+UBYTE GetMemoMode(VOID)
+{
+    static LONG mode = -1;
+    UBYTE value[16];
+    
+    if (mode < 0) {
+        mode = MEMO_OFF;
+        if (GetVar(MEMO_VAR, value, sizeof(value), 0) > 0) {
+            if (Stricmp(value, "COMMENT") == 0) {
+                mode = MEMO_COMMENT;
+            } else if (Stricmp(value, "SIDECAR") == 0) {
+                mode = MEMO_SIDECAR;
+            }
+        }
+    }
+    
+    return (UBYTE)mode;
+}
+
+/* The size and datestamp part of a comment memo, ";size;days.minute.tick" in hex */
+VOID FormatMemoStamp(struct FileInfoBlock *fib, STRPTR out, ULONG outSize)
+{
+    SNPrintf(out, outSize, ";%lx;%lx.%lx.%lx", fib->fib_Size, fib->fib_Date.ds_Days,
+             fib->fib_Date.ds_Minute, fib->fib_Date.ds_Tick);
+}
+
+/* Type memoed for a file by an earlier identification */
+/* Returns the type in a static buffer, or NULL if there is none or the file */
+/* has changed size or datestamp since. Reads the file's metadata, never its contents */
+STRPTR ReadTypeMemo(STRPTR fileName, BPTR fileLock)
+{
+    static UBYTE memoType[MEMO_TYPE_MAX];
+    struct FileInfoBlock *fib;
+    struct MemoRecord *records;
+    UBYTE stamp[48];
+    UBYTE path[256];
+    UBYTE *comment;
+    UBYTE *end;
+    BPTR oldDir;
+    BPTR lock;
+    LONG length;
+    LONG i;
+    BOOL found = FALSE;
+    
+    oldDir = CurrentDir(fileLock);
+    lock = Lock(fileName, SHARED_LOCK);
+    CurrentDir(oldDir);
+    if (lock == NULL) {
+        return NULL;
+    }
+    
+    fib = AllocDosObject(DOS_FIB, NULL);
+    if (fib == NULL || !Examine(lock, fib) || fib->fib_DirEntryType >= 0) {
+        if (fib != NULL) {
+            FreeDosObject(DOS_FIB, fib);
+        }
+        UnLock(lock);
+        return NULL;
+    }
+    
+    comment = fib->fib_Comment;
+    length = strlen(MEMO_PREFIX);
+    if (GetMemoMode() == MEMO_COMMENT && Strnicmp(comment, MEMO_PREFIX, length) == 0) {
+        /* Ours - "PX:type;size;date", valid while the stamp still matches the file */
+        comment += length;
+        for (end = comment; *end != '\0' && *end != ';'; end++) {
+        }
+        FormatMemoStamp(fib, stamp, sizeof(stamp));
+        if (end > comment && end - comment < MEMO_TYPE_MAX && strcmp((char *)end, (char *)stamp) == 0) {
+            memcpy(memoType, comment, end - comment);
+            memoType[end - comment] = '\0';
+            found = TRUE;
+        }
+    } else if ((GetMemoMode() == MEMO_SIDECAR || *comment != '\0') &&
+               NameFromLock(lock, path, sizeof(path))) {
+        /* The comment belongs to someone else - look in the sidecar */
+        records = AllocVec(sizeof(struct MemoRecord) * MEMO_MAX, MEMF_CLEAR);
+        if (records != NULL) {
+            LoadMemos(records);
+            for (i = 0; i < MEMO_MAX; i++) {
+                if (records[i].mm_Path[0] != '\0' && Stricmp(records[i].mm_Path, path) == 0) {
+                    if (records[i].mm_Size == fib->fib_Size &&
+                        CompareDates(&records[i].mm_Date, &fib->fib_Date) == 0) {
+                        Strncpy(memoType, records[i].mm_Type, sizeof(memoType));
+                        found = TRUE;
+                    }
+                    break;
+                }
+            }
+            FreeVec(records);
+        }
+    }
+    
+    FreeDosObject(DOS_FIB, fib);
+    UnLock(lock);
+    
+    return found ? (STRPTR)memoType : NULL;
+}
+
+/* Memo the type just identified for a file */
+/* Goes into the file comment when it is empty or already ours, otherwise into the */
+/* sidecar. Files on write-protected volumes get no comment memo */
+VOID WriteTypeMemo(STRPTR fileName, BPTR fileLock, STRPTR typeIdentifier)
+{
+    struct FileInfoBlock *fib;
+    struct MemoRecord *records;
+    struct MemoRecord *record;
+    UBYTE comment[80];
+    UBYTE stamp[48];
+    UBYTE path[256];
+    BPTR oldDir;
+    BPTR lock;
+    BPTR dirLock;
+    BPTR memoLock;
+    LONG slot;
+    LONG i;
+    
+    if (strlen((char *)typeIdentifier) >= MEMO_TYPE_MAX) {
+        return;
+    }
+    
+    oldDir = CurrentDir(fileLock);
+    lock = Lock(fileName, SHARED_LOCK);
+    CurrentDir(oldDir);
+    if (lock == NULL) {
+        return;
+    }
+    
+    fib = AllocDosObject(DOS_FIB, NULL);
+    if (fib == NULL || !Examine(lock, fib) || fib->fib_DirEntryType >= 0) {
+        if (fib != NULL) {
+            FreeDosObject(DOS_FIB, fib);
+        }
+        UnLock(lock);
+        return;
+    }
+    
+    if (GetMemoMode() == MEMO_COMMENT &&
+        (fib->fib_Comment[0] == '\0' ||
+         Strnicmp(fib->fib_Comment, MEMO_PREFIX, strlen(MEMO_PREFIX)) == 0)) {
+        FormatMemoStamp(fib, stamp, sizeof(stamp));
+        SNPrintf(comment, sizeof(comment), "%s%s%s", MEMO_PREFIX, typeIdentifier, stamp);
+        oldDir = CurrentDir(fileLock);
+        SetComment(fileName, comment);
+        CurrentDir(oldDir);
+    } else if (NameFromLock(lock, path, sizeof(path))) {
+        dirLock = Lock("ENV:ProjectX", SHARED_LOCK);
+        if (dirLock == NULL) {
+            dirLock = CreateDir("ENV:ProjectX");
+        }
+        if (dirLock != NULL) {
+            UnLock(dirLock);
+        }
+        
+        /* Another ProjectX memoing at the same time would lose one of the two memos */
+        memoLock = OpenLockFile(MEMO_LOCK);
+        records = NULL;
+        if (memoLock != NULL) {
+            records = AllocVec(sizeof(struct MemoRecord) * MEMO_MAX, MEMF_CLEAR);
+        }
+        if (records != NULL) {
+            LoadMemos(records);
+            
+            /* The file's own slot, else a free one, else the oldest memo */
+            slot = -1;
+            for (i = 0; i < MEMO_MAX && slot < 0; i++) {
+                if (records[i].mm_Path[0] != '\0' && Stricmp(records[i].mm_Path, path) == 0) {
+                    slot = i;
+                }
+            }
+            for (i = 0; i < MEMO_MAX && slot < 0; i++) {
+                if (records[i].mm_Path[0] == '\0') {
+                    slot = i;
+                }
+            }
+            if (slot < 0) {
+                slot = 0;
+                for (i = 1; i < MEMO_MAX; i++) {
+                    if (CompareDates(&records[i].mm_Written, &records[slot].mm_Written) > 0) {
+                        slot = i;
+                    }
+                }
+            }
+            
+            /* Rewrite the sidecar only when the memo is new or has changed */
+            record = &records[slot];
+            if (Stricmp(record->mm_Path, path) != 0 || Stricmp(record->mm_Type, typeIdentifier) != 0 ||
+                record->mm_Size != fib->fib_Size || CompareDates(&record->mm_Date, &fib->fib_Date) != 0) {
+                Strncpy(record->mm_Path, path, sizeof(record->mm_Path));
+                Strncpy(record->mm_Type, typeIdentifier, sizeof(record->mm_Type));
+                record->mm_Date = fib->fib_Date;
+                record->mm_Size = fib->fib_Size;
+                DateStamp(&record->mm_Written);
+                SaveMemos(records);
+            }
+            FreeVec(records);
+        }
+        if (memoLock != NULL) {
+            Close(memoLock);
+        }
+    }
+    
+    FreeDosObject(DOS_FIB, fib);
+    UnLock(lock);
+}
+
+/* Read the memo sidecar, the archived copy after a reboot, or start an empty one */
+VOID LoadMemos(struct MemoRecord *records)
+{
+    struct MemoHeader header;
+    BPTR file;
+    
+    memset(records, 0, sizeof(struct MemoRecord) * MEMO_MAX);
+    
+    file = Open(MEMO_FILE, MODE_OLDFILE);
+    if (file == NULL) {
+        file = Open(MEMO_ARCHIVE, MODE_OLDFILE);
+    }
+    if (file == NULL) {
+        return;
+    }
+    if (Read(file, &header, sizeof(header)) != sizeof(header) ||
+        header.mmh_Magic != MEMO_MAGIC || header.mmh_Version != MEMO_VERSION ||
+        header.mmh_Count != MEMO_MAX ||
+        Read(file, records, sizeof(struct MemoRecord) * MEMO_MAX) !=
+            (LONG)(sizeof(struct MemoRecord) * MEMO_MAX)) {
+        memset(records, 0, sizeof(struct MemoRecord) * MEMO_MAX);
+    }
+    Close(file);
+}
+
+/* Write the memo sidecar through a temporary file, holding MEMO_LOCK */
+VOID SaveMemos(struct MemoRecord *records)
+{
+    struct MemoHeader header;
+    BPTR file;
+    BOOL success = FALSE;
+    
+    file = Open(MEMO_TEMP, MODE_NEWFILE);
+    if (file == NULL) {
+        return;
+    }
+    
+    header.mmh_Magic = MEMO_MAGIC;
+    header.mmh_Version = MEMO_VERSION;
+    header.mmh_Count = MEMO_MAX;
+    if (Write(file, &header, sizeof(header)) == sizeof(header) &&
+        Write(file, records, sizeof(struct MemoRecord) * MEMO_MAX) ==
+            (LONG)(sizeof(struct MemoRecord) * MEMO_MAX)) {
+        success = TRUE;
+    }
+    Close(file);
+    
+    if (success) {
+        DeleteFile(MEMO_FILE);
+        Rename(MEMO_TEMP, MEMO_FILE);
+    } else {
+        DeleteFile(MEMO_TEMP);
+    }
+}
+
+/* Identify every file of a multi-file open in one batch, before the first is launched */
+/* Files with a memo or a prefetched answer, and files on volumes whose policy avoids */
+/* reading them, are left to GetFileTypeIdentifier() as before */
+VOID PrepareIdentifyBatch(struct WBStartup *wbs)
+{
+    struct IdentifyBatchEntry *entry;
+    struct IdentifyEngine *engine;
+    struct VolumeRecord *volume;
+    struct WBArg *wbarg;
+    STRPTR prefetchedType;
+    STRPTR prefetchedTool;
+    STRPTR overrideTool;
+    LONG i;
+    
+    if (wbs->sm_NumArgs <= 2) {
+        return;
+    }
+    
+    identifyBatch = AllocVec((wbs->sm_NumArgs - 1) * sizeof(struct IdentifyBatchEntry), MEMF_CLEAR);
+    if (identifyBatch == NULL) {
+        return;
+    }
+    
+    for (i = 1, wbarg = &wbs->sm_ArgList[i]; i < wbs->sm_NumArgs; i++, wbarg++) {
+        if (wbarg->wa_Lock == NULL || wbarg->wa_Name == NULL || *wbarg->wa_Name == '\0' ||
+            GetVolumePolicy(FindVolume(wbarg->wa_Lock)) != POLICY_SNIFF) {
+            continue;
+        }
+        if (GetMemoMode() != MEMO_OFF && ReadTypeMemo(wbarg->wa_Name, wbarg->wa_Lock) != NULL) {
+            continue;
+        }
+        if (LookupPrefetched(wbarg->wa_Name, wbarg->wa_Lock, &prefetchedType, &prefetchedTool, NULL)) {
+            if (prefetchedTool != NULL) {
+                FreeVec(prefetchedTool);
+            }
+            continue;
+        }
+        
+        /* Files a drawer or global name rule gives a tool are never identified */
+        overrideTool = FindOverrideTool(wbarg->wa_Name, wbarg->wa_Lock, NULL);
+        if (overrideTool != NULL) {
+            FreeVec(overrideTool);
+            continue;
+        }
+        
+        entry = &identifyBatch[identifyBatchCount++];
+        entry->be_Name = wbarg->wa_Name;
+        entry->be_Lock = wbarg->wa_Lock;
+    }
+    
+    /* A single file gains nothing from a batch */
+    if (identifyBatchCount < 2) {
+        FreeIdentifyBatch();
+        return;
+    }
+    
+    for (engine = identifyEngines; engine->ie_Name != NULL; engine++) {
+        IdentifyBatch(engine, identifyBatch, identifyBatchCount);
+    }
+    
+    /* Each answer is timed for its volume, as a single identification would be */
+    for (i = 0; i < identifyBatchCount; i++) {
+        volume = FindVolume(identifyBatch[i].be_Lock);
+        if (volume != NULL) {
+            RecordVolumeLatency(volume, identifyBatch[i].be_Micros);
+        }
+    }
+}
+
+/* The batch entry for a file, NULL if it was not part of the batch */
+struct IdentifyBatchEntry *FindBatchEntry(STRPTR fileName, BPTR fileLock)
+{
+    LONG i;
+    
+    for (i = 0; i < identifyBatchCount; i++) {
+        if (identifyBatch[i].be_Lock == fileLock &&
+            strcmp((char *)identifyBatch[i].be_Name, (char *)fileName) == 0) {
+            return &identifyBatch[i];
+        }
+    }
+    
+    return NULL;
+}
+
+/* Free the batch of a multi-file open */
+VOID FreeIdentifyBatch(VOID)
+{
+    if (identifyBatch != NULL) {
+        FreeVec(identifyBatch);
+        identifyBatch = NULL;
+    }
+    identifyBatchCount = 0;
+}
+
+/* Open a lock file for exclusive use, waiting up to a second for another ProjectX */
+/* MODE_NEWFILE holds an exclusive lock until Close(), which releases it again */
+/* Returns NULL if it stayed in use */
+BPTR OpenLockFile(STRPTR lockPath)
+{
+    BPTR file;
+    LONG tries;
+    
+    for (tries = 0; tries < LOCK_FILE_TRIES; tries++) {
+        file = Open(lockPath, MODE_NEWFILE);
+        if (file != NULL || IoErr() != ERROR_OBJECT_IN_USE) {
+            return file;
+        }
+        Delay(2);
+    }
+    
+    return NULL;
+}
+
+/* Take over our own seglist, so the shell or Workbench does not unload it when we end */
+/* Returns NULL, leaving it where it is, for a resident command, whose code is shared */
+BPTR TakeOwnSegList(VOID)
+{
+    struct Process *me = (struct Process *)FindTask(NULL);
+    struct CommandLineInterface *cli;
+    struct Segment *segment;
+    UBYTE name[108];
+    BPTR segList = NULL;
+    LONG system;
+    
+    if (startupMessage != NULL) {
+        /* Workbench unloads sm_Segment once it has the reply */
+        segList = startupMessage->sm_Segment;
+        startupMessage->sm_Segment = NULL;
+        return segList;
+    }
+    
+    cli = (struct CommandLineInterface *)BADDR(me->pr_CLI);
+    if (cli == NULL || cli->cli_Module == NULL || !GetProgramName(name, sizeof(name))) {
+        return NULL;
+    }
+    
+    Forbid();
+    for (system = 0; system <= 1; system++) {
+        segment = FindSegment(FilePart(name), NULL, system);
+        if (segment != NULL && segment->seg_Seg == cli->cli_Module) {
+            Permit();
+            return NULL;
+        }
+    }
+    
+    /* The shell unloads cli_Module after the command, unless it has been cleared */
+    segList = cli->cli_Module;
+    cli->cli_Module = NULL;
+    Permit();
+    
+    return segList;
+}
+
+/* Hand the replies still due to a reaper process, so Cleanup() need not wait */
+/* Returns TRUE if there was nothing to wait for or the reaper took it over */
+BOOL StartReaper(VOID)
+{
+    struct Reaper *reaper;
+    struct Process *process;
+    
+    if (identifyStalled > 0) {
+        CollectStalledJobs();
+        StopIdentifyWorker();
+    }
+    if (identifyStalled == 0 && directPending == NULL && CollectRoute()) {
+        return TRUE;
+    }
+    
+    reaper = AllocVec(sizeof(struct Reaper), MEMF_PUBLIC | MEMF_CLEAR);
+    if (reaper == NULL) {
+        return FALSE;
+    }
+    reaper->rp_SegList = TakeOwnSegList();
+    if (reaper->rp_SegList == NULL) {
+        FreeVec(reaper);
+        return FALSE;
+    }
+    
+    process = CreateNewProcTags(NP_Entry, (ULONG)RunReaper,
+                                NP_Name, (ULONG)"ProjectX reaper",
+                                NP_StackSize, REAPER_STACK,
+                                TAG_DONE);
+    if (process == NULL) {
+        /* Give the seglist back to whoever would have unloaded it */
+        if (startupMessage != NULL) {
+            startupMessage->sm_Segment = reaper->rp_SegList;
+        } else {
+            Cli()->cli_Module = reaper->rp_SegList;
+        }
+        FreeVec(reaper);
+        return FALSE;
+    }
+    MEMTRACK_PROCESS(REAPER_STACK);
+    
+    if (identifyStalled > 0) {
+        reaper->rp_IdentifyPort = identifyPort;
+        reaper->rp_Stalled = identifyStalled;
+        identifyPort = NULL;
+        identifyStalled = 0;
+    }
+    if (directPending != NULL) {
+        reaper->rp_LaunchPort = directPort;
+        reaper->rp_Launch = directPending;
+        directPort = NULL;
+        directPending = NULL;
+    }
+    if (routePending != NULL) {
+        reaper->rp_RoutePort = routePort;
+        reaper->rp_Route = routePending;
+        reaper->rp_RouteMethod = routeMethod;
+        routePort = NULL;
+        routePending = NULL;
+        /* An ARexx message needs rexxsyslib to be freed - the reaper closes it */
+        if (routeMethod == ROUTE_AREXX) {
+            reaper->rp_RexxBase = RexxSysBase;
+            RexxSysBase = NULL;
+        }
+    }
+    PutMsg(&process->pr_MsgPort, &reaper->rp_Message);
+    
+    return TRUE;
+}
+
+/* Reaper process entry - takes the ports over, waits for every reply due, */
+/* then unloads the seglist it runs in */
+VOID __saveds RunReaper(VOID)
+{
+    struct Process *me = (struct Process *)FindTask(NULL);
+    struct Reaper *reaper;
+    struct Message *reply;
+    struct Library *dos;
+    BPTR segList;
+    BYTE identifySignal = -1;
+    BYTE launchSignal = -1;
+    BYTE routeSignal = -1;
+    
+    WaitPort(&me->pr_MsgPort);
+    reaper = (struct Reaper *)GetMsg(&me->pr_MsgPort);
+    segList = reaper->rp_SegList;
+    
+    /* ProjectX may have closed dos.library by the time we need it */
+    dos = OpenLibrary("dos.library", 36);
+    
+    /* The ports signal ProjectX's task - point them at ours */
+    if (reaper->rp_IdentifyPort != NULL) {
+        identifySignal = AllocSignal(-1);
+        Forbid();
+        reaper->rp_IdentifyPort->mp_SigTask = (struct Task *)me;
+        reaper->rp_IdentifyPort->mp_SigBit = identifySignal;
+        Permit();
+    }
+    if (reaper->rp_LaunchPort != NULL) {
+        launchSignal = AllocSignal(-1);
+        Forbid();
+        reaper->rp_LaunchPort->mp_SigTask = (struct Task *)me;
+        reaper->rp_LaunchPort->mp_SigBit = launchSignal;
+        Permit();
+    }
+    if (reaper->rp_RoutePort != NULL) {
+        routeSignal = AllocSignal(-1);
+        Forbid();
+        reaper->rp_RoutePort->mp_SigTask = (struct Task *)me;
+        reaper->rp_RoutePort->mp_SigBit = routeSignal;
+        Permit();
+    }
+    
+    while (reaper->rp_Stalled > 0 || reaper->rp_Launch != NULL || reaper->rp_Route != NULL) {
+        /* A stalled worker is told to quit once it has caught up, and waited for again */
+        while (reaper->rp_Stalled > 0 && (reply = GetMsg(reaper->rp_IdentifyPort)) != NULL) {
+            if (RetireIdentifyJob((struct IdentifyJob *)reply)) {
+                reaper->rp_Stalled--;
+            }
+        }
+        if (reaper->rp_Launch != NULL && GetMsg(reaper->rp_LaunchPort) != NULL) {
+            FreeDirectLaunch(reaper->rp_Launch);
+            reaper->rp_Launch = NULL;
+        }
+        if (reaper->rp_Route != NULL && GetMsg(reaper->rp_RoutePort) != NULL) {
+            FreeReaperRoute(reaper);
+        }
+        if (reaper->rp_Stalled > 0 || reaper->rp_Launch != NULL || reaper->rp_Route != NULL) {
+            Wait((identifySignal >= 0 ? 1UL << identifySignal : 0) |
+                 (launchSignal >= 0 ? 1UL << launchSignal : 0) |
+                 (routeSignal >= 0 ? 1UL << routeSignal : 0));
+        }
+    }
+    
+    /* DeleteMsgPort() frees the port's signal, which is ours now */
+    if (reaper->rp_IdentifyPort != NULL) {
+        DeleteMsgPort(reaper->rp_IdentifyPort);
+    }
+    if (reaper->rp_LaunchPort != NULL) {
+        DeleteMsgPort(reaper->rp_LaunchPort);
+    }
+    if (reaper->rp_RoutePort != NULL) {
+        DeleteMsgPort(reaper->rp_RoutePort);
+    }
+    FreeVec(reaper);
+    if (dos != NULL) {
+        CloseLibrary(dos);
+    }
+    
+    /* Our code goes with the seglist, so stay in Forbid() until we are gone */
+    Forbid();
+    if (segList != NULL) {
+        UnLoadSeg(segList);
+    }
+}
+
+/* Free the reaper's routed message once its reply is in */
+/* ProjectX has let go of rexxsyslib by then, so the reaper's own base is used */
+VOID FreeReaperRoute(struct Reaper *reaper)
+{
+    struct RxsLib *RexxSysBase = reaper->rp_RexxBase;
+    struct RexxMsg *rexxMsg;
+    
+    if (reaper->rp_RouteMethod == ROUTE_AREXX) {
+        rexxMsg = (struct RexxMsg *)reaper->rp_Route;
+        if (rexxMsg->rm_Args[0] != NULL) {
+            DeleteArgstring(rexxMsg->rm_Args[0]);
+        }
+        DeleteRexxMsg(rexxMsg);
+    } else {
+        FreeRouteMessage(reaper->rp_Route, reaper->rp_RouteMethod);
+    }
+    reaper->rp_Route = NULL;
+    
+    if (RexxSysBase != NULL) {
+        CloseLibrary((struct Library *)RexxSysBase);
+        reaper->rp_RexxBase = NULL;
+    }
+}
+
+/* Memory hooks for the platform-neutral core */
+APTR CoreAlloc(ULONG size)
+{
+    return AllocVec(size, MEMF_PUBLIC | MEMF_CLEAR);
+}
+
+VOID CoreFree(APTR memory)
+{
+    FreeVec(memory);
+}
@@ -0,0 +1,589 @@
+/*
+ * pxcore.c - platform-neutral ProjectX logic
+ *
+ * Copyright (c) 2025 amigazen project
+ * Licensed under BSD 2-Clause License
+ */
+
+#include <exec/types.h>
+#include <string.h>
+
+#include "pxcore.h"
+
+/* A longword, and an integer wide enough for a pointer - a ULONG is 64 bits on LP64 hosts */
+#if defined(__SASC) || defined(AMIGA)
+typedef ULONG CoreLong;
+typedef ULONG CoreAddress;
+#else
+#include <stdint.h>
+typedef uint32_t CoreLong;
+typedef uintptr_t CoreAddress;
+#endif
+
+/* Name-only guesses, used when identification misses its deadline */
+struct NameGuess {
+    STRPTR ng_Suffix;
+    STRPTR ng_Type;
+    ULONG ng_Hits;                          /* Names guessed with this suffix */
+};
+
+static struct NameGuess nameGuesses[] = {
+    { (STRPTR)".txt", (STRPTR)"ascii", 0 }, { (STRPTR)".doc", (STRPTR)"ascii", 0 }, { (STRPTR)".readme", (STRPTR)"ascii", 0 },
+    { (STRPTR)".guide", (STRPTR)"amigaguide", 0 },
+    { (STRPTR)".iff", (STRPTR)"ilbm", 0 },  { (STRPTR)".ilbm", (STRPTR)"ilbm", 0 }, { (STRPTR)".pic", (STRPTR)"ilbm", 0 },
+    { (STRPTR)".jpg", (STRPTR)"jpeg", 0 },  { (STRPTR)".jpeg", (STRPTR)"jpeg", 0 }, { (STRPTR)".png", (STRPTR)"png", 0 },
+    { (STRPTR)".gif", (STRPTR)"gif", 0 },   { (STRPTR)".8svx", (STRPTR)"8svx", 0 }, { (STRPTR)".mod", (STRPTR)"mod", 0 },
+    { (STRPTR)".lha", (STRPTR)"lha", 0 },   { (STRPTR)".lzh", (STRPTR)"lha", 0 },   { (STRPTR)".lzx", (STRPTR)"lzx", 0 },
+    { (STRPTR)".zip", (STRPTR)"zip", 0 },   { (STRPTR)".pdf", (STRPTR)"pdf", 0 },   { (STRPTR)".html", (STRPTR)"html", 0 },
+    { (STRPTR)".htm", (STRPTR)"html", 0 },  { (STRPTR)".rexx", (STRPTR)"rexx", 0 }, { (STRPTR)".c", (STRPTR)"c", 0 },
+    { (STRPTR)".h", (STRPTR)"h", 0 },
+    { NULL, NULL, 0 }
+};
+
+#define NAME_GUESS_COUNT ((LONG)(sizeof(nameGuesses) / sizeof(nameGuesses[0])) - 1)
+
+/* Order the suffixes are tried in, most guessed first when adapting */
+static struct NameGuess *guessOrder[NAME_GUESS_COUNT];
+static BOOL guessOrderSet = FALSE;
+static BOOL guessAdaptive = TRUE;
+static ULONG guessesSinceReorder = 0;
+
+/* Cost of the guesses since the last CoreResetGuesses() */
+static ULONG guessCalls = 0;
+static ULONG guessRules = 0;
+
+/* Text classification state, carried from byte to byte */
+struct TextScan {
+    UBYTE ts_Pending;                       /* UTF-8 continuation bytes still expected */
+    BOOL ts_HighBit;                        /* Some byte above 0x7F */
+    BOOL ts_NotUtf8;                        /* Some 8-bit sequence is not valid UTF-8 */
+    BOOL ts_LastCR;                         /* The previous byte was a CR */
+    ULONG ts_CRLF;                          /* Lines ending in CR LF */
+    ULONG ts_Bare;                          /* Lines ending in a lone LF or CR */
+};
+
+/* Type identifiers of the text classes, CRLF variants second */
+static STRPTR textTypes[][2] = {
+    { NULL, NULL },
+    { (STRPTR)"ascii", (STRPTR)"ascii-crlf" },
+    { (STRPTR)"latin1", (STRPTR)"latin1-crlf" },
+    { (STRPTR)"utf8", (STRPTR)"utf8-crlf" }
+};
+
+/* Longword masks - bit 7 of every byte, and every byte 0x20 */
+#define TEXT_HIGH_BITS 0x80808080UL
+#define TEXT_SPACES    0x20202020UL
+
+/* AmigaDOS pattern characters other than the ones a suffix rule may use */
+static UBYTE wildChars[] = "#?()|~[]%'*";
+
+/* Lower case of an ASCII or Latin-1 character */
+UBYTE CoreLower(UBYTE c)
+{
+    if ((c >= 'A' && c <= 'Z') || (c >= 0xC0 && c <= 0xDE && c != 0xD7)) {
+        return (UBYTE)(c + 0x20);
+    }
+    return c;
+}
+
+/* Compare two strings ignoring case, like utility.library Stricmp() */
+LONG CoreStricmp(STRPTR a, STRPTR b)
+{
+    UBYTE ca;
+    UBYTE cb;
+
+    do {
+        ca = CoreLower(*a++);
+        cb = CoreLower(*b++);
+    } while (ca == cb && ca != '\0');
+
+    return (LONG)ca - (LONG)cb;
+}
+
+/* Add a name pattern to the suffix trie if it is a plain suffix */
+/* Accepts #?suffix and #?prefix(alt|alt|...) with no other wildcards; */
+/* returns FALSE, leaving the trie untouched, for any other pattern */
+BOOL CoreAddSuffix(struct CoreSuffix **root, STRPTR pattern, APTR payload, UWORD order)
+{
+    UBYTE *key = pattern;
+    UBYTE *open;
+    UBYTE *alt;
+    UBYTE *altEnd;
+    UBYTE *c;
+    UBYTE *w;
+    UBYTE suffix[64];
+    struct CoreSuffix **link;
+    struct CoreSuffix *node;
+    LONG prefixLen;
+    LONG len;
+    LONG i;
+
+    if (key[0] != '#' || key[1] != '?' || key[2] == '\0') {
+        return FALSE;
+    }
+    key += 2;
+
+    /* Only one trailing group of alternatives is allowed */
+    open = NULL;
+    for (c = key; *c != '\0'; c++) {
+        if (*c == '(' && open == NULL) {
+            open = c;
+        } else if (*c == ')' && open != NULL && c[1] == '\0') {
+            break;
+        } else if (*c == '|' && open != NULL) {
+            continue;
+        } else {
+            for (w = wildChars; *w != '\0' && *w != *c; w++) {
+            }
+            if (*w != '\0') {
+                return FALSE;
+            }
+        }
+    }
+    if (open != NULL && *c != ')') {
+        return FALSE;
+    }
+
+    prefixLen = (open != NULL) ? (LONG)(open - key) : (LONG)strlen((char *)key);
+
+    /* Check every alternative before inserting any of them */
+    alt = (open != NULL) ? open + 1 : key + prefixLen;
+    do {
+        for (altEnd = alt; *altEnd != '\0' && *altEnd != '|' && *altEnd != ')'; altEnd++) {
+        }
+        len = prefixLen + (LONG)(altEnd - alt);
+        if (len == 0 || len >= (LONG)sizeof(suffix)) {
+            return FALSE;
+        }
+        alt = altEnd + 1;
+    } while (*altEnd == '|');
+
+    /* Insert prefix + each alternative, reversed and in lower case */
+    alt = (open != NULL) ? open + 1 : key + prefixLen;
+    do {
+        for (altEnd = alt; *altEnd != '\0' && *altEnd != '|' && *altEnd != ')'; altEnd++) {
+        }
+        len = prefixLen + (LONG)(altEnd - alt);
+        memcpy(suffix, key, prefixLen);
+        memcpy(suffix + prefixLen, alt, altEnd - alt);
+
+        link = root;
+        node = NULL;
+        for (i = len - 1; i >= 0; i--) {
+            for (node = *link; node != NULL; node = node->cs_Sibling) {
+                if (node->cs_Char == CoreLower(suffix[i])) {
+                    break;
+                }
+            }
+            if (node == NULL) {
+                node = CoreAlloc(sizeof(struct CoreSuffix));
+                if (node == NULL) {
+                    return FALSE;
+                }
+                node->cs_Char = CoreLower(suffix[i]);
+                node->cs_Sibling = *link;
+                *link = node;
+            }
+            link = &node->cs_Child;
+        }
+
+        /* The lower order keeps the suffix */
+        if (node->cs_Payload == NULL || order < node->cs_Order) {
+            node->cs_Payload = payload;
+            node->cs_Order = order;
+        }
+
+        alt = altEnd + 1;
+    } while (*altEnd == '|');
+
+    return TRUE;
+}
+
+/* One backwards walk of the name through the trie */
+/* Returns the payload of the lowest order suffix matching the name, or NULL */
+APTR CoreMatchSuffix(struct CoreSuffix *root, STRPTR name, UWORD *order)
+{
+    struct CoreSuffix *nodes = root;
+    struct CoreSuffix *node;
+    struct CoreSuffix *best = NULL;
+    LONG i;
+
+    for (i = (LONG)strlen((char *)name) - 1; i >= 0 && nodes != NULL; i--) {
+        for (node = nodes; node != NULL; node = node->cs_Sibling) {
+            if (node->cs_Char == CoreLower(name[i])) {
+                break;
+            }
+        }
+        if (node == NULL) {
+            break;
+        }
+        if (node->cs_Payload != NULL && (best == NULL || node->cs_Order < best->cs_Order)) {
+            best = node;
+        }
+        nodes = node->cs_Child;
+    }
+
+    if (best == NULL) {
+        return NULL;
+    }
+    if (order != NULL) {
+        *order = best->cs_Order;
+    }
+    return best->cs_Payload;
+}
+
+/* Free a suffix trie */
+VOID CoreFreeSuffixes(struct CoreSuffix *root)
+{
+    struct CoreSuffix *node;
+    struct CoreSuffix *nextNode;
+
+    for (node = root; node != NULL; node = nextNode) {
+        nextNode = node->cs_Sibling;
+        CoreFreeSuffixes(node->cs_Child);
+        CoreFree(node);
+    }
+}
+
+/* Guess a type from the file name alone, NULL if the suffix is not known */
+/* Counts a hit for the suffix found, and reorders by hits every CORE_REORDER_INTERVAL guesses */
+STRPTR CoreGuessType(STRPTR fileName)
+{
+    struct NameGuess *guess;
+    LONG nameLen = strlen((char *)fileName);
+    LONG suffixLen;
+    LONG i;
+
+    if (!guessOrderSet) {
+        CoreResetGuesses(guessAdaptive);
+    }
+
+    guessCalls++;
+    for (i = 0; i < NAME_GUESS_COUNT; i++) {
+        guess = guessOrder[i];
+        guessRules++;
+        suffixLen = strlen((char *)guess->ng_Suffix);
+        if (nameLen > suffixLen &&
+            CoreStricmp(fileName + nameLen - suffixLen, guess->ng_Suffix) == 0) {
+            guess->ng_Hits++;
+            if (guessAdaptive && ++guessesSinceReorder >= CORE_REORDER_INTERVAL) {
+                CoreReorderGuesses();
+            }
+            return guess->ng_Type;
+        }
+    }
+
+    return NULL;
+}
+
+/* Whether suffix a ends with suffix b, or b with a - then one name can match both */
+static BOOL GuessesOverlap(struct NameGuess *a, struct NameGuess *b)
+{
+    LONG lenA = strlen((char *)a->ng_Suffix);
+    LONG lenB = strlen((char *)b->ng_Suffix);
+
+    if (lenA >= lenB) {
+        return (BOOL)(CoreStricmp(a->ng_Suffix + lenA - lenB, b->ng_Suffix) == 0);
+    }
+    return (BOOL)(CoreStricmp(b->ng_Suffix + lenB - lenA, a->ng_Suffix) == 0);
+}
+
+/* Move the most guessed suffixes to the front */
+/* Two suffixes that one name could both match never change places, so the first */
+/* match - and with it the type guessed - is the same as in the table order */
+VOID CoreReorderGuesses(VOID)
+{
+    struct NameGuess *guess;
+    LONG i;
+    LONG j;
+
+    if (!guessOrderSet) {
+        CoreResetGuesses(guessAdaptive);
+    }
+
+    for (i = 1; i < NAME_GUESS_COUNT; i++) {
+        guess = guessOrder[i];
+        for (j = i; j > 0 && guessOrder[j - 1]->ng_Hits < guess->ng_Hits &&
+                    !GuessesOverlap(guessOrder[j - 1], guess); j--) {
+            guessOrder[j] = guessOrder[j - 1];
+        }
+        guessOrder[j] = guess;
+    }
+
+    guessesSinceReorder = 0;
+}
+
+/* Add hits learned elsewhere, such as earlier runs, to every suffix of a type */
+VOID CoreAddGuessHits(STRPTR type, ULONG hits)
+{
+    struct NameGuess *guess;
+
+    /* Set the order up now, or the first reorder would reset the hits away */
+    if (!guessOrderSet) {
+        CoreResetGuesses(guessAdaptive);
+    }
+
+    for (guess = nameGuesses; guess->ng_Suffix != NULL; guess++) {
+        if (CoreStricmp(guess->ng_Type, type) == 0) {
+            guess->ng_Hits += hits;
+        }
+    }
+}
+
+/* Back to the table order with no hits counted, adapting from here on or not */
+VOID CoreResetGuesses(BOOL adaptive)
+{
+    LONG i;
+
+    for (i = 0; i < NAME_GUESS_COUNT; i++) {
+        guessOrder[i] = &nameGuesses[i];
+        nameGuesses[i].ng_Hits = 0;
+    }
+    guessOrderSet = TRUE;
+    guessAdaptive = adaptive;
+    guessesSinceReorder = 0;
+    guessCalls = 0;
+    guessRules = 0;
+}
+
+/* Guesses made and suffixes compared since the last reset */
+VOID CoreGuessCost(ULONG *calls, ULONG *rules)
+{
+    *calls = guessCalls;
+    *rules = guessRules;
+}
+
+/* Take one byte of a text header, FALSE if it makes the header binary */
+static BOOL ScanTextByte(struct TextScan *scan, UBYTE c)
+{
+    if (scan->ts_LastCR) {
+        scan->ts_LastCR = FALSE;
+        if (c == '\n') {
+            scan->ts_CRLF++;
+            return TRUE;
+        }
+        scan->ts_Bare++;
+    }
+
+    if (c < 0x20) {
+        /* Only layout characters and ESC, for ANSI sequences, are text */
+        if (c == '\r') {
+            scan->ts_LastCR = TRUE;
+        } else if (c == '\n') {
+            scan->ts_Bare++;
+        } else if (c != '\t' && c != '\f' && c != 0x1B) {
+            return FALSE;
+        }
+    }
+
+    /* UTF-8 - a lead byte announces its continuation bytes, 10xxxxxx each */
+    if (c & 0x80) {
+        scan->ts_HighBit = TRUE;
+        if ((c & 0xC0) == 0x80) {
+            if (scan->ts_Pending == 0) {
+                scan->ts_NotUtf8 = TRUE;
+            } else {
+                scan->ts_Pending--;
+            }
+            return TRUE;
+        }
+        if (c >= 0xC2 && c <= 0xDF) {
+            scan->ts_NotUtf8 |= (scan->ts_Pending != 0);
+            scan->ts_Pending = 1;
+        } else if (c >= 0xE0 && c <= 0xEF) {
+            scan->ts_NotUtf8 |= (scan->ts_Pending != 0);
+            scan->ts_Pending = 2;
+        } else if (c >= 0xF0 && c <= 0xF4) {
+            scan->ts_NotUtf8 |= (scan->ts_Pending != 0);
+            scan->ts_Pending = 3;
+        } else {
+            scan->ts_NotUtf8 = TRUE;
+            scan->ts_Pending = 0;
+        }
+    } else if (scan->ts_Pending != 0) {
+        scan->ts_NotUtf8 = TRUE;
+        scan->ts_Pending = 0;
+    }
+
+    return TRUE;
+}
+
+/* Text class of a finished scan */
+static UBYTE TextScanResult(struct TextScan *scan, ULONG length)
+{
+    UBYTE text;
+
+    if (length == 0) {
+        return CORE_TEXT_BINARY;
+    }
+
+    if (!scan->ts_HighBit) {
+        text = CORE_TEXT_ASCII;
+    } else if (scan->ts_NotUtf8) {
+        text = CORE_TEXT_LATIN1;
+    } else {
+        text = CORE_TEXT_UTF8;
+    }
+    if (scan->ts_CRLF > 0 && scan->ts_Bare == 0) {
+        text |= CORE_TEXT_CRLF;
+    }
+
+    return text;
+}
+
+/* Classify a file header as binary or as a kind of text, a longword at a time */
+/* Longwords of four printable ASCII characters - almost all of a text file - are */
+/* passed with two mask tests: bit 7 set in no byte, and no byte below 0x20, which */
+/* (w - 0x20202020) & ~w borrows into bit 7 of. Any other longword, and the bytes */
+/* before the first longword boundary and after the last, go through ScanTextByte(). */
+/* A UTF-8 sequence cut off by the end of the header still counts as UTF-8 */
+UBYTE CoreClassifyText(UBYTE *buffer, ULONG length)
+{
+    struct TextScan scan;
+    UBYTE *p = buffer;
+    ULONG left = length;
+    CoreLong word;
+    LONG i;
+
+    memset(&scan, 0, sizeof(scan));
+
+    while (left > 0 && ((CoreAddress)p & 3) != 0) {
+        if (!ScanTextByte(&scan, *p++)) {
+            return CORE_TEXT_BINARY;
+        }
+        left--;
+    }
+
+    for (; left >= 4; p += 4, left -= 4) {
+        word = *(CoreLong *)p;
+        if (scan.ts_Pending == 0 &&
+            (word & TEXT_HIGH_BITS) == 0 &&
+            ((word - TEXT_SPACES) & ~word & TEXT_HIGH_BITS) == 0) {
+            /* A CR just before ended its line without an LF */
+            if (scan.ts_LastCR) {
+                scan.ts_Bare++;
+                scan.ts_LastCR = FALSE;
+            }
+            continue;
+        }
+        for (i = 0; i < 4; i++) {
+            if (!ScanTextByte(&scan, p[i])) {
+                return CORE_TEXT_BINARY;
+            }
+        }
+    }
+
+    while (left > 0) {
+        if (!ScanTextByte(&scan, *p++)) {
+            return CORE_TEXT_BINARY;
+        }
+        left--;
+    }
+
+    return TextScanResult(&scan, length);
+}
+
+/* Classify a file header a byte at a time - the reference for CoreClassifyText() */
+UBYTE CoreClassifyTextBytes(UBYTE *buffer, ULONG length)
+{
+    struct TextScan scan;
+    ULONG i;
+
+    memset(&scan, 0, sizeof(scan));
+
+    for (i = 0; i < length; i++) {
+        if (!ScanTextByte(&scan, buffer[i])) {
+            return CORE_TEXT_BINARY;
+        }
+    }
+
+    return TextScanResult(&scan, length);
+}
+
+/* Type identifier for a text class, NULL for binary */
+STRPTR CoreTextType(UBYTE text)
+{
+    UBYTE textClass = text & CORE_TEXT_CLASS;
+
+    if (textClass == CORE_TEXT_BINARY || textClass > CORE_TEXT_UTF8) {
+        return NULL;
+    }
+    return textTypes[textClass][(text & CORE_TEXT_CRLF) ? 1 : 0];
+}
+
+/* The plain text type a text subtype falls back to, NULL if it is not a subtype */
+STRPTR CoreTextParent(STRPTR type)
+{
+    LONG i;
+
+    for (i = CORE_TEXT_ASCII; i <= CORE_TEXT_UTF8; i++) {
+        if ((i != CORE_TEXT_ASCII && CoreStricmp(type, textTypes[i][0]) == 0) ||
+            CoreStricmp(type, textTypes[i][1]) == 0) {
+            return textTypes[CORE_TEXT_ASCII][0];
+        }
+    }
+
+    return NULL;
+}
+
+/* Histogram bucket for a latency; the last bucket takes everything slower */
+LONG CoreBucket(ULONG micros, LONG buckets)
+{
+    LONG bucket;
+
+    for (bucket = 0; bucket < buckets - 1 && micros >= (CORE_BUCKET_BASE << bucket); bucket++) {
+    }
+
+    return bucket;
+}
+
+/* Latency below which the given percentage of samples fall, as a bucket upper bound */
+ULONG CorePercentile(ULONG *counts, LONG buckets, LONG percent)
+{
+    ULONG total = 0;
+    ULONG wanted;
+    ULONG seen = 0;
+    LONG bucket;
+
+    for (bucket = 0; bucket < buckets; bucket++) {
+        total += counts[bucket];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    wanted = (total * percent + 99) / 100;
+    for (bucket = 0; bucket < buckets - 1; bucket++) {
+        seen += counts[bucket];
+        if (seen >= wanted) {
+            break;
+        }
+    }
+
+    return CORE_BUCKET_BASE << bucket;
+}
+
+/* Fold one sample into a moving average weighted 3:1 towards the past */
+ULONG CoreMovingMean(ULONG mean, ULONG samples, ULONG value)
+{
+    if (samples == 0) {
+        return value;
+    }
+    return (mean * 3 + value) / 4;
+}
+
+/* Identification policy for a volume with the given mean latency */
+/* A few samples are needed first, so one slow spin-up does not make a volume slow */
+UBYTE CoreVolumePolicy(ULONG meanMillis, ULONG samples, UBYTE override)
+{
+    if (override != POLICY_AUTO) {
+        return override;
+    }
+    if (samples < VOLUME_MIN_SAMPLES || meanMillis < VOLUME_NAME_MILLIS) {
+        return POLICY_SNIFF;
+    }
+    if (meanMillis < VOLUME_CACHE_MILLIS) {
+        return POLICY_NAME;
+    }
+    return POLICY_CACHE;
+}
@@ -0,0 +1,84 @@
+/*
+ * pxcore.h - platform-neutral ProjectX logic
+ *
+ * Copyright (c) 2025 amigazen project
+ * Licensed under BSD 2-Clause License
+ *
+ * Everything in pxcore.c is plain C on top of exec/types.h and string.h,
+ * and stdint.h when built off the Amiga:
+ * no library calls, no locks, no messages. The program linking the core
+ * provides CoreAlloc() and CoreFree(), so the same code can be built and
+ * exercised on any host that supplies those two hooks.
+ */
+
+#ifndef PXCORE_H
+#define PXCORE_H
+
+#include <exec/types.h>
+
+/* Latency histograms - bucket n counts latencies below CORE_BUCKET_BASE << n us */
+#define CORE_BUCKET_BASE 256UL
+
+/* Per-volume identification policies */
+#define POLICY_AUTO  0                      /* No override - follow the measured latency */
+#define POLICY_SNIFF 1                      /* Always identify from the contents */
+#define POLICY_NAME  2                      /* Guess from a known suffix, else identify */
+#define POLICY_CACHE 3                      /* Only the prefetch cache and name guesses */
+
+#define VOLUME_NAME_MILLIS    150           /* Slower than this - trust a known suffix */
+#define VOLUME_CACHE_MILLIS   1000          /* Slower than this - only known suffixes are not read */
+#define VOLUME_MIN_SAMPLES    4             /* Identifications timed before leaving SNIFF */
+
+/* Name guesses are reordered by hits after this many guesses */
+#define CORE_REORDER_INTERVAL 32
+
+/* Text classes reported by CoreClassifyText() */
+#define CORE_TEXT_BINARY 0                  /* Control characters other than layout ones */
+#define CORE_TEXT_ASCII  1
+#define CORE_TEXT_LATIN1 2                  /* 8-bit characters that are not valid UTF-8 */
+#define CORE_TEXT_UTF8   3
+#define CORE_TEXT_CLASS  0x0F
+#define CORE_TEXT_CRLF   0x10               /* Flag - every line ends in CR LF */
+
+/* Suffix trie node, keyed by the lower case name read backwards */
+struct CoreSuffix {
+    struct CoreSuffix *cs_Sibling;
+    struct CoreSuffix *cs_Child;
+    APTR cs_Payload;                        /* Caller's data for the suffix ending here */
+    UWORD cs_Order;                         /* Lower wins when several suffixes match */
+    UBYTE cs_Char;
+};
+
+/* Platform hooks - cleared memory, and its release */
+APTR CoreAlloc(ULONG size);
+VOID CoreFree(APTR memory);
+
+/* Case folding and comparison, ASCII and Latin-1 */
+UBYTE CoreLower(UBYTE c);
+LONG CoreStricmp(STRPTR a, STRPTR b);
+
+/* Suffix trie */
+BOOL CoreAddSuffix(struct CoreSuffix **root, STRPTR pattern, APTR payload, UWORD order);
+APTR CoreMatchSuffix(struct CoreSuffix *root, STRPTR name, UWORD *order);
+VOID CoreFreeSuffixes(struct CoreSuffix *root);
+
+/* Name-only type guesses, tried most guessed suffix first */
+STRPTR CoreGuessType(STRPTR fileName);
+VOID CoreReorderGuesses(VOID);
+VOID CoreAddGuessHits(STRPTR type, ULONG hits);
+VOID CoreResetGuesses(BOOL adaptive);
+VOID CoreGuessCost(ULONG *calls, ULONG *rules);
+
+/* Text classification of a file header, a longword at a time or a byte at a time */
+UBYTE CoreClassifyText(UBYTE *buffer, ULONG length);
+UBYTE CoreClassifyTextBytes(UBYTE *buffer, ULONG length);
+STRPTR CoreTextType(UBYTE text);
+STRPTR CoreTextParent(STRPTR type);
+
+/* Latency histograms and volume policy */
+LONG CoreBucket(ULONG micros, LONG buckets);
+ULONG CorePercentile(ULONG *counts, LONG buckets, LONG percent);
+ULONG CoreMovingMean(ULONG mean, ULONG samples, ULONG value);
+UBYTE CoreVolumePolicy(ULONG meanMillis, ULONG samples, UBYTE override);
+
+#endif /* PXCORE_H */